@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include <cJSON.h>
+
+#include "camera.h"
+#include "world.h"
+#include "math/vector3.h"
+#include "types/base_types.h"
+
+#define ANIMATION_DEFAULT_FRAME_RATE 24.0f
+
+typedef enum AnimationTarget {
+  ANIMATION_TARGET_CAMERA_POSITION,
+  ANIMATION_TARGET_FOCAL_LENGTH,
+  ANIMATION_TARGET_HITTABLE_POSITION
+} AnimationTarget;
+
+// focal length keyframes only use value.x
+typedef struct AnimationKeyframe {
+  f32 time;
+  Vector3 value;
+} AnimationKeyframe;
+
+typedef struct AnimationTrack {
+  AnimationTarget target;
+  u32 hittable_index;
+
+  AnimationKeyframe* keyframes;
+  u32 keyframes_count;
+} AnimationTrack;
+
+typedef struct Animation {
+  AnimationTrack* tracks;
+  u32 tracks_count;
+
+  f32 frame_rate;
+  f32 duration;
+} Animation;
+
+// the tracks live in an optional "animation" object of the .scene file next to the camera and hittables, the world
+// loader parses it once the hittables the tracks point at exist and keeps it on the world
+bool animation_json_parse(Animation* animation, World* world, cJSON* animation_json);
+cJSON* animation_json_create(Animation* animation);
+u32 animation_frame_count(Animation* animation);
+
+// linearly interpolates every track at the time and holds the first and last keyframes outside of them,
+// returns how many hittables moved
+u32 animation_apply(Animation* animation, World* world, Camera* camera, f32 time);
+
+// drops the tracks of a removed hittable and moves the ones after it down an index
+void animation_remove_hittable(Animation* animation, u32 index);
+
+void animation_destroy(Animation* animation);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types/base_types.h"
+
+// what a job falls back to for every setting its entry leaves out
+typedef struct BatchDefaults {
+  u32 width, height;
+  u32 samples;
+  u32 threads; // 0 keeps the camera's default
+} BatchDefaults;
+
+typedef struct BatchSummary {
+  u32 jobs_count;
+  u32 failed_count;
+  f64 total_time;
+} BatchSummary;
+
+// a job file is a JSON object with a "jobs" array, each job names a "scene" and an "output" and may set
+// "width", "height", "samples", "seed" and a "camera" object with "position" and "focal_length"
+//
+// jobs run one after another on one camera, the worker pool and the decoded textures are kept between them,
+// a job that fails is reported and skipped, only a job file that cannot be read fails the batch
+bool batch_render(const char* jobs_path, BatchDefaults* defaults, BatchSummary* summary);
@@ -1,40 +1,49 @@
 #pragma once
 
 #include <stdbool.h>
-#include <pthread.h>
 
+#include "render_stats.h"
 #include "tonemapping.h"
 #include "world.h"
+#include "world_snapshot.h"
 #include "types/base_types.h"
 #include "math/vector3.h"
 #include "viewport.h"
+#include "thread_pool.h"
 #include "types/color.h"
 
 #define DEFAULT_SAMPLE_LIMIT 1000
+#define DEFAULT_SEED 0
+#define DEFAULT_FOCAL_LENGTH 1.0f
 
-#define MAX_THREAD_COUNT 16
-#define DEFAULT_THREAD_COUNT 16
+#define CAMERA_PREVIEW_START_SCALE 8
+
+#define DEFAULT_TIME_BUDGET 60.0
+#define DEFAULT_TARGET_NOISE 0.01f
+
+// the noise estimate needs a few samples in both halves before it means anything
+#define CAMERA_NOISE_MIN_SAMPLES 8
+#define CAMERA_NOISE_ESTIMATE_INTERVAL 8
+#define CAMERA_NOISE_UNKNOWN -1.0f
 
-typedef struct CameraRenderWorkerData {
-  bool alive;
-  bool export_mode;
-  bool work_ready;
-  bool work_done;
-  pthread_mutex_t lock;
-  pthread_cond_t cond;
+// exports render this many samples between termination checks, the framebuffer is consistent after each chunk
+#define CAMERA_EXPORT_CHUNK_SAMPLES 4
 
-  struct Camera* camera;
-  World* world;
-  u64 state;
+// a render never has more slices than the pool can have threads, by default one per pool thread but at least
+// DEFAULT_THREAD_COUNT, so slices of uneven cost still balance out on few cores
+#define MAX_THREAD_COUNT THREAD_POOL_MAX_THREADS
+#define DEFAULT_THREAD_COUNT 16
 
-  usize start_x, end_x;
-  usize start_y, end_y;
-} CameraRenderWorkerData;
+struct Checkpoint;
+struct SnapshotWriter;
+struct SceneStream;
 
-typedef struct CameraRenderWorker {
-  pthread_t thread;
-  CameraRenderWorkerData thread_data;
-} CameraRenderWorker;
+// sample_limit always caps the render, the other modes can stop it earlier
+typedef enum CameraTermination {
+  CAMERA_TERMINATION_SAMPLES,
+  CAMERA_TERMINATION_TIME,
+  CAMERA_TERMINATION_NOISE
+} CameraTermination;
 
 typedef struct Camera {
   Vector3 position;
@@ -46,22 +55,60 @@ typedef struct Camera {
   u32 width, height;
   u32 sample_count;
   u32 sample_limit;
+  u32 seed;
+
+  // framebuffer_even only accumulates the even samples, comparing both halves gives the noise estimate
+  Color* framebuffer_even;
+  f32 noise_estimate; // relative rms error of the current average, CAMERA_NOISE_UNKNOWN until estimated
+
+  CameraTermination termination;
+  f64 time_budget; // seconds
+  f32 target_noise;
+  f64 render_time; // seconds spent rendering the current accumulation
 
   ToneMappingOperator tonemapping_operator;
 
   bool render;
 
-  CameraRenderWorker render_workers[MAX_THREAD_COUNT];
+  // after an invalidation the image is first rendered at 1/8, 1/4 and 1/2 resolution before
+  // accumulating at full resolution, preview_scale is the next pass (1 = replace the preview, 0 = done)
+  bool progressive_preview;
+  u32 preview_scale;
+
+  f64 invalidated_time;
+  f64 time_to_first_image;
+  bool first_image_pending;
+
+  // the frame is split into thread_count row slices that run as jobs on a shared pool, so changing
+  // either the thread count or the resolution never touches the threads themselves
+  ThreadPool* thread_pool;
   u32 thread_count;
+
+  // accumulated over every render call until camera_reset_stats, each slice only ever writes its own entry
+  RenderStats slice_stats[MAX_THREAD_COUNT];
+
+  // when set, render jobs use the latest published snapshot instead of the world they were given
+  WorldSnapshotQueue* world_snapshots;
+
+  // when set, exports copy the accumulation into it every checkpoint interval and once they finish
+  struct Checkpoint* checkpoint;
+  // when set, exports copy the accumulation into it whenever a snapshot is due
+  struct SnapshotWriter* snapshot_writer;
+  // when set, exports add the scene's hittables as they load and restart whenever more arrived
+  struct SceneStream* scene_stream;
 } Camera;
 
-Camera* camera_create(u32 width, u32 height, World* world);
-void camera_render_workers_create(Camera* camera, World* world);
+Camera* camera_create(u32 width, u32 height);
 void camera_clear_framebuffer(Camera* camera);
+void camera_invalidate(Camera* camera);
 void camera_change_resolution(Camera* camera, u32 new_width, u32 new_height);
 void camera_render_frame(Camera* camera, World* world);
 void camera_render_export(Camera* camera, World* world);
-void camera_render_worker_render(CameraRenderWorker* worker);
-void camera_render_worker_wait(CameraRenderWorker* worker);
-void camera_render_workers_destroy(Camera* camera);
+// continues an export from whatever the framebuffer holds, e.g. a restored checkpoint
+void camera_render_export_continue(Camera* camera, World* world);
+void camera_render_samples(Camera* camera, World* world, u32 first_sample, u32 sample_count);
+f32 camera_estimate_noise(Camera* camera);
+bool camera_is_finished(Camera* camera);
+RenderStats camera_get_stats(Camera* camera);
+void camera_reset_stats(Camera* camera);
 void camera_destroy(Camera* camera);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "camera.h"
+#include "types/base_types.h"
+#include "types/color.h"
+
+#define CHECKPOINT_MAGIC "PTCK"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_SLOTS 2
+
+#define DEFAULT_CHECKPOINT_INTERVAL 60.0
+
+// the file starts with this header, the random numbers only depend on the pixel, sample index and seed,
+// so the sample count and seed are the whole sampler position
+typedef struct CheckpointHeader {
+  char magic[4];
+  u32 version;
+
+  u32 width, height;
+  u32 seed;
+  u32 padding;
+  u64 scene_hash;
+
+  u64 slot_size;
+  u64 slot_offsets[CHECKPOINT_SLOTS];
+} CheckpointHeader;
+
+// a slot is this header followed by copies of framebuffer and framebuffer_even, the header is only written
+// once the copies are on disk and its checksum covers it, so a slot is complete exactly when the checksum
+// matches, the slots take turns so the last complete one survives a crash during the next write
+typedef struct CheckpointSlotHeader {
+  u64 generation; // 0 while the slot was never completed
+  u32 sample_count;
+  f32 noise_estimate;
+  f64 render_time;
+  u32 crc;
+  u32 padding;
+} CheckpointSlotHeader;
+
+// exports copy into the slot that is not the newest complete one while they render, a writer thread then
+// flushes it and commits its header so the render never waits on the disk
+typedef struct Checkpoint {
+  const char* path;
+  s32 file_descriptor;
+  u8* data;
+  usize size;
+  CheckpointHeader* header;
+
+  f64 interval; // seconds between checkpoints
+  f64 last_time;
+
+  pthread_t writer;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  bool alive;
+
+  // the slot being written and its header once committed, only read by the writer while pending is set
+  bool pending;
+  u32 writing_slot;
+  CheckpointSlotHeader writing_header;
+
+  u32 newest_slot;
+  u64 generation;
+  u32 written_count;
+  f64 write_time; // seconds the writer spent flushing, summed over every checkpoint
+  bool failed;
+} Checkpoint;
+
+// a hash of the scene file's bytes, a checkpoint only resumes the scene it was written for
+u64 checkpoint_scene_hash(const char* scene_path);
+
+// creates the file for the camera's resolution, with resume it instead has to match the camera, seed and
+// scene and its newest complete slot is restored into the camera
+Checkpoint* checkpoint_open(const char* path, Camera* camera, u64 scene_hash, f64 interval, bool resume);
+
+// true once the interval passed and the previous checkpoint is committed, the render then copies its
+// rows into the returned buffers and calls checkpoint_commit once they are all copied
+bool checkpoint_begin(Checkpoint* checkpoint, Color** framebuffer, Color** framebuffer_even);
+void checkpoint_commit(Checkpoint* checkpoint, Camera* camera);
+
+// copies and commits the current state right away, e.g. when the render finished, and waits for it
+bool checkpoint_write(Checkpoint* checkpoint, Camera* camera);
+
+// waits for the writer, so every commit is on disk once this returns
+void checkpoint_close(Checkpoint* checkpoint);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "camera.h"
+#include "world.h"
+#include "types/base_types.h"
+
+#define DISTRIBUTED_MAX_WORKERS 64
+
+// sent from the coordinator to a worker process
+typedef struct DistributedJob {
+  u32 first_sample;
+  u32 sample_count;
+} DistributedJob;
+
+// sent back from a worker process, followed by width * height colors holding the
+// sum of every sample in the job
+typedef struct DistributedResult {
+  u32 first_sample;
+  u32 sample_count;
+  u32 width, height;
+  f64 render_time;
+} DistributedResult;
+
+// forks the workers, so only the headless cli uses it, never a process with gl or windowing threads,
+// on failure the framebuffer is left cleared
+bool distributed_render(Camera* camera, World* world, u32 worker_count, u32 threads_per_worker);
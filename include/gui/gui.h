@@ -8,12 +8,17 @@
 #include "types/color.h"
 #include "camera.h"
 #include "image.h"
+#include "render_stats.h"
+#include "scene_stream.h"
 
 // these can probably be replaced by some a macro
 #define MATERIAL_TYPES_STRING "Diffuse\0Metal\0Glass\0Emissive\0"
 #define TONEMAPPING_OPERATORS_STRING "Clamp\0Reinhard\0"
-#define IMAGE_TYPES_STRING "HDR\0JPG\0"
+#define IMAGE_TYPES_STRING "HDR\0JPG\0PNG\0EXR\0"
 #define HITTABLE_TYPES_STRING "Sphere\0Plane\0"
+#define TERMINATION_MODES_STRING "Samples\0Time\0Noise\0"
+
+#define GUI_STATS_INTERVAL 0.5
 
 typedef struct GUI {
   Window* window;
@@ -26,8 +31,20 @@ typedef struct GUI {
   bool show_export_warning_window;
 
   ImageType export_image_type;
+  ImageOptions export_image_options;
 
   HittableType add_type;
+
+  // the camera counters only ever grow, rates are taken from the difference every GUI_STATS_INTERVAL seconds
+  RenderStats stats_previous;
+  RenderStats stats_rate;
+  f64 stats_time;
+
+  // last texture_image_decode_generation seen, a change means placeholders were replaced by decoded images
+  u32 texture_decode_generation;
+
+  // the scene being loaded, its chunks are added to the world every update until it is done
+  SceneStream* scene_stream;
 } GUI;
 
 GUI gui_create(u32 width, u32 height);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "textures/image.h"
+#include "textures/solid_color.h"
+
+bool texture_solid_color_gui_edit(TextureSolidColor* solid_color);
+bool texture_image_gui_edit(TextureImage** image);
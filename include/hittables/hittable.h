@@ -4,6 +4,7 @@
 #include "materials/material.h"
 #include "types/rayhit.h"
 #include "math/ray.h"
+#include "types/base_types.h"
 
 #define HITTABLE_IDENTIFER_MAX_LENGTH 16
 
@@ -19,6 +20,11 @@ typedef struct Hittable {
   Vector3* position;
   Material* material;
 
+  // 0 until a world snapshot copied the hittable, whoever edits it resets it to 0 so the next snapshot copies it
+  // again instead of sharing the copy that is still unchanged
+  u64 snapshot_revision;
+
   RayHit (*hit)(struct Hittable* hittable, Ray ray);
+  struct Hittable* (*clone)(struct Hittable* hittable);
   void (*destroy)(struct Hittable* hittable);
 } Hittable;
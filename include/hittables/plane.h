@@ -24,4 +24,5 @@ RayHit hittable_plane_ray_hit(HittablePlane* plane, Ray ray);
 cJSON* hittable_plane_json_create(HittablePlane* plane);
 HittablePlane* hittable_plane_json_parse(cJSON* plane_json);
 
+HittablePlane* hittable_plane_clone(HittablePlane* plane);
 void hittable_plane_destroy(HittablePlane* plane);
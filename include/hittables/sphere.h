@@ -21,4 +21,5 @@ RayHit hittable_sphere_ray_hit(HittableSphere* sphere, Ray ray);
 cJSON* hittable_sphere_json_create(HittableSphere* sphere);
 HittableSphere* hittable_sphere_json_parse(cJSON* sphere_json);
 
+HittableSphere* hittable_sphere_clone(HittableSphere* sphere);
 void hittable_sphere_destroy(HittableSphere* sphere);
@@ -1,11 +1,34 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "camera.h"
 
 typedef enum ImageType {
   HDR,
-  JPG
+  JPG,
+  PNG,
+  EXR
 } ImageType;
 
-void image_create_jpg(const char* filename, Camera* camera);
-void image_create_hdr(const char* filename, Camera* camera);
+// only exr has choices, the other formats always write 8 bit or rgbe color
+typedef struct ImageOptions {
+  bool exr_float; // 32 bit float channels instead of half
+  bool exr_aovs; // adds the average of the even and the odd samples as the "even" and "odd" layers
+} ImageOptions;
+
+ImageOptions image_options_default();
+
+// the format is picked from the extension up front so a long render is never thrown away
+bool image_type_from_path(const char* path, ImageType* type);
+
+// every writer encodes horizontal bands straight from the accumulation buffer on the camera's thread pool
+// and writes them in order, so only a few bands of output are ever held in memory
+bool image_create(const char* filename, ImageType type, Camera* camera, ImageOptions* options);
+bool image_create_jpg(const char* filename, Camera* camera);
+bool image_create_png(const char* filename, Camera* camera);
+bool image_create_hdr(const char* filename, Camera* camera);
+bool image_create_exr(const char* filename, Camera* camera, ImageOptions* options);
+
+bool image_compare_hdr(const char* filename, Camera* camera, f64* rmse);
+bool image_create_metadata(const char* filename, Camera* camera);
@@ -14,10 +14,11 @@ typedef struct MaterialDiffuse {
 } MaterialDiffuse;
 
 MaterialDiffuse* material_diffuse_create(Texture* texture);
-Color material_diffuse_get_color(MaterialDiffuse* diffuse, Vector2 uv_coordinates);
+Color material_diffuse_get_color(MaterialDiffuse* diffuse, Vector2 uv_coordinates, f32 uv_footprint);
 Vector3 material_diffuse_get_direction(MaterialDiffuse* diffuse, RayHit rayhit, u64* state);
 
 cJSON* material_diffuse_json_create(MaterialDiffuse* diffuse);
 MaterialDiffuse* material_diffuse_json_parse(cJSON* diffuse_json);
 
+MaterialDiffuse* material_diffuse_clone(MaterialDiffuse* diffuse);
 void material_diffuse_destroy(MaterialDiffuse* diffuse);
@@ -15,10 +15,11 @@ typedef struct MaterialEmissive {
 } MaterialEmissive;
 
 MaterialEmissive* material_emissive_create(Texture* albedo, f32 emission_strength);
-Color material_emissive_get_color(MaterialEmissive* emissive, Vector2 uv_coordinates);
+Color material_emissive_get_color(MaterialEmissive* emissive, Vector2 uv_coordinates, f32 uv_footprint);
 Vector3 material_emissive_get_direction(MaterialEmissive* diffuse, RayHit rayhit, u64* state);
 
 cJSON* material_emissive_json_create(MaterialEmissive* emissive);
 MaterialEmissive* material_emissive_json_parse(cJSON* emissive_json);
 
+MaterialEmissive* material_emissive_clone(MaterialEmissive* emissive);
 void material_emissive_destroy(MaterialEmissive* diffuse);
@@ -16,10 +16,11 @@ typedef struct MaterialGlass {
 } MaterialGlass;
 
 MaterialGlass* material_glass_create(Texture* albedo, f32 refraction_index, f32 roughness);
-Color material_glass_get_color(MaterialGlass* glass, Vector2 uv_coordinates);
+Color material_glass_get_color(MaterialGlass* glass, Vector2 uv_coordinates, f32 uv_footprint);
 Vector3 material_glass_get_direction(MaterialGlass* glass, RayHit rayhit, u64* state);
 
 cJSON* material_glass_json_create(MaterialGlass* glass);
 MaterialGlass* material_glass_json_parse(cJSON* glass_json);
 
+MaterialGlass* material_glass_clone(MaterialGlass* glass);
 void material_glass_destroy(MaterialGlass* glass);
@@ -17,7 +17,8 @@ struct RayHit;
 typedef struct Material {
   MaterialType type;
 
-  Color (*get_color)(struct Material* material, Vector2 uv_coordinates);
+  Color (*get_color)(struct Material* material, Vector2 uv_coordinates, f32 uv_footprint); // uv_footprint is the width the lookup covers in uv units
   Vector3 (*get_direction)(struct Material* material, struct RayHit rayhit, u64* state); // the return vector will be normalized
+  struct Material* (*clone)(struct Material* material);
   void (*destroy)(struct Material* material);
 } Material;
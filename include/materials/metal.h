@@ -15,10 +15,11 @@ typedef struct Metal {
 } Metal;
 
 Metal* material_metal_create(Texture* albedo, f32 roughness);
-Color material_metal_get_color(Metal* metal, Vector2 uv_coordinates);
+Color material_metal_get_color(Metal* metal, Vector2 uv_coordinates, f32 uv_footprint);
 Vector3 material_metal_get_direction(Metal* metal, RayHit rayhit, u64* state);
 
 cJSON* material_metal_json_create(Metal* metal);
 Metal* material_metal_json_parse(cJSON* metal_json);
 
+Metal* material_metal_clone(Metal* metal);
 void material_metal_destroy(Metal* metal);
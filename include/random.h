@@ -4,6 +4,8 @@
 #include "math/vector3.h"
 #include "hittables/hittable.h"
 
+u64 random_state_create(u32 pixel_index, u32 sample_index, u32 dimension, u32 seed);
+
 u32 pcg32(u64* state);
 f32 random_f32(u64* state);
 f32 random_f32_range(u64* state, f32 min, f32 max);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "hittables/hittable.h"
+#include "types/base_types.h"
+
+#define RENDER_STATS_HITTABLE_TYPE_COUNT (HITTABLE_TYPE_PLANE + 1)
+
+// per ray counters are only compiled in with PATH_TRACER_RENDER_STATS, the stage times are taken once per job and always kept
+#ifdef PATH_TRACER_RENDER_STATS
+#define RENDER_STATS_ENABLED true
+#define RENDER_STATS_ADD(stats, counter, value) ((stats)->counter += (value))
+#else
+#define RENDER_STATS_ENABLED false
+#define RENDER_STATS_ADD(stats, counter, value) ((void) 0)
+#endif
+
+typedef enum RenderStage {
+  RENDER_STAGE_SNAPSHOT,
+  RENDER_STAGE_PREVIEW,
+  RENDER_STAGE_SAMPLE,
+  RENDER_STAGE_EXPORT_COPY, // copying the accumulation for checkpoints and snapshots
+  RENDER_STAGE_COUNT
+} RenderStage;
+
+// filled by one render worker on its own stack and added to its slice afterwards, so nothing is shared while tracing
+typedef struct RenderStats {
+  u64 primary_rays;
+  u64 secondary_rays;
+  u64 intersection_tests[RENDER_STATS_HITTABLE_TYPE_COUNT];
+  u64 bounces;
+  u64 escaped_rays;
+  u64 material_evaluations;
+
+  f64 stage_time[RENDER_STAGE_COUNT];
+} RenderStats;
+
+void render_stats_add(RenderStats* total, RenderStats* stats);
+f64 render_stats_busy_time(RenderStats* stats);
+const char* render_stats_stage_name(RenderStage stage);
+void render_stats_print(RenderStats* stats, f64 wall_time);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "camera.h"
+#include "world.h"
+#include "types/base_types.h"
+
+#define SCENE_BINARY_MAGIC "PTSB"
+#define SCENE_BINARY_VERSION 1
+#define SCENE_BINARY_EXTENSION ".bscene"
+
+// a binary scene is this header followed by flat hittable, material and texture tables and a string table,
+// every table starts 8 byte aligned and every index refers into the next table, image paths are nul terminated
+typedef struct SceneBinaryHeader {
+  char magic[4];
+  u32 version;
+
+  f32 camera_position[3];
+  u32 seed;
+
+  u32 hittables_count;
+  u32 materials_count;
+  u32 textures_count;
+  u32 strings_size;
+
+  u64 hittables_offset;
+  u64 materials_offset;
+  u64 textures_offset;
+  u64 strings_offset;
+} SceneBinaryHeader;
+
+// spheres only use the radius, planes only the normal and size
+typedef struct SceneBinaryHittable {
+  u32 type;
+  u32 material;
+  f32 position[3];
+  f32 radius;
+  f32 normal[3];
+  f32 size[2];
+} SceneBinaryHittable;
+
+// only the parameters of the material's type are meaningful
+typedef struct SceneBinaryMaterial {
+  u32 type;
+  u32 texture;
+  f32 roughness;
+  f32 refraction_index;
+  f32 emission_strength;
+} SceneBinaryMaterial;
+
+typedef struct SceneBinaryTexture {
+  u32 type;
+  f32 color[3];
+  u32 path_offset;
+} SceneBinaryTexture;
+
+bool scene_binary_is_binary_path(const char* filename);
+
+bool scene_binary_save(World* world, Camera* camera, const char* filename);
+bool scene_binary_load(World* world, Camera* camera, const char* filename);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "camera.h"
+#include "world.h"
+#include "types/base_types.h"
+
+#define SCENE_GENERATOR_CLUSTER_SIZE 64
+#define SCENE_GENERATOR_NESTING_DEPTH 4
+
+typedef enum SceneGeneratorDistribution {
+  SCENE_GENERATOR_DISTRIBUTION_UNIFORM,
+  SCENE_GENERATOR_DISTRIBUTION_CLUSTERED,
+  SCENE_GENERATOR_DISTRIBUTION_NESTED_GLASS
+} SceneGeneratorDistribution;
+
+typedef struct SceneGeneratorOptions {
+  u32 sphere_count;
+  u32 plane_count;
+  SceneGeneratorDistribution distribution;
+
+  // relative weights of diffuse, metal and glass, emissive_fraction of the objects are emissive on top of that
+  f32 material_weights[3];
+  f32 emissive_fraction;
+
+  // texture_fraction of the objects use the image at texture_path instead of a solid color, sharing one decode
+  const char* texture_path;
+  f32 texture_fraction;
+
+  u32 seed;
+} SceneGeneratorOptions;
+
+// procedural scenes whose cost scales with the object count, used to benchmark and stress the renderer
+bool scene_generator_spheres(World* world, Camera* camera, u32 sphere_count, u32 seed);
+
+SceneGeneratorOptions scene_generator_options_default();
+bool scene_generator_generate(World* world, Camera* camera, SceneGeneratorOptions* options);
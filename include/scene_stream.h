@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "camera.h"
+#include "world.h"
+#include "hittables/hittable.h"
+#include "math/vector3.h"
+#include "types/base_types.h"
+
+// the first chunk is small so something shows up right away, every later one doubles, so a huge scene is handed
+// over in a logarithmic number of chunks and the accumulation is only restarted that often
+#define SCENE_STREAM_FIRST_CHUNK 256
+
+typedef struct SceneStreamOptions {
+  // prints a line whenever a chunk is added to the world
+  bool print_progress;
+
+  // hittables in the first chunk, SCENE_STREAM_FIRST_CHUNK by default
+  u32 first_chunk;
+  // the loader waits for every chunk to be polled before it parses on, so each one reaches the world on its own
+  bool throttle;
+} SceneStreamOptions;
+
+typedef struct SceneStreamProgress {
+  usize bytes_parsed;
+  usize bytes_total;
+  u32 hittables_parsed;
+  u32 hittables_added;
+  u32 chunks_added;
+  bool done;
+  bool failed;
+
+  f64 first_chunk_time; // seconds from the start until the first chunk was added, 0 until then
+  f64 load_time; // seconds until the whole scene was parsed and its textures decoded, 0 until then
+} SceneStreamProgress;
+
+// a loader thread parses the scene and hands its hittables over in chunks, the thread owning the world takes them
+// whenever it polls, so the world is never touched while a render reads it, json scenes are parsed one hittable
+// at a time, binary scenes are read in one piece since their tables need no parsing
+typedef struct SceneStream {
+  const char* path;
+  SceneStreamOptions options;
+  f64 start_time;
+
+  pthread_t loader;
+  pthread_mutex_t lock;
+  pthread_cond_t chunk_cond;
+  atomic_bool cancelled;
+
+  // guarded by the lock, filled by the loader and emptied by polling, events counts every change a poll can see
+  u32 events;
+  Hittable** pending;
+  u32 pending_count, pending_capacity;
+  bool camera_ready;
+  Vector3 camera_position;
+  u32 camera_seed;
+
+  SceneStreamProgress progress;
+
+  // only touched by the polling thread
+  bool camera_applied;
+  u32 events_seen;
+  u32 texture_decode_generation;
+} SceneStream;
+
+SceneStreamOptions scene_stream_options_default();
+
+// starts loading right away, the world should be empty and is filled by polling
+SceneStream* scene_stream_start(const char* path, SceneStreamOptions* options);
+
+// adds every hittable loaded since the last poll to the world and applies the scene's camera once it was read,
+// true when anything the image depends on changed, including image textures that finished decoding
+bool scene_stream_poll(SceneStream* stream, World* world, Camera* camera);
+// false once the scene was parsed and its textures decoded, or loading failed
+bool scene_stream_is_loading(SceneStream* stream);
+// blocks until there is something new to poll or loading stopped
+void scene_stream_wait(SceneStream* stream);
+// blocks until the scene's camera was read, for json scenes that put it behind the hittables that is the whole load
+void scene_stream_wait_camera(SceneStream* stream, Camera* camera);
+
+SceneStreamProgress scene_stream_get_progress(SceneStream* stream);
+
+// stops the loader, hittables it loaded that were never polled are destroyed
+void scene_stream_destroy(SceneStream* stream);
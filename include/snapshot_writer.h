@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "camera.h"
+#include "image.h"
+#include "thread_pool.h"
+#include "types/base_types.h"
+#include "types/color.h"
+
+#define SNAPSHOT_MAX_OUTPUTS 4
+#define DEFAULT_SNAPSHOT_INTERVAL 10.0
+
+typedef struct SnapshotOutput {
+  const char* path;
+  ImageType type;
+} SnapshotOutput;
+
+// a snapshot is due after either interval, 0 turns that interval off
+typedef struct SnapshotOptions {
+  SnapshotOutput outputs[SNAPSHOT_MAX_OUTPUTS];
+  u32 outputs_count;
+  u32 sample_interval;
+  f64 time_interval; // seconds
+  ImageOptions image_options;
+} SnapshotOptions;
+
+// exports copy their accumulation into the writer's buffers while they render, a writer thread then encodes
+// every output from the copy, so neither the render nor its thread pool ever waits on encoding or the disk
+typedef struct SnapshotWriter {
+  SnapshotOptions options;
+
+  // a copy of the render camera whose framebuffers are the snapshot buffers and whose thread pool is the
+  // writer's own, only touched by the writer while pending is set
+  Camera camera;
+  Color* framebuffer;
+  Color* framebuffer_even;
+  ThreadPool* thread_pool;
+
+  pthread_t writer;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  bool alive;
+  bool pending;
+
+  u32 last_sample_count;
+  f64 last_time;
+  f64 due_time; // when the time interval last came due, whether the snapshot was written or skipped
+
+  // the cadence is measured from the first to the last committed snapshot
+  u32 committed_count;
+  u32 first_sample_count;
+  f64 first_time;
+
+  u32 written_count;
+  u32 skipped_count; // due while the previous snapshot was still being written
+  f64 encode_time; // seconds the writer spent encoding and writing, summed over every snapshot
+  bool failed;
+} SnapshotWriter;
+
+SnapshotOptions snapshot_options_default();
+
+SnapshotWriter* snapshot_writer_create(Camera* camera, SnapshotOptions* options);
+
+// the number of samples the next export chunk may render so a sample interval ends exactly on it
+u32 snapshot_writer_clamp_chunk(SnapshotWriter* writer, u32 sample_count, u32 chunk);
+
+// true when a snapshot is due once the chunk ending at end_sample_count is rendered and the previous one is
+// written, the render then copies its rows into the returned buffers and calls snapshot_writer_commit
+bool snapshot_writer_begin(SnapshotWriter* writer, u32 end_sample_count, Color** framebuffer, Color** framebuffer_even);
+void snapshot_writer_commit(SnapshotWriter* writer, Camera* camera);
+
+void snapshot_writer_print_stats(SnapshotWriter* writer);
+
+// waits for the snapshot being written
+void snapshot_writer_destroy(SnapshotWriter* writer);
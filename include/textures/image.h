@@ -1,33 +1,117 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdatomic.h>
 
 #include <cJSON.h>
 
 #include "textures/texture.h"
 #include "types/color.h"
 #include "types/base_types.h"
-#include "gui/texture.h"
 
 #define TEXTURE_IMAGE_INVALID_PATH "../assets/invalid.png"
+#define TEXTURE_IMAGE_PLACEHOLDER_COLOR (Color) { 0.5f, 0.5f, 0.5f }
+
+#define TEXTURE_IMAGE_TILE_SHIFT 3
+#define TEXTURE_IMAGE_TILE_SIZE (1 << TEXTURE_IMAGE_TILE_SHIFT)
+#define TEXTURE_IMAGE_MAX_LEVELS 32
+
+// ldr files keep their 8 bit srgb values and hdr files are stored as half floats, both are turned into linear
+// floats texel by texel during a lookup, the fourth channel only pads a texel to a power of two size
+typedef enum TextureImageFormat {
+  TEXTURE_IMAGE_FORMAT_SRGB8,
+  TEXTURE_IMAGE_FORMAT_HALF
+} TextureImageFormat;
+
+typedef enum TextureImageState {
+  TEXTURE_IMAGE_STATE_PENDING,
+  TEXTURE_IMAGE_STATE_READY,
+  TEXTURE_IMAGE_STATE_FAILED
+} TextureImageState;
+
+// texels are stored in square tiles of TEXTURE_IMAGE_TILE_SIZE, each tile contiguous and the tiles in row order,
+// so the four texels of a bilinear lookup almost always share a cache line or two
+typedef struct TextureImageLevel {
+  u32 width, height;
+  u32 tiles_x;
+  u8* texels;
+} TextureImageLevel;
 
 typedef struct TextureImage {
   Texture texture;
 
+  // image textures are shared rather than copied when a material is cloned
+  atomic_uint reference_count;
+
   const char* path_to_image;
-  Color* pixels;
+
+  // the pixels, size, levels and owner are only valid once the state is ready, until then lookups return the
+  // placeholder color
+  atomic_uint state;
   u32 width, height;
 
-  GLTexture gl_texture;
+  // one allocation holding the whole mip pyramid, every level is half the size of the previous one down to 1x1
+  TextureImageFormat format;
+  u8* pixels;
+  usize pixels_size;
+  TextureImageLevel levels[TEXTURE_IMAGE_MAX_LEVELS];
+  u32 levels_count;
+
+  // set when another path decoded to the same file contents, the pixels are borrowed from it and it holds a reference
+  struct TextureImage* pixels_owner;
+
+  // set when the image is paged from a cache file, then only the coarsest levels that fit into a single page
+  // have texels and the pixels are those pinned levels
+  struct VirtualTexture* virtual_texture;
+
+  // the image's entry in the texture cache, NULL when it is not cached, only touched under the cache lock
+  struct TextureImageCacheEntry* cache_entry;
+
+  // gpu preview owned by the gui, created lazily on the gui thread and 0 until then
+  u32 preview_texture;
+  void (*preview_texture_destroy)(u32 preview_texture);
 } TextureImage;
 
+typedef struct TextureImageCacheStats {
+  u32 decodes;
+  u32 path_hits;
+  u32 content_hits;
+  usize entries;
+
+  usize resident_bytes;
+  usize saved_bytes;
+  f64 decode_time;
+} TextureImageCacheStats;
+
 TextureImage* texture_image_create(const char* path);
-Color texture_image_get(TextureImage* image, Vector2 uv_coordinates);
-void texture_image_change_image(TextureImage* texture, const char* path);
 
-bool texture_image_gui_edit(TextureImage* image);
+// builds the tiled mip pyramid from rows of 8 bit srgb rgba for TEXTURE_IMAGE_FORMAT_SRGB8 or of linear rgb
+// floats for TEXTURE_IMAGE_FORMAT_HALF, used by decoding and for generated images
+bool texture_image_build_levels(TextureImage* image, TextureImageFormat format, const void* data, u32 width, u32 height);
+
+// uv_footprint is the width a lookup covers in uv units, up to one texel is a bilinear lookup into the full
+// image, anything wider blends bilinear lookups into the two levels around its size
+Color texture_image_get(TextureImage* image, Vector2 uv_coordinates, f32 uv_footprint);
+Color texture_image_get_texel(TextureImage* image, u32 level, u32 x, u32 y);
+TextureImageState texture_image_get_state(TextureImage* image);
 
 cJSON* texture_image_json_create(TextureImage* image);
 TextureImage* texture_image_json_parse(cJSON* image_json);
 
 void texture_image_destroy(TextureImage* image);
+
+// every image is cached by its canonical path and the hash of its file contents, so any number of materials
+// using the same file share one decode, the cache only holds weak references unless retaining is on, which
+// keeps images decoded between scenes until it is turned off again
+void texture_image_cache_retain(bool retain);
+TextureImageCacheStats texture_image_cache_get_stats();
+void texture_image_cache_print_stats();
+
+// between these calls texture_image_create only registers the images of this thread, submitting decodes them
+// all on the global pool at once and waits for them
+void texture_image_decode_defer();
+void texture_image_decode_submit();
+
+// counts finished decodes, so a caller can poll it to notice that pending images changed
+u32 texture_image_decode_generation();
+u32 texture_image_decodes_pending();
@@ -12,7 +12,8 @@ typedef enum TextureType {
 
 typedef struct Texture {
   TextureType type;
-  Color (*get_color)(struct Texture* texture, Vector2 uv_coordinates);
+  Color (*get_color)(struct Texture* texture, Vector2 uv_coordinates, f32 uv_footprint);
+  struct Texture* (*clone)(struct Texture* texture);
   void (*destroy)(struct Texture* texture);
 } Texture;
 
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "textures/image.h"
+#include "types/base_types.h"
+
+#define VIRTUAL_TEXTURE_MAGIC "PTVT"
+#define VIRTUAL_TEXTURE_VERSION 1
+#define VIRTUAL_TEXTURE_EXTENSION ".ptvt"
+
+// every page is 16 KiB, 64x64 srgb8 or 64x32 half texels, stored as TEXTURE_IMAGE_TILE_SIZE tiles in row order
+#define VIRTUAL_TEXTURE_PAGE_SIZE 16384
+#define VIRTUAL_TEXTURE_PAGE_SHIFT_X 6
+#define VIRTUAL_TEXTURE_PAGE_SHIFT_Y_SRGB8 6
+#define VIRTUAL_TEXTURE_PAGE_SHIFT_Y_HALF 5
+
+// pages start at this offset, so every page read is aligned
+#define VIRTUAL_TEXTURE_HEADER_SIZE 4096
+
+#define VIRTUAL_TEXTURE_PAGE_LOADING 1
+#define VIRTUAL_TEXTURE_PAGE_SLOT_BASE 2
+
+#define DEFAULT_VIRTUAL_TEXTURE_BUDGET ((usize) 512 * 1024 * 1024)
+
+// a cache file is this header followed by the pages of every level, level after level and in row order
+typedef struct VirtualTextureHeader {
+  char magic[4];
+  u32 version;
+
+  u64 content_hash;
+  u64 content_size;
+
+  u32 format;
+  u32 width, height;
+  u32 levels_count;
+  u64 pages_count;
+} VirtualTextureHeader;
+
+// levels that fit in a single page are pinned in memory for as long as the texture lives, so a lookup always
+// has a coarser level to fall back to, the finer levels are read page by page into the shared slots
+typedef struct VirtualTexture {
+  s32 file_descriptor;
+  u32 page_shift_x, page_shift_y;
+  u32 paged_levels_count;
+
+  u32 pages_x[TEXTURE_IMAGE_MAX_LEVELS];
+  u64 first_page[TEXTURE_IMAGE_MAX_LEVELS];
+
+  // per page: 0 when absent, VIRTUAL_TEXTURE_PAGE_LOADING while it is read, otherwise its slot plus
+  // VIRTUAL_TEXTURE_PAGE_SLOT_BASE
+  atomic_uint* page_table;
+
+  u8* pinned;
+  usize pinned_size;
+} VirtualTexture;
+
+// hands out the texels of one resident page, which cannot be evicted until it is released
+typedef struct VirtualTexturePage {
+  const u8* texels;
+  u32 slot;
+} VirtualTexturePage;
+
+typedef struct VirtualTextureOptions {
+  const char* cache_directory;
+  usize budget_bytes;
+
+  // waiting for missing pages keeps renders exactly like the in memory textures, otherwise a lookup uses the
+  // next resident coarser level while the pager thread reads the page
+  bool wait;
+} VirtualTextureOptions;
+
+typedef struct VirtualTextureStats {
+  u64 hits;
+  u64 misses;
+  u64 page_ins;
+  u64 evictions;
+  u64 bytes_read;
+  f64 page_in_time;
+
+  usize resident_bytes;
+  usize budget_bytes;
+} VirtualTextureStats;
+
+VirtualTextureOptions virtual_texture_options_default();
+
+// image textures decoded after this are paged through the cache directory, before any are loaded
+bool virtual_texture_pager_start(VirtualTextureOptions* options);
+bool virtual_texture_pager_is_running();
+// only once every virtual texture is closed
+void virtual_texture_pager_stop();
+
+// the cache file name for a source file's contents inside the cache directory
+bool virtual_texture_cache_path(char* buffer, usize buffer_size, u64 content_hash, usize content_size);
+
+// converts the in memory levels of a decoded image into a cache file
+bool virtual_texture_write(const char* path, TextureImage* image, u64 content_hash, usize content_size);
+
+// fills the image's size, format and levels from a cache file, the pinned levels get their texels and the
+// paged ones none, NULL when the file is missing or was written for other contents
+VirtualTexture* virtual_texture_open(const char* path, TextureImage* image, u64 content_hash, usize content_size);
+void virtual_texture_close(VirtualTexture* texture);
+
+// false when the page is not resident, which also requests it, unless waiting is on or forced with wait
+bool virtual_texture_page_acquire(VirtualTexture* texture, u32 level, u32 page_x, u32 page_y, bool wait, VirtualTexturePage* page);
+void virtual_texture_page_release(VirtualTexturePage* page);
+bool virtual_texture_pager_waits();
+// adds the hits this thread counted to the stats, at the end of every render slice
+void virtual_texture_flush_hits();
+
+VirtualTextureStats virtual_texture_get_stats();
+void virtual_texture_print_stats();
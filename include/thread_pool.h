@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "types/base_types.h"
+
+#define THREAD_POOL_MAX_THREADS 64
+#define THREAD_POOL_STARTING_CAPACITY 64
+#define THREAD_POOL_SCALE_FACTOR 2
+
+typedef void (*ThreadPoolJobFunction)(void* data, usize index);
+
+// counts the unfinished jobs of one batch so independent users of the pool can wait on just their own work
+typedef struct ThreadPoolGroup {
+  u32 pending;
+} ThreadPoolGroup;
+
+typedef struct ThreadPoolJob {
+  ThreadPoolJobFunction function;
+  void* data;
+  usize index;
+  ThreadPoolGroup* group;
+} ThreadPoolJob;
+
+typedef struct ThreadPool {
+  pthread_t threads[THREAD_POOL_MAX_THREADS];
+  u32 thread_count;
+
+  bool alive;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+
+  // ring buffer of queued jobs
+  ThreadPoolJob* jobs;
+  usize jobs_head;
+  usize jobs_count;
+  usize jobs_capacity;
+} ThreadPool;
+
+ThreadPool* thread_pool_create(u32 thread_count);
+// created on first use with one thread per online core, safe to call from any thread
+ThreadPool* thread_pool_get_global();
+
+void thread_pool_submit(ThreadPool* pool, ThreadPoolGroup* group, ThreadPoolJobFunction function, void* data, usize index);
+void thread_pool_wait(ThreadPool* pool, ThreadPoolGroup* group);
+void thread_pool_parallel_for(ThreadPool* pool, usize count, ThreadPoolJobFunction function, void* data);
+
+void thread_pool_destroy(ThreadPool* pool);
+// only once nothing uses the global pool anymore, the next thread_pool_get_global starts a new one
+void thread_pool_global_destroy();
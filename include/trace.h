@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types/base_types.h"
+
+#define TRACE_BUFFER_CAPACITY 16384
+#define TRACE_MAX_THREADS 128
+
+// a complete event, name has to be a string literal since only the pointer is kept
+typedef struct TraceEvent {
+  const char* name;
+  f64 start;
+  f64 duration;
+} TraceEvent;
+
+// owned by a single thread and only appended to by it, once full the oldest events are overwritten
+typedef struct TraceBuffer {
+  TraceEvent events[TRACE_BUFFER_CAPACITY];
+  u64 written;
+  u32 thread_id;
+  const char* thread_name;
+} TraceBuffer;
+
+typedef struct TraceScope {
+  const char* name;
+  f64 start;
+} TraceScope;
+
+// start, stop and write are meant to be called while no traced work is running, e.g. between frames
+void trace_start();
+void trace_stop();
+bool trace_is_recording();
+
+TraceScope trace_begin(const char* name);
+void trace_end(TraceScope scope);
+void trace_set_thread_name(const char* name);
+
+bool trace_write(const char* path);
+
+// only once every traced thread has finished, their buffers are freed
+void trace_destroy();
@@ -13,6 +13,7 @@ typedef struct RayHit {
   Ray ray;
   f32 t;
   Vector2 uv_coordinates;
+  f32 uv_scale; // world units covered by one unit of uv, used to turn a ray footprint into a texture footprint
   Vector3 hit_position;
   Vector3 normal;
   bool inside;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "types/base_types.h"
+
+#define DEFLATE_ADLER32_INIT 1u
+#define DEFLATE_CRC32_INIT 0u
+
+// the largest output deflate_compress can produce for size bytes of input
+usize deflate_bound(usize size);
+
+// writes raw deflate blocks without a zlib header, returns the compressed size or 0 when out of memory,
+// a segment that is not final ends byte aligned after an empty stored block, so segments compressed
+// independently, e.g. on different threads, join into one valid stream in order
+usize deflate_compress(const u8* data, usize size, bool final, u8* output);
+
+u32 deflate_adler32(u32 adler, const u8* data, usize size);
+u32 deflate_adler32_combine(u32 first, u32 second, usize second_size);
+u32 deflate_crc32(u32 crc, const u8* data, usize size);
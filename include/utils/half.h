@@ -0,0 +1,37 @@
+#pragma once
+
+#include "types/base_types.h"
+
+// ieee 754 binary16 as used by half float textures and exr output, inline since texture lookups convert every texel they touch
+
+// shifted into place a half is a single float with an exponent 112 too small, which one multiply fixes for normal
+// and subnormal halves alike, infinities and nans get an all ones exponent first so the multiply keeps them
+static inline f32 half_to_f32(u16 half) {
+  union { u32 bits; f32 value; } result = { .bits = ((u32) (half & 0x7fff) << 13) | ((u32) (half & 0x8000) << 16) };
+  if ((half & 0x7c00) == 0x7c00) { result.bits |= 0x7f800000; }
+
+  return result.value * 0x1p112f;
+}
+
+// rounds to nearest even, values past the half range become infinity and nans stay nans
+static inline u16 half_from_f32(f32 value) {
+  union { u32 bits; f32 value; } single = { .value = value };
+  u32 sign = single.bits & 0x80000000u;
+  single.bits ^= sign;
+
+  u16 half;
+  if (single.bits >= ((127 + 16) << 23)) {
+    half = (single.bits > (255u << 23)) ? 0x7e00 : 0x7c00;
+  } else if (single.bits < ((127 - 14) << 23)) {
+    // adding 0.5 shifts a subnormal half's mantissa into the low bits and rounds it there
+    union { u32 bits; f32 value; } magic = { .bits = (126u << 23) };
+    single.value += magic.value;
+    half = (u16) (single.bits - magic.bits);
+  } else {
+    u32 mantissa_odd = (single.bits >> 13) & 1;
+    single.bits += ((u32) (15 - 127) << 23) + 0xfff + mantissa_odd;
+    half = (u16) (single.bits >> 13);
+  }
+
+  return half | (u16) (sign >> 16);
+}
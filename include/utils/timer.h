@@ -0,0 +1,5 @@
+#pragma once
+
+#include "types/base_types.h"
+
+f64 timer_get_seconds();
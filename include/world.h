@@ -1,8 +1,13 @@
 #pragma once
 
+#include <stdbool.h>
+
+#include <cJSON.h>
+
 #include "hittables/hittable.h"
 #include "types/base_types.h"
 #include "types/color.h"
+#include "math/vector3.h"
 
 #define WORLD_STARTING_CAPACITY 5
 #define WORLD_SCALE_FACTOR 2.0
@@ -10,6 +15,7 @@
 #define DEFAULT_MAX_RAY_BOUNCES 10
 #define DEFAULT_SKY_COLOR (Color) { 0.65f, 0.80f, 1.0f }
 
+struct Animation;
 struct Camera;
 
 typedef struct World {
@@ -22,13 +28,22 @@ typedef struct World {
 
   u32 max_ray_bounces;
   Color sky_color;
+
+  // keyframes from the scene file, NULL when it has none, saved back with the scene
+  struct Animation* animation;
 } World;
 
 World world_create();
 void world_add(World* world, Hittable* object);
 void world_remove(World* world, usize index);
 
-void world_scene_save(World* world, struct Camera* camera, const char* filename);
-void world_scene_load(World* world, struct Camera* camera, const char* filename);
+// .bscene files use the binary format from scene_binary.h, anything else is JSON
+bool world_scene_save(World* world, struct Camera* camera, const char* filename);
+// image textures are decoded in parallel and are all done when this returns
+bool world_scene_load(World* world, struct Camera* camera, const char* filename);
+
+// the pieces of a json scene, shared with the streaming loader which parses the hittables one at a time
+bool world_camera_json_parse(cJSON* camera_json, Vector3* position, u32* seed);
+Hittable* world_hittable_json_parse(cJSON* hittable_json);
 
 void world_destroy(World* world);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include "thread_pool.h"
+#include "world.h"
+#include "types/base_types.h"
+
+// one reader slot per render slice plus a spare one for the thread that owns the queue
+#define WORLD_SNAPSHOT_MAX_READERS (THREAD_POOL_MAX_THREADS + 1)
+
+// a copy of one hittable, shared by every snapshot it is unchanged in, only the producer counts references
+typedef struct WorldSnapshotHittable {
+  Hittable* hittable;
+  u64 revision;
+  u32 reference_count;
+} WorldSnapshotHittable;
+
+typedef struct WorldSnapshot {
+  World world;
+  WorldSnapshotHittable** shared; // one per hittable in the world
+  u64 version;
+
+  u64 retired_epoch;
+  struct WorldSnapshot* next_retired;
+} WorldSnapshot;
+
+// a single producer (the gui thread) publishes immutable copies of its world, any number of
+// readers (render workers) pin the current copy for the duration of a job, retired copies are
+// freed once every reader has moved past the epoch they were retired in, a copy only clones the
+// hittables whose snapshot_revision was reset since the last one and shares every other one
+typedef struct WorldSnapshotQueue {
+  _Atomic(WorldSnapshot*) current;
+  atomic_ullong epoch;
+  atomic_ullong reader_epochs[WORLD_SNAPSHOT_MAX_READERS]; // 0 while the reader holds nothing
+
+  // only touched by the producer
+  WorldSnapshot* retired;
+  u64 version;
+  u64 revision; // the last snapshot_revision handed to a hittable
+} WorldSnapshotQueue;
+
+void world_snapshot_queue_create(WorldSnapshotQueue* queue, World* world);
+void world_snapshot_queue_publish(WorldSnapshotQueue* queue, World* world);
+void world_snapshot_queue_reclaim(WorldSnapshotQueue* queue);
+
+WorldSnapshot* world_snapshot_acquire(WorldSnapshotQueue* queue, u32 reader);
+void world_snapshot_release(WorldSnapshotQueue* queue, u32 reader);
+
+void world_snapshot_queue_destroy(WorldSnapshotQueue* queue);
@@ -0,0 +1,261 @@
+#include "animation.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cJSON.h>
+
+#include "camera.h"
+#include "world.h"
+#include "hittables/hittable.h"
+#include "math/vector3.h"
+#include "types/base_types.h"
+
+static bool animation_track_json_parse(AnimationTrack* track, World* world, cJSON* track_json);
+static cJSON* animation_track_json_create(AnimationTrack* track);
+static Vector3 animation_track_evaluate(AnimationTrack* track, f32 time);
+
+bool animation_json_parse(Animation* animation, World* world, cJSON* animation_json) {
+  *animation = (Animation) { .frame_rate = ANIMATION_DEFAULT_FRAME_RATE };
+  if (!cJSON_IsObject(animation_json)) { goto error; }
+
+  cJSON* frame_rate_json = cJSON_GetObjectItemCaseSensitive(animation_json, "frame_rate");
+  if (frame_rate_json) {
+    if (!cJSON_IsNumber(frame_rate_json) || cJSON_GetNumberValue(frame_rate_json) <= 0.0) { goto error; }
+    animation->frame_rate = (f32) cJSON_GetNumberValue(frame_rate_json);
+  }
+
+  cJSON* tracks_json = cJSON_GetObjectItemCaseSensitive(animation_json, "tracks");
+  if (!cJSON_IsArray(tracks_json)) { goto error; }
+
+  s32 tracks_count = cJSON_GetArraySize(tracks_json);
+  if (tracks_count > 0) {
+    animation->tracks = (AnimationTrack*) calloc(tracks_count, sizeof(AnimationTrack));
+    if (!animation->tracks) { goto error; }
+  }
+
+  cJSON* track_json;
+  cJSON_ArrayForEach(track_json, tracks_json) {
+    AnimationTrack* track = &animation->tracks[animation->tracks_count];
+    if (!animation_track_json_parse(track, world, track_json)) { goto error; }
+    animation->tracks_count++;
+
+    f32 end_time = track->keyframes[track->keyframes_count - 1].time;
+    if (end_time > animation->duration) { animation->duration = end_time; }
+  }
+
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [ANIMATION] [JSON] Failed to parse animation!\n");
+  animation_destroy(animation);
+  return false;
+}
+
+cJSON* animation_json_create(Animation* animation) {
+  cJSON* animation_json = cJSON_CreateObject();
+  if (!animation_json) { goto error; }
+
+  if (!cJSON_AddNumberToObject(animation_json, "frame_rate", animation->frame_rate)) { goto error; }
+
+  cJSON* tracks_json = cJSON_AddArrayToObject(animation_json, "tracks");
+  if (!tracks_json) { goto error; }
+
+  for (u32 i = 0; i < animation->tracks_count; i++) {
+    cJSON* track_json = animation_track_json_create(&animation->tracks[i]);
+    if (!track_json) { goto error; }
+
+    cJSON_AddItemToArray(tracks_json, track_json);
+  }
+
+  return animation_json;
+
+error:
+  fprintf(stderr, "[ERROR] [ANIMATION] [JSON] Failed to create animation JSON object!\n");
+  cJSON_Delete(animation_json);
+  return NULL;
+}
+
+u32 animation_frame_count(Animation* animation) {
+  return (u32) (animation->duration * animation->frame_rate) + 1;
+}
+
+u32 animation_apply(Animation* animation, World* world, Camera* camera, f32 time) {
+  u32 moved_count = 0;
+
+  for (u32 i = 0; i < animation->tracks_count; i++) {
+    AnimationTrack* track = &animation->tracks[i];
+    Vector3 value = animation_track_evaluate(track, time);
+
+    switch (track->target) {
+      case ANIMATION_TARGET_CAMERA_POSITION: camera->position = value; break;
+      case ANIMATION_TARGET_FOCAL_LENGTH: camera->focal_length = value.x; break;
+      case ANIMATION_TARGET_HITTABLE_POSITION: {
+        // there is no acceleration structure, so moving a hittable only rewrites its position
+        Vector3* position = world->hittables[track->hittable_index]->position;
+        if (memcmp(position, &value, sizeof(Vector3)) != 0) {
+          *position = value;
+          world->hittables[track->hittable_index]->snapshot_revision = 0;
+          moved_count++;
+        }
+      } break;
+    }
+  }
+
+  return moved_count;
+}
+
+void animation_remove_hittable(Animation* animation, u32 index) {
+  u32 kept_count = 0;
+  for (u32 i = 0; i < animation->tracks_count; i++) {
+    AnimationTrack track = animation->tracks[i];
+    if (track.target == ANIMATION_TARGET_HITTABLE_POSITION && track.hittable_index == index) {
+      free(track.keyframes);
+      continue;
+    }
+
+    if (track.target == ANIMATION_TARGET_HITTABLE_POSITION && track.hittable_index > index) { track.hittable_index--; }
+    animation->tracks[kept_count++] = track;
+  }
+
+  animation->tracks_count = kept_count;
+}
+
+void animation_destroy(Animation* animation) {
+  for (u32 i = 0; i < animation->tracks_count; i++) {
+    free(animation->tracks[i].keyframes);
+  }
+
+  free(animation->tracks);
+  animation->tracks = NULL;
+  animation->tracks_count = 0;
+}
+
+static bool animation_track_json_parse(AnimationTrack* track, World* world, cJSON* track_json) {
+  const char* target = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(track_json, "target"));
+  if (!target) { return false; }
+
+  if (strcmp(target, "camera_position") == 0) {
+    track->target = ANIMATION_TARGET_CAMERA_POSITION;
+  } else if (strcmp(target, "focal_length") == 0) {
+    track->target = ANIMATION_TARGET_FOCAL_LENGTH;
+  } else if (strcmp(target, "hittable_position") == 0) {
+    track->target = ANIMATION_TARGET_HITTABLE_POSITION;
+
+    cJSON* hittable_json = cJSON_GetObjectItemCaseSensitive(track_json, "hittable");
+    if (!cJSON_IsNumber(hittable_json)) { return false; }
+
+    f64 hittable_index = cJSON_GetNumberValue(hittable_json);
+    if (hittable_index < 0.0 || hittable_index >= world->hittables_count) {
+      fprintf(stderr, "[ERROR] [ANIMATION] Track targets hittable %.0f but the scene has %u!\n", hittable_index, world->hittables_count);
+      return false;
+    }
+    track->hittable_index = (u32) hittable_index;
+  } else {
+    fprintf(stderr, "[ERROR] [ANIMATION] Unknown track target: %s!\n", target);
+    return false;
+  }
+
+  cJSON* keyframes_json = cJSON_GetObjectItemCaseSensitive(track_json, "keyframes");
+  if (!cJSON_IsArray(keyframes_json) || cJSON_GetArraySize(keyframes_json) == 0) { return false; }
+
+  track->keyframes = (AnimationKeyframe*) malloc(sizeof(AnimationKeyframe) * cJSON_GetArraySize(keyframes_json));
+  if (!track->keyframes) { return false; }
+
+  cJSON* keyframe_json;
+  cJSON_ArrayForEach(keyframe_json, keyframes_json) {
+    AnimationKeyframe* keyframe = &track->keyframes[track->keyframes_count];
+
+    cJSON* time_json = cJSON_GetObjectItemCaseSensitive(keyframe_json, "time");
+    if (!cJSON_IsNumber(time_json)) { goto error; }
+    keyframe->time = (f32) cJSON_GetNumberValue(time_json);
+
+    // evaluating relies on the keyframes being sorted
+    if (track->keyframes_count > 0 && keyframe->time <= track->keyframes[track->keyframes_count - 1].time) {
+      fprintf(stderr, "[ERROR] [ANIMATION] Keyframe times have to increase!\n");
+      goto error;
+    }
+
+    cJSON* value_json = cJSON_GetObjectItemCaseSensitive(keyframe_json, "value");
+    if (track->target == ANIMATION_TARGET_FOCAL_LENGTH) {
+      if (!cJSON_IsNumber(value_json) || cJSON_GetNumberValue(value_json) <= 0.0) { goto error; }
+      keyframe->value = (Vector3) { (f32) cJSON_GetNumberValue(value_json), 0.0f, 0.0f };
+    } else {
+      if (!cJSON_IsArray(value_json) || cJSON_GetArraySize(value_json) != 3) { goto error; }
+      for (u32 i = 0; i < 3; i++) {
+        cJSON* element = cJSON_GetArrayItem(value_json, i);
+        if (!cJSON_IsNumber(element)) { goto error; }
+        keyframe->value.data[i] = (f32) cJSON_GetNumberValue(element);
+      }
+    }
+
+    track->keyframes_count++;
+  }
+
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [ANIMATION] [JSON] Failed to parse keyframe %u of %s track!\n", track->keyframes_count, target);
+  free(track->keyframes);
+  track->keyframes = NULL;
+  track->keyframes_count = 0;
+  return false;
+}
+
+static cJSON* animation_track_json_create(AnimationTrack* track) {
+  cJSON* track_json = cJSON_CreateObject();
+  if (!track_json) { return NULL; }
+
+  const char* target = NULL;
+  switch (track->target) {
+    case ANIMATION_TARGET_CAMERA_POSITION: target = "camera_position"; break;
+    case ANIMATION_TARGET_FOCAL_LENGTH: target = "focal_length"; break;
+    case ANIMATION_TARGET_HITTABLE_POSITION: target = "hittable_position"; break;
+  }
+  if (!cJSON_AddStringToObject(track_json, "target", target)) { goto error; }
+  if (track->target == ANIMATION_TARGET_HITTABLE_POSITION && !cJSON_AddNumberToObject(track_json, "hittable", track->hittable_index)) { goto error; }
+
+  cJSON* keyframes_json = cJSON_AddArrayToObject(track_json, "keyframes");
+  if (!keyframes_json) { goto error; }
+
+  for (u32 i = 0; i < track->keyframes_count; i++) {
+    AnimationKeyframe* keyframe = &track->keyframes[i];
+
+    cJSON* keyframe_json = cJSON_CreateObject();
+    if (!keyframe_json) { goto error; }
+    cJSON_AddItemToArray(keyframes_json, keyframe_json);
+
+    if (!cJSON_AddNumberToObject(keyframe_json, "time", keyframe->time)) { goto error; }
+
+    if (track->target == ANIMATION_TARGET_FOCAL_LENGTH) {
+      if (!cJSON_AddNumberToObject(keyframe_json, "value", keyframe->value.x)) { goto error; }
+    } else {
+      cJSON* value_json = cJSON_CreateFloatArray(keyframe->value.data, 3);
+      if (!value_json) { goto error; }
+      cJSON_AddItemToObject(keyframe_json, "value", value_json);
+    }
+  }
+
+  return track_json;
+
+error:
+  cJSON_Delete(track_json);
+  return NULL;
+}
+
+static Vector3 animation_track_evaluate(AnimationTrack* track, f32 time) {
+  if (time <= track->keyframes[0].time) { return track->keyframes[0].value; }
+
+  for (u32 i = 1; i < track->keyframes_count; i++) {
+    AnimationKeyframe* next = &track->keyframes[i];
+    if (time > next->time) { continue; }
+
+    AnimationKeyframe* previous = &track->keyframes[i - 1];
+    f32 t = (time - previous->time) / (next->time - previous->time);
+    return vector3_add(previous->value, vector3_scale(vector3_subtract(next->value, previous->value), t));
+  }
+
+  return track->keyframes[track->keyframes_count - 1].value;
+}
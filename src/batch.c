@@ -0,0 +1,195 @@
+#include "batch.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cJSON.h>
+
+#include "camera.h"
+#include "image.h"
+#include "textures/image.h"
+#include "trace.h"
+#include "world.h"
+#include "math/vector3.h"
+#include "types/base_types.h"
+#include "utils/file.h"
+#include "utils/timer.h"
+
+// strings point into the parsed job file
+typedef struct BatchJob {
+  const char* scene_path;
+  const char* output_path;
+  ImageType output_type;
+  u32 width, height;
+  u32 samples;
+  u32 seed;
+  bool seed_set;
+  Vector3 position;
+  bool position_set;
+  f32 focal_length;
+} BatchJob;
+
+static bool batch_parse_job(cJSON* job_json, BatchDefaults* defaults, BatchJob* job);
+static bool batch_parse_u32(cJSON* object_json, const char* name, u32* value);
+static bool batch_run_job(BatchJob* job, World* world, Camera* camera, u32 index, u32 jobs_count);
+
+bool batch_render(const char* jobs_path, BatchDefaults* defaults, BatchSummary* summary) {
+  *summary = (BatchSummary) {0};
+
+  const char* string = file_to_string(jobs_path);
+  if (!string) {
+    fprintf(stderr, "[ERROR] [BATCH] Failed to load job file: %s!\n", jobs_path);
+    return false;
+  }
+
+  cJSON* jobs_file_json = cJSON_Parse(string);
+  free((void*) string);
+
+  cJSON* jobs_json = cJSON_GetObjectItemCaseSensitive(jobs_file_json, "jobs");
+  if (!cJSON_IsArray(jobs_json)) {
+    fprintf(stderr, "[ERROR] [BATCH] Job file has no jobs array: %s!\n", jobs_path);
+    cJSON_Delete(jobs_file_json);
+    return false;
+  }
+
+  World world = world_create();
+  Camera* camera = camera_create(defaults->width, defaults->height);
+  if (!camera) {
+    world_destroy(&world);
+    cJSON_Delete(jobs_file_json);
+    return false;
+  }
+
+  if (defaults->threads > 0) { camera->thread_count = defaults->threads; }
+  texture_image_cache_retain(true);
+
+  summary->jobs_count = cJSON_GetArraySize(jobs_json);
+  f64 start_time = timer_get_seconds();
+
+  u32 index = 0;
+  cJSON* job_json;
+  cJSON_ArrayForEach(job_json, jobs_json) {
+    index++;
+
+    BatchJob job;
+    if (!batch_parse_job(job_json, defaults, &job) || !batch_run_job(&job, &world, camera, index, summary->jobs_count)) {
+      fprintf(stderr, "[ERROR] [BATCH] Job %u/%u failed, continuing with the next one!\n", index, summary->jobs_count);
+      summary->failed_count++;
+    }
+  }
+
+  summary->total_time = timer_get_seconds() - start_time;
+
+  printf("[INFO] [BATCH] Finished %u/%u jobs in %.3fs, %u failed\n", summary->jobs_count - summary->failed_count, summary->jobs_count, summary->total_time, summary->failed_count);
+  texture_image_cache_print_stats();
+
+  camera_destroy(camera);
+  world_destroy(&world);
+  texture_image_cache_retain(false);
+  cJSON_Delete(jobs_file_json);
+  return true;
+}
+
+static bool batch_parse_job(cJSON* job_json, BatchDefaults* defaults, BatchJob* job) {
+  *job = (BatchJob) {
+    .width = defaults->width,
+    .height = defaults->height,
+    .samples = defaults->samples,
+    .focal_length = DEFAULT_FOCAL_LENGTH
+  };
+
+  if (!cJSON_IsObject(job_json)) { goto error; }
+
+  job->scene_path = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(job_json, "scene"));
+  job->output_path = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(job_json, "output"));
+  if (!job->scene_path || !job->output_path) { goto error; }
+  if (!image_type_from_path(job->output_path, &job->output_type)) { goto error; }
+
+  if (!batch_parse_u32(job_json, "width", &job->width) || job->width == 0) { goto error; }
+  if (!batch_parse_u32(job_json, "height", &job->height) || job->height == 0) { goto error; }
+  if (!batch_parse_u32(job_json, "samples", &job->samples) || job->samples == 0) { goto error; }
+
+  job->seed_set = cJSON_HasObjectItem(job_json, "seed");
+  if (!batch_parse_u32(job_json, "seed", &job->seed)) { goto error; }
+
+  cJSON* camera_json = cJSON_GetObjectItemCaseSensitive(job_json, "camera");
+  if (camera_json) {
+    if (!cJSON_IsObject(camera_json)) { goto error; }
+
+    cJSON* position_json = cJSON_GetObjectItemCaseSensitive(camera_json, "position");
+    if (position_json) {
+      if (!cJSON_IsArray(position_json) || cJSON_GetArraySize(position_json) != 3) { goto error; }
+
+      for (u32 i = 0; i < 3; i++) {
+        cJSON* element = cJSON_GetArrayItem(position_json, i);
+        if (!cJSON_IsNumber(element)) { goto error; }
+        job->position.data[i] = (f32) cJSON_GetNumberValue(element);
+      }
+      job->position_set = true;
+    }
+
+    cJSON* focal_length_json = cJSON_GetObjectItemCaseSensitive(camera_json, "focal_length");
+    if (focal_length_json) {
+      if (!cJSON_IsNumber(focal_length_json) || cJSON_GetNumberValue(focal_length_json) <= 0.0) { goto error; }
+      job->focal_length = (f32) cJSON_GetNumberValue(focal_length_json);
+    }
+  }
+
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [BATCH] Failed to parse job, it needs a scene and an .hdr, .jpg, .png or .exr output!\n");
+  return false;
+}
+
+// missing values keep their default, only a value of the wrong type is an error
+static bool batch_parse_u32(cJSON* object_json, const char* name, u32* value) {
+  cJSON* value_json = cJSON_GetObjectItemCaseSensitive(object_json, name);
+  if (!value_json) { return true; }
+
+  f64 number = cJSON_GetNumberValue(value_json);
+  if (!cJSON_IsNumber(value_json) || number < 0.0 || number > UINT32_MAX) { return false; }
+
+  *value = (u32) number;
+  return true;
+}
+
+static bool batch_run_job(BatchJob* job, World* world, Camera* camera, u32 index, u32 jobs_count) {
+  TraceScope trace = trace_begin("Batch Job");
+  f64 start_time = timer_get_seconds();
+
+  if (job->width != camera->width || job->height != camera->height) {
+    camera_change_resolution(camera, job->width, job->height);
+  }
+
+  // scenes do not store the focal length, so an override from an earlier job has to be undone
+  camera->focal_length = job->focal_length;
+  if (!world_scene_load(world, camera, job->scene_path)) { goto error; }
+
+  if (job->position_set) { camera->position = job->position; }
+  if (job->seed_set) { camera->seed = job->seed; }
+  camera->sample_limit = job->samples;
+  camera->termination = CAMERA_TERMINATION_SAMPLES;
+
+  f64 load_time = timer_get_seconds() - start_time;
+
+  camera_render_export(camera, world);
+  f64 render_time = timer_get_seconds() - start_time - load_time;
+
+  ImageOptions image_options = image_options_default();
+  if (!image_create(job->output_path, job->output_type, camera, &image_options) || !image_create_metadata(job->output_path, camera)) { goto error; }
+
+  f64 write_time = timer_get_seconds() - start_time - load_time - render_time;
+
+  printf("[INFO] [BATCH] Job %u/%u %s -> %s at %ux%u: load %.3fs, render %.3fs (%.2f samples/s), write %.3fs\n",
+    index, jobs_count, job->scene_path, job->output_path, job->width, job->height, load_time, render_time, (camera->sample_count / render_time), write_time);
+
+  trace_end(trace);
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [BATCH] Failed to render %s to %s!\n", job->scene_path, job->output_path);
+  trace_end(trace);
+  return false;
+}
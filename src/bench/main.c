@@ -0,0 +1,709 @@
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <cJSON.h>
+
+#include "camera.h"
+#include "distributed.h"
+#include "image.h"
+#include "render_stats.h"
+#include "scene_binary.h"
+#include "scene_generator.h"
+#include "thread_pool.h"
+#include "world.h"
+#include "types/base_types.h"
+#include "types/color.h"
+#include "utils/file.h"
+#include "utils/timer.h"
+
+#define BENCH_DEFAULT_WIDTH 160
+#define BENCH_DEFAULT_HEIGHT 120
+#define BENCH_DEFAULT_SAMPLES 16
+#define BENCH_DEFAULT_SEED 1
+#define BENCH_DEFAULT_OUTPUT "bench.json"
+#define BENCH_DEFAULT_SCENES_DIRECTORY "../scenes"
+#define BENCH_DEFAULT_REFERENCES_DIRECTORY "../bench/references"
+#define BENCH_DEFAULT_TOLERANCE 30.0
+
+#define BENCH_PATH_LENGTH 1024
+#define BENCH_MAX_EXTRA_SCENES 64
+
+#define BENCH_LOAD_REPETITIONS 3
+#define BENCH_LOAD_JSON_PATH "bench-load.scene"
+#define BENCH_LOAD_BINARY_PATH "bench-load" SCENE_BINARY_EXTENSION
+
+#define BENCH_WRITE_REPETITIONS 3
+#define BENCH_WRITE_PATH_LENGTH 64
+
+// a scene is either a file in the scenes directory or generated with sphere_count spheres,
+// external scenes are paths given on the command line and have no reference image
+typedef struct BenchScene {
+  const char* name;
+  const char* filename;
+  u32 sphere_count;
+  bool external;
+} BenchScene;
+
+// changing this list or the defaults above invalidates the stored references and any earlier results
+static const BenchScene bench_scenes[] = {
+  { "test", "test.scene", 0, false },
+  { "brick-earth", "brick-earth.scene", 0, false },
+  { "spheres-16", NULL, 16, false },
+  { "spheres-64", NULL, 64, false },
+  { "spheres-256", NULL, 256, false }
+};
+
+typedef struct BenchImageFormat {
+  const char* name;
+  const char* extension;
+  ImageType type;
+  ImageOptions options;
+} BenchImageFormat;
+
+static const BenchImageFormat bench_image_formats[] = {
+  { "hdr", ".hdr", HDR, { .exr_float = false, .exr_aovs = false } },
+  { "jpg", ".jpg", JPG, { .exr_float = false, .exr_aovs = false } },
+  { "png", ".png", PNG, { .exr_float = false, .exr_aovs = false } },
+  { "exr-half", ".exr", EXR, { .exr_float = false, .exr_aovs = false } },
+  { "exr-float-aovs", ".exr", EXR, { .exr_float = true, .exr_aovs = true } }
+};
+
+typedef struct BenchOptions {
+  const char* output_path;
+  const char* scenes_directory;
+  const char* references_directory;
+  const char* baseline_path;
+  f64 tolerance; // percent
+  u32 width, height;
+  u32 samples;
+  u32 threads;
+  bool update_references;
+
+  // generated stress scenes to sweep on top of the fixed list
+  BenchScene extra_scenes[BENCH_MAX_EXTRA_SCENES];
+  u32 extra_scene_count;
+
+  // with an object count the bench only compares loading the json and binary scene formats
+  u32 load_objects;
+
+  // only renders the first scene and times writing it in every image format
+  bool write_images;
+
+  // with a process count the bench only renders the first scene with 1 up to that many worker processes
+  u32 max_processes;
+} BenchOptions;
+
+static void bench_print_usage(const char* program);
+static bool bench_parse_options(int argc, char** argv, BenchOptions* options);
+static bool bench_load_scene(const BenchScene* scene, World* world, Camera* camera, BenchOptions* options);
+static cJSON* bench_run_scene(const BenchScene* scene, World* world, Camera* camera, BenchOptions* options, f64 load_time, f64 first_pixel_time);
+static bool bench_compare_baseline(cJSON* results_json, BenchOptions* options);
+static u64 bench_peak_memory();
+static bool bench_scene_formats(BenchOptions* options);
+static cJSON* bench_scene_format(const char* format, const char* path);
+static bool bench_image_writes(BenchOptions* options);
+static cJSON* bench_image_write(const BenchImageFormat* format, Camera* camera);
+static bool bench_process_scaling(BenchOptions* options);
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  if (!bench_parse_options(argc, argv, &options)) {
+    bench_print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (options.load_objects > 0) {
+    bool completed = bench_scene_formats(&options);
+    thread_pool_global_destroy();
+    return completed ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (options.write_images) {
+    bool completed = bench_image_writes(&options);
+    thread_pool_global_destroy();
+    return completed ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (options.max_processes > 0) {
+    bool completed = bench_process_scaling(&options);
+    thread_pool_global_destroy();
+    return completed ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  s32 status = EXIT_FAILURE;
+  World world = world_create();
+  cJSON* results_json = NULL;
+  Camera* camera = camera_create(options.width, options.height);
+  if (!camera) { goto cleanup; }
+
+  results_json = cJSON_CreateObject();
+  if (!results_json) { goto error; }
+
+  if (!cJSON_AddNumberToObject(results_json, "width", options.width)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "height", options.height)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "samples", options.samples)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "threads", options.threads)) { goto error; }
+  if (!cJSON_AddBoolToObject(results_json, "render_stats", RENDER_STATS_ENABLED)) { goto error; }
+
+  cJSON* scenes_json = cJSON_AddArrayToObject(results_json, "scenes");
+  if (!scenes_json) { goto error; }
+
+  usize builtin_count = sizeof(bench_scenes) / sizeof(BenchScene);
+  for (usize i = 0; i < builtin_count + options.extra_scene_count; i++) {
+    const BenchScene* scene = (i < builtin_count) ? &bench_scenes[i] : &options.extra_scenes[i - builtin_count];
+
+    f64 load_start = timer_get_seconds();
+    if (!bench_load_scene(scene, &world, camera, &options)) { goto cleanup; }
+    f64 load_time = timer_get_seconds() - load_start;
+
+    // one sample over the whole image right after loading is the first picture the gui would show
+    camera->sample_limit = 1;
+    camera_render_export(camera, &world);
+    camera->sample_limit = options.samples;
+    f64 first_pixel_time = timer_get_seconds() - load_start;
+
+    cJSON* scene_json = bench_run_scene(scene, &world, camera, &options, load_time, first_pixel_time);
+    if (!scene_json) { goto cleanup; }
+    cJSON_AddItemToArray(scenes_json, scene_json);
+  }
+
+  if (!cJSON_AddNumberToObject(results_json, "peak_memory_bytes", bench_peak_memory())) { goto error; }
+
+  const char* string = cJSON_Print(results_json);
+  if (!string) { goto error; }
+  bool written = file_write_string(options.output_path, string);
+  free((void*) string);
+  if (!written) { goto cleanup; }
+
+  printf("[INFO] [BENCH] Wrote %s\n", options.output_path);
+
+  if (options.baseline_path && !bench_compare_baseline(results_json, &options)) { goto cleanup; }
+
+  status = EXIT_SUCCESS;
+  goto cleanup;
+
+error:
+  fprintf(stderr, "[ERROR] [BENCH] Failed to create JSON results!\n");
+
+cleanup:
+  cJSON_Delete(results_json);
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  thread_pool_global_destroy();
+  return status;
+}
+
+static void bench_print_usage(const char* program) {
+  fprintf(stderr,
+    "Usage: %s [options]\n"
+    "  -W, --width <pixels>          image width (default %u)\n"
+    "  -H, --height <pixels>         image height (default %u)\n"
+    "  -s, --samples <count>         samples per pixel (default %u)\n"
+    "  -t, --threads <count>         row slices rendered in parallel (default %u, max %u)\n"
+    "  -o, --output <path>           JSON results (default %s)\n"
+    "  -d, --scenes <directory>      scene files (default %s)\n"
+    "  -r, --references <directory>  reference images (default %s)\n"
+    "  -u, --update-references       overwrite the reference images with this run\n"
+    "  -b, --baseline <path>         fail if samples/s drops against an earlier results file\n"
+    "  -T, --tolerance <percent>     allowed drop against the baseline (default %.0f)\n"
+    "  -L, --load <objects>          only time loading a generated scene as .scene and %s\n"
+    "  -e, --extra-scene <path>      also run this scene file, e.g. one written by PathTracerCLI --generate\n"
+    "  -w, --write-images            only time writing the first scene in every image format, e.g. at -W 7680 -H 4320\n"
+    "  -P, --processes <max>         only time the first scene rendered by 1 to max single threaded worker processes\n"
+    "  -h, --help                    show this message\n",
+    program, BENCH_DEFAULT_WIDTH, BENCH_DEFAULT_HEIGHT, BENCH_DEFAULT_SAMPLES, DEFAULT_THREAD_COUNT, MAX_THREAD_COUNT,
+    BENCH_DEFAULT_OUTPUT, BENCH_DEFAULT_SCENES_DIRECTORY, BENCH_DEFAULT_REFERENCES_DIRECTORY, BENCH_DEFAULT_TOLERANCE,
+    SCENE_BINARY_EXTENSION
+  );
+}
+
+static bool bench_parse_u32(const char* string, u32* value) {
+  char* end;
+  unsigned long parsed = strtoul(string, &end, 10);
+  if (end == string || *end != '\0' || parsed > UINT32_MAX) { return false; }
+
+  *value = (u32) parsed;
+  return true;
+}
+
+static bool bench_parse_options(int argc, char** argv, BenchOptions* options) {
+  *options = (BenchOptions) {
+    .output_path = BENCH_DEFAULT_OUTPUT,
+    .scenes_directory = BENCH_DEFAULT_SCENES_DIRECTORY,
+    .references_directory = BENCH_DEFAULT_REFERENCES_DIRECTORY,
+    .baseline_path = NULL,
+    .tolerance = BENCH_DEFAULT_TOLERANCE,
+    .width = BENCH_DEFAULT_WIDTH,
+    .height = BENCH_DEFAULT_HEIGHT,
+    .samples = BENCH_DEFAULT_SAMPLES,
+    .threads = DEFAULT_THREAD_COUNT,
+    .update_references = false,
+    .extra_scene_count = 0,
+    .load_objects = 0,
+    .write_images = false,
+    .max_processes = 0
+  };
+
+  static const struct option long_options[] = {
+    { "width", required_argument, NULL, 'W' },
+    { "height", required_argument, NULL, 'H' },
+    { "samples", required_argument, NULL, 's' },
+    { "threads", required_argument, NULL, 't' },
+    { "output", required_argument, NULL, 'o' },
+    { "scenes", required_argument, NULL, 'd' },
+    { "references", required_argument, NULL, 'r' },
+    { "update-references", no_argument, NULL, 'u' },
+    { "baseline", required_argument, NULL, 'b' },
+    { "tolerance", required_argument, NULL, 'T' },
+    { "extra-scene", required_argument, NULL, 'e' },
+    { "load", required_argument, NULL, 'L' },
+    { "write-images", no_argument, NULL, 'w' },
+    { "processes", required_argument, NULL, 'P' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  s32 option;
+  while ((option = getopt_long(argc, argv, "W:H:s:t:o:d:r:ub:T:e:L:wP:h", long_options, NULL)) != -1) {
+    bool valid = true;
+    switch (option) {
+      case 'W': valid = bench_parse_u32(optarg, &options->width) && options->width > 0; break;
+      case 'H': valid = bench_parse_u32(optarg, &options->height) && options->height > 0; break;
+      case 's': valid = bench_parse_u32(optarg, &options->samples) && options->samples > 0; break;
+      case 't': valid = bench_parse_u32(optarg, &options->threads) && options->threads > 0 && options->threads <= MAX_THREAD_COUNT; break;
+      case 'o': options->output_path = optarg; break;
+      case 'd': options->scenes_directory = optarg; break;
+      case 'r': options->references_directory = optarg; break;
+      case 'u': options->update_references = true; break;
+      case 'b': options->baseline_path = optarg; break;
+      case 'T': {
+        char* end;
+        options->tolerance = strtod(optarg, &end);
+        valid = (end != optarg && *end == '\0' && options->tolerance >= 0.0);
+      } break;
+      case 'L': valid = bench_parse_u32(optarg, &options->load_objects) && options->load_objects > 0; break;
+      case 'w': options->write_images = true; break;
+      case 'P': valid = bench_parse_u32(optarg, &options->max_processes) && options->max_processes > 0 && options->max_processes <= DISTRIBUTED_MAX_WORKERS; break;
+      case 'e': {
+        valid = (options->extra_scene_count < BENCH_MAX_EXTRA_SCENES);
+        if (!valid) { break; }
+
+        const char* name = strrchr(optarg, '/');
+        options->extra_scenes[options->extra_scene_count++] = (BenchScene) { (name ? name + 1 : optarg), optarg, 0, true };
+      } break;
+      default: return false;
+    }
+
+    if (!valid) {
+      fprintf(stderr, "[ERROR] [BENCH] Invalid value for option -%c: %s!\n", option, optarg);
+      return false;
+    }
+  }
+
+  return (optind == argc);
+}
+
+static bool bench_load_scene(const BenchScene* scene, World* world, Camera* camera, BenchOptions* options) {
+  // scene files carry their own seed, overriding it keeps every scene comparable between runs
+  if (scene->external) {
+    if (!world_scene_load(world, camera, scene->filename)) { return false; }
+  } else if (scene->filename) {
+    char path[BENCH_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s", options->scenes_directory, scene->filename);
+    if (!world_scene_load(world, camera, path)) { return false; }
+  } else {
+    if (!scene_generator_spheres(world, camera, scene->sphere_count, BENCH_DEFAULT_SEED)) { return false; }
+  }
+
+  camera->seed = BENCH_DEFAULT_SEED;
+  camera->sample_limit = options->samples;
+  camera->thread_count = options->threads;
+  return true;
+}
+
+static cJSON* bench_run_scene(const BenchScene* scene, World* world, Camera* camera, BenchOptions* options, f64 load_time, f64 first_pixel_time) {
+  camera_reset_stats(camera);
+
+  f64 start_time = timer_get_seconds();
+  camera_render_export(camera, world);
+  f64 wall_time = timer_get_seconds() - start_time;
+
+  RenderStats stats = camera_get_stats(camera);
+  u64 primary_rays = stats.primary_rays, secondary_rays = stats.secondary_rays;
+
+  char reference_path[BENCH_PATH_LENGTH];
+  snprintf(reference_path, sizeof(reference_path), "%s/%s.hdr", options->references_directory, scene->name);
+
+  bool has_rmse = false;
+  f64 rmse = 0.0;
+  if (scene->external) {
+    has_rmse = false;
+  } else if (options->update_references) {
+    if (!image_create_hdr(reference_path, camera)) { return NULL; }
+  } else {
+    has_rmse = image_compare_hdr(reference_path, camera, &rmse);
+  }
+
+  printf("[INFO] [BENCH] %s: %.3fs, %.2f Mrays/s primary, %.2f Mrays/s secondary\n", scene->name, wall_time, (primary_rays / wall_time) / 1e6, (secondary_rays / wall_time) / 1e6);
+
+  cJSON* scene_json = cJSON_CreateObject();
+  if (!scene_json) { goto error; }
+
+  if (!cJSON_AddStringToObject(scene_json, "name", scene->name)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "hittables", world->hittables_count)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "load_time", load_time)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "first_pixel_time", first_pixel_time)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "wall_time", wall_time)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "primary_rays", primary_rays)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "secondary_rays", secondary_rays)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "primary_rays_per_second", primary_rays / wall_time)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "secondary_rays_per_second", secondary_rays / wall_time)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "samples_per_second", camera->sample_count / wall_time)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "sphere_tests", stats.intersection_tests[HITTABLE_TYPE_SPHERE])) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "plane_tests", stats.intersection_tests[HITTABLE_TYPE_PLANE])) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "bounces", stats.bounces)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "escaped_rays", stats.escaped_rays)) { goto error; }
+  if (!cJSON_AddNumberToObject(scene_json, "material_evaluations", stats.material_evaluations)) { goto error; }
+
+  // the counters are kept per row slice, a pool thread can run several slices of one frame
+  cJSON* slices_json = cJSON_AddArrayToObject(scene_json, "slices");
+  if (!slices_json) { goto error; }
+
+  for (u32 i = 0; i < camera->thread_count; i++) {
+    cJSON* slice_json = cJSON_CreateObject();
+    if (!slice_json) { goto error; }
+    cJSON_AddItemToArray(slices_json, slice_json);
+
+    f64 busy_time = render_stats_busy_time(&camera->slice_stats[i]);
+    if (!cJSON_AddNumberToObject(slice_json, "busy_time", busy_time)) { goto error; }
+    if (!cJSON_AddNumberToObject(slice_json, "utilization", busy_time / wall_time)) { goto error; }
+  }
+
+  if (!cJSON_AddNumberToObject(scene_json, "peak_memory_bytes", bench_peak_memory())) { goto error; }
+
+  if (has_rmse) {
+    if (!cJSON_AddNumberToObject(scene_json, "rmse", rmse)) { goto error; }
+  } else {
+    if (!cJSON_AddNullToObject(scene_json, "rmse")) { goto error; }
+  }
+
+  return scene_json;
+
+error:
+  fprintf(stderr, "[ERROR] [BENCH] Failed to create JSON object for scene: %s!\n", scene->name);
+  cJSON_Delete(scene_json);
+  return NULL;
+}
+
+// a baseline is any earlier results file rendered with the same settings, samples per second is compared
+// since it does not depend on whether the ray counters are compiled in
+static bool bench_compare_baseline(cJSON* results_json, BenchOptions* options) {
+  const char* string = file_to_string(options->baseline_path);
+  if (!string) {
+    fprintf(stderr, "[ERROR] [BENCH] Failed to load baseline: %s!\n", options->baseline_path);
+    return false;
+  }
+
+  cJSON* baseline_json = cJSON_Parse(string);
+  free((void*) string);
+  if (!baseline_json) {
+    fprintf(stderr, "[ERROR] [BENCH] Failed to parse baseline: %s!\n", options->baseline_path);
+    return false;
+  }
+
+  bool passed = true;
+
+  const char* settings[] = { "width", "height", "samples", "threads" };
+  for (usize i = 0; i < (sizeof(settings) / sizeof(const char*)); i++) {
+    cJSON* baseline_setting = cJSON_GetObjectItemCaseSensitive(baseline_json, settings[i]);
+    cJSON* result_setting = cJSON_GetObjectItemCaseSensitive(results_json, settings[i]);
+    if (!cJSON_IsNumber(baseline_setting) || cJSON_GetNumberValue(baseline_setting) != cJSON_GetNumberValue(result_setting)) {
+      fprintf(stderr, "[ERROR] [BENCH] Baseline was rendered with a different %s!\n", settings[i]);
+      passed = false;
+    }
+  }
+
+  cJSON* baseline_scenes = cJSON_GetObjectItemCaseSensitive(baseline_json, "scenes");
+  cJSON* result_scenes = cJSON_GetObjectItemCaseSensitive(results_json, "scenes");
+
+  cJSON* result_scene;
+  cJSON_ArrayForEach(result_scene, result_scenes) {
+    const char* name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(result_scene, "name"));
+    f64 result = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(result_scene, "samples_per_second"));
+
+    cJSON* baseline_scene = NULL;
+    cJSON* candidate;
+    cJSON_ArrayForEach(candidate, baseline_scenes) {
+      const char* candidate_name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(candidate, "name"));
+      if (candidate_name && strcmp(candidate_name, name) == 0) { baseline_scene = candidate; }
+    }
+
+    cJSON* baseline_value = cJSON_GetObjectItemCaseSensitive(baseline_scene, "samples_per_second");
+    if (!cJSON_IsNumber(baseline_value)) {
+      fprintf(stderr, "[ERROR] [BENCH] Baseline has no result for scene: %s!\n", name);
+      passed = false;
+      continue;
+    }
+
+    f64 baseline = cJSON_GetNumberValue(baseline_value);
+    f64 change = ((result / baseline) - 1.0) * 100.0;
+    if (change < -options->tolerance) {
+      fprintf(stderr, "[ERROR] [BENCH] %s: %.2f samples/s is %.1f%% slower than the baseline %.2f samples/s!\n", name, result, -change, baseline);
+      passed = false;
+    } else {
+      printf("[INFO] [BENCH] %s: %+.1f%% against the baseline\n", name, change);
+    }
+  }
+
+  cJSON_Delete(baseline_json);
+  return passed;
+}
+
+// ru_maxrss is in kilobytes on linux
+static u64 bench_peak_memory() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+  return (u64) usage.ru_maxrss * 1024;
+}
+
+// the scene is generated once and written in both formats, each is then loaded a few times and the fastest load counts
+static bool bench_scene_formats(BenchOptions* options) {
+  bool completed = false;
+  cJSON* results_json = NULL;
+  World world = world_create();
+  Camera* camera = camera_create(options->width, options->height);
+  if (!camera) { goto cleanup; }
+
+  SceneGeneratorOptions generator = scene_generator_options_default();
+  generator.sphere_count = options->load_objects;
+  generator.seed = BENCH_DEFAULT_SEED;
+  if (!scene_generator_generate(&world, camera, &generator)) { goto cleanup; }
+
+  if (!world_scene_save(&world, camera, BENCH_LOAD_JSON_PATH)) { goto cleanup; }
+  if (!world_scene_save(&world, camera, BENCH_LOAD_BINARY_PATH)) { goto cleanup; }
+
+  results_json = cJSON_CreateObject();
+  if (!results_json) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "objects", options->load_objects)) { goto error; }
+
+  cJSON* formats_json = cJSON_AddArrayToObject(results_json, "formats");
+  if (!formats_json) { goto error; }
+
+  cJSON* json_format = bench_scene_format("json", BENCH_LOAD_JSON_PATH);
+  if (!json_format) { goto cleanup; }
+  cJSON_AddItemToArray(formats_json, json_format);
+
+  cJSON* binary_format = bench_scene_format("binary", BENCH_LOAD_BINARY_PATH);
+  if (!binary_format) { goto cleanup; }
+  cJSON_AddItemToArray(formats_json, binary_format);
+
+  f64 speedup = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json_format, "load_time")) / cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(binary_format, "load_time"));
+  if (!cJSON_AddNumberToObject(results_json, "binary_speedup", speedup)) { goto error; }
+  printf("[INFO] [BENCH] Binary scenes load %.1fx faster than json with %u objects\n", speedup, options->load_objects);
+
+  const char* string = cJSON_Print(results_json);
+  if (!string) { goto error; }
+  bool written = file_write_string(options->output_path, string);
+  free((void*) string);
+  if (!written) { goto cleanup; }
+
+  printf("[INFO] [BENCH] Wrote %s\n", options->output_path);
+  completed = true;
+  goto cleanup;
+
+error:
+  fprintf(stderr, "[ERROR] [BENCH] Failed to create JSON results!\n");
+
+cleanup:
+  remove(BENCH_LOAD_JSON_PATH);
+  remove(BENCH_LOAD_BINARY_PATH);
+  cJSON_Delete(results_json);
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  return completed;
+}
+
+static cJSON* bench_scene_format(const char* format, const char* path) {
+  struct stat file_stat;
+  if (stat(path, &file_stat) != 0) {
+    fprintf(stderr, "[ERROR] [BENCH] Failed to write %s scene: %s!\n", format, path);
+    return NULL;
+  }
+
+  World world = world_create();
+  Camera* camera = camera_create(1, 1);
+  if (!camera) { return NULL; }
+
+  f64 load_time = INFINITY;
+  bool loaded = true;
+  for (u32 i = 0; i < BENCH_LOAD_REPETITIONS && loaded; i++) {
+    f64 start_time = timer_get_seconds();
+    loaded = world_scene_load(&world, camera, path);
+    f64 time = timer_get_seconds() - start_time;
+    if (time < load_time) { load_time = time; }
+  }
+
+  camera_destroy(camera);
+  world_destroy(&world);
+  if (!loaded) { return NULL; }
+
+  printf("[INFO] [BENCH] %s: %lld bytes loaded in %.3fs\n", format, (long long) file_stat.st_size, load_time);
+
+  cJSON* format_json = cJSON_CreateObject();
+  if (!format_json) { return NULL; }
+
+  if (!cJSON_AddStringToObject(format_json, "format", format) ||
+      !cJSON_AddNumberToObject(format_json, "file_bytes", (f64) file_stat.st_size) ||
+      !cJSON_AddNumberToObject(format_json, "load_time", load_time)) {
+    cJSON_Delete(format_json);
+    return NULL;
+  }
+
+  return format_json;
+}
+
+// the render only provides realistic pixels, every format is then written a few times and the fastest write counts
+static bool bench_image_writes(BenchOptions* options) {
+  bool completed = false;
+  cJSON* results_json = NULL;
+  World world = world_create();
+  Camera* camera = camera_create(options->width, options->height);
+  if (!camera) { goto cleanup; }
+
+  if (!bench_load_scene(&bench_scenes[0], &world, camera, options)) { goto cleanup; }
+  camera_render_export(camera, &world);
+
+  results_json = cJSON_CreateObject();
+  if (!results_json) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "width", options->width)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "height", options->height)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "threads", options->threads)) { goto error; }
+
+  cJSON* formats_json = cJSON_AddArrayToObject(results_json, "formats");
+  if (!formats_json) { goto error; }
+
+  for (usize i = 0; i < sizeof(bench_image_formats) / sizeof(BenchImageFormat); i++) {
+    cJSON* format_json = bench_image_write(&bench_image_formats[i], camera);
+    if (!format_json) { goto cleanup; }
+    cJSON_AddItemToArray(formats_json, format_json);
+  }
+
+  const char* string = cJSON_Print(results_json);
+  if (!string) { goto error; }
+  bool written = file_write_string(options->output_path, string);
+  free((void*) string);
+  if (!written) { goto cleanup; }
+
+  printf("[INFO] [BENCH] Wrote %s\n", options->output_path);
+  completed = true;
+  goto cleanup;
+
+error:
+  fprintf(stderr, "[ERROR] [BENCH] Failed to create JSON results!\n");
+
+cleanup:
+  cJSON_Delete(results_json);
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  return completed;
+}
+
+static cJSON* bench_image_write(const BenchImageFormat* format, Camera* camera) {
+  char path[BENCH_WRITE_PATH_LENGTH];
+  snprintf(path, sizeof(path), "bench-write%s", format->extension);
+
+  ImageOptions image_options = format->options;
+  f64 write_time = INFINITY;
+  bool written = true;
+  for (u32 i = 0; i < BENCH_WRITE_REPETITIONS && written; i++) {
+    f64 start_time = timer_get_seconds();
+    written = image_create(path, format->type, camera, &image_options);
+    f64 time = timer_get_seconds() - start_time;
+    if (time < write_time) { write_time = time; }
+  }
+
+  struct stat file_stat;
+  bool found = (stat(path, &file_stat) == 0);
+  remove(path);
+  if (!written || !found) { return NULL; }
+
+  f64 pixels = (f64) camera->width * camera->height;
+  printf("[INFO] [BENCH] %s: %lld bytes written in %.3fs (%.1f Mpixels/s)\n", format->name, (long long) file_stat.st_size, write_time, (pixels / write_time) / 1e6);
+
+  cJSON* format_json = cJSON_CreateObject();
+  if (!format_json) { return NULL; }
+
+  if (!cJSON_AddStringToObject(format_json, "format", format->name) ||
+      !cJSON_AddNumberToObject(format_json, "file_bytes", (f64) file_stat.st_size) ||
+      !cJSON_AddNumberToObject(format_json, "write_time", write_time)) {
+    cJSON_Delete(format_json);
+    return NULL;
+  }
+
+  return format_json;
+}
+
+// every worker renders with one thread, so the sweep shows how throughput scales with processes alone
+static bool bench_process_scaling(BenchOptions* options) {
+  bool completed = false;
+  cJSON* results_json = NULL;
+  World world = world_create();
+  Camera* camera = camera_create(options->width, options->height);
+  if (!camera) { goto cleanup; }
+
+  if (!bench_load_scene(&bench_scenes[0], &world, camera, options)) { goto cleanup; }
+
+  results_json = cJSON_CreateObject();
+  if (!results_json) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "width", options->width)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "height", options->height)) { goto error; }
+  if (!cJSON_AddNumberToObject(results_json, "samples", options->samples)) { goto error; }
+
+  cJSON* processes_json = cJSON_AddArrayToObject(results_json, "processes");
+  if (!processes_json) { goto error; }
+
+  f64 single_rate = 0.0;
+  for (u32 workers = 1; workers <= options->max_processes; workers++) {
+    if (!distributed_render(camera, &world, workers, 1)) { goto cleanup; }
+
+    f64 rate = camera->sample_count / camera->render_time;
+    if (workers == 1) { single_rate = rate; }
+    printf("[INFO] [BENCH] %u workers: %.2f samples/s (%.2fx one worker)\n", workers, rate, rate / single_rate);
+
+    cJSON* workers_json = cJSON_CreateObject();
+    if (!workers_json) { goto error; }
+    cJSON_AddItemToArray(processes_json, workers_json);
+
+    if (!cJSON_AddNumberToObject(workers_json, "workers", workers) ||
+        !cJSON_AddNumberToObject(workers_json, "render_time", camera->render_time) ||
+        !cJSON_AddNumberToObject(workers_json, "samples_per_second", rate) ||
+        !cJSON_AddNumberToObject(workers_json, "speedup", rate / single_rate)) {
+      goto error;
+    }
+  }
+
+  const char* string = cJSON_Print(results_json);
+  if (!string) { goto error; }
+  bool written = file_write_string(options->output_path, string);
+  free((void*) string);
+  if (!written) { goto cleanup; }
+
+  printf("[INFO] [BENCH] Wrote %s\n", options->output_path);
+  completed = true;
+  goto cleanup;
+
+error:
+  fprintf(stderr, "[ERROR] [BENCH] Failed to create JSON results!\n");
+
+cleanup:
+  cJSON_Delete(results_json);
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  return completed;
+}
@@ -1,12 +1,13 @@
 #include "camera.h"
 
 #include <float.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <pthread.h>
 
+#include "checkpoint.h"
 #include "materials/material.h"
 #include "math/vector2.h"
 #include "math/vector3.h"
@@ -15,44 +16,99 @@
 #include "world.h"
 #include "types/base_types.h"
 #include "random.h"
+#include "scene_stream.h"
+#include "snapshot_writer.h"
+#include "textures/virtual_texture.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "utils/timer.h"
 #include "types/rayhit.h"
 #include "camera.h"
 
-static RayHit cast_indirect(Ray ray, World* world, u64* state);
+#define CAMERA_RANDOM_DIMENSION_PATH 0
+#define CAMERA_RANDOM_DIMENSION_PREVIEW 1
+#define CAMERA_MIN_FOOTPRINT_COSINE 0.01f
+
+// a checkpoint and a snapshot can both be due after the same chunk
+#define CAMERA_EXPORT_COPIES 2
+
+typedef struct CameraExportCopy {
+  Color* framebuffer;
+  Color* framebuffer_even;
+} CameraExportCopy;
+
+typedef struct CameraRenderJob {
+  Camera* camera;
+  World* world;
+  u32 first_sample, sample_count;
+  bool replace; // overwrite instead of accumulate on the first sample, used to replace a preview
+  u32 preview_scale;
+
+  // every slice copies its rows into these once its samples are done
+  CameraExportCopy* copies;
+  u32 copies_count;
+} CameraRenderJob;
+
+static void camera_render_samples_replace(Camera* camera, World* world, u32 first_sample, u32 sample_count, bool replace, CameraExportCopy* copies, u32 copies_count);
+static u32 camera_export_chunk(Camera* camera);
+static RayHit cast_indirect(Ray ray, World* world, RenderStats* stats);
 static RayHit cast_direct(Ray ray, World* world, u64* state);
 
-static Color cast_ray(Ray ray, World* world, u64* state, u32 bounce_count) {
+// a ray cone, the width a pixel covers grows by spread_angle per unit of distance along the whole path, and is
+// projected onto the surface to pick how blurred a texture lookup can be, bounces keep the primary spread so
+// textures seen indirectly are never blurrier than they would be if seen directly from that far away
+static inline f32 uv_footprint(RayHit* rayhit, f32 cone_width) {
+  if (rayhit->uv_scale <= 0.0f) { return 0.0f; }
+
+  f32 cosine = fabsf(vector3_dot_product(rayhit->ray.direction, rayhit->normal)) / vector3_length(rayhit->ray.direction);
+  if (cosine < CAMERA_MIN_FOOTPRINT_COSINE) { cosine = CAMERA_MIN_FOOTPRINT_COSINE; }
+
+  // the geometric mean of the footprint's two axes, the long one stretches by 1 / cosine at grazing angles
+  return cone_width / (rayhit->uv_scale * sqrtf(cosine));
+}
+
+static Color cast_ray(Ray ray, World* world, u64* state, RenderStats* stats, f32 spread_angle) {
   Color result = world->sky_color;
+  f32 cone_width = 0.0f;
 
   usize max_bounces = world->max_ray_bounces;
   if (!world->indirect_light_sampling) { max_bounces = 1; }
 
   for (usize i = 0; i < max_bounces; i++) {
-    RayHit indirect = cast_indirect(ray, world, state);
-    if (!indirect.hit) { return result; }
+    if (i > 0) { RENDER_STATS_ADD(stats, secondary_rays, 1); }
+    RayHit indirect = cast_indirect(ray, world, stats);
+    if (!indirect.hit) {
+      RENDER_STATS_ADD(stats, escaped_rays, 1);
+      return result;
+    }
 
-    result = color_mulitply(result, indirect.material->get_color(indirect.material, indirect.uv_coordinates));
+    RENDER_STATS_ADD(stats, material_evaluations, 1);
+    cone_width += spread_angle * indirect.t * vector3_length(ray.direction);
+    result = color_mulitply(result, indirect.material->get_color(indirect.material, indirect.uv_coordinates, uv_footprint(&indirect, cone_width)));
 
     ray = (Ray) {
       .origin = indirect.hit_position,
       .direction = indirect.material->get_direction(indirect.material, indirect, state)
     };
+    RENDER_STATS_ADD(stats, bounces, 1);
 
     if (world->direct_light_sampling) {
       RayHit direct = cast_direct(ray, world, state);
       if (!direct.hit) { return result; }
-      result = color_mulitply(result, direct.material->get_color(direct.material, direct.uv_coordinates));
+      f32 direct_cone_width = cone_width + spread_angle * direct.t * vector3_length(ray.direction);
+      result = color_mulitply(result, direct.material->get_color(direct.material, direct.uv_coordinates, uv_footprint(&direct, direct_cone_width)));
     }
   }
 
   return result;
 }
 
-static RayHit cast_indirect(Ray ray, World* world, u64* state) {
+static RayHit cast_indirect(Ray ray, World* world, RenderStats* stats) {
   RayHit closest_hit = {0};
   f32 closest_t = FLT_MAX;
 
   for (usize i = 0; i < world->hittables_count; i++) {
+    RENDER_STATS_ADD(stats, intersection_tests[world->hittables[i]->type], 1);
     RayHit rayhit = world->hittables[i]->hit(world->hittables[i], ray);
     if (rayhit.hit && rayhit.t > 0.001f && rayhit.t < closest_t) {
       closest_hit = rayhit;
@@ -67,7 +123,7 @@ static RayHit cast_direct(Ray ray, World* world, u64* state) {
   return (RayHit) {0};
 }
 
-Camera* camera_create(u32 width, u32 height, World* world) {
+Camera* camera_create(u32 width, u32 height) {
   Camera* camera = (Camera*) malloc(sizeof(Camera));
   if (!camera) {
     fprintf(stderr, "[ERROR] [CAMERA] Failed to allocate memory for camera!\n");
@@ -75,7 +131,7 @@ Camera* camera_create(u32 width, u32 height, World* world) {
   }
 
   camera->position = (Vector3) { 0.0f, 0.0f, 0.0f };
-  camera->focal_length = 1.0f;
+  camera->focal_length = DEFAULT_FOCAL_LENGTH;
 
   camera->viewport = viewport_create(width, height);
 
@@ -83,94 +139,184 @@ Camera* camera_create(u32 width, u32 height, World* world) {
   camera->height = height;
 
   u32 framebuffer_length = width * height;
+  camera->framebuffer_even = NULL;
   camera->framebuffer = (Color*) malloc(sizeof(Color) * framebuffer_length);
   if (!camera->framebuffer) {
     fprintf(stderr, "[ERROR] [CAMERA] Failed to allocate memory for framebuffer!\n");
-    return NULL;
+    goto error;
   }
   memset(camera->framebuffer, 0, sizeof(Color) * framebuffer_length);
+
+  camera->framebuffer_even = (Color*) malloc(sizeof(Color) * framebuffer_length);
+  if (!camera->framebuffer_even) {
+    fprintf(stderr, "[ERROR] [CAMERA] Failed to allocate memory for even sample framebuffer!\n");
+    goto error;
+  }
+  memset(camera->framebuffer_even, 0, sizeof(Color) * framebuffer_length);
+  camera->noise_estimate = CAMERA_NOISE_UNKNOWN;
+
   camera->sample_count = 0;
   camera->sample_limit = DEFAULT_SAMPLE_LIMIT;
+  camera->seed = DEFAULT_SEED;
+
+  camera->termination = CAMERA_TERMINATION_SAMPLES;
+  camera->time_budget = DEFAULT_TIME_BUDGET;
+  camera->target_noise = DEFAULT_TARGET_NOISE;
+  camera->render_time = 0.0;
+
   camera->tonemapping_operator = (ToneMappingOperator) { CLAMP, 1.0f };
 
   camera->render = true;
 
-  camera->thread_count = DEFAULT_THREAD_COUNT;
-  camera_render_workers_create(camera, world);
+  camera->progressive_preview = true;
+  camera->preview_scale = 0;
+  camera->invalidated_time = timer_get_seconds();
+  camera->time_to_first_image = 0.0;
+  camera->first_image_pending = true;
+
+  camera->world_snapshots = NULL;
+  camera->checkpoint = NULL;
+  camera->snapshot_writer = NULL;
+  camera->scene_stream = NULL;
+
+  camera->thread_pool = thread_pool_get_global();
+  if (!camera->thread_pool) {
+    fprintf(stderr, "[ERROR] [CAMERA] Failed to get thread pool!\n");
+    goto error;
+  }
+  camera->thread_count = (camera->thread_pool->thread_count > DEFAULT_THREAD_COUNT) ? camera->thread_pool->thread_count : DEFAULT_THREAD_COUNT;
+  camera_reset_stats(camera);
 
   return camera;
+
+error:
+  free(camera->framebuffer);
+  free(camera->framebuffer_even);
+  free(camera);
+  return NULL;
 }
 
-static void* camera_render_worker_work(void* thread_data) {
-  CameraRenderWorkerData* data = (CameraRenderWorkerData*) thread_data;
+static void camera_render_slice(void* job_data, usize slice) {
+  CameraRenderJob* job = (CameraRenderJob*) job_data;
+  Camera* camera = job->camera;
+  World* world = job->world;
+
+  // the remainder rows are spread over the slices instead of all landing on the last one
+  usize start_x = 0, end_x = camera->width;
+  usize start_y = (slice * camera->height) / camera->thread_count;
+  usize end_y = ((slice + 1) * camera->height) / camera->thread_count;
+
+  TraceScope trace = trace_begin("Render Slice");
+  RenderStats stats = {0};
+  f64 start_time = timer_get_seconds();
+
+  // slices never exceed MAX_THREAD_COUNT and a slice index is never in flight twice, so it doubles as the reader slot
+  WorldSnapshot* snapshot = NULL;
+  if (camera->world_snapshots) {
+    snapshot = world_snapshot_acquire(camera->world_snapshots, slice);
+    world = &snapshot->world;
+  }
 
-  while (true) {
-    pthread_mutex_lock(&data->lock);
-    while (!data->work_ready) {
-      pthread_cond_wait(&data->cond, &data->lock);
+  f64 trace_time = timer_get_seconds();
+  stats.stage_time[RENDER_STAGE_SNAPSHOT] = trace_time - start_time;
+
+  f32 spread_angle = camera->viewport.pixel_delta.y / camera->focal_length;
+  for (usize sample = 0; sample < job->sample_count; sample++) {
+    for (usize y = start_y; y < end_y; y++) {
+      for (usize x = start_x; x < end_x; x++) {
+        usize i = (y * camera->width + x);
+        u64 state = random_state_create(i, job->first_sample + sample, CAMERA_RANDOM_DIMENSION_PATH, camera->seed);
+
+        f32 direction_x = camera->viewport.first_pixel.x + (camera->viewport.pixel_delta.x * (x + (random_f32(&state) - 0.5f)));
+        f32 direction_y = camera->viewport.first_pixel.y + (camera->viewport.pixel_delta.y * (y + (random_f32(&state) - 0.5f)));
+        Vector3 direction = { direction_x, direction_y, -camera->focal_length };
+        Color color = cast_ray((Ray) { camera->position, direction }, world, &state, &stats, spread_angle);
+        bool replace = (sample == 0 && job->replace);
+        camera->framebuffer[i] = replace ? color : color_add(camera->framebuffer[i], color);
+        if (((job->first_sample + sample) & 1) == 0) {
+          camera->framebuffer_even[i] = replace ? color : color_add(camera->framebuffer_even[i], color);
+        }
+      }
     }
+  }
 
-    if (!data->alive) {
-      pthread_mutex_unlock(&data->lock);
-      break;
-    }
+  f64 copy_time = timer_get_seconds();
+  stats.stage_time[RENDER_STAGE_SAMPLE] = copy_time - trace_time;
 
-    usize sample_count = 1;
-    if (data->export_mode) {
-      sample_count = data->camera->sample_limit;
-    }
+  // the other slices keep rendering while this one copies, so a checkpoint or snapshot never stops the whole frame
+  usize offset = start_y * camera->width, length = (end_y - start_y) * camera->width;
+  for (u32 i = 0; i < job->copies_count; i++) {
+    memcpy(&job->copies[i].framebuffer[offset], &camera->framebuffer[offset], sizeof(Color) * length);
+    memcpy(&job->copies[i].framebuffer_even[offset], &camera->framebuffer_even[offset], sizeof(Color) * length);
+  }
+  if (job->copies_count > 0) { stats.stage_time[RENDER_STAGE_EXPORT_COPY] = timer_get_seconds() - copy_time; }
+
+  stats.primary_rays = (u64) job->sample_count * (end_y - start_y) * (end_x - start_x);
+  render_stats_add(&camera->slice_stats[slice], &stats);
+
+  if (snapshot) { world_snapshot_release(camera->world_snapshots, slice); }
+  virtual_texture_flush_hits();
+  trace_end(trace);
+}
+
+// traces one ray per preview_scale x preview_scale block and fills the whole block with it
+static void camera_render_preview_slice(void* job_data, usize slice) {
+  CameraRenderJob* job = (CameraRenderJob*) job_data;
+  Camera* camera = job->camera;
+  World* world = job->world;
+  u32 scale = job->preview_scale;
+
+  usize block_rows = (camera->height + scale - 1) / scale;
+  usize block_columns = (camera->width + scale - 1) / scale;
+  // coarse passes can have fewer block rows than slices, then some slices get none instead of one getting all
+  usize start_row = (slice * block_rows) / camera->thread_count;
+  usize end_row = ((slice + 1) * block_rows) / camera->thread_count;
+
+  TraceScope trace = trace_begin("Preview Slice");
+  RenderStats stats = {0};
+  f64 start_time = timer_get_seconds();
+
+  WorldSnapshot* snapshot = NULL;
+  if (camera->world_snapshots) {
+    snapshot = world_snapshot_acquire(camera->world_snapshots, slice);
+    world = &snapshot->world;
+  }
+
+  f64 trace_time = timer_get_seconds();
+  stats.stage_time[RENDER_STAGE_SNAPSHOT] = trace_time - start_time;
 
-    data->work_ready = false;
+  // a preview ray stands in for the whole block, so it may use a blurrier texture level
+  f32 spread_angle = (camera->viewport.pixel_delta.y * scale) / camera->focal_length;
+  for (usize row = start_row; row < end_row; row++) {
+    for (usize column = 0; column < block_columns; column++) {
+      usize start_x = column * scale, start_y = row * scale;
+      usize end_x = (start_x + scale < camera->width) ? start_x + scale : camera->width;
+      usize end_y = (start_y + scale < camera->height) ? start_y + scale : camera->height;
 
-    Camera* camera = data->camera;
-    World* world = data->world;
-    u64* state = &data->state;
-    usize start_x = data->start_x, end_x = data->end_x;
-    usize start_y = data->start_y, end_y = data->end_y;
-    pthread_mutex_unlock(&data->lock);
+      u64 state = random_state_create(start_y * camera->width + start_x, 0, CAMERA_RANDOM_DIMENSION_PREVIEW, camera->seed);
+
+      f32 center_x = (start_x + end_x - 1) * 0.5f;
+      f32 center_y = (start_y + end_y - 1) * 0.5f;
+      f32 direction_x = camera->viewport.first_pixel.x + (camera->viewport.pixel_delta.x * center_x);
+      f32 direction_y = camera->viewport.first_pixel.y + (camera->viewport.pixel_delta.y * center_y);
+      Vector3 direction = { direction_x, direction_y, -camera->focal_length };
+      Color color = cast_ray((Ray) { camera->position, direction }, world, &state, &stats, spread_angle);
 
-    for (usize sample = 0; sample < sample_count; sample++) {
       for (usize y = start_y; y < end_y; y++) {
         for (usize x = start_x; x < end_x; x++) {
-          usize i = (y * camera->width + x);
-
-          f32 direction_x = camera->viewport.first_pixel.x + (camera->viewport.pixel_delta.x * (x + (random_f32(state) - 0.5f)));
-          f32 direction_y = camera->viewport.first_pixel.y + (camera->viewport.pixel_delta.y * (y + (random_f32(state) - 0.5f)));
-          Vector3 direction = { direction_x, direction_y, -camera->focal_length };
-          data->camera->framebuffer[i] = color_add(camera->framebuffer[i], cast_ray((Ray) { camera->position, direction }, world, state, 0));
+          camera->framebuffer[y * camera->width + x] = color;
         }
       }
     }
-
-    pthread_mutex_lock(&data->lock);
-    data->work_done = true;
-    pthread_cond_signal(&data->cond);
-    pthread_mutex_unlock(&data->lock);
   }
 
-  return NULL;
-}
+  stats.primary_rays = (end_row - start_row) * block_columns;
+  stats.stage_time[RENDER_STAGE_PREVIEW] = timer_get_seconds() - trace_time;
+  render_stats_add(&camera->slice_stats[slice], &stats);
 
-void camera_render_workers_create(Camera* camera, World* world) {
-  for (usize i = 0; i < camera->thread_count; i++) {
-    u64 state = time(NULL) * (88172645463325252ULL + i); // probably find a like correct way of doing this
-    camera->render_workers[i].thread_data = (CameraRenderWorkerData) {
-      .alive = true,
-      .export_mode = false,
-      .work_ready = false,
-      .work_done = false,
-
-      .camera = camera,
-      .world = world,
-      .state = state,
-
-      .start_x = 0,
-      .end_x = camera->width,
-    };
-    pthread_mutex_init(&camera->render_workers[i].thread_data.lock, NULL);
-    pthread_cond_init(&camera->render_workers[i].thread_data.cond, NULL);
-    pthread_create(&camera->render_workers[i].thread, NULL, camera_render_worker_work, &camera->render_workers[i].thread_data);
-  }
+  if (snapshot) { world_snapshot_release(camera->world_snapshots, slice); }
+  virtual_texture_flush_hits();
+  trace_end(trace);
 }
 
 void camera_change_resolution(Camera* camera, u32 new_width, u32 new_height) {
@@ -181,6 +327,14 @@ void camera_change_resolution(Camera* camera, u32 new_width, u32 new_height) {
     return;
   }
   camera->framebuffer = temp;
+
+  temp = (Color*) realloc(camera->framebuffer_even, sizeof(Color) * framebuffer_length);
+  if (!temp) {
+    fprintf(stderr, "[ERROR] [CAMERA] Failed to reallocate memory for even sample framebuffer!\n");
+    return;
+  }
+  camera->framebuffer_even = temp;
+
   camera->width = new_width;
   camera->height = new_height;
 
@@ -191,92 +345,218 @@ void camera_change_resolution(Camera* camera, u32 new_width, u32 new_height) {
 
 inline void camera_clear_framebuffer(Camera* camera) {
   memset(camera->framebuffer, 0, sizeof(Color) * camera->width * camera->height);
+  memset(camera->framebuffer_even, 0, sizeof(Color) * camera->width * camera->height);
   camera->sample_count = 0;
+  camera->preview_scale = 0;
+  camera->render_time = 0.0;
+  camera->noise_estimate = CAMERA_NOISE_UNKNOWN;
 }
 
-void camera_render_frame(Camera* camera, World* world) {
-  if (!camera->render || camera->sample_count >= camera->sample_limit) { return; }
+// called whenever the image is no longer valid, with the preview on there is no need to clear
+// the framebuffer since the first preview pass writes every pixel
+void camera_invalidate(Camera* camera) {
+  camera->invalidated_time = timer_get_seconds();
+  camera->first_image_pending = true;
+
+  if (!camera->progressive_preview) {
+    camera_clear_framebuffer(camera);
+    return;
+  }
 
-  for (usize i = 0; i < camera->thread_count; i++) {
-    usize index_delta = (camera->height / camera->thread_count);
+  camera->sample_count = 0;
+  camera->preview_scale = CAMERA_PREVIEW_START_SCALE;
+  camera->render_time = 0.0;
+  camera->noise_estimate = CAMERA_NOISE_UNKNOWN;
+}
 
-    pthread_mutex_lock(&camera->render_workers[i].thread_data.lock);
-    camera->render_workers[i].thread_data.start_y = (i * index_delta);
-    camera->render_workers[i].thread_data.end_y = (i * index_delta) + index_delta;
-    if (i == camera->thread_count - 1) {
-      camera->render_workers[i].thread_data.end_y = camera->height;
+void camera_render_frame(Camera* camera, World* world) {
+  if (!camera->render) { return; }
+  if (camera->preview_scale == 0 && camera_is_finished(camera)) { return; }
+
+  TraceScope trace = trace_begin("Render Frame");
+
+  if (camera->preview_scale > 1) {
+    CameraRenderJob job = { .camera = camera, .world = world, .preview_scale = camera->preview_scale };
+    thread_pool_parallel_for(camera->thread_pool, camera->thread_count, camera_render_preview_slice, &job);
+
+    camera->sample_count = 1;
+    camera->preview_scale /= 2;
+  } else if (camera->preview_scale == 1) {
+    // the framebuffer still holds the last preview pass, the first full sample replaces it
+    camera->sample_count = 0;
+    camera->preview_scale = 0;
+    camera_render_samples_replace(camera, world, 0, 1, true, NULL, 0);
+  } else {
+    camera_render_samples(camera, world, camera->sample_count, 1);
+    if ((camera->sample_count % CAMERA_NOISE_ESTIMATE_INTERVAL) == 0) {
+      camera->noise_estimate = camera_estimate_noise(camera);
     }
-    pthread_mutex_unlock(&camera->render_workers[i].thread_data.lock);
-
-    camera_render_worker_render(&camera->render_workers[i]);
   }
 
-  for (usize i = 0; i < camera->thread_count; i++) {
-    camera_render_worker_wait(&camera->render_workers[i]);
+  if (camera->first_image_pending) {
+    camera->time_to_first_image = timer_get_seconds() - camera->invalidated_time;
+    camera->first_image_pending = false;
   }
 
-  camera->sample_count++;
+  trace_end(trace);
 }
 
+// renders in chunks until camera_is_finished, in time mode a chunk is shrunk or skipped when the
+// average sample time says it would not fit in the remaining budget
 void camera_render_export(Camera* camera, World* world) {
   camera_clear_framebuffer(camera);
-  for (usize i = 0; i < camera->thread_count; i++) {
-    usize index_delta = (camera->height / camera->thread_count);
-
-    pthread_mutex_lock(&camera->render_workers[i].thread_data.lock);
-    camera->render_workers[i].thread_data.export_mode = true;
-    camera->render_workers[i].thread_data.start_y = (i * index_delta);
-    camera->render_workers[i].thread_data.end_y = (i * index_delta) + index_delta;
-    if (i == camera->thread_count - 1) {
-      camera->render_workers[i].thread_data.end_y = camera->height;
+  camera_render_export_continue(camera, world);
+}
+
+void camera_render_export_continue(Camera* camera, World* world) {
+  SceneStream* stream = camera->scene_stream;
+  while (true) {
+    // a streamed scene restarts the accumulation whenever more of it arrived, the export only ends once the
+    // image is finished on the whole scene
+    if (stream && scene_stream_poll(stream, world, camera)) { camera_clear_framebuffer(camera); }
+
+    u32 chunk = camera_export_chunk(camera);
+    if (chunk == 0) {
+      if (!stream) { break; }
+      if (scene_stream_is_loading(stream)) {
+        scene_stream_wait(stream);
+        continue;
+      }
+      if (!scene_stream_poll(stream, world, camera)) { break; }
+
+      camera_clear_framebuffer(camera);
+      continue;
     }
-    pthread_mutex_unlock(&camera->render_workers[i].thread_data.lock);
 
-    camera_render_worker_render(&camera->render_workers[i]);
+    // more of the scene arriving restarts the image anyway, so only one sample is rendered between polls meanwhile
+    if (stream && scene_stream_is_loading(stream)) { chunk = 1; }
+
+    if (camera->snapshot_writer) { chunk = snapshot_writer_clamp_chunk(camera->snapshot_writer, camera->sample_count, chunk); }
+
+    CameraExportCopy copies[CAMERA_EXPORT_COPIES];
+    u32 copies_count = 0;
+    bool checkpoint = camera->checkpoint && checkpoint_begin(camera->checkpoint, &copies[copies_count].framebuffer, &copies[copies_count].framebuffer_even);
+    if (checkpoint) { copies_count++; }
+    bool snapshot = camera->snapshot_writer && snapshot_writer_begin(camera->snapshot_writer, camera->sample_count + chunk, &copies[copies_count].framebuffer, &copies[copies_count].framebuffer_even);
+    if (snapshot) { copies_count++; }
+
+    camera_render_samples_replace(camera, world, camera->sample_count, chunk, false, copies, copies_count);
+
+    if (camera->termination == CAMERA_TERMINATION_NOISE) {
+      camera->noise_estimate = camera_estimate_noise(camera);
+    }
+
+    if (checkpoint) { checkpoint_commit(camera->checkpoint, camera); }
+    if (snapshot) { snapshot_writer_commit(camera->snapshot_writer, camera); }
+
+    // a streamed export counts from when the stream started until an image shows any of the scene
+    if (stream && camera->first_image_pending && world->hittables_count > 0) {
+      camera->time_to_first_image = timer_get_seconds() - camera->invalidated_time;
+      camera->first_image_pending = false;
+    }
   }
 
-  for (usize i = 0; i < camera->thread_count; i++) {
-    camera_render_worker_wait(&camera->render_workers[i]);
-    camera->render_workers[i].thread_data.export_mode = false;
+  camera->noise_estimate = camera_estimate_noise(camera);
+
+  // the final state lets a later run resume with a higher sample limit
+  if (camera->checkpoint) { checkpoint_write(camera->checkpoint, camera); }
+}
+
+// 0 once the export is finished
+static u32 camera_export_chunk(Camera* camera) {
+  if (camera_is_finished(camera)) { return 0; }
+
+  u32 chunk = camera->sample_limit - camera->sample_count;
+  if (chunk > CAMERA_EXPORT_CHUNK_SAMPLES) { chunk = CAMERA_EXPORT_CHUNK_SAMPLES; }
+
+  if (camera->termination == CAMERA_TERMINATION_TIME && camera->sample_count > 0) {
+    f64 sample_time = camera->render_time / camera->sample_count;
+    f64 affordable = (camera->time_budget - camera->render_time) / sample_time;
+    if (affordable < 1.0) { return 0; }
+    if (affordable < chunk) { chunk = (u32) affordable; }
   }
 
-  camera->sample_count = camera->sample_limit;
+  return chunk;
 }
 
-void camera_render_worker_render(CameraRenderWorker* worker) {
-  pthread_mutex_lock(&worker->thread_data.lock);
+void camera_render_samples(Camera* camera, World* world, u32 first_sample, u32 sample_count) {
+  camera_render_samples_replace(camera, world, first_sample, sample_count, false, NULL, 0);
+}
 
-  worker->thread_data.work_done = false;
-  worker->thread_data.work_ready = true;
-  pthread_cond_signal(&worker->thread_data.cond);
-  pthread_mutex_unlock(&worker->thread_data.lock);
+static void camera_render_samples_replace(Camera* camera, World* world, u32 first_sample, u32 sample_count, bool replace, CameraExportCopy* copies, u32 copies_count) {
+  if (camera->thread_count == 0) { camera->thread_count = 1; }
+  if (camera->thread_count > MAX_THREAD_COUNT) { camera->thread_count = MAX_THREAD_COUNT; }
+
+  f64 start_time = timer_get_seconds();
+
+  CameraRenderJob job = {
+    .camera = camera,
+    .world = world,
+    .first_sample = first_sample,
+    .sample_count = sample_count,
+    .replace = replace,
+    .preview_scale = 1,
+    .copies = copies,
+    .copies_count = copies_count
+  };
+  thread_pool_parallel_for(camera->thread_pool, camera->thread_count, camera_render_slice, &job);
+
+  camera->sample_count += sample_count;
+  camera->render_time += timer_get_seconds() - start_time;
 }
 
-void camera_render_worker_wait(CameraRenderWorker* worker) {
-  pthread_mutex_lock(&worker->thread_data.lock);
-  while (!worker->thread_data.work_done) {
-    pthread_cond_wait(&worker->thread_data.cond, &worker->thread_data.lock);
+// the even and odd samples form two independent estimates of the image, half their rms difference
+// estimates the error of the full average, which is then made relative to the mean brightness
+f32 camera_estimate_noise(Camera* camera) {
+  if (camera->sample_count < CAMERA_NOISE_MIN_SAMPLES) { return CAMERA_NOISE_UNKNOWN; }
+
+  f64 even_count = (camera->sample_count + 1) / 2;
+  f64 odd_count = camera->sample_count / 2;
+
+  usize framebuffer_length = camera->width * camera->height;
+  f64 squared_difference = 0.0, brightness = 0.0;
+  for (usize i = 0; i < framebuffer_length; i++) {
+    Color full = camera->framebuffer[i];
+    Color even = camera->framebuffer_even[i];
+
+    f64 full_luminance = (full.red + full.green + full.blue) / 3.0;
+    f64 even_luminance = (even.red + even.green + even.blue) / 3.0;
+    f64 difference = (even_luminance / even_count) - ((full_luminance - even_luminance) / odd_count);
+
+    squared_difference += difference * difference;
+    brightness += full_luminance / camera->sample_count;
   }
-  pthread_mutex_unlock(&worker->thread_data.lock);
+
+  if (brightness <= 0.0) { return 0.0f; }
+  return (f32) ((0.5 * sqrt(squared_difference / framebuffer_length)) / (brightness / framebuffer_length));
 }
 
-void camera_render_workers_destroy(Camera* camera) {
-  for (usize i = 0; i < camera->thread_count; i++) {
-    pthread_mutex_lock(&camera->render_workers[i].thread_data.lock);
-    camera->render_workers[i].thread_data.alive = false;
-    camera->render_workers[i].thread_data.work_ready = true;
-    pthread_cond_signal(&camera->render_workers[i].thread_data.cond);
-    pthread_mutex_unlock(&camera->render_workers[i].thread_data.lock);
+bool camera_is_finished(Camera* camera) {
+  if (camera->sample_count >= camera->sample_limit) { return true; }
 
-    pthread_join(camera->render_workers[i].thread, NULL);
+  switch (camera->termination) {
+    case CAMERA_TERMINATION_SAMPLES: return false;
+    case CAMERA_TERMINATION_TIME: return camera->render_time >= camera->time_budget;
+    case CAMERA_TERMINATION_NOISE: return camera->noise_estimate != CAMERA_NOISE_UNKNOWN && camera->noise_estimate <= camera->target_noise;
+  }
 
-    pthread_mutex_destroy(&camera->render_workers[i].thread_data.lock);
-    pthread_cond_destroy(&camera->render_workers[i].thread_data.cond);
+  return false;
+}
+
+RenderStats camera_get_stats(Camera* camera) {
+  RenderStats total = {0};
+  for (usize i = 0; i < MAX_THREAD_COUNT; i++) {
+    render_stats_add(&total, &camera->slice_stats[i]);
   }
+  return total;
+}
+
+inline void camera_reset_stats(Camera* camera) {
+  memset(camera->slice_stats, 0, sizeof(camera->slice_stats));
 }
 
 void camera_destroy(Camera* camera) {
-  camera_render_workers_destroy(camera);
   free(camera->framebuffer);
+  free(camera->framebuffer_even);
   free(camera);
 }
@@ -0,0 +1,335 @@
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "camera.h"
+#include "trace.h"
+#include "types/base_types.h"
+#include "types/color.h"
+#include "utils/deflate.h"
+#include "utils/timer.h"
+
+// a multiple of every common page size, msync only takes page aligned ranges
+#define CHECKPOINT_ALIGNMENT 65536
+#define CHECKPOINT_HASH_BUFFER_SIZE 16384
+
+#define CHECKPOINT_FNV_OFFSET 14695981039346656037ull
+#define CHECKPOINT_FNV_PRIME 1099511628211ull
+
+static void* checkpoint_writer(void* checkpoint_pointer);
+static bool checkpoint_restore(Checkpoint* checkpoint, Camera* camera, u64 scene_hash);
+static CheckpointSlotHeader* checkpoint_slot_header(Checkpoint* checkpoint, u32 slot);
+static Color* checkpoint_slot_framebuffer(Checkpoint* checkpoint, u32 slot, bool even);
+static u32 checkpoint_slot_crc(const CheckpointSlotHeader* slot_header);
+static void checkpoint_wait(Checkpoint* checkpoint);
+
+static inline u64 checkpoint_align(u64 size) {
+  return (size + CHECKPOINT_ALIGNMENT - 1) & ~((u64) CHECKPOINT_ALIGNMENT - 1);
+}
+
+u64 checkpoint_scene_hash(const char* scene_path) {
+  u64 hash = CHECKPOINT_FNV_OFFSET;
+  FILE* file = fopen(scene_path, "rb");
+  if (!file) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to open scene for hashing: %s!\n", scene_path);
+    return hash;
+  }
+
+  u8 buffer[CHECKPOINT_HASH_BUFFER_SIZE];
+  usize size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    for (usize i = 0; i < size; i++) {
+      hash = (hash ^ buffer[i]) * CHECKPOINT_FNV_PRIME;
+    }
+  }
+
+  fclose(file);
+  return hash;
+}
+
+Checkpoint* checkpoint_open(const char* path, Camera* camera, u64 scene_hash, f64 interval, bool resume) {
+  Checkpoint* checkpoint = (Checkpoint*) calloc(1, sizeof(Checkpoint));
+  if (!checkpoint) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to allocate memory for checkpoint!\n");
+    return NULL;
+  }
+
+  checkpoint->path = path;
+  checkpoint->file_descriptor = -1;
+  checkpoint->data = MAP_FAILED;
+  checkpoint->interval = interval;
+  pthread_mutex_init(&checkpoint->lock, NULL);
+  pthread_cond_init(&checkpoint->work_cond, NULL);
+  pthread_cond_init(&checkpoint->done_cond, NULL);
+
+  u64 framebuffer_size = sizeof(Color) * (u64) camera->width * camera->height;
+  u64 slot_size = checkpoint_align(CHECKPOINT_ALIGNMENT + 2 * framebuffer_size);
+  checkpoint->size = CHECKPOINT_ALIGNMENT + CHECKPOINT_SLOTS * slot_size;
+
+  checkpoint->file_descriptor = open(path, resume ? O_RDWR : (O_RDWR | O_CREAT | O_TRUNC), 0644);
+  if (checkpoint->file_descriptor < 0) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to open checkpoint %s: %s!\n", path, strerror(errno));
+    goto error;
+  }
+
+  if (resume) {
+    struct stat file_stat;
+    if (fstat(checkpoint->file_descriptor, &file_stat) != 0 || (u64) file_stat.st_size != checkpoint->size) {
+      fprintf(stderr, "[ERROR] [CHECKPOINT] Checkpoint %s was not written for a %ux%u render!\n", path, camera->width, camera->height);
+      goto error;
+    }
+  } else if (ftruncate(checkpoint->file_descriptor, (off_t) checkpoint->size) != 0) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to resize checkpoint %s: %s!\n", path, strerror(errno));
+    goto error;
+  }
+
+  checkpoint->data = mmap(NULL, checkpoint->size, PROT_READ | PROT_WRITE, MAP_SHARED, checkpoint->file_descriptor, 0);
+  if (checkpoint->data == MAP_FAILED) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to map checkpoint %s: %s!\n", path, strerror(errno));
+    goto error;
+  }
+  checkpoint->header = (CheckpointHeader*) checkpoint->data;
+
+  if (resume) {
+    if (!checkpoint_restore(checkpoint, camera, scene_hash)) { goto error; }
+  } else {
+    // the slots start out zeroed, so neither counts as complete until the writer commits it
+    CheckpointHeader* header = checkpoint->header;
+    memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->version = CHECKPOINT_VERSION;
+    header->width = camera->width;
+    header->height = camera->height;
+    header->seed = camera->seed;
+    header->scene_hash = scene_hash;
+    header->slot_size = slot_size;
+    for (u32 i = 0; i < CHECKPOINT_SLOTS; i++) {
+      header->slot_offsets[i] = CHECKPOINT_ALIGNMENT + i * slot_size;
+    }
+
+    if (msync(checkpoint->data, CHECKPOINT_ALIGNMENT, MS_SYNC) != 0) {
+      fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to write checkpoint %s: %s!\n", path, strerror(errno));
+      goto error;
+    }
+    checkpoint->newest_slot = CHECKPOINT_SLOTS - 1;
+  }
+
+  checkpoint->alive = true;
+  if (pthread_create(&checkpoint->writer, NULL, checkpoint_writer, checkpoint) != 0) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to create writer thread!\n");
+    checkpoint->alive = false;
+    goto error;
+  }
+
+  checkpoint->last_time = timer_get_seconds();
+  return checkpoint;
+
+error:
+  if (checkpoint->data != MAP_FAILED) { munmap(checkpoint->data, checkpoint->size); }
+  if (checkpoint->file_descriptor >= 0) { close(checkpoint->file_descriptor); }
+  pthread_mutex_destroy(&checkpoint->lock);
+  pthread_cond_destroy(&checkpoint->work_cond);
+  pthread_cond_destroy(&checkpoint->done_cond);
+  free(checkpoint);
+  return NULL;
+}
+
+bool checkpoint_begin(Checkpoint* checkpoint, Color** framebuffer, Color** framebuffer_even) {
+  if (timer_get_seconds() - checkpoint->last_time < checkpoint->interval) { return false; }
+
+  // a slow disk skips a checkpoint instead of holding up the render
+  pthread_mutex_lock(&checkpoint->lock);
+  bool busy = checkpoint->pending;
+  u32 slot = (checkpoint->newest_slot + 1) % CHECKPOINT_SLOTS;
+  pthread_mutex_unlock(&checkpoint->lock);
+  if (busy) { return false; }
+
+  checkpoint->writing_slot = slot;
+  *framebuffer = checkpoint_slot_framebuffer(checkpoint, slot, false);
+  *framebuffer_even = checkpoint_slot_framebuffer(checkpoint, slot, true);
+  return true;
+}
+
+void checkpoint_commit(Checkpoint* checkpoint, Camera* camera) {
+  CheckpointSlotHeader slot_header = {
+    .generation = checkpoint->generation + 1,
+    .sample_count = camera->sample_count,
+    .noise_estimate = camera->noise_estimate,
+    .render_time = camera->render_time
+  };
+  slot_header.crc = checkpoint_slot_crc(&slot_header);
+
+  pthread_mutex_lock(&checkpoint->lock);
+  checkpoint->writing_header = slot_header;
+  checkpoint->pending = true;
+  pthread_cond_signal(&checkpoint->work_cond);
+  pthread_mutex_unlock(&checkpoint->lock);
+
+  checkpoint->last_time = timer_get_seconds();
+}
+
+bool checkpoint_write(Checkpoint* checkpoint, Camera* camera) {
+  checkpoint_wait(checkpoint);
+
+  u64 generation = checkpoint->generation;
+  u32 slot = (checkpoint->newest_slot + 1) % CHECKPOINT_SLOTS;
+  usize framebuffer_size = sizeof(Color) * camera->width * camera->height;
+
+  checkpoint->writing_slot = slot;
+  memcpy(checkpoint_slot_framebuffer(checkpoint, slot, false), camera->framebuffer, framebuffer_size);
+  memcpy(checkpoint_slot_framebuffer(checkpoint, slot, true), camera->framebuffer_even, framebuffer_size);
+  checkpoint_commit(checkpoint, camera);
+
+  checkpoint_wait(checkpoint);
+  return checkpoint->generation > generation;
+}
+
+void checkpoint_close(Checkpoint* checkpoint) {
+  pthread_mutex_lock(&checkpoint->lock);
+  checkpoint->alive = false;
+  pthread_cond_signal(&checkpoint->work_cond);
+  pthread_mutex_unlock(&checkpoint->lock);
+  pthread_join(checkpoint->writer, NULL);
+
+  munmap(checkpoint->data, checkpoint->size);
+  close(checkpoint->file_descriptor);
+  pthread_mutex_destroy(&checkpoint->lock);
+  pthread_cond_destroy(&checkpoint->work_cond);
+  pthread_cond_destroy(&checkpoint->done_cond);
+  free(checkpoint);
+}
+
+// the copies have to reach the disk before the header that declares them complete does
+static void* checkpoint_writer(void* checkpoint_pointer) {
+  Checkpoint* checkpoint = (Checkpoint*) checkpoint_pointer;
+  trace_set_thread_name("Checkpoint Writer");
+
+  pthread_mutex_lock(&checkpoint->lock);
+  while (true) {
+    while (checkpoint->alive && !checkpoint->pending) {
+      pthread_cond_wait(&checkpoint->work_cond, &checkpoint->lock);
+    }
+    if (!checkpoint->pending) { break; }
+
+    u32 slot = checkpoint->writing_slot;
+    CheckpointSlotHeader slot_header = checkpoint->writing_header;
+    pthread_mutex_unlock(&checkpoint->lock);
+
+    TraceScope trace = trace_begin("Checkpoint");
+    f64 start_time = timer_get_seconds();
+
+    u8* slot_data = checkpoint->data + checkpoint->header->slot_offsets[slot];
+    bool written = msync(slot_data + CHECKPOINT_ALIGNMENT, checkpoint->header->slot_size - CHECKPOINT_ALIGNMENT, MS_SYNC) == 0;
+    if (written) {
+      memcpy(slot_data, &slot_header, sizeof(slot_header));
+      written = msync(slot_data, CHECKPOINT_ALIGNMENT, MS_SYNC) == 0;
+    }
+    if (!written) {
+      fprintf(stderr, "[ERROR] [CHECKPOINT] Failed to write checkpoint %s: %s!\n", checkpoint->path, strerror(errno));
+    }
+
+    f64 write_time = timer_get_seconds() - start_time;
+    trace_end(trace);
+
+    pthread_mutex_lock(&checkpoint->lock);
+    if (written) {
+      checkpoint->newest_slot = slot;
+      checkpoint->generation = slot_header.generation;
+      checkpoint->written_count++;
+    } else {
+      checkpoint->failed = true;
+    }
+    checkpoint->write_time += write_time;
+    checkpoint->pending = false;
+    pthread_cond_broadcast(&checkpoint->done_cond);
+  }
+  pthread_mutex_unlock(&checkpoint->lock);
+
+  return NULL;
+}
+
+static bool checkpoint_restore(Checkpoint* checkpoint, Camera* camera, u64 scene_hash) {
+  CheckpointHeader* header = checkpoint->header;
+  if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 || header->version != CHECKPOINT_VERSION) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] %s is not a version %u checkpoint!\n", checkpoint->path, CHECKPOINT_VERSION);
+    return false;
+  }
+
+  u64 slot_size = (checkpoint->size - CHECKPOINT_ALIGNMENT) / CHECKPOINT_SLOTS;
+  if (header->width != camera->width || header->height != camera->height || header->slot_size != slot_size) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Checkpoint %s was written for a %ux%u render!\n", checkpoint->path, header->width, header->height);
+    return false;
+  }
+
+  for (u32 i = 0; i < CHECKPOINT_SLOTS; i++) {
+    if (header->slot_offsets[i] != CHECKPOINT_ALIGNMENT + i * slot_size) {
+      fprintf(stderr, "[ERROR] [CHECKPOINT] Checkpoint %s has an invalid slot table!\n", checkpoint->path);
+      return false;
+    }
+  }
+
+  if (header->seed != camera->seed || header->scene_hash != scene_hash) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Checkpoint %s was written for a different scene or seed!\n", checkpoint->path);
+    return false;
+  }
+
+  CheckpointSlotHeader* newest = NULL;
+  for (u32 i = 0; i < CHECKPOINT_SLOTS; i++) {
+    CheckpointSlotHeader* slot_header = checkpoint_slot_header(checkpoint, i);
+    if (slot_header->generation == 0 || slot_header->crc != checkpoint_slot_crc(slot_header)) { continue; }
+
+    if (!newest || slot_header->generation > newest->generation) {
+      newest = slot_header;
+      checkpoint->newest_slot = i;
+    }
+  }
+
+  if (!newest) {
+    fprintf(stderr, "[ERROR] [CHECKPOINT] Checkpoint %s holds no complete checkpoint yet!\n", checkpoint->path);
+    return false;
+  }
+
+  usize framebuffer_size = sizeof(Color) * camera->width * camera->height;
+  memcpy(camera->framebuffer, checkpoint_slot_framebuffer(checkpoint, checkpoint->newest_slot, false), framebuffer_size);
+  memcpy(camera->framebuffer_even, checkpoint_slot_framebuffer(checkpoint, checkpoint->newest_slot, true), framebuffer_size);
+  camera->sample_count = newest->sample_count;
+  camera->noise_estimate = newest->noise_estimate;
+  camera->render_time = newest->render_time;
+  camera->preview_scale = 0;
+  checkpoint->generation = newest->generation;
+
+  printf("[INFO] [CHECKPOINT] Resuming %s at %u samples after %.3fs of rendering\n", checkpoint->path, camera->sample_count, camera->render_time);
+  return true;
+}
+
+static CheckpointSlotHeader* checkpoint_slot_header(Checkpoint* checkpoint, u32 slot) {
+  return (CheckpointSlotHeader*) (checkpoint->data + checkpoint->header->slot_offsets[slot]);
+}
+
+static Color* checkpoint_slot_framebuffer(Checkpoint* checkpoint, u32 slot, bool even) {
+  u64 framebuffer_size = sizeof(Color) * (u64) checkpoint->header->width * checkpoint->header->height;
+  u8* slot_data = checkpoint->data + checkpoint->header->slot_offsets[slot] + CHECKPOINT_ALIGNMENT;
+  return (Color*) (even ? slot_data + framebuffer_size : slot_data);
+}
+
+static u32 checkpoint_slot_crc(const CheckpointSlotHeader* slot_header) {
+  CheckpointSlotHeader copy = *slot_header;
+  copy.crc = 0;
+  return deflate_crc32(DEFLATE_CRC32_INIT, (const u8*) &copy, sizeof(copy));
+}
+
+static void checkpoint_wait(Checkpoint* checkpoint) {
+  pthread_mutex_lock(&checkpoint->lock);
+  while (checkpoint->pending) {
+    pthread_cond_wait(&checkpoint->done_cond, &checkpoint->lock);
+  }
+  pthread_mutex_unlock(&checkpoint->lock);
+}
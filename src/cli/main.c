@@ -0,0 +1,678 @@
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "animation.h"
+#include "batch.h"
+#include "camera.h"
+#include "checkpoint.h"
+#include "distributed.h"
+#include "image.h"
+#include "render_stats.h"
+#include "scene_generator.h"
+#include "scene_stream.h"
+#include "snapshot_writer.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "world.h"
+#include "textures/image.h"
+#include "textures/virtual_texture.h"
+#include "types/base_types.h"
+#include "utils/timer.h"
+
+#define CLI_DEFAULT_WIDTH 640
+#define CLI_DEFAULT_HEIGHT 480
+#define CLI_DEFAULT_OUTPUT "render.hdr"
+#define CLI_PATH_LENGTH 1024
+
+// generator options only exist in long form
+enum {
+  CLI_OPTION_SPHERES = 256,
+  CLI_OPTION_PLANES,
+  CLI_OPTION_DISTRIBUTION,
+  CLI_OPTION_MATERIALS,
+  CLI_OPTION_EMISSIVE,
+  CLI_OPTION_TEXTURE,
+  CLI_OPTION_TEXTURE_FRACTION,
+  CLI_OPTION_EXR_FLOAT,
+  CLI_OPTION_EXR_AOVS,
+  CLI_OPTION_CHECKPOINT,
+  CLI_OPTION_CHECKPOINT_INTERVAL,
+  CLI_OPTION_RESUME,
+  CLI_OPTION_SNAPSHOT,
+  CLI_OPTION_SNAPSHOT_SAMPLES,
+  CLI_OPTION_SNAPSHOT_INTERVAL,
+  CLI_OPTION_TEXTURE_CACHE,
+  CLI_OPTION_TEXTURE_BUDGET,
+  CLI_OPTION_TEXTURE_PAGE_WAIT,
+  CLI_OPTION_STREAM
+};
+
+typedef struct CLIOptions {
+  const char* scene_path;
+  const char* output_path;
+  ImageType output_type;
+  ImageOptions image_options;
+  const char* trace_path;
+  const char* jobs_path;
+  bool animation;
+  const char* convert_path;
+  u32 width, height;
+  u32 samples;
+  bool samples_set;
+  CameraTermination termination;
+  f64 time_budget;
+  f32 target_noise;
+  u32 threads;
+  u32 processes;
+  u32 seed;
+  bool seed_set;
+
+  // with a checkpoint path the accumulation is saved every interval, with resume the render continues from it
+  const char* checkpoint_path;
+  f64 checkpoint_interval;
+  bool resume;
+
+  // every snapshot path is rewritten whenever a snapshot is due during the render
+  SnapshotOptions snapshot;
+  bool snapshot_interval_set;
+
+  // with a cache directory image textures are paged from tiled cache files instead of kept in memory
+  VirtualTextureOptions texture_paging;
+
+  // with streaming the render starts on the first hittables and restarts whenever more of the scene loaded
+  bool stream;
+
+  // with a generate path the cli writes a procedural scene instead of rendering one
+  const char* generate_path;
+  SceneGeneratorOptions generator;
+} CLIOptions;
+
+static void cli_print_usage(const char* program);
+static bool cli_parse_u32(const char* string, u32* value);
+static bool cli_parse_f64(const char* string, f64* value);
+
+static bool cli_parse_options(int argc, char** argv, CLIOptions* options);
+static bool cli_parse_distribution(const char* string, SceneGeneratorDistribution* distribution);
+static bool cli_parse_material_weights(const char* string, f32 weights[3]);
+static bool cli_generate(CLIOptions* options);
+static bool cli_batch(CLIOptions* options);
+static bool cli_convert(CLIOptions* options);
+static bool cli_write_trace(CLIOptions* options);
+static bool cli_write_image(const char* path, CLIOptions* options, Camera* camera);
+static bool cli_render_animation(CLIOptions* options, World* world, Camera* camera);
+static bool cli_frame_path(char* buffer, usize buffer_size, const char* output_path, u32 frame);
+
+int main(int argc, char** argv) {
+  CLIOptions options;
+  if (!cli_parse_options(argc, argv, &options)) {
+    cli_print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (options.generate_path) { return cli_generate(&options) ? EXIT_SUCCESS : EXIT_FAILURE; }
+  if (options.convert_path) { return cli_convert(&options) ? EXIT_SUCCESS : EXIT_FAILURE; }
+
+  trace_set_thread_name("Main");
+  if (options.trace_path) { trace_start(); }
+
+  if (options.texture_paging.cache_directory && !virtual_texture_pager_start(&options.texture_paging)) { return EXIT_FAILURE; }
+
+  s32 status = EXIT_FAILURE;
+  if (options.jobs_path) {
+    bool completed = cli_batch(&options);
+    if (cli_write_trace(&options) && completed) { status = EXIT_SUCCESS; }
+
+    if (virtual_texture_pager_is_running()) { virtual_texture_print_stats(); }
+    virtual_texture_pager_stop();
+    thread_pool_global_destroy();
+    trace_destroy();
+    return status;
+  }
+
+  World world = world_create();
+  Checkpoint* checkpoint = NULL;
+  SnapshotWriter* snapshot_writer = NULL;
+  SceneStream* scene_stream = NULL;
+  Camera* camera = camera_create(options.width, options.height);
+  if (!camera) { goto cleanup; }
+
+  f64 load_start = timer_get_seconds();
+  if (options.stream) {
+    SceneStreamOptions stream_options = scene_stream_options_default();
+    stream_options.print_progress = true;
+    scene_stream = scene_stream_start(options.scene_path, &stream_options);
+    if (!scene_stream) { goto cleanup; }
+
+    // the seed override below has to win over the scene's
+    scene_stream_wait_camera(scene_stream, camera);
+    if (scene_stream_get_progress(scene_stream).failed) { goto cleanup; }
+
+    camera->scene_stream = scene_stream;
+    camera->invalidated_time = load_start;
+    camera->first_image_pending = true;
+    printf("[INFO] [CLI] Streaming %s\n", options.scene_path);
+  } else {
+    if (!world_scene_load(&world, camera, options.scene_path)) { goto cleanup; }
+    printf("[INFO] [CLI] Loaded %s in %.3fs\n", options.scene_path, timer_get_seconds() - load_start);
+    texture_image_cache_print_stats();
+  }
+
+  // with a time or noise target the sample count only caps the render when given explicitly
+  camera->sample_limit = (options.termination == CAMERA_TERMINATION_SAMPLES || options.samples_set) ? options.samples : UINT32_MAX;
+  camera->termination = options.termination;
+  camera->time_budget = options.time_budget;
+  camera->target_noise = options.target_noise;
+  if (options.threads > 0) { camera->thread_count = options.threads; }
+  if (options.seed_set) { camera->seed = options.seed; }
+
+  if (options.checkpoint_path) {
+    checkpoint = checkpoint_open(options.checkpoint_path, camera, checkpoint_scene_hash(options.scene_path), options.checkpoint_interval, options.resume);
+    if (!checkpoint) { goto cleanup; }
+    camera->checkpoint = checkpoint;
+  }
+
+  if (options.snapshot.outputs_count > 0) {
+    snapshot_writer = snapshot_writer_create(camera, &options.snapshot);
+    if (!snapshot_writer) { goto cleanup; }
+    camera->snapshot_writer = snapshot_writer;
+  }
+
+  if (options.animation) {
+    if (!cli_render_animation(&options, &world, camera)) { goto cleanup; }
+    if (!cli_write_trace(&options)) { goto cleanup; }
+
+    status = EXIT_SUCCESS;
+    goto cleanup;
+  }
+
+  printf("[INFO] [CLI] Rendering %s at %ux%u ", options.scene_path, options.width, options.height);
+  switch (options.termination) {
+    case CAMERA_TERMINATION_SAMPLES: printf("with %u samples\n", camera->sample_limit); break;
+    case CAMERA_TERMINATION_TIME: printf("for %.2fs\n", camera->time_budget); break;
+    case CAMERA_TERMINATION_NOISE: printf("to %.4f relative noise\n", camera->target_noise); break;
+  }
+
+  u32 first_sample = camera->sample_count;
+  f64 start_time = timer_get_seconds();
+  if (options.processes > 0) {
+    if (!distributed_render(camera, &world, options.processes, camera->thread_count)) { goto cleanup; }
+  } else if (options.resume) {
+    camera_render_export_continue(camera, &world);
+  } else {
+    camera_render_export(camera, &world);
+  }
+  f64 render_time = timer_get_seconds() - start_time;
+
+  if (scene_stream) {
+    SceneStreamProgress progress = scene_stream_get_progress(scene_stream);
+    if (progress.failed) { goto cleanup; }
+
+    printf("[INFO] [CLI] Streamed %u hittables in %u chunks, the first after %.3fs and the first image after %.3fs, loaded in %.3fs\n",
+      progress.hittables_added, progress.chunks_added, progress.first_chunk_time, camera->time_to_first_image, progress.load_time);
+    texture_image_cache_print_stats();
+  }
+
+  u32 rendered_samples = camera->sample_count - first_sample;
+  printf("[INFO] [CLI] Rendered %u samples in %.3fs (%.2f samples/s)\n", rendered_samples, render_time, (rendered_samples / render_time));
+  if (camera->noise_estimate != CAMERA_NOISE_UNKNOWN) {
+    printf("[INFO] [CLI] Estimated relative noise %.4f\n", camera->noise_estimate);
+  }
+
+  // worker processes keep their counters, only an in-process render has any to show
+  if (options.processes == 0) {
+    RenderStats stats = camera_get_stats(camera);
+    render_stats_print(&stats, render_time);
+  }
+
+  if (virtual_texture_pager_is_running()) { virtual_texture_print_stats(); }
+
+  if (checkpoint) {
+    printf("[INFO] [CLI] Wrote %u checkpoints to %s, flushing them took %.3fs on the writer thread\n", checkpoint->written_count, options.checkpoint_path, checkpoint->write_time);
+    if (checkpoint->failed) { goto cleanup; }
+  }
+
+  if (snapshot_writer) { snapshot_writer_print_stats(snapshot_writer); }
+
+  f64 write_start = timer_get_seconds();
+  if (!cli_write_image(options.output_path, &options, camera)) { goto cleanup; }
+  printf("[INFO] [CLI] Wrote %s and %s.json in %.3fs\n", options.output_path, options.output_path, timer_get_seconds() - write_start);
+
+  // the final image is still worth keeping, but the run has to fail
+  if (snapshot_writer && snapshot_writer->failed) {
+    fprintf(stderr, "[ERROR] [CLI] Some snapshots could not be written!\n");
+    goto cleanup;
+  }
+
+  if (!cli_write_trace(&options)) { goto cleanup; }
+
+  status = EXIT_SUCCESS;
+
+cleanup:
+  if (checkpoint) { checkpoint_close(checkpoint); }
+  if (snapshot_writer) { snapshot_writer_destroy(snapshot_writer); }
+  if (scene_stream) { scene_stream_destroy(scene_stream); }
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  virtual_texture_pager_stop();
+  thread_pool_global_destroy();
+  trace_destroy();
+  return status;
+}
+
+static void cli_print_usage(const char* program) {
+  fprintf(stderr,
+    "Usage: %s [options] <scene>\n"
+    "       %s [options] --jobs <file>\n"
+    "  -W, --width <pixels>      image width (default %u)\n"
+    "  -H, --height <pixels>     image height (default %u)\n"
+    "  -s, --samples <count>     samples per pixel, or the cap with a budget or noise target (default %u)\n"
+    "  -B, --time-budget <secs>  stop once this much time was spent rendering\n"
+    "  -N, --target-noise <rel>  stop once the estimated relative noise is this low\n"
+    "  -t, --threads <count>     row slices rendered in parallel per process (default one per core, at least %u, max %u)\n"
+    "  -p, --processes <count>   render in forked worker processes (default 0, in-process)\n"
+    "  -S, --seed <seed>         override the scene seed\n"
+    "  -o, --output <path>       output image, .hdr, .jpg, .png or .exr (default %s)\n"
+    "  --exr-float               write 32 bit float instead of half exr channels\n"
+    "  --exr-aovs                add the even and odd sample averages as exr layers\n"
+    "  --checkpoint <path>       save the accumulation to this file while rendering and once done\n"
+    "  --checkpoint-interval <s> seconds between checkpoints (default %.0f)\n"
+    "  --resume                  continue bit exactly from the checkpoint file, e.g. with a higher sample count\n"
+    "  --snapshot <path>         rewrite this image while rendering, .hdr, .jpg, .png or .exr, up to %u times\n"
+    "  --snapshot-samples <n>    write the snapshots every n samples\n"
+    "  --snapshot-interval <s>   write the snapshots every s seconds (default %.0f unless only samples are given)\n"
+    "  --texture-cache <dir>     page image textures from tiled cache files written to this directory\n"
+    "  --texture-budget <MiB>    memory for paged texture data (default %zu)\n"
+    "  --texture-page-wait       wait for missing pages instead of using a coarser level meanwhile\n"
+    "  --stream                  start rendering on the first loaded hittables, restarting as more of the scene loads\n"
+    "  -T, --trace <path>        record a chrome trace of the run\n"
+    "  -A, --animation           render the scene's keyframes as numbered frames, e.g. render_0000.hdr\n"
+    "  -C, --convert <path>      save the scene to another file instead of rendering, .bscene is binary\n"
+    "  -J, --jobs <path>         render every job in a JSON job file, the options above are the defaults\n"
+    "  -h, --help                show this message\n"
+    "\n"
+    "Usage: %s --generate <scene> [options]\n"
+    "  -G, --generate <path>     write a procedural stress scene instead of rendering\n"
+    "  --spheres <count>         sphere count (default %u)\n"
+    "  --planes <count>          randomly oriented plane count (default %u)\n"
+    "  --distribution <name>     uniform, clustered or nested-glass (default uniform)\n"
+    "  --materials <d,m,g>       relative diffuse, metal and glass weights (default 1,1,1)\n"
+    "  --emissive <fraction>     fraction of emissive objects (default %.2f)\n"
+    "  --texture <path>          image texture shared by the textured objects\n"
+    "  --texture-fraction <f>    fraction of objects using the texture (default 0)\n"
+    "  -S, --seed <seed>         generator seed\n",
+    program, program, CLI_DEFAULT_WIDTH, CLI_DEFAULT_HEIGHT, DEFAULT_SAMPLE_LIMIT, DEFAULT_THREAD_COUNT, MAX_THREAD_COUNT, CLI_DEFAULT_OUTPUT, DEFAULT_CHECKPOINT_INTERVAL, SNAPSHOT_MAX_OUTPUTS, DEFAULT_SNAPSHOT_INTERVAL,
+    DEFAULT_VIRTUAL_TEXTURE_BUDGET / (1024 * 1024),
+    program, scene_generator_options_default().sphere_count, scene_generator_options_default().plane_count, scene_generator_options_default().emissive_fraction
+  );
+}
+
+static bool cli_parse_u32(const char* string, u32* value) {
+  char* end;
+  unsigned long parsed = strtoul(string, &end, 10);
+  if (end == string || *end != '\0' || parsed > UINT32_MAX) { return false; }
+
+  *value = (u32) parsed;
+  return true;
+}
+
+static bool cli_parse_f64(const char* string, f64* value) {
+  char* end;
+  *value = strtod(string, &end);
+  return (end != string && *end == '\0');
+}
+
+static bool cli_parse_options(int argc, char** argv, CLIOptions* options) {
+  *options = (CLIOptions) {
+    .scene_path = NULL,
+    .output_path = CLI_DEFAULT_OUTPUT,
+    .output_type = HDR,
+    .image_options = image_options_default(),
+    .trace_path = NULL,
+    .jobs_path = NULL,
+    .animation = false,
+    .convert_path = NULL,
+    .width = CLI_DEFAULT_WIDTH,
+    .height = CLI_DEFAULT_HEIGHT,
+    .samples = DEFAULT_SAMPLE_LIMIT,
+    .samples_set = false,
+    .termination = CAMERA_TERMINATION_SAMPLES,
+    .time_budget = DEFAULT_TIME_BUDGET,
+    .target_noise = DEFAULT_TARGET_NOISE,
+    .threads = 0,
+    .processes = 0,
+    .seed = DEFAULT_SEED,
+    .seed_set = false,
+    .checkpoint_path = NULL,
+    .checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL,
+    .resume = false,
+    .snapshot = snapshot_options_default(),
+    .snapshot_interval_set = false,
+    .texture_paging = virtual_texture_options_default(),
+    .stream = false,
+    .generate_path = NULL,
+    .generator = scene_generator_options_default()
+  };
+
+  static const struct option long_options[] = {
+    { "width", required_argument, NULL, 'W' },
+    { "height", required_argument, NULL, 'H' },
+    { "samples", required_argument, NULL, 's' },
+    { "time-budget", required_argument, NULL, 'B' },
+    { "target-noise", required_argument, NULL, 'N' },
+    { "threads", required_argument, NULL, 't' },
+    { "processes", required_argument, NULL, 'p' },
+    { "seed", required_argument, NULL, 'S' },
+    { "output", required_argument, NULL, 'o' },
+    { "trace", required_argument, NULL, 'T' },
+    { "animation", no_argument, NULL, 'A' },
+    { "convert", required_argument, NULL, 'C' },
+    { "jobs", required_argument, NULL, 'J' },
+    { "exr-float", no_argument, NULL, CLI_OPTION_EXR_FLOAT },
+    { "exr-aovs", no_argument, NULL, CLI_OPTION_EXR_AOVS },
+    { "checkpoint", required_argument, NULL, CLI_OPTION_CHECKPOINT },
+    { "checkpoint-interval", required_argument, NULL, CLI_OPTION_CHECKPOINT_INTERVAL },
+    { "resume", no_argument, NULL, CLI_OPTION_RESUME },
+    { "snapshot", required_argument, NULL, CLI_OPTION_SNAPSHOT },
+    { "snapshot-samples", required_argument, NULL, CLI_OPTION_SNAPSHOT_SAMPLES },
+    { "snapshot-interval", required_argument, NULL, CLI_OPTION_SNAPSHOT_INTERVAL },
+    { "texture-cache", required_argument, NULL, CLI_OPTION_TEXTURE_CACHE },
+    { "texture-budget", required_argument, NULL, CLI_OPTION_TEXTURE_BUDGET },
+    { "texture-page-wait", no_argument, NULL, CLI_OPTION_TEXTURE_PAGE_WAIT },
+    { "stream", no_argument, NULL, CLI_OPTION_STREAM },
+    { "help", no_argument, NULL, 'h' },
+    { "generate", required_argument, NULL, 'G' },
+    { "spheres", required_argument, NULL, CLI_OPTION_SPHERES },
+    { "planes", required_argument, NULL, CLI_OPTION_PLANES },
+    { "distribution", required_argument, NULL, CLI_OPTION_DISTRIBUTION },
+    { "materials", required_argument, NULL, CLI_OPTION_MATERIALS },
+    { "emissive", required_argument, NULL, CLI_OPTION_EMISSIVE },
+    { "texture", required_argument, NULL, CLI_OPTION_TEXTURE },
+    { "texture-fraction", required_argument, NULL, CLI_OPTION_TEXTURE_FRACTION },
+    { NULL, 0, NULL, 0 }
+  };
+
+  s32 option;
+  while ((option = getopt_long(argc, argv, "W:H:s:B:N:t:p:S:o:T:AC:J:G:h", long_options, NULL)) != -1) {
+    bool valid = true;
+    switch (option) {
+      case 'W': valid = cli_parse_u32(optarg, &options->width) && options->width > 0; break;
+      case 'H': valid = cli_parse_u32(optarg, &options->height) && options->height > 0; break;
+      case 's': valid = cli_parse_u32(optarg, &options->samples) && options->samples > 0; options->samples_set = true; break;
+      case 'B': valid = cli_parse_f64(optarg, &options->time_budget) && options->time_budget > 0.0; options->termination = CAMERA_TERMINATION_TIME; break;
+      case 'N': {
+        f64 target_noise;
+        valid = cli_parse_f64(optarg, &target_noise) && target_noise > 0.0;
+        options->target_noise = (f32) target_noise;
+        options->termination = CAMERA_TERMINATION_NOISE;
+      } break;
+      case 't': valid = cli_parse_u32(optarg, &options->threads) && options->threads > 0 && options->threads <= MAX_THREAD_COUNT; break;
+      case 'p': valid = cli_parse_u32(optarg, &options->processes) && options->processes <= DISTRIBUTED_MAX_WORKERS; break;
+      case 'S': valid = cli_parse_u32(optarg, &options->seed); options->seed_set = true; break;
+      case 'o': options->output_path = optarg; valid = image_type_from_path(optarg, &options->output_type); break;
+      case 'T': options->trace_path = optarg; break;
+      case 'A': options->animation = true; break;
+      case 'C': options->convert_path = optarg; break;
+      case 'J': options->jobs_path = optarg; break;
+      case 'G': options->generate_path = optarg; break;
+      case CLI_OPTION_SPHERES: valid = cli_parse_u32(optarg, &options->generator.sphere_count); break;
+      case CLI_OPTION_PLANES: valid = cli_parse_u32(optarg, &options->generator.plane_count); break;
+      case CLI_OPTION_DISTRIBUTION: valid = cli_parse_distribution(optarg, &options->generator.distribution); break;
+      case CLI_OPTION_MATERIALS: valid = cli_parse_material_weights(optarg, options->generator.material_weights); break;
+      case CLI_OPTION_EMISSIVE:
+      case CLI_OPTION_TEXTURE_FRACTION: {
+        f64 fraction;
+        valid = cli_parse_f64(optarg, &fraction) && fraction >= 0.0 && fraction <= 1.0;
+        if (option == CLI_OPTION_EMISSIVE) {
+          options->generator.emissive_fraction = (f32) fraction;
+        } else {
+          options->generator.texture_fraction = (f32) fraction;
+        }
+      } break;
+      case CLI_OPTION_TEXTURE: options->generator.texture_path = optarg; break;
+      case CLI_OPTION_EXR_FLOAT: options->image_options.exr_float = true; break;
+      case CLI_OPTION_EXR_AOVS: options->image_options.exr_aovs = true; break;
+      case CLI_OPTION_CHECKPOINT: options->checkpoint_path = optarg; break;
+      case CLI_OPTION_CHECKPOINT_INTERVAL: valid = cli_parse_f64(optarg, &options->checkpoint_interval) && options->checkpoint_interval >= 0.0; break;
+      case CLI_OPTION_RESUME: options->resume = true; break;
+      case CLI_OPTION_SNAPSHOT: {
+        SnapshotOptions* snapshot = &options->snapshot;
+        valid = snapshot->outputs_count < SNAPSHOT_MAX_OUTPUTS && image_type_from_path(optarg, &snapshot->outputs[snapshot->outputs_count].type);
+        if (valid) { snapshot->outputs[snapshot->outputs_count++].path = optarg; }
+      } break;
+      case CLI_OPTION_SNAPSHOT_SAMPLES: valid = cli_parse_u32(optarg, &options->snapshot.sample_interval) && options->snapshot.sample_interval > 0; break;
+      case CLI_OPTION_SNAPSHOT_INTERVAL: {
+        valid = cli_parse_f64(optarg, &options->snapshot.time_interval) && options->snapshot.time_interval > 0.0;
+        options->snapshot_interval_set = true;
+      } break;
+      case CLI_OPTION_TEXTURE_CACHE: options->texture_paging.cache_directory = optarg; break;
+      case CLI_OPTION_TEXTURE_BUDGET: {
+        u32 budget = 0;
+        valid = cli_parse_u32(optarg, &budget) && budget > 0;
+        options->texture_paging.budget_bytes = (usize) budget * 1024 * 1024;
+      } break;
+      case CLI_OPTION_TEXTURE_PAGE_WAIT: options->texture_paging.wait = true; break;
+      case CLI_OPTION_STREAM: options->stream = true; break;
+      default: return false;
+    }
+
+    if (!valid) {
+      if (option < 256) {
+        fprintf(stderr, "[ERROR] [CLI] Invalid value for option -%c: %s!\n", option, optarg);
+      } else {
+        fprintf(stderr, "[ERROR] [CLI] Invalid value for option: %s!\n", optarg);
+      }
+      return false;
+    }
+  }
+
+  if (options->generate_path) {
+    if (optind != argc) {
+      fprintf(stderr, "[ERROR] [CLI] Generating a scene takes no scene file!\n");
+      return false;
+    }
+
+    options->generator.seed = options->seed;
+    return true;
+  }
+
+  // batch jobs always render a fixed sample count in process
+  if (options->jobs_path) {
+    if (optind != argc || options->processes > 0 || options->termination != CAMERA_TERMINATION_SAMPLES || options->animation || options->checkpoint_path || options->snapshot.outputs_count > 0 || options->stream) {
+      fprintf(stderr, "[ERROR] [CLI] A job file takes no scene file, worker processes, time budget, noise target, animation, checkpoint, snapshot or streaming!\n");
+      return false;
+    }
+
+    return true;
+  }
+
+  if (optind != argc - 1) {
+    fprintf(stderr, "[ERROR] [CLI] Expected exactly one scene file!\n");
+    return false;
+  }
+
+  // the pager thread does not survive the fork into worker processes
+  if (options->texture_paging.cache_directory && options->processes > 0) {
+    fprintf(stderr, "[ERROR] [CLI] Texture paging only works without worker processes!\n");
+    return false;
+  }
+
+  // workers split a fixed sample range up front, so they cannot stop early
+  if (options->processes > 0 && options->termination != CAMERA_TERMINATION_SAMPLES) {
+    fprintf(stderr, "[ERROR] [CLI] Time budgets and noise targets only work without worker processes!\n");
+    return false;
+  }
+
+  if (options->resume && !options->checkpoint_path) {
+    fprintf(stderr, "[ERROR] [CLI] Resuming needs the --checkpoint file to resume from!\n");
+    return false;
+  }
+
+  // only the in-process export accumulates into one framebuffer that can be saved as it goes
+  if ((options->checkpoint_path || options->snapshot.outputs_count > 0) && (options->processes > 0 || options->animation)) {
+    fprintf(stderr, "[ERROR] [CLI] Checkpoints and snapshots only work for single images without worker processes!\n");
+    return false;
+  }
+
+  // a restarted accumulation cannot continue a checkpoint, and workers and frames all need the whole scene
+  if (options->stream && (options->checkpoint_path || options->processes > 0 || options->animation)) {
+    fprintf(stderr, "[ERROR] [CLI] Streaming only works for single images without checkpoints or worker processes!\n");
+    return false;
+  }
+
+  // every chunk restarts the accumulation, which would restart a time budget and put snapshots of a partly loaded
+  // scene into the sample count of the whole one
+  if (options->stream && (options->termination != CAMERA_TERMINATION_SAMPLES || options->snapshot.outputs_count > 0)) {
+    fprintf(stderr, "[ERROR] [CLI] Streaming only works with a fixed sample count and without snapshots!\n");
+    return false;
+  }
+
+  if (options->snapshot.sample_interval > 0 && !options->snapshot_interval_set) { options->snapshot.time_interval = 0.0; }
+  options->snapshot.image_options = options->image_options;
+
+  options->scene_path = argv[optind];
+  return true;
+}
+
+static bool cli_parse_distribution(const char* string, SceneGeneratorDistribution* distribution) {
+  if (strcmp(string, "uniform") == 0) {
+    *distribution = SCENE_GENERATOR_DISTRIBUTION_UNIFORM;
+  } else if (strcmp(string, "clustered") == 0) {
+    *distribution = SCENE_GENERATOR_DISTRIBUTION_CLUSTERED;
+  } else if (strcmp(string, "nested-glass") == 0) {
+    *distribution = SCENE_GENERATOR_DISTRIBUTION_NESTED_GLASS;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static bool cli_parse_material_weights(const char* string, f32 weights[3]) {
+  char* end;
+  const char* current = string;
+  for (u32 i = 0; i < 3; i++) {
+    f64 weight = strtod(current, &end);
+    if (end == current || weight < 0.0) { return false; }
+    weights[i] = (f32) weight;
+
+    char expected = (i < 2) ? ',' : '\0';
+    if (*end != expected) { return false; }
+    current = end + 1;
+  }
+
+  return (weights[0] + weights[1] + weights[2]) > 0.0f;
+}
+
+static bool cli_generate(CLIOptions* options) {
+  bool generated = false;
+  World world = world_create();
+  Camera* camera = camera_create(options->width, options->height);
+  if (!camera) { goto cleanup; }
+
+  if (!scene_generator_generate(&world, camera, &options->generator)) { goto cleanup; }
+
+  if (!world_scene_save(&world, camera, options->generate_path)) { goto cleanup; }
+  printf("[INFO] [CLI] Wrote %s with %u spheres and %u planes\n", options->generate_path, options->generator.sphere_count, options->generator.plane_count);
+  generated = true;
+
+cleanup:
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  return generated;
+}
+
+static bool cli_batch(CLIOptions* options) {
+  BatchDefaults defaults = {
+    .width = options->width,
+    .height = options->height,
+    .samples = options->samples,
+    .threads = options->threads
+  };
+
+  BatchSummary summary;
+  if (!batch_render(options->jobs_path, &defaults, &summary)) { return false; }
+
+  return (summary.failed_count == 0);
+}
+
+static bool cli_write_trace(CLIOptions* options) {
+  if (!options->trace_path) { return true; }
+
+  trace_stop();
+  if (!trace_write(options->trace_path)) { return false; }
+
+  printf("[INFO] [CLI] Wrote trace %s\n", options->trace_path);
+  return true;
+}
+
+static bool cli_write_image(const char* path, CLIOptions* options, Camera* camera) {
+  return image_create(path, options->output_type, camera, &options->image_options) && image_create_metadata(path, camera);
+}
+
+// the world stays loaded between frames, so textures and worker threads are only set up once
+static bool cli_render_animation(CLIOptions* options, World* world, Camera* camera) {
+  // a scene without keyframes renders as a single frame
+  Animation still = { .frame_rate = ANIMATION_DEFAULT_FRAME_RATE };
+  Animation* animation = world->animation ? world->animation : &still;
+
+  u32 frame_count = animation_frame_count(animation);
+  printf("[INFO] [CLI] Rendering %u frames of %s at %ux%u, %.2f fps\n", frame_count, options->scene_path, options->width, options->height, animation->frame_rate);
+
+  f64 start_time = timer_get_seconds();
+  for (u32 frame = 0; frame < frame_count; frame++) {
+    f64 frame_start = timer_get_seconds();
+    u32 moved_count = animation_apply(animation, world, camera, frame / animation->frame_rate);
+
+    if (options->processes > 0) {
+      if (!distributed_render(camera, world, options->processes, camera->thread_count)) { return false; }
+    } else {
+      camera_render_export(camera, world);
+    }
+
+    char path[CLI_PATH_LENGTH];
+    if (!cli_frame_path(path, sizeof(path), options->output_path, frame)) { return false; }
+    if (!cli_write_image(path, options, camera)) { return false; }
+
+    printf("[INFO] [CLI] Frame %u/%u: %u samples in %.3fs, %u hittables moved, wrote %s\n", frame + 1, frame_count, camera->sample_count, timer_get_seconds() - frame_start, moved_count, path);
+  }
+
+  f64 total_time = timer_get_seconds() - start_time;
+  printf("[INFO] [CLI] Rendered %u frames in %.3fs (%.1f frames/hour)\n", frame_count, total_time, (frame_count / total_time) * 3600.0);
+  return true;
+}
+
+// render.hdr becomes render_0000.hdr, render_0001.hdr and so on
+static bool cli_frame_path(char* buffer, usize buffer_size, const char* output_path, u32 frame) {
+  const char* extension = strrchr(output_path, '.');
+  s32 length = snprintf(buffer, buffer_size, "%.*s_%04u%s", (s32) (extension - output_path), output_path, frame, extension);
+  if (length < 0 || (usize) length >= buffer_size) {
+    fprintf(stderr, "[ERROR] [CLI] Frame path is too long: %s!\n", output_path);
+    return false;
+  }
+
+  return true;
+}
+
+// both formats go through world_scene_load and world_scene_save, which pick the format from the extension
+static bool cli_convert(CLIOptions* options) {
+  bool converted = false;
+  World world = world_create();
+  Camera* camera = camera_create(options->width, options->height);
+  if (!camera) { goto cleanup; }
+
+  f64 start_time = timer_get_seconds();
+  if (!world_scene_load(&world, camera, options->scene_path)) { goto cleanup; }
+  f64 load_time = timer_get_seconds() - start_time;
+
+  if (!world_scene_save(&world, camera, options->convert_path)) { goto cleanup; }
+  printf("[INFO] [CLI] Converted %s (%u hittables, loaded in %.3fs) to %s\n", options->scene_path, world.hittables_count, load_time, options->convert_path);
+  converted = true;
+
+cleanup:
+  if (camera) { camera_destroy(camera); }
+  world_destroy(&world);
+  return converted;
+}
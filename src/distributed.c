@@ -0,0 +1,231 @@
+#include "distributed.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "camera.h"
+#include "world.h"
+#include "types/base_types.h"
+#include "types/color.h"
+#include "utils/timer.h"
+#include "thread_pool.h"
+
+static bool write_all(s32 socket, const void* buffer, usize length);
+static bool read_all(s32 socket, void* buffer, usize length);
+static void worker_run(s32 socket, Camera* camera, World* world, u32 threads_per_worker);
+
+// the coordinator forks one process per worker, so every worker starts with an exact copy of
+// the scene and no serialization is needed, each worker then renders a contiguous range of
+// samples and sends the sum back along with the sum of its even samples, both are merged in worker order to keep
+// the result repeatable
+bool distributed_render(Camera* camera, World* world, u32 worker_count, u32 threads_per_worker) {
+  if (worker_count == 0 || worker_count > DISTRIBUTED_MAX_WORKERS) {
+    fprintf(stderr, "[ERROR] [DISTRIBUTED] Worker count must be between 1 and %d!\n", DISTRIBUTED_MAX_WORKERS);
+    return false;
+  }
+  if (worker_count > camera->sample_limit) { worker_count = camera->sample_limit; }
+  if (threads_per_worker == 0) { threads_per_worker = 1; }
+  if (threads_per_worker > MAX_THREAD_COUNT) { threads_per_worker = MAX_THREAD_COUNT; }
+
+  usize framebuffer_length = camera->width * camera->height;
+  Color* partial = (Color*) malloc(sizeof(Color) * framebuffer_length);
+  if (!partial) {
+    fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to allocate memory for partial framebuffer!\n");
+    return false;
+  }
+
+  pid_t pids[DISTRIBUTED_MAX_WORKERS];
+  s32 sockets[DISTRIBUTED_MAX_WORKERS];
+  u32 spawned_count = 0;
+  bool success = true;
+
+  f64 start_time = timer_get_seconds();
+
+  u32 first_sample = 0;
+  for (u32 i = 0; i < worker_count; i++) {
+    DistributedJob job = {
+      .first_sample = first_sample,
+      .sample_count = (camera->sample_limit / worker_count) + (i < (camera->sample_limit % worker_count) ? 1 : 0)
+    };
+    first_sample += job.sample_count;
+
+    s32 pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to create socket pair for worker %u: %s!\n", i, strerror(errno));
+      success = false;
+      break;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to fork worker %u: %s!\n", i, strerror(errno));
+      close(pair[0]);
+      close(pair[1]);
+      success = false;
+      break;
+    }
+
+    if (pid == 0) {
+      close(pair[0]);
+      for (u32 j = 0; j < spawned_count; j++) { close(sockets[j]); }
+      worker_run(pair[1], camera, world, threads_per_worker);
+    }
+
+    close(pair[1]);
+    pids[spawned_count] = pid;
+    sockets[spawned_count] = pair[0];
+    spawned_count++;
+
+    if (!write_all(pair[0], &job, sizeof(DistributedJob))) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to send job to worker %u!\n", i);
+      success = false;
+      break;
+    }
+  }
+
+  camera_clear_framebuffer(camera);
+
+  for (u32 i = 0; i < spawned_count && success; i++) {
+    DistributedResult result;
+    if (!read_all(sockets[i], &result, sizeof(DistributedResult))) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to receive result header from worker %u!\n", i);
+      success = false;
+      break;
+    }
+
+    if (result.width != camera->width || result.height != camera->height) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Worker %u returned a %ux%u framebuffer, expected %ux%u!\n", i, result.width, result.height, camera->width, camera->height);
+      success = false;
+      break;
+    }
+
+    if (!read_all(sockets[i], partial, sizeof(Color) * framebuffer_length)) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to receive framebuffer from worker %u!\n", i);
+      success = false;
+      break;
+    }
+
+    for (usize j = 0; j < framebuffer_length; j++) {
+      camera->framebuffer[j] = color_add(camera->framebuffer[j], partial[j]);
+    }
+
+    // the sample indices are global, so every worker's even sum belongs to the same half of the samples
+    if (!read_all(sockets[i], partial, sizeof(Color) * framebuffer_length)) {
+      fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to receive even sample framebuffer from worker %u!\n", i);
+      success = false;
+      break;
+    }
+
+    for (usize j = 0; j < framebuffer_length; j++) {
+      camera->framebuffer_even[j] = color_add(camera->framebuffer_even[j], partial[j]);
+    }
+    camera->sample_count += result.sample_count;
+
+    printf("[INFO] [DISTRIBUTED] Worker %u rendered samples %u-%u in %0.3fs (%0.2f samples/s)\n", i, result.first_sample, result.first_sample + result.sample_count, result.render_time, result.sample_count / result.render_time);
+  }
+
+  // workers still rendering after a failure would only finish work that is thrown away
+  for (u32 i = 0; i < spawned_count; i++) {
+    close(sockets[i]);
+    if (!success) { kill(pids[i], SIGKILL); }
+    waitpid(pids[i], NULL, 0);
+  }
+
+  free(partial);
+
+  // a partly merged framebuffer must never end up in an image
+  if (!success) {
+    camera_clear_framebuffer(camera);
+    fprintf(stderr, "[ERROR] [DISTRIBUTED] Failed to render with %u workers!\n", worker_count);
+    return false;
+  }
+
+  f64 total_time = timer_get_seconds() - start_time;
+  camera->render_time = total_time;
+  camera->noise_estimate = camera_estimate_noise(camera);
+  printf("[INFO] [DISTRIBUTED] %u workers rendered %u samples in %0.3fs (%0.2f samples/s, %0.2f Mpixel-samples/s)\n", spawned_count, camera->sample_count, total_time, camera->sample_count / total_time, ((f64) framebuffer_length * camera->sample_count) / (total_time * 1000000.0));
+
+  return true;
+}
+
+static void worker_run(s32 socket, Camera* camera, World* world, u32 threads_per_worker) {
+  DistributedJob job;
+  if (!read_all(socket, &job, sizeof(DistributedJob))) {
+    fprintf(stderr, "[ERROR] [DISTRIBUTED] [WORKER] Failed to receive job!\n");
+    _exit(EXIT_FAILURE);
+  }
+
+  // only the forking thread survives fork(), the global pool notices and starts fresh threads here
+  camera->thread_pool = thread_pool_get_global();
+  if (!camera->thread_pool) {
+    fprintf(stderr, "[ERROR] [DISTRIBUTED] [WORKER] Failed to create thread pool!\n");
+    _exit(EXIT_FAILURE);
+  }
+  camera->thread_count = threads_per_worker;
+
+  f64 start_time = timer_get_seconds();
+  camera_clear_framebuffer(camera);
+  camera_render_samples(camera, world, job.first_sample, job.sample_count);
+
+  DistributedResult result = {
+    .first_sample = job.first_sample,
+    .sample_count = job.sample_count,
+    .width = camera->width,
+    .height = camera->height,
+    .render_time = timer_get_seconds() - start_time
+  };
+
+  usize framebuffer_size = sizeof(Color) * camera->width * camera->height;
+  bool sent = write_all(socket, &result, sizeof(DistributedResult)) && write_all(socket, camera->framebuffer, framebuffer_size) &&
+    write_all(socket, camera->framebuffer_even, framebuffer_size);
+  if (!sent) {
+    fprintf(stderr, "[ERROR] [DISTRIBUTED] [WORKER] Failed to send result!\n");
+  }
+
+  close(socket);
+
+  // skip atexit handlers, they belong to the coordinator
+  _exit(sent ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+// a worker that died must show up as a failed write, not as a SIGPIPE killing the coordinator
+static bool write_all(s32 socket, const void* buffer, usize length) {
+  const u8* bytes = (const u8*) buffer;
+  while (length > 0) {
+    ssize_t written = send(socket, bytes, length, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+
+    bytes += written;
+    length -= written;
+  }
+
+  return true;
+}
+
+static bool read_all(s32 socket, void* buffer, usize length) {
+  u8* bytes = (u8*) buffer;
+  while (length > 0) {
+    ssize_t bytes_read = read(socket, bytes, length);
+    if (bytes_read < 0) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+    if (bytes_read == 0) { return false; }
+
+    bytes += bytes_read;
+    length -= bytes_read;
+  }
+
+  return true;
+}
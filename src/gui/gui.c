@@ -28,14 +28,28 @@
 #include "textures/texture.h"
 #include "textures/image.h"
 #include "tonemapping.h"
-#include "utils/file.h"
+#include "gui/file_dialog.h"
+#include "gui/texture_edit.h"
 #include "world.h"
-
+#include "world_snapshot.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "utils/timer.h"
+
+typedef struct GUITonemapJob {
+  ColorRGB* destination;
+  Camera* camera;
+  usize length;
+  usize chunk_count;
+} GUITonemapJob;
+
+static void gui_tonemap_chunk(void* job_data, usize chunk);
 static void gui_update_main_menu_bar(GUI* gui);
 static void gui_update_window_export_warning(GUI* gui, Camera* camera, World* world);
 static void gui_update_window_render(GUI* gui, Camera* camera);
 static void gui_update_window_camera(GUI* gui, Camera* camera, World* world, bool* reset_camera_framebuffer);
-static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool* reset_camera_framebuffer);
+static void gui_update_stats(GUI* gui, Camera* camera);
+static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool* world_changed);
 
 GUI gui_create(u32 width, u32 height) {
   GUI gui;
@@ -54,16 +68,27 @@ GUI gui_create(u32 width, u32 height) {
   gui.show_export_warning_window = false;
 
   gui.export_image_type = HDR;
+  gui.export_image_options = image_options_default();
 
   gui.add_type = HITTABLE_TYPE_SPHERE;
 
+  gui.stats_previous = (RenderStats) {0};
+  gui.stats_rate = (RenderStats) {0};
+  gui.stats_time = timer_get_seconds();
+
+  gui.texture_decode_generation = texture_image_decode_generation();
+  gui.scene_stream = NULL;
+
   return gui;
 }
 
 void gui_update(GUI* gui, Camera* camera, World* world) {
   window_update(gui->window);
 
+  TraceScope trace = trace_begin("GUI Update");
+
   bool reset_camera_framebuffer = false;
+  bool world_changed = false;
 
   window_imgui_begin_frame();
     gui_update_main_menu_bar(gui);
@@ -71,10 +96,37 @@ void gui_update(GUI* gui, Camera* camera, World* world) {
     igDockSpaceOverViewport(igGetID_Str("dockspace"), NULL, ImGuiDockNodeFlags_PassthruCentralNode, NULL);
     if (gui->show_render_window) { gui_update_window_render(gui, camera); }
     if (gui->show_camera_window) { gui_update_window_camera(gui, camera, world, &reset_camera_framebuffer); }
-    if (gui->show_world_window) { gui_update_window_world(gui, world, camera, &reset_camera_framebuffer); }
+    if (gui->show_world_window) { gui_update_window_world(gui, world, camera, &world_changed); }
   window_imgui_end_frame();
 
-  if (reset_camera_framebuffer) { camera_clear_framebuffer(camera); }
+  // a streamed chunk lands in the world like an edit, the stream is polled once more after it stopped loading
+  if (gui->scene_stream) {
+    bool loading = scene_stream_is_loading(gui->scene_stream);
+    if (scene_stream_poll(gui->scene_stream, world, camera)) { world_changed = true; }
+    if (!loading) {
+      scene_stream_destroy(gui->scene_stream);
+      gui->scene_stream = NULL;
+    }
+  }
+
+  // edits only ever touch the gui's copy of the world, render workers pick them up from the next published snapshot
+  if (world_changed) {
+    TraceScope publish_trace = trace_begin("Snapshot Publish");
+    if (camera->world_snapshots) { world_snapshot_queue_publish(camera->world_snapshots, world); }
+    trace_end(publish_trace);
+    reset_camera_framebuffer = true;
+  }
+
+  // snapshots share their image textures with this world, so a finished decode only needs the image restarted
+  u32 texture_decode_generation = texture_image_decode_generation();
+  if (texture_decode_generation != gui->texture_decode_generation) {
+    gui->texture_decode_generation = texture_decode_generation;
+    reset_camera_framebuffer = true;
+  }
+
+  if (reset_camera_framebuffer) { camera_invalidate(camera); }
+
+  trace_end(trace);
 }
 
 static void gui_update_main_menu_bar(GUI* gui) {
@@ -88,6 +140,22 @@ static void gui_update_main_menu_bar(GUI* gui) {
       }
       igEndMenu();
     }
+    if (igBeginMenu("Trace", true)) {
+      if (igMenuItem_Bool("Start Recording", NULL, false, !trace_is_recording())) {
+        trace_start();
+      }
+      if (igMenuItem_Bool("Stop And Save", NULL, false, trace_is_recording())) {
+        trace_stop();
+
+        nfdfilteritem_t filter_items[] = { { "Chrome trace", "json" } };
+        const char* path = file_dialog_get_save(filter_items, (sizeof(filter_items) / sizeof(nfdfilteritem_t)));
+        if (path && path[0] != '\0') {
+          trace_write(path);
+          file_dialog_string_destroy(path);
+        }
+      }
+      igEndMenu();
+    }
     if (igBeginMenu("Window", true)) {
       igMenuItem_BoolPtr("Show Camera Window", NULL, &gui->show_camera_window, true);
       igMenuItem_BoolPtr("Show World Window", NULL, &gui->show_world_window, true);
@@ -100,6 +168,10 @@ static void gui_update_main_menu_bar(GUI* gui) {
 static void gui_update_window_export_warning(GUI* gui, Camera* camera, World* world) {
   igBegin("Exporting", &gui->show_export_warning_window, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize);
     igCombo_Str("Export Type", (s32*) &gui->export_image_type, IMAGE_TYPES_STRING, 0);
+    if (gui->export_image_type == EXR) {
+      igCheckbox("32-bit Float", &gui->export_image_options.exr_float);
+      igCheckbox("Even/Odd Sample Layers", &gui->export_image_options.exr_aovs);
+    }
 
     igSeparator();
 
@@ -111,15 +183,16 @@ static void gui_update_window_export_warning(GUI* gui, Camera* camera, World* wo
       switch (gui->export_image_type) {
         case HDR: filter_items[0] = (nfdfilteritem_t) { "HDR", "hdr" }; break;
         case JPG: filter_items[0] = (nfdfilteritem_t) { "JPG", "jpg" }; break;
+        case PNG: filter_items[0] = (nfdfilteritem_t) { "PNG", "png" }; break;
+        case EXR: filter_items[0] = (nfdfilteritem_t) { "EXR", "exr" }; break;
       }
 
       const char* path = file_dialog_get_save(filter_items, 1);
 
       camera_render_export(camera, world);
 
-      switch (gui->export_image_type) {
-        case HDR: image_create_hdr(path, camera); break;
-        case JPG: image_create_jpg(path, camera); break;
+      if (image_create(path, gui->export_image_type, camera, &gui->export_image_options)) {
+        image_create_metadata(path, camera);
       }
 
       file_dialog_string_destroy(path);
@@ -134,13 +207,15 @@ static void gui_update_window_export_warning(GUI* gui, Camera* camera, World* wo
 
 static void gui_update_window_render(GUI* gui, Camera* camera) {
   if (camera->render || camera->sample_count <= camera->sample_limit) {
-    usize framebuffer_length = camera->width * camera->height;
-    for (usize i = 0; i < framebuffer_length; i++) {
-      gui->framebufferRGB[i] = tonemapping(camera->tonemapping_operator, color_scale(camera->framebuffer[i], 1.0f / camera->sample_count));
-    }
+    TraceScope trace = trace_begin("Tonemap");
+    GUITonemapJob job = { gui->framebufferRGB, camera, camera->width * camera->height, camera->thread_count };
+    thread_pool_parallel_for(camera->thread_pool, job.chunk_count, gui_tonemap_chunk, &job);
+    trace_end(trace);
 
+    trace = trace_begin("Texture Upload");
     texture_bind(gui->texture);
     texture_set_colorRGB_buffer(gui->texture, gui->framebufferRGB, camera->width, camera->height);
+    trace_end(trace);
   }
 
   igBegin("Render", &gui->show_render_window, 0);
@@ -148,12 +223,68 @@ static void gui_update_window_render(GUI* gui, Camera* camera) {
   igEnd();
 }
 
+static void gui_tonemap_chunk(void* job_data, usize chunk) {
+  GUITonemapJob* job = (GUITonemapJob*) job_data;
+
+  usize chunk_length = (job->length + job->chunk_count - 1) / job->chunk_count;
+  usize start = chunk * chunk_length;
+  usize end = (start + chunk_length < job->length) ? start + chunk_length : job->length;
+
+  for (usize i = start; i < end; i++) {
+    job->destination[i] = tonemapping(job->camera->tonemapping_operator, color_scale(job->camera->framebuffer[i], 1.0f / job->camera->sample_count));
+  }
+}
+
 static void gui_update_window_camera(GUI* gui, Camera* camera, World* world, bool* reset_camera_framebuffer) {
   igBegin("Camera", &gui->show_camera_window, 0);
     igSeparatorText("Statistics");
 
     igText("FPS: %0.2f", igGetIO_ContextPtr(gui->window->imgui_context)->Framerate);
     igText("Samples: %d", camera->sample_count);
+    igText("Render Time: %0.2f s", camera->render_time);
+    if (camera->noise_estimate == CAMERA_NOISE_UNKNOWN) {
+      igText("Noise Estimate: -");
+    } else {
+      igText("Noise Estimate: %0.4f", camera->noise_estimate);
+    }
+    igText("Time To First Image: %0.2f ms", camera->time_to_first_image * 1000.0);
+    igText("Pending Texture Decodes: %u", texture_image_decodes_pending());
+    if (gui->scene_stream) {
+      SceneStreamProgress progress = scene_stream_get_progress(gui->scene_stream);
+      f32 fraction = (progress.bytes_total > 0) ? ((f32) progress.bytes_parsed / progress.bytes_total) : 0.0f;
+      char overlay[64];
+      snprintf(overlay, sizeof(overlay), "%u hittables", progress.hittables_added);
+      igText("Loading Scene:");
+      igProgressBar(fraction, (ImVec2) { -1.0f, 0.0f }, overlay);
+    }
+    igText("Texture Memory: %0.2f MiB", texture_image_cache_get_stats().resident_bytes / (1024.0 * 1024.0));
+
+    gui_update_stats(gui, camera);
+    RenderStats* rate = &gui->stats_rate;
+    igText("Primary Rays: %0.2f M/s", rate->primary_rays / 1e6);
+    if (RENDER_STATS_ENABLED) {
+      igText("Total Rays: %0.2f M/s", (rate->primary_rays + rate->secondary_rays) / 1e6);
+    }
+
+    if (igTreeNode_Str("Breakdown")) {
+      if (RENDER_STATS_ENABLED) {
+        igText("Secondary Rays: %0.2f M/s", rate->secondary_rays / 1e6);
+        igText("Sphere Tests: %0.2f M/s", rate->intersection_tests[HITTABLE_TYPE_SPHERE] / 1e6);
+        igText("Plane Tests: %0.2f M/s", rate->intersection_tests[HITTABLE_TYPE_PLANE] / 1e6);
+        igText("Bounces: %0.2f M/s", rate->bounces / 1e6);
+        igText("Escaped Rays: %0.2f M/s", rate->escaped_rays / 1e6);
+        igText("Material Evaluations: %0.2f M/s", rate->material_evaluations / 1e6);
+      } else {
+        igTextDisabled("Ray counters compiled out");
+      }
+
+      // slice seconds per wall second, so with every slice busy this adds up to the slice count
+      for (usize i = 0; i < RENDER_STAGE_COUNT; i++) {
+        igText("%s: %0.2f", render_stats_stage_name(i), rate->stage_time[i]);
+      }
+
+      igTreePop();
+    }
 
     igSeparatorText("Settings");
 
@@ -166,9 +297,6 @@ static void gui_update_window_camera(GUI* gui, Camera* camera, World* world, boo
     if (igDragInt2("Resolution", (s32*) resolution, 1, 1, INT32_MAX, "%u", 0)) {
       camera_change_resolution(camera, resolution[0], resolution[1]);
 
-      camera_render_workers_destroy(camera);
-      camera_render_workers_create(camera, world);
-
       ColorRGB* temp = (ColorRGB*) realloc(gui->framebufferRGB, sizeof(ColorRGB) * (camera->width * camera->height));
       if (!temp) {
         fprintf(stderr, "[ERROR] [GUI] Failed to resize RGB framebuffer!\n");
@@ -182,6 +310,18 @@ static void gui_update_window_camera(GUI* gui, Camera* camera, World* world, boo
         *reset_camera_framebuffer = true;
       }
     }
+    igCombo_Str("Stop After", (s32*) &camera->termination, TERMINATION_MODES_STRING, 0);
+    switch (camera->termination) {
+      case CAMERA_TERMINATION_SAMPLES: break; // sample limit above
+      case CAMERA_TERMINATION_TIME: {
+        f32 time_budget = camera->time_budget;
+        if (igDragFloat("Time Budget", &time_budget, 0.5f, 0.1f, 86400.0f, "%0.1f s", 0)) { camera->time_budget = time_budget; }
+      } break;
+      case CAMERA_TERMINATION_NOISE: {
+        igDragFloat("Target Noise", &camera->target_noise, 0.001f, 0.0001f, 1.0f, "%0.4f", 0);
+      } break;
+    }
+    if (igInputInt("Seed", (s32*) &camera->seed, 1, 1, 0)) { *reset_camera_framebuffer = true; }
     igCombo_Str("Tonemapping", (s32*) &camera->tonemapping_operator, TONEMAPPING_OPERATORS_STRING, 0);
     switch (camera->tonemapping_operator.type) {
       case CLAMP: break; // clamp doesnt use any variables
@@ -190,32 +330,55 @@ static void gui_update_window_camera(GUI* gui, Camera* camera, World* world, boo
       } break;
     }
 
-    if (igSliderInt("Thread Count", (s32*) &camera->thread_count, 1, MAX_THREAD_COUNT, "%u", 0)) {
-      camera_render_workers_destroy(camera);
-      camera_render_workers_create(camera, world);
-    }
+    igSliderInt("Render Slices", (s32*) &camera->thread_count, 1, MAX_THREAD_COUNT, "%u", 0);
+    igCheckbox("Progressive Preview", &camera->progressive_preview);
     igCheckbox("Render", &camera->render);
     if (igSmallButton("Reset framebuffer")) { *reset_camera_framebuffer = true; }
   igEnd();
 }
 
-static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool* reset_camera_framebuffer) {
+static void gui_update_stats(GUI* gui, Camera* camera) {
+  f64 time = timer_get_seconds();
+  f64 elapsed = time - gui->stats_time;
+  if (elapsed < GUI_STATS_INTERVAL) { return; }
+
+  RenderStats stats = camera_get_stats(camera);
+  RenderStats* previous = &gui->stats_previous;
+  RenderStats* rate = &gui->stats_rate;
+
+  rate->primary_rays = (stats.primary_rays - previous->primary_rays) / elapsed;
+  rate->secondary_rays = (stats.secondary_rays - previous->secondary_rays) / elapsed;
+  for (usize i = 0; i < RENDER_STATS_HITTABLE_TYPE_COUNT; i++) {
+    rate->intersection_tests[i] = (stats.intersection_tests[i] - previous->intersection_tests[i]) / elapsed;
+  }
+  rate->bounces = (stats.bounces - previous->bounces) / elapsed;
+  rate->escaped_rays = (stats.escaped_rays - previous->escaped_rays) / elapsed;
+  rate->material_evaluations = (stats.material_evaluations - previous->material_evaluations) / elapsed;
+  for (usize i = 0; i < RENDER_STAGE_COUNT; i++) {
+    rate->stage_time[i] = (stats.stage_time[i] - previous->stage_time[i]) / elapsed;
+  }
+
+  *previous = stats;
+  gui->stats_time = time;
+}
+
+static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool* world_changed) {
   bool remove_hittable = false;
   usize remove_hittable_index;
 
   igBegin("World", &gui->show_world_window, 0);
     igSeparatorText("Settings");
 
-    if (igCheckbox("Indirect Light Sampling", &world->indirect_light_sampling)) { *reset_camera_framebuffer = true; }
-    if (igCheckbox("Direct Light Sampling (Experimental)", &world->direct_light_sampling)) { *reset_camera_framebuffer = true; }
-    igInputInt("Max Ray Bounces", (s32*) &world->max_ray_bounces, 1, 1, 0);
-    if (igColorEdit3("Sky Color", world->sky_color.data, ImGuiColorEditFlags_NoPicker)) { *reset_camera_framebuffer = true; }
+    if (igCheckbox("Indirect Light Sampling", &world->indirect_light_sampling)) { *world_changed = true; }
+    if (igCheckbox("Direct Light Sampling (Experimental)", &world->direct_light_sampling)) { *world_changed = true; }
+    if (igInputInt("Max Ray Bounces", (s32*) &world->max_ray_bounces, 1, 1, 0)) { *world_changed = true; }
+    if (igColorEdit3("Sky Color", world->sky_color.data, ImGuiColorEditFlags_NoPicker)) { *world_changed = true; }
 
     igSeparatorText("Scene");
 
     if (igSmallButton("Save")) {
       NFD_Init();
-      nfdfilteritem_t filter_items[] = { { "Scene file", "scene" } };
+      nfdfilteritem_t filter_items[] = { { "Scene file", "scene,bscene" } };
       const char* path = file_dialog_get_save(filter_items, (sizeof(filter_items) / sizeof(nfdfilteritem_t)));
 
       world_scene_save(world, camera, path);
@@ -225,12 +388,20 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
     igSameLine(0, gui->window->imgui_context->Style.ItemInnerSpacing.x);
 
     if (igSmallButton("Load")) {
-      nfdfilteritem_t filter_items[] = { { "Scene file", "scene" } };
+      nfdfilteritem_t filter_items[] = { { "Scene file", "scene,bscene" } };
       const char* path = file_dialog_get_open(filter_items, (sizeof(filter_items) / sizeof(nfdfilteritem_t)));
-      world_scene_load(world, camera, path);
-      file_dialog_string_destroy(path);
+      if (path && path[0] != '\0') {
+        // the world starts out empty and fills up while the render already runs
+        if (gui->scene_stream) { scene_stream_destroy(gui->scene_stream); }
+        world_destroy(world);
+        *world = world_create();
+
+        SceneStreamOptions stream_options = scene_stream_options_default();
+        gui->scene_stream = scene_stream_start(path, &stream_options);
+        file_dialog_string_destroy(path);
 
-      *reset_camera_framebuffer = true;
+        *world_changed = true;
+      }
     }
 
     igSeparator();
@@ -239,17 +410,18 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
       igPushID_Int(i);
 
       Hittable* hittable = world->hittables[i];
+      bool hittable_changed = false;
 
       if (igCollapsingHeader_BoolPtr(hittable->identifer, NULL, 0)) {
         igSeparatorText("Settings");
 
-        if (igDragFloat3("Position", hittable->position->data, 0.1f, -1000.0f, 1000.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
+        if (igDragFloat3("Position", hittable->position->data, 0.1f, -1000.0f, 1000.0f, "%0.2f", 0)) { hittable_changed = true; }
 
         switch (hittable->type) {
           case HITTABLE_TYPE_SPHERE: {
             HittableSphere* sphere = (HittableSphere*) hittable;
 
-            if (igDragFloat("Radius", &sphere->radius, 0.1f, -1000.0f, 1000.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
+            if (igDragFloat("Radius", &sphere->radius, 0.1f, -1000.0f, 1000.0f, "%0.2f", 0)) { hittable_changed = true; }
           } break;
           case HITTABLE_TYPE_PLANE: {
             HittablePlane* plane = (HittablePlane*) hittable;
@@ -257,9 +429,9 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
             if (igDragFloat3("Normal", plane->normal.data, 0.01f, -1.0f, 1.0f, "%0.2f", 0)) {
               plane->normal = vector3_normalize(plane->normal);
               hittable_plane_update_tangent_vectors(plane);
-              *reset_camera_framebuffer = true;
+              hittable_changed = true;
             }
-            if (igDragFloat2("Size", plane->size.data, 0.1f, 0.0f, 1000.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
+            if (igDragFloat2("Size", plane->size.data, 0.1f, 0.0f, 1000.0f, "%0.2f", 0)) { hittable_changed = true; }
           } break;
         }
 
@@ -268,7 +440,7 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
         if (igSmallButton("Remove")) {
           remove_hittable = true;
           remove_hittable_index = i;
-          *reset_camera_framebuffer = true;
+          hittable_changed = true;
         }
 
         igSeparatorText("Material");
@@ -284,6 +456,8 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
             case MATERIAL_TYPE_EMISSIVE: old_albedo = ((MaterialEmissive*) material)->albedo; break;
           }
 
+          // the new material takes its own reference to the albedo before the old material releases it
+          old_albedo = old_albedo->clone(old_albedo);
           material->destroy(world->hittables[i]->material);
 
           switch (new_type) {
@@ -294,7 +468,7 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
           }
 
           material = world->hittables[i]->material;
-          *reset_camera_framebuffer = true;
+          hittable_changed = true;
         }
 
         igSeparator();
@@ -306,9 +480,9 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
             bool changed = false;
             switch (diffuse->albedo->type) {
               case TEXTURE_TYPE_SOLID_COLOR: changed = texture_solid_color_gui_edit((TextureSolidColor*) diffuse->albedo); break;
-              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage*) diffuse->albedo); break;
+              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage**) &diffuse->albedo); break;
             }
-            if (changed) { *reset_camera_framebuffer = true; }
+            if (changed) { hittable_changed = true; }
           } break;
           case MATERIAL_TYPE_METAL: {
             Metal* metal = (Metal*) material;
@@ -316,39 +490,45 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
             bool changed = false;
             switch (metal->albedo->type) {
               case TEXTURE_TYPE_SOLID_COLOR: changed = texture_solid_color_gui_edit((TextureSolidColor*) metal->albedo); break;
-              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage*) metal->albedo); break;
+              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage**) &metal->albedo); break;
             }
-            if (changed) { *reset_camera_framebuffer = true; }
+            if (changed) { hittable_changed = true; }
 
-            if (igDragFloat("Roughness", &metal->roughness, 0.1f, 0.0f, 1.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
+            if (igDragFloat("Roughness", &metal->roughness, 0.1f, 0.0f, 1.0f, "%0.2f", 0)) { hittable_changed = true; }
           } break;
           case MATERIAL_TYPE_GLASS: {
             MaterialGlass* glass = (MaterialGlass*) material;
 
             bool changed = false;
             switch (glass->albedo->type) {
-              case TEXTURE_TYPE_SOLID_COLOR: *reset_camera_framebuffer = texture_solid_color_gui_edit((TextureSolidColor*) glass->albedo); break;
-              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage*) glass->albedo); break;
+              case TEXTURE_TYPE_SOLID_COLOR: changed = texture_solid_color_gui_edit((TextureSolidColor*) glass->albedo); break;
+              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage**) &glass->albedo); break;
             }
-            if (changed) { *reset_camera_framebuffer = true; }
+            if (changed) { hittable_changed = true; }
 
-            if (igDragFloat("Refraction Index", &glass->refraction_index, 0.1f, 0.0f, 50.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
-            if (igDragFloat("Roughness", &glass->roughness, 0.1f, 0.0f, 1.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
+            if (igDragFloat("Refraction Index", &glass->refraction_index, 0.1f, 0.0f, 50.0f, "%0.2f", 0)) { hittable_changed = true; }
+            if (igDragFloat("Roughness", &glass->roughness, 0.1f, 0.0f, 1.0f, "%0.2f", 0)) { hittable_changed = true; }
           } break;
           case MATERIAL_TYPE_EMISSIVE: {
             MaterialEmissive* emissive = (MaterialEmissive*) material;
 
             bool changed = false;
             switch (emissive->albedo->type) {
-              case TEXTURE_TYPE_SOLID_COLOR: *reset_camera_framebuffer = texture_solid_color_gui_edit((TextureSolidColor*) emissive->albedo); break;
-              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage*) emissive->albedo); break;
+              case TEXTURE_TYPE_SOLID_COLOR: changed = texture_solid_color_gui_edit((TextureSolidColor*) emissive->albedo); break;
+              case TEXTURE_TYPE_IMAGE: changed = texture_image_gui_edit((TextureImage**) &emissive->albedo); break;
             }
-            if (changed) { *reset_camera_framebuffer = true; }
+            if (changed) { hittable_changed = true; }
 
-            if (igDragFloat("Emission Strength", &emissive->emission_strength, 0.1f, 0.0f, 1000.0f, "%0.2f", 0)) { *reset_camera_framebuffer = true; }
+            if (igDragFloat("Emission Strength", &emissive->emission_strength, 0.1f, 0.0f, 1000.0f, "%0.2f", 0)) { hittable_changed = true; }
           } break;
         }
       }
+
+      // only the edited hittable is copied into the next snapshot, every other one is shared with the current one
+      if (hittable_changed) {
+        hittable->snapshot_revision = 0;
+        *world_changed = true;
+      }
       igPopID();
     }
 
@@ -368,7 +548,7 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
       }
 
       world_add(world, new_hittable);
-      *reset_camera_framebuffer = true;
+      *world_changed = true;
     }
   igEnd();
 
@@ -376,11 +556,14 @@ static void gui_update_window_world(GUI* gui, World* world, Camera* camera, bool
 }
 
 void gui_render(GUI* gui) {
+  TraceScope trace = trace_begin("GUI Render");
   window_clear(gui->window);
   window_imgui_render();
+  trace_end(trace);
 }
 
 void gui_destroy(GUI* gui) {
+  if (gui->scene_stream) { scene_stream_destroy(gui->scene_stream); }
   free(gui->framebufferRGB);
   texture_destroy(gui->texture);
   window_destroy(gui->window);
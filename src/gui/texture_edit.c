@@ -0,0 +1,89 @@
+#include "gui/texture_edit.h"
+#include "gui/file_dialog.h"
+#include "gui/texture.h"
+#include "textures/image.h"
+#include "textures/solid_color.h"
+#include "tonemapping.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <nfd.h>
+
+#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
+#include <cimgui.h>
+#include <cimgui_impl.h>
+
+static bool texture_image_upload_preview(TextureImage* image);
+
+bool texture_solid_color_gui_edit(TextureSolidColor* solid_color) {
+  return igColorEdit3("Albedo", solid_color->color.data, 0);
+}
+
+bool texture_image_gui_edit(TextureImage** image_pointer) {
+  TextureImage* image = *image_pointer;
+
+  // decodes finish on the pool, the preview is uploaded on the first frame after that
+  TextureImageState state = texture_image_get_state(image);
+  if (state == TEXTURE_IMAGE_STATE_PENDING) {
+    igText("Decoding...");
+  } else if (state == TEXTURE_IMAGE_STATE_FAILED) {
+    igText("Failed to decode image");
+  } else if (image->preview_texture || texture_image_upload_preview(image)) {
+    ImVec2 image_preview_size;
+    if (image->width > image->height) {
+      image_preview_size = (ImVec2) { (((f32) image->width / image->height) * 128.0f), 128.0f };
+    } else {
+      image_preview_size = (ImVec2) { 128.0f, (((f32) image->height / image->width) * 128.0f) };
+    }
+    igImage((ImTextureRef) { NULL, image->preview_texture }, image_preview_size, (ImVec2) { 0.0f, 1.0f }, (ImVec2) { 1.0f, 0.0f } );
+
+    const char* format = (image->format == TEXTURE_IMAGE_FORMAT_SRGB8) ? "sRGB8" : "Half";
+    igText("%ux%u %s, %0.2f MiB%s", image->width, image->height, format, image->pixels_size / (1024.0 * 1024.0), image->pixels_owner ? " (shared)" : "");
+  }
+
+  if (igSmallButton("Change Image")) {
+    nfdfilteritem_t filter_items[] = { { "Image", "jpg,png" } };
+    const char* path = file_dialog_get_open(filter_items, (sizeof(filter_items) / sizeof(nfdfilteritem_t)));
+    if (!path || (path[0] == '\0')) {
+      return false;
+    }
+
+    TextureImage* new_image = texture_image_create(path);
+    file_dialog_string_destroy(path);
+    if (!new_image) {
+      return false;
+    }
+
+    texture_image_destroy(image);
+    *image_pointer = new_image;
+    return true;
+  }
+
+  return false;
+}
+
+// must run on the thread owning the gl context, which is why it is not done when the image is decoded
+static bool texture_image_upload_preview(TextureImage* image) {
+  usize pixels_length = (image->width * image->height);
+  ColorRGB* pixelsRGB = (ColorRGB*) malloc(sizeof(ColorRGB) * pixels_length);
+  if (!pixelsRGB) {
+    fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to allocate memory for pixels RGB!\n");
+    return false;
+  }
+
+  // the full resolution level is stored in tiles, the gl texture wants plain rows
+  for (u32 y = 0; y < image->height; y++) {
+    for (u32 x = 0; x < image->width; x++) {
+      pixelsRGB[y * image->width + x] = tonemapping_clamp(texture_image_get_texel(image, 0, x, y));
+    }
+  }
+
+  image->preview_texture = texture_create();
+  image->preview_texture_destroy = texture_destroy;
+  texture_set_colorRGB_buffer(image->preview_texture, pixelsRGB, image->width, image->height);
+
+  free(pixelsRGB);
+  return true;
+}
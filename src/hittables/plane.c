@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include "cJSON.h"
@@ -10,6 +11,7 @@
 #include "math/vector2.h"
 
 static RayHit hit(Hittable* hittable, Ray ray);
+static Hittable* clone(Hittable* hittable);
 static void destroy(Hittable* hittable);
 
 HittablePlane* hittable_plane_create(Vector3 position, Vector3 normal, Vector2 size, Material* material) {
@@ -25,6 +27,7 @@ HittablePlane* hittable_plane_create(Vector3 position, Vector3 normal, Vector2 s
     .position = &plane->position,
     .material = material,
     .hit = hit,
+    .clone = clone,
     .destroy = destroy
   };
 
@@ -40,6 +43,10 @@ static inline RayHit hit(Hittable* hittable, Ray ray) {
   return hittable_plane_ray_hit((HittablePlane*) hittable, ray);
 }
 
+static inline Hittable* clone(Hittable* hittable) {
+  return (Hittable*) hittable_plane_clone((HittablePlane*) hittable);
+}
+
 static inline void destroy(Hittable* hittable) {
   hittable_plane_destroy((HittablePlane*) hittable);
 }
@@ -75,6 +82,7 @@ RayHit hittable_plane_ray_hit(HittablePlane* plane, Ray ray) {
     .ray = ray,
     .t = t,
     .uv_coordinates = (Vector2) { u, vcoord },
+    .uv_scale = 1.0f,
     .hit_position = hit_position,
     .normal = plane->normal,
     .inside = false,
@@ -148,7 +156,22 @@ error:
   return NULL;
 }
 
+HittablePlane* hittable_plane_clone(HittablePlane* plane) {
+  Material* material = plane->hittable.material->clone(plane->hittable.material);
+  if (!material) { return NULL; }
+
+  HittablePlane* clone = hittable_plane_create(plane->position, plane->normal, plane->size, material);
+  if (!clone) {
+    material->destroy(material);
+    return NULL;
+  }
+
+  memcpy(clone->hittable.identifer, plane->hittable.identifer, HITTABLE_IDENTIFER_MAX_LENGTH);
+
+  return clone;
+}
+
 void hittable_plane_destroy(HittablePlane* plane) {
-  free(plane->hittable.material);
+  if (plane->hittable.material) { plane->hittable.material->destroy(plane->hittable.material); }
   free(plane);
 }
@@ -2,6 +2,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <stdbool.h>
 #include <cJSON.h>
@@ -14,6 +15,7 @@
 #include "math/vector3.h"
 
 static RayHit hit(Hittable* hittable, Ray ray);
+static Hittable* clone(Hittable* hittable);
 static void destroy(Hittable* hittable);
 
 HittableSphere* hittable_sphere_create(Vector3 position, f32 radius, Material* material) {
@@ -29,6 +31,7 @@ HittableSphere* hittable_sphere_create(Vector3 position, f32 radius, Material* m
     .position = &sphere->position,
     .material = material,
     .hit = hit,
+    .clone = clone,
     .destroy = destroy
   };
 
@@ -42,6 +45,10 @@ inline static RayHit hit(Hittable* hittable, Ray ray) {
   return hittable_sphere_ray_hit((HittableSphere*) hittable, ray);
 }
 
+inline static Hittable* clone(Hittable* hittable) {
+  return (Hittable*) hittable_sphere_clone((HittableSphere*) hittable);
+}
+
 inline static void destroy(Hittable* hittable) {
   hittable_sphere_destroy((HittableSphere*) hittable);
 }
@@ -79,6 +86,7 @@ RayHit hittable_sphere_ray_hit(HittableSphere* sphere, Ray ray) {
     .hit_position = hit_position,
     .normal = vector3_normalize(vector3_subtract(hit_position, sphere->position)),
     .uv_coordinates = uv_coordinates,
+    .uv_scale = M_SQRT2 * M_PI * sphere->radius, // between the 2 pi r around and the pi r from pole to pole
     .inside = inside,
     .material = sphere->hittable.material
   };
@@ -127,7 +135,22 @@ error:
   return NULL;
 }
 
+HittableSphere* hittable_sphere_clone(HittableSphere* sphere) {
+  Material* material = sphere->hittable.material->clone(sphere->hittable.material);
+  if (!material) { return NULL; }
+
+  HittableSphere* clone = hittable_sphere_create(sphere->position, sphere->radius, material);
+  if (!clone) {
+    material->destroy(material);
+    return NULL;
+  }
+
+  memcpy(clone->hittable.identifer, sphere->hittable.identifer, HITTABLE_IDENTIFER_MAX_LENGTH);
+
+  return clone;
+}
+
 void hittable_sphere_destroy(HittableSphere* sphere) {
-  free(sphere->hittable.material);
+  if (sphere->hittable.material) { sphere->hittable.material->destroy(sphere->hittable.material); }
   free(sphere);
 }
@@ -1,46 +1,881 @@
 #include "image.h"
 
+#include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
+#include <stb_image.h>
+
+#include <cJSON.h>
 
 #include "camera.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include "types/base_types.h"
 #include "types/color.h"
+#include "utils/deflate.h"
+#include "utils/file.h"
+#include "utils/half.h"
+
+// a multiple of the largest jpeg block height, and the exr tile size so a band is one row of tiles
+#define IMAGE_BAND_ROWS 32
+
+#define IMAGE_JPG_QUALITY 100
+#define IMAGE_JPG_MAX_SIZE 65535
+
+#define IMAGE_PNG_FILTERS 5
+#define IMAGE_PNG_CHUNK_OVERHEAD 12
+
+#define IMAGE_EXR_TILE_SIZE IMAGE_BAND_ROWS
+#define IMAGE_EXR_TILE_HEADER_SIZE 20
+#define IMAGE_EXR_MAX_CHANNELS 9
+#define IMAGE_EXR_PIXEL_HALF 1
+#define IMAGE_EXR_PIXEL_FLOAT 2
+#define IMAGE_EXR_COMPRESSION_ZIP 3
+
+#define IMAGE_ZLIB_OVERHEAD 6
+
+// one horizontal strip of the image encoded on its own, the png checksum covers the band's filtered rows
+// and the exr tile sizes are only known once it is encoded
+typedef struct ImageBand {
+  u8* data;
+  usize size, capacity;
+  u32 adler;
+  usize raw_size;
+  u32* tile_sizes;
+  bool failed;
+} ImageBand;
+
+typedef struct ImageWriter ImageWriter;
+typedef void (*ImageEncodeFunction)(ImageWriter* writer, ImageBand* band, u32 index);
+typedef bool (*ImageWriteFunction)(ImageWriter* writer, ImageBand* band, u32 index);
+
+struct ImageWriter {
+  Camera* camera;
+  FILE* file;
+  ImageEncodeFunction encode;
+  ImageWriteFunction write;
+
+  u32 bands_count;
+  u32 wave_size;
+  ImageBand* bands;
+
+  // average, even and odd halves of the accumulated samples
+  f32 scale, even_scale, odd_scale;
+
+  u32 png_adler;
+
+  u32 exr_channels_count;
+  u32 exr_pixel_size;
+  u32 exr_tiles_x;
+  u64 exr_position;
+  u64* exr_offsets;
+};
+
+typedef enum ImageExrSource {
+  IMAGE_EXR_SOURCE_AVERAGE,
+  IMAGE_EXR_SOURCE_EVEN,
+  IMAGE_EXR_SOURCE_ODD
+} ImageExrSource;
+
+typedef struct ImageExrChannel {
+  const char* name;
+  ImageExrSource source;
+  u32 component;
+} ImageExrChannel;
+
+// exr wants its channels sorted by name, the layers follow the plain rgb ones
+static const ImageExrChannel image_exr_channels[IMAGE_EXR_MAX_CHANNELS] = {
+  { "B", IMAGE_EXR_SOURCE_AVERAGE, 2 },
+  { "G", IMAGE_EXR_SOURCE_AVERAGE, 1 },
+  { "R", IMAGE_EXR_SOURCE_AVERAGE, 0 },
+  { "even.B", IMAGE_EXR_SOURCE_EVEN, 2 },
+  { "even.G", IMAGE_EXR_SOURCE_EVEN, 1 },
+  { "even.R", IMAGE_EXR_SOURCE_EVEN, 0 },
+  { "odd.B", IMAGE_EXR_SOURCE_ODD, 2 },
+  { "odd.G", IMAGE_EXR_SOURCE_ODD, 1 },
+  { "odd.R", IMAGE_EXR_SOURCE_ODD, 0 }
+};
+
+static bool image_write(const char* filename, ImageWriter* writer);
+static void image_band_job(void* job_data, usize index);
+static void image_band_rows(ImageWriter* writer, u32 index, u32* y, u32* rows);
+static const Color* image_source_row(Camera* camera, const Color* framebuffer, u32 y);
+static void image_tonemap_rows(ImageWriter* writer, u32 y, u32 rows, ColorRGB* destination);
+static bool image_band_reserve(ImageBand* band, usize capacity);
+static void image_band_append(void* context, void* data, int size);
+static void image_write_u32_be(u8* destination, u32 value);
+static void image_jpg_encode(ImageWriter* writer, ImageBand* band, u32 index);
+static bool image_jpg_write(ImageWriter* writer, ImageBand* band, u32 index);
+static void image_png_encode(ImageWriter* writer, ImageBand* band, u32 index);
+static bool image_png_write(ImageWriter* writer, ImageBand* band, u32 index);
+static void image_png_filter_row(u32 filter, const u8* row, const u8* previous, usize size, u8* destination);
+static bool image_png_write_chunk(FILE* file, const char* type, const u8* data, u32 size);
+static usize image_hdr_header(char* buffer, usize buffer_size, u32 width, u32 height);
+static void image_hdr_encode(ImageWriter* writer, ImageBand* band, u32 index);
+static bool image_hdr_write(ImageWriter* writer, ImageBand* band, u32 index);
+static bool image_exr_write_header(ImageWriter* writer, ImageOptions* options);
+static usize image_exr_attribute(u8* destination, const char* name, const char* type, const void* value, u32 value_size);
+static void image_exr_encode(ImageWriter* writer, ImageBand* band, u32 index);
+static bool image_exr_write(ImageWriter* writer, ImageBand* band, u32 index);
+static usize image_exr_compress(const u8* data, usize size, u8* scratch, u8* destination);
+static f32 image_exr_value(ImageWriter* writer, const ImageExrChannel* channel, usize i);
+
+ImageOptions image_options_default() {
+  return (ImageOptions) {
+    .exr_float = false,
+    .exr_aovs = false
+  };
+}
+
+bool image_create(const char* filename, ImageType type, Camera* camera, ImageOptions* options) {
+  switch (type) {
+    case HDR: return image_create_hdr(filename, camera);
+    case JPG: return image_create_jpg(filename, camera);
+    case PNG: return image_create_png(filename, camera);
+    case EXR: return image_create_exr(filename, camera, options);
+  }
+
+  return false;
+}
+
+// every band becomes one restart interval, its huffman coder starts over just like stb_image_write's
+// does for a whole image, so each band is encoded as a small jpeg whose header is only kept from the first
+bool image_create_jpg(const char* filename, Camera* camera) {
+  if (camera->width > IMAGE_JPG_MAX_SIZE || camera->height > IMAGE_JPG_MAX_SIZE) {
+    fprintf(stderr, "[ERROR] [IMAGE] JPG images are at most %ux%u: %s!\n", IMAGE_JPG_MAX_SIZE, IMAGE_JPG_MAX_SIZE, filename);
+    return false;
+  }
+
+  FILE* file = fopen(filename, "wb");
+  if (!file) { goto error; }
+
+  // bands are written top row first, the flag is global in stb_image_write so it is never set again
+  stbi_flip_vertically_on_write(false);
+
+  ImageWriter writer = { .camera = camera, .file = file, .encode = image_jpg_encode, .write = image_jpg_write };
+  bool written = image_write(filename, &writer);
+
+  static const u8 end_of_image[] = { 0xff, 0xd9 };
+  written = written && fwrite(end_of_image, 1, sizeof(end_of_image), file) == sizeof(end_of_image);
+  if (fclose(file) != 0 || !written) { goto error; }
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [IMAGE] Failed to write image: %s!\n", filename);
+  return false;
+}
+
+// every band is deflated on its own and ends on a byte boundary, so the bands simply follow each other as
+// idat chunks and only their adler32 checksums have to be combined in order
+bool image_create_png(const char* filename, Camera* camera) {
+  FILE* file = fopen(filename, "wb");
+  if (!file) { goto error; }
+
+  static const u8 signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  u8 header[13] = {0};
+  image_write_u32_be(&header[0], camera->width);
+  image_write_u32_be(&header[4], camera->height);
+  header[8] = 8; // bits per channel
+  header[9] = 2; // rgb
+
+  ImageWriter writer = { .camera = camera, .file = file, .encode = image_png_encode, .write = image_png_write, .png_adler = DEFLATE_ADLER32_INIT };
+  bool written = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) && image_png_write_chunk(file, "IHDR", header, sizeof(header));
+  written = written && image_write(filename, &writer);
+
+  u8 adler[4];
+  image_write_u32_be(adler, writer.png_adler);
+  written = written && image_png_write_chunk(file, "IDAT", adler, sizeof(adler)) && image_png_write_chunk(file, "IEND", NULL, 0);
+  if (fclose(file) != 0 || !written) { goto error; }
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [IMAGE] Failed to write image: %s!\n", filename);
+  return false;
+}
+
+// rgbe scanlines are run length encoded one at a time, so bands encoded by stb_image_write only lose their header
+bool image_create_hdr(const char* filename, Camera* camera) {
+  FILE* file = fopen(filename, "wb");
+  if (!file) { goto error; }
+
+  char header[256];
+  usize header_size = image_hdr_header(header, sizeof(header), camera->width, camera->height);
+
+  ImageWriter writer = { .camera = camera, .file = file, .encode = image_hdr_encode, .write = image_hdr_write };
+  bool written = fwrite(header, 1, header_size, file) == header_size && image_write(filename, &writer);
+  if (fclose(file) != 0 || !written) { goto error; }
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [IMAGE] Failed to write image: %s!\n", filename);
+  return false;
+}
+
+// a single level tiled exr with zip compressed tiles, a band is one row of tiles and the tile offset table
+// in front of them is filled in once every band is written
+bool image_create_exr(const char* filename, Camera* camera, ImageOptions* options) {
+  ImageOptions default_options = image_options_default();
+  if (!options) { options = &default_options; }
+
+  ImageWriter writer = {
+    .camera = camera,
+    .encode = image_exr_encode,
+    .write = image_exr_write,
+    .exr_channels_count = options->exr_aovs ? IMAGE_EXR_MAX_CHANNELS : 3,
+    .exr_pixel_size = options->exr_float ? sizeof(f32) : sizeof(u16),
+    .exr_tiles_x = (camera->width + IMAGE_EXR_TILE_SIZE - 1) / IMAGE_EXR_TILE_SIZE
+  };
+
+  u32 tiles_y = (camera->height + IMAGE_EXR_TILE_SIZE - 1) / IMAGE_EXR_TILE_SIZE;
+  usize tiles_count = (usize) writer.exr_tiles_x * tiles_y;
+  writer.exr_offsets = (u64*) calloc(tiles_count, sizeof(u64));
+  if (!writer.exr_offsets) { goto error; }
+
+  writer.file = fopen(filename, "wb");
+  if (!writer.file) { goto error; }
+
+  bool written = image_exr_write_header(&writer, options);
+  u64 offsets_position = writer.exr_position;
+  writer.exr_position += tiles_count * sizeof(u64);
+
+  written = written && fwrite(writer.exr_offsets, sizeof(u64), tiles_count, writer.file) == tiles_count;
+  written = written && image_write(filename, &writer);
+  written = written && fseek(writer.file, (long) offsets_position, SEEK_SET) == 0;
+  written = written && fwrite(writer.exr_offsets, sizeof(u64), tiles_count, writer.file) == tiles_count;
+  if (fclose(writer.file) != 0 || !written) { goto error; }
+
+  free(writer.exr_offsets);
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [IMAGE] Failed to write image: %s!\n", filename);
+  free(writer.exr_offsets);
+  return false;
+}
+
+// root mean square error of the averaged radiance against a .hdr written by image_create_hdr,
+// its shared exponent encoding alone leaves an rmse of a few thousandths for an identical render
+bool image_compare_hdr(const char* filename, Camera* camera, f64* rmse) {
+  s32 width, height;
+  stbi_set_flip_vertically_on_load(true);
+  f32* reference = stbi_loadf(filename, &width, &height, NULL, 3);
+  if (!reference) {
+    fprintf(stderr, "[ERROR] [IMAGE] Failed to load reference image: %s!\n", filename);
+    return false;
+  }
+
+  if ((u32) width != camera->width || (u32) height != camera->height) {
+    fprintf(stderr, "[ERROR] [IMAGE] Reference image %s is %dx%d instead of %ux%u!\n", filename, width, height, camera->width, camera->height);
+    stbi_image_free(reference);
+    return false;
+  }
 
-void image_create_jpg(const char* filename, Camera* camera) {
   usize framebuffer_length = camera->width * camera->height;
-  ColorRGB* framebufferRGB = (ColorRGB*) malloc(sizeof(ColorRGB) * framebuffer_length);
-  if (!framebufferRGB) {
-    fprintf(stderr, "[ERROR] [IMAGE] Failed to allocate memory for RGB framebuffer!\n");
+  f64 squared_error = 0.0;
+  for (usize i = 0; i < framebuffer_length; i++) {
+    Color color = color_scale(camera->framebuffer[i], 1.0f / camera->sample_count);
+    for (usize channel = 0; channel < 3; channel++) {
+      f64 difference = (f64) color.data[channel] - reference[i * 3 + channel];
+      squared_error += difference * difference;
+    }
+  }
+
+  stbi_image_free(reference);
+
+  *rmse = sqrt(squared_error / (framebuffer_length * 3));
+  return true;
+}
+
+// written next to the image as <filename>.json, since neither format can carry how the render ended
+bool image_create_metadata(const char* filename, Camera* camera) {
+  const char* termination = "samples";
+  switch (camera->termination) {
+    case CAMERA_TERMINATION_SAMPLES: termination = "samples"; break;
+    case CAMERA_TERMINATION_TIME: termination = "time"; break;
+    case CAMERA_TERMINATION_NOISE: termination = "noise"; break;
+  }
+
+  cJSON* metadata_json = cJSON_CreateObject();
+  if (!metadata_json) { goto error; }
+
+  if (!cJSON_AddNumberToObject(metadata_json, "width", camera->width)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "height", camera->height)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "seed", camera->seed)) { goto error; }
+  if (!cJSON_AddStringToObject(metadata_json, "termination", termination)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "sample_limit", camera->sample_limit)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "time_budget", camera->time_budget)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "target_noise", camera->target_noise)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "samples", camera->sample_count)) { goto error; }
+  if (!cJSON_AddNumberToObject(metadata_json, "render_time", camera->render_time)) { goto error; }
+
+  if (camera->noise_estimate == CAMERA_NOISE_UNKNOWN) {
+    if (!cJSON_AddNullToObject(metadata_json, "noise_estimate")) { goto error; }
+  } else {
+    if (!cJSON_AddNumberToObject(metadata_json, "noise_estimate", camera->noise_estimate)) { goto error; }
+  }
+
+  const char* string = cJSON_Print(metadata_json);
+  if (!string) { goto error; }
+
+  usize path_length = strlen(filename) + sizeof(".json");
+  char* path = (char*) malloc(path_length);
+  if (!path) {
+    free((void*) string);
+    goto error;
+  }
+  snprintf(path, path_length, "%s.json", filename);
+
+  bool written = file_write_string(path, string);
+
+  free(path);
+  free((void*) string);
+  if (!written) { goto error; }
+
+  cJSON_Delete(metadata_json);
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [IMAGE] Failed to create metadata for image: %s!\n", filename);
+  cJSON_Delete(metadata_json);
+  return false;
+}
+
+
+// bands are encoded a wave at a time on the camera's pool while the wave before is written, so at most two
+// waves of encoded output are held and the frame is never converted into a full size copy first
+static bool image_write(const char* filename, ImageWriter* writer) {
+  Camera* camera = writer->camera;
+  TraceScope trace = trace_begin("Image Write");
+
+  f32 even_count = (f32) ((camera->sample_count + 1) / 2);
+  f32 odd_count = (f32) (camera->sample_count / 2);
+  writer->scale = 1.0f / camera->sample_count;
+  writer->even_scale = (even_count > 0.0f) ? 1.0f / even_count : 0.0f;
+  writer->odd_scale = (odd_count > 0.0f) ? 1.0f / odd_count : 0.0f;
+
+  writer->bands_count = (camera->height + IMAGE_BAND_ROWS - 1) / IMAGE_BAND_ROWS;
+  writer->wave_size = camera->thread_count;
+  writer->bands = (ImageBand*) calloc(2 * writer->wave_size, sizeof(ImageBand));
+  if (!writer->bands) {
+    fprintf(stderr, "[ERROR] [IMAGE] Failed to allocate image bands for %s!\n", filename);
+    trace_end(trace);
+    return false;
+  }
+
+  ThreadPoolGroup groups[2] = {0};
+  u32 waves_count = (writer->bands_count + writer->wave_size - 1) / writer->wave_size;
+  bool written = true;
+  for (u32 wave = 0; wave <= waves_count; wave++) {
+    if (wave < waves_count) {
+      u32 end = (wave + 1) * writer->wave_size;
+      if (end > writer->bands_count) { end = writer->bands_count; }
+      for (u32 index = wave * writer->wave_size; index < end; index++) {
+        thread_pool_submit(camera->thread_pool, &groups[wave & 1], image_band_job, writer, index);
+      }
+    }
+    if (wave == 0) { continue; }
+
+    // a failed band still lets the rest of the submitted work finish before the bands are freed
+    u32 previous = wave - 1;
+    thread_pool_wait(camera->thread_pool, &groups[previous & 1]);
+
+    u32 end = (previous + 1) * writer->wave_size;
+    if (end > writer->bands_count) { end = writer->bands_count; }
+    for (u32 index = previous * writer->wave_size; index < end; index++) {
+      ImageBand* band = &writer->bands[index % (2 * writer->wave_size)];
+      written = written && !band->failed && writer->write(writer, band, index);
+
+      free(band->data);
+      free(band->tile_sizes);
+      *band = (ImageBand) {0};
+    }
+  }
+
+  free(writer->bands);
+  writer->bands = NULL;
+  trace_end(trace);
+  return written;
+}
+
+static void image_band_job(void* job_data, usize index) {
+  ImageWriter* writer = (ImageWriter*) job_data;
+  TraceScope trace = trace_begin("Image Band");
+  writer->encode(writer, &writer->bands[index % (2 * writer->wave_size)], (u32) index);
+  trace_end(trace);
+}
+
+static void image_band_rows(ImageWriter* writer, u32 index, u32* y, u32* rows) {
+  *y = index * IMAGE_BAND_ROWS;
+  *rows = (writer->camera->height - *y < IMAGE_BAND_ROWS) ? writer->camera->height - *y : IMAGE_BAND_ROWS;
+}
+
+// images are written top row first, the framebuffer starts at the bottom
+static inline const Color* image_source_row(Camera* camera, const Color* framebuffer, u32 y) {
+  return &framebuffer[(usize) (camera->height - 1 - y) * camera->width];
+}
+
+static void image_tonemap_rows(ImageWriter* writer, u32 y, u32 rows, ColorRGB* destination) {
+  Camera* camera = writer->camera;
+  for (u32 row = 0; row < rows; row++) {
+    const Color* source = image_source_row(camera, camera->framebuffer, y + row);
+    for (u32 x = 0; x < camera->width; x++) {
+      destination[(usize) row * camera->width + x] = tonemapping(camera->tonemapping_operator, color_scale(source[x], writer->scale));
+    }
+  }
+}
+
+static bool image_band_reserve(ImageBand* band, usize capacity) {
+  if (capacity <= band->capacity) { return true; }
+
+  u8* temp = (u8*) realloc(band->data, capacity);
+  if (!temp) {
+    band->failed = true;
+    return false;
+  }
+
+  band->data = temp;
+  band->capacity = capacity;
+  return true;
+}
+
+// stb_image_write output callback
+static void image_band_append(void* context, void* data, int size) {
+  ImageBand* band = (ImageBand*) context;
+  if (band->failed) { return; }
+
+  usize capacity = band->capacity;
+  while (band->size + size > capacity) { capacity = (capacity > 0) ? capacity * 2 : 4096; }
+  if (!image_band_reserve(band, capacity)) { return; }
+
+  memcpy(&band->data[band->size], data, size);
+  band->size += size;
+}
+
+static void image_write_u32_be(u8* destination, u32 value) {
+  destination[0] = (u8) (value >> 24);
+  destination[1] = (u8) (value >> 16);
+  destination[2] = (u8) (value >> 8);
+  destination[3] = (u8) value;
+}
+
+// keeps only the entropy coded data after the scan header, the first band also keeps the headers with
+// the full image height and a restart interval of one band
+static void image_jpg_encode(ImageWriter* writer, ImageBand* band, u32 index) {
+  Camera* camera = writer->camera;
+  u32 y, rows;
+  image_band_rows(writer, index, &y, &rows);
+
+  ColorRGB* pixels = (ColorRGB*) malloc(sizeof(ColorRGB) * camera->width * rows);
+  if (!pixels) {
+    band->failed = true;
     return;
   }
 
-  for (usize i = 0; i < framebuffer_length; i++) {
-    framebufferRGB[i] = tonemapping(camera->tonemapping_operator, color_scale(camera->framebuffer[i], 1.0f / camera->sample_count));
+  image_tonemap_rows(writer, y, rows, pixels);
+  bool encoded = stbi_write_jpg_to_func(image_band_append, band, camera->width, rows, 3, pixels, IMAGE_JPG_QUALITY);
+  free(pixels);
+  if (!encoded || band->failed) { goto error; }
+
+  // walk the marker segments up to the start of scan, the frame header holds the height
+  usize frame_start = 0, scan_header_start = 0, position = 2;
+  while (position + 4 <= band->size && scan_header_start == 0) {
+    if (band->data[position] != 0xff) { goto error; }
+
+    u8 marker = band->data[position + 1];
+    if (marker == 0xc0 || marker == 0xc2) { frame_start = position; }
+    if (marker == 0xda) { scan_header_start = position; }
+    position += 2 + ((usize) band->data[position + 2] << 8 | band->data[position + 3]);
+  }
+  if (frame_start == 0 || scan_header_start == 0 || position > band->size) { goto error; }
+
+  // the end of image marker follows the last band, not every band
+  usize scan_size = band->size - position - 2;
+  if (index > 0) {
+    memmove(band->data, &band->data[position], scan_size);
+    band->size = scan_size;
+    return;
   }
 
-  stbi_flip_vertically_on_write(true);
-  stbi_write_jpg(filename, camera->width, camera->height, 3, framebufferRGB, 100);
+  u32 block_size = (IMAGE_JPG_QUALITY <= 90) ? 16 : 8;
+  u32 restart_interval = ((camera->width + block_size - 1) / block_size) * (IMAGE_BAND_ROWS / block_size);
+  const u8 restart_segment[] = { 0xff, 0xdd, 0x00, 0x04, (u8) (restart_interval >> 8), (u8) restart_interval };
+  if (!image_band_reserve(band, band->size + sizeof(restart_segment))) { goto error; }
+
+  band->data[frame_start + 5] = (u8) (camera->height >> 8);
+  band->data[frame_start + 6] = (u8) camera->height;
+  memmove(&band->data[scan_header_start + sizeof(restart_segment)], &band->data[scan_header_start], position - scan_header_start + scan_size);
+  memcpy(&band->data[scan_header_start], restart_segment, sizeof(restart_segment));
+  band->size = position + sizeof(restart_segment) + scan_size;
+  return;
 
-  free(framebufferRGB);
+error:
+  band->failed = true;
 }
 
-void image_create_hdr(const char* filename, Camera* camera) {
-  usize framebuffer_length = camera->width * camera->height;
-  Color* framebuffer = (Color*) malloc(sizeof(Color) * framebuffer_length);
-  if (!framebuffer) {
-    fprintf(stderr, "[ERROR] [IMAGE] Failed to allocate memory for floating-point framebuffer!\n");
+static bool image_jpg_write(ImageWriter* writer, ImageBand* band, u32 index) {
+  if (fwrite(band->data, 1, band->size, writer->file) != band->size) { return false; }
+  if (index == writer->bands_count - 1) { return true; }
+
+  const u8 restart_marker[] = { 0xff, (u8) (0xd0 + (index & 7)) };
+  return fwrite(restart_marker, 1, sizeof(restart_marker), writer->file) == sizeof(restart_marker);
+}
+
+// each row takes the filter with the smallest sum of absolute differences like stb_image_write, the row above
+// the band is tonemapped again so bands never wait on each other
+static void image_png_encode(ImageWriter* writer, ImageBand* band, u32 index) {
+  Camera* camera = writer->camera;
+  u32 y, rows;
+  image_band_rows(writer, index, &y, &rows);
+
+  usize row_size = (usize) camera->width * 3;
+  usize filtered_size = (row_size + 1) * rows;
+  u8* rows_data = (u8*) malloc(row_size * (rows + 1) + filtered_size + row_size * IMAGE_PNG_FILTERS);
+  if (!rows_data) {
+    band->failed = true;
     return;
   }
 
-  for (usize i = 0; i < framebuffer_length; i++) {
-    framebuffer[i] = color_scale(camera->framebuffer[i], 1.0f / camera->sample_count);
+  u8* filtered = &rows_data[row_size * (rows + 1)];
+  u8* candidates = &filtered[filtered_size];
+
+  if (y > 0) {
+    image_tonemap_rows(writer, y - 1, rows + 1, (ColorRGB*) rows_data);
+  } else {
+    memset(rows_data, 0, row_size);
+    image_tonemap_rows(writer, y, rows, (ColorRGB*) &rows_data[row_size]);
+  }
+
+  for (u32 row = 0; row < rows; row++) {
+    const u8* previous = &rows_data[row * row_size];
+    const u8* current = &rows_data[(row + 1) * row_size];
+
+    u32 best_filter = 0;
+    u64 best_score = UINT64_MAX;
+    for (u32 filter = 0; filter < IMAGE_PNG_FILTERS; filter++) {
+      u8* candidate = &candidates[filter * row_size];
+      image_png_filter_row(filter, current, previous, row_size, candidate);
+
+      u64 score = 0;
+      for (usize i = 0; i < row_size; i++) { score += abs((s8) candidate[i]); }
+      if (score < best_score) {
+        best_score = score;
+        best_filter = filter;
+      }
+    }
+
+    filtered[row * (row_size + 1)] = (u8) best_filter;
+    memcpy(&filtered[row * (row_size + 1) + 1], &candidates[best_filter * row_size], row_size);
+  }
+
+  // the zlib header goes in front of the first band, the adler32 checksum after the last one
+  usize header_size = (index == 0) ? 2 : 0;
+  band->data = (u8*) malloc(IMAGE_PNG_CHUNK_OVERHEAD + header_size + deflate_bound(filtered_size));
+  if (!band->data) { goto error; }
+
+  u8* chunk_data = &band->data[8];
+  if (index == 0) {
+    chunk_data[0] = 0x78;
+    chunk_data[1] = 0x01;
+  }
+
+  usize compressed_size = deflate_compress(filtered, filtered_size, index == writer->bands_count - 1, &chunk_data[header_size]);
+  if (compressed_size == 0) { goto error; }
+
+  u32 chunk_size = (u32) (header_size + compressed_size);
+  image_write_u32_be(&band->data[0], chunk_size);
+  memcpy(&band->data[4], "IDAT", 4);
+  image_write_u32_be(&chunk_data[chunk_size], deflate_crc32(DEFLATE_CRC32_INIT, &band->data[4], chunk_size + 4));
+
+  band->size = chunk_size + IMAGE_PNG_CHUNK_OVERHEAD;
+  band->adler = deflate_adler32(DEFLATE_ADLER32_INIT, filtered, filtered_size);
+  band->raw_size = filtered_size;
+  free(rows_data);
+  return;
+
+error:
+  band->failed = true;
+  free(rows_data);
+}
+
+static bool image_png_write(ImageWriter* writer, ImageBand* band, u32 index) {
+  (void) index;
+  writer->png_adler = deflate_adler32_combine(writer->png_adler, band->adler, band->raw_size);
+  return fwrite(band->data, 1, band->size, writer->file) == band->size;
+}
+
+// none, sub, up, average and paeth over 3 byte pixels
+static void image_png_filter_row(u32 filter, const u8* row, const u8* previous, usize size, u8* destination) {
+  switch (filter) {
+    case 0: memcpy(destination, row, size); break;
+    case 1:
+      memcpy(destination, row, 3);
+      for (usize i = 3; i < size; i++) { destination[i] = row[i] - row[i - 3]; }
+      break;
+    case 2:
+      for (usize i = 0; i < size; i++) { destination[i] = row[i] - previous[i]; }
+      break;
+    case 3:
+      for (usize i = 0; i < 3; i++) { destination[i] = row[i] - (previous[i] >> 1); }
+      for (usize i = 3; i < size; i++) { destination[i] = row[i] - ((row[i - 3] + previous[i]) >> 1); }
+      break;
+    case 4:
+      for (usize i = 0; i < 3; i++) { destination[i] = row[i] - previous[i]; }
+      for (usize i = 3; i < size; i++) {
+        s32 left = row[i - 3], up = previous[i], up_left = previous[i - 3];
+        s32 estimate = left + up - up_left;
+        s32 left_distance = abs(estimate - left), up_distance = abs(estimate - up), up_left_distance = abs(estimate - up_left);
+        s32 predictor = (left_distance <= up_distance && left_distance <= up_left_distance) ? left : (up_distance <= up_left_distance) ? up : up_left;
+        destination[i] = row[i] - (u8) predictor;
+      }
+      break;
+  }
+}
+
+static bool image_png_write_chunk(FILE* file, const char* type, const u8* data, u32 size) {
+  u8 header[8];
+  image_write_u32_be(&header[0], size);
+  memcpy(&header[4], type, 4);
+
+  u8 crc[4];
+  image_write_u32_be(crc, deflate_crc32(deflate_crc32(DEFLATE_CRC32_INIT, &header[4], 4), data, size));
+
+  return fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+    (size == 0 || fwrite(data, 1, size, file) == size) &&
+    fwrite(crc, 1, sizeof(crc), file) == sizeof(crc);
+}
+
+// the same header stb_image_write puts in front of its scanlines
+static usize image_hdr_header(char* buffer, usize buffer_size, u32 width, u32 height) {
+  s32 size = snprintf(buffer, buffer_size, "#?RADIANCE\n# Written by stb_image_write.h\nFORMAT=32-bit_rle_rgbe\nEXPOSURE=          1.0000000000000\n\n-Y %u +X %u\n", height, width);
+  return (size > 0) ? (usize) size : 0;
+}
+
+static void image_hdr_encode(ImageWriter* writer, ImageBand* band, u32 index) {
+  Camera* camera = writer->camera;
+  u32 y, rows;
+  image_band_rows(writer, index, &y, &rows);
+
+  Color* pixels = (Color*) malloc(sizeof(Color) * camera->width * rows);
+  if (!pixels) {
+    band->failed = true;
+    return;
+  }
+
+  for (u32 row = 0; row < rows; row++) {
+    const Color* source = image_source_row(camera, camera->framebuffer, y + row);
+    for (u32 x = 0; x < camera->width; x++) {
+      pixels[(usize) row * camera->width + x] = color_scale(source[x], writer->scale);
+    }
+  }
+
+  bool encoded = stbi_write_hdr_to_func(image_band_append, band, camera->width, rows, 3, (f32*) pixels);
+  free(pixels);
+
+  char header[256];
+  usize header_size = image_hdr_header(header, sizeof(header), camera->width, rows);
+  if (!encoded || band->failed || band->size < header_size || memcmp(band->data, header, header_size) != 0) {
+    band->failed = true;
+    return;
+  }
+
+  band->size -= header_size;
+  memmove(band->data, &band->data[header_size], band->size);
+}
+
+static bool image_hdr_write(ImageWriter* writer, ImageBand* band, u32 index) {
+  (void) index;
+  return fwrite(band->data, 1, band->size, writer->file) == band->size;
+}
+
+static bool image_exr_write_header(ImageWriter* writer, ImageOptions* options) {
+  Camera* camera = writer->camera;
+  u8 header[1024];
+  usize size = 0;
+
+  // magic number, then version 2 with the single part tiled flag
+  const u8 magic[] = { 0x76, 0x2f, 0x31, 0x01, 0x02, 0x02, 0x00, 0x00 };
+  memcpy(header, magic, sizeof(magic));
+  size += sizeof(magic);
+
+  // pixel type, linear flag with reserved bytes, x and y sampling
+  u8 channels[IMAGE_EXR_MAX_CHANNELS * 24 + 1];
+  usize channels_size = 0;
+  for (u32 i = 0; i < writer->exr_channels_count; i++) {
+    usize name_size = strlen(image_exr_channels[i].name) + 1;
+    memcpy(&channels[channels_size], image_exr_channels[i].name, name_size);
+    channels_size += name_size;
+
+    s32 description[4] = { options->exr_float ? IMAGE_EXR_PIXEL_FLOAT : IMAGE_EXR_PIXEL_HALF, 0, 1, 1 };
+    memcpy(&channels[channels_size], description, sizeof(description));
+    channels_size += sizeof(description);
+  }
+  channels[channels_size++] = 0;
+
+  u8 compression = IMAGE_EXR_COMPRESSION_ZIP;
+  s32 window[4] = { 0, 0, (s32) camera->width - 1, (s32) camera->height - 1 };
+  u8 line_order = 0; // increasing y
+  f32 pixel_aspect_ratio = 1.0f;
+  f32 screen_window_center[2] = { 0.0f, 0.0f };
+  f32 screen_window_width = 1.0f;
+
+  // tile width and height, then one level rounded down
+  u32 tile_size = IMAGE_EXR_TILE_SIZE;
+  u8 tiles[9] = {0};
+  memcpy(&tiles[0], &tile_size, sizeof(u32));
+  memcpy(&tiles[4], &tile_size, sizeof(u32));
+
+  size += image_exr_attribute(&header[size], "channels", "chlist", channels, channels_size);
+  size += image_exr_attribute(&header[size], "compression", "compression", &compression, sizeof(compression));
+  size += image_exr_attribute(&header[size], "dataWindow", "box2i", window, sizeof(window));
+  size += image_exr_attribute(&header[size], "displayWindow", "box2i", window, sizeof(window));
+  size += image_exr_attribute(&header[size], "lineOrder", "lineOrder", &line_order, sizeof(line_order));
+  size += image_exr_attribute(&header[size], "pixelAspectRatio", "float", &pixel_aspect_ratio, sizeof(pixel_aspect_ratio));
+  size += image_exr_attribute(&header[size], "screenWindowCenter", "v2f", screen_window_center, sizeof(screen_window_center));
+  size += image_exr_attribute(&header[size], "screenWindowWidth", "float", &screen_window_width, sizeof(screen_window_width));
+  size += image_exr_attribute(&header[size], "tiles", "tiledesc", tiles, sizeof(tiles));
+  header[size++] = 0;
+
+  writer->exr_position = size;
+  return fwrite(header, 1, size, writer->file) == size;
+}
+
+static usize image_exr_attribute(u8* destination, const char* name, const char* type, const void* value, u32 value_size) {
+  usize size = 0;
+  memcpy(&destination[size], name, strlen(name) + 1);
+  size += strlen(name) + 1;
+  memcpy(&destination[size], type, strlen(type) + 1);
+  size += strlen(type) + 1;
+  memcpy(&destination[size], &value_size, sizeof(u32));
+  size += sizeof(u32);
+  memcpy(&destination[size], value, value_size);
+  return size + value_size;
+}
+
+// a tile holds its rows one after another, each row holds every channel's values for the tile's columns
+static void image_exr_encode(ImageWriter* writer, ImageBand* band, u32 index) {
+  Camera* camera = writer->camera;
+  u32 y, rows;
+  image_band_rows(writer, index, &y, &rows);
+
+  usize raw_capacity = (usize) IMAGE_EXR_TILE_SIZE * IMAGE_EXR_TILE_SIZE * writer->exr_channels_count * writer->exr_pixel_size;
+  usize tile_capacity = IMAGE_EXR_TILE_HEADER_SIZE + IMAGE_ZLIB_OVERHEAD + deflate_bound(raw_capacity);
+  u8* raw = (u8*) malloc(2 * raw_capacity);
+  band->data = (u8*) malloc(tile_capacity * writer->exr_tiles_x);
+  band->tile_sizes = (u32*) malloc(sizeof(u32) * writer->exr_tiles_x);
+  if (!raw || !band->data || !band->tile_sizes) {
+    band->failed = true;
+    free(raw);
+    return;
   }
 
-  stbi_flip_vertically_on_write(true);
-  stbi_write_hdr(filename, camera->width, camera->height, 3, (f32*) framebuffer);
+  u8* scratch = &raw[raw_capacity];
+  for (u32 tile_x = 0; tile_x < writer->exr_tiles_x; tile_x++) {
+    u32 x = tile_x * IMAGE_EXR_TILE_SIZE;
+    u32 columns = (camera->width - x < IMAGE_EXR_TILE_SIZE) ? camera->width - x : IMAGE_EXR_TILE_SIZE;
+
+    u8* value = raw;
+    for (u32 row = 0; row < rows; row++) {
+      usize row_start = (usize) (camera->height - 1 - (y + row)) * camera->width + x;
+      for (u32 channel = 0; channel < writer->exr_channels_count; channel++) {
+        for (u32 column = 0; column < columns; column++) {
+          f32 sample = image_exr_value(writer, &image_exr_channels[channel], row_start + column);
+          if (writer->exr_pixel_size == sizeof(u16)) {
+            u16 half = half_from_f32(sample);
+            memcpy(value, &half, sizeof(u16));
+          } else {
+            memcpy(value, &sample, sizeof(f32));
+          }
+          value += writer->exr_pixel_size;
+        }
+      }
+    }
+
+    u8* tile = &band->data[band->size];
+    s32 tile_header[5] = { (s32) tile_x, (s32) index, 0, 0, 0 };
+    usize raw_size = value - raw;
+    usize data_size = image_exr_compress(raw, raw_size, scratch, &tile[IMAGE_EXR_TILE_HEADER_SIZE]);
+
+    // tiles that do not get smaller are stored as they are, which readers tell apart by the size alone
+    if (data_size == 0 || data_size >= raw_size) {
+      memcpy(&tile[IMAGE_EXR_TILE_HEADER_SIZE], raw, raw_size);
+      data_size = raw_size;
+    }
+
+    tile_header[4] = (s32) data_size;
+    memcpy(tile, tile_header, sizeof(tile_header));
+    band->tile_sizes[tile_x] = (u32) (IMAGE_EXR_TILE_HEADER_SIZE + data_size);
+    band->size += band->tile_sizes[tile_x];
+  }
+
+  free(raw);
+}
+
+static bool image_exr_write(ImageWriter* writer, ImageBand* band, u32 index) {
+  for (u32 tile_x = 0; tile_x < writer->exr_tiles_x; tile_x++) {
+    writer->exr_offsets[(usize) index * writer->exr_tiles_x + tile_x] = writer->exr_position;
+    writer->exr_position += band->tile_sizes[tile_x];
+  }
+
+  return fwrite(band->data, 1, band->size, writer->file) == band->size;
+}
+
+// openexr's zip compression splits the even and odd bytes and stores the difference of neighbours before deflating,
+// which is what lets the high bytes of similar values compress
+static usize image_exr_compress(const u8* data, usize size, u8* scratch, u8* destination) {
+  usize half_size = (size + 1) / 2;
+  for (usize i = 0; i < size; i++) {
+    scratch[(i & 1) ? half_size + (i >> 1) : (i >> 1)] = data[i];
+  }
+
+  for (usize i = size - 1; i > 0; i--) {
+    scratch[i] = (u8) (scratch[i] - scratch[i - 1] + 128);
+  }
+
+  destination[0] = 0x78;
+  destination[1] = 0x01;
+  usize compressed_size = deflate_compress(scratch, size, true, &destination[2]);
+  if (compressed_size == 0) { return 0; }
+
+  image_write_u32_be(&destination[2 + compressed_size], deflate_adler32(DEFLATE_ADLER32_INIT, scratch, size));
+  return compressed_size + IMAGE_ZLIB_OVERHEAD;
+}
+
+static inline f32 image_exr_value(ImageWriter* writer, const ImageExrChannel* channel, usize i) {
+  Camera* camera = writer->camera;
+  switch (channel->source) {
+    case IMAGE_EXR_SOURCE_AVERAGE: return camera->framebuffer[i].data[channel->component] * writer->scale;
+    case IMAGE_EXR_SOURCE_EVEN: return camera->framebuffer_even[i].data[channel->component] * writer->even_scale;
+    case IMAGE_EXR_SOURCE_ODD: return (camera->framebuffer[i].data[channel->component] - camera->framebuffer_even[i].data[channel->component]) * writer->odd_scale;
+  }
+
+  return 0.0f;
+}
+
+bool image_type_from_path(const char* path, ImageType* type) {
+  const char* extension = strrchr(path, '.');
+  if (!extension) { return false; }
+
+  if (strcmp(extension, ".hdr") == 0) {
+    *type = HDR;
+    return true;
+  }
+  if (strcmp(extension, ".jpg") == 0 || strcmp(extension, ".jpeg") == 0) {
+    *type = JPG;
+    return true;
+  }
+  if (strcmp(extension, ".png") == 0) {
+    *type = PNG;
+    return true;
+  }
+  if (strcmp(extension, ".exr") == 0) {
+    *type = EXR;
+    return true;
+  }
 
-  free(framebuffer);
+  return false;
 }
@@ -1,13 +1,24 @@
 #include "world.h"
 #include "camera.h"
+#include "scene_stream.h"
+#include "world_snapshot.h"
+#include "thread_pool.h"
+#include "trace.h"
 #include "gui/gui.h"
 
 int main() {
+  trace_set_thread_name("Main");
+
   GUI gui = gui_create(1280, 720);
   World world = world_create();
-  Camera* camera = camera_create(640, 480, &world);
+  Camera* camera = camera_create(640, 480);
+
+  SceneStreamOptions stream_options = scene_stream_options_default();
+  gui.scene_stream = scene_stream_start("../scenes/brick-earth.scene", &stream_options);
 
-  world_scene_load(&world, camera, "../scenes/brick-earth.scene");
+  WorldSnapshotQueue world_snapshots;
+  world_snapshot_queue_create(&world_snapshots, &world);
+  camera->world_snapshots = &world_snapshots;
 
   while (window_is_running(gui.window)) {
     gui_update(&gui, camera, &world);
@@ -18,5 +29,8 @@ int main() {
 
   gui_destroy(&gui);
   camera_destroy(camera);
+  world_snapshot_queue_destroy(&world_snapshots);
   world_destroy(&world);
+  thread_pool_global_destroy();
+  trace_destroy();
 }
@@ -14,8 +14,9 @@
 #include "textures/texture.h"
 #include "textures/solid_color.h"
 
-static Color get_color(Material* material, Vector2 uv_coordinates);
+static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint);
 static Vector3 get_direction(Material* material, RayHit rayhit, u64* state);
+static Material* clone(Material* material);
 static void destroy(Material* material);
 
 MaterialDiffuse* material_diffuse_create(Texture* albedo) {
@@ -25,26 +26,30 @@ MaterialDiffuse* material_diffuse_create(Texture* albedo) {
     return NULL;
   }
 
-  diffuse->material = (Material) { MATERIAL_TYPE_DIFFUSE, get_color, get_direction, destroy };
+  diffuse->material = (Material) { MATERIAL_TYPE_DIFFUSE, get_color, get_direction, clone, destroy };
   diffuse->albedo = albedo;
 
   return diffuse;
 }
 
-inline static Color get_color(Material* material, Vector2 uv_coordinates) {
-  return material_diffuse_get_color((MaterialDiffuse*) material, uv_coordinates);
+inline static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint) {
+  return material_diffuse_get_color((MaterialDiffuse*) material, uv_coordinates, uv_footprint);
 }
 
 inline static Vector3 get_direction(Material* material, RayHit rayhit, u64* state) {
   return material_diffuse_get_direction((MaterialDiffuse*) material, rayhit, state);
 }
 
+inline static Material* clone(Material* material) {
+  return (Material*) material_diffuse_clone((MaterialDiffuse*) material);
+}
+
 inline static void destroy(Material* material) {
   material_diffuse_destroy((MaterialDiffuse*) material);
 }
 
-inline Color material_diffuse_get_color(MaterialDiffuse* diffuse, Vector2 uv_coordinates) {
-  return diffuse->albedo->get_color(diffuse->albedo, uv_coordinates);
+inline Color material_diffuse_get_color(MaterialDiffuse* diffuse, Vector2 uv_coordinates, f32 uv_footprint) {
+  return diffuse->albedo->get_color(diffuse->albedo, uv_coordinates, uv_footprint);
 }
 
 inline Vector3 material_diffuse_get_direction(MaterialDiffuse *diffuse, RayHit rayhit, u64 *state) {
@@ -84,6 +89,16 @@ error:
   return NULL;
 }
 
+MaterialDiffuse* material_diffuse_clone(MaterialDiffuse* diffuse) {
+  Texture* albedo = diffuse->albedo->clone(diffuse->albedo);
+  if (!albedo) { return NULL; }
+
+  MaterialDiffuse* clone = material_diffuse_create(albedo);
+  if (!clone) { albedo->destroy(albedo); }
+
+  return clone;
+}
+
 inline void material_diffuse_destroy(MaterialDiffuse* diffuse) {
   diffuse->albedo->destroy(diffuse->albedo);
   free(diffuse);
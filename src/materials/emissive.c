@@ -12,8 +12,9 @@
 #include "types/rayhit.h"
 #include "textures/solid_color.h"
 
-static Color get_color(Material* material, Vector2 uv_coordinates);
+static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint);
 static Vector3 get_direction(Material* material, RayHit rayhit, u64* state);
+static Material* clone(Material* material);
 static void destroy(Material* material);
 
 MaterialEmissive* material_emissive_create(Texture* albedo, f32 emission_strength) {
@@ -23,27 +24,31 @@ MaterialEmissive* material_emissive_create(Texture* albedo, f32 emission_strengt
     return NULL;
   }
 
-  emissive->material = (Material) { MATERIAL_TYPE_EMISSIVE, get_color, get_direction, destroy };
+  emissive->material = (Material) { MATERIAL_TYPE_EMISSIVE, get_color, get_direction, clone, destroy };
   emissive->albedo = albedo;
   emissive->emission_strength = emission_strength;
 
   return emissive;
 }
 
-inline static Color get_color(Material* material, Vector2 uv_coordinates) {
-  return material_emissive_get_color((MaterialEmissive*) material, uv_coordinates);
+inline static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint) {
+  return material_emissive_get_color((MaterialEmissive*) material, uv_coordinates, uv_footprint);
 }
 
 inline static Vector3 get_direction(Material* material, RayHit rayhit, u64* state) {
   return material_emissive_get_direction((MaterialEmissive*) material, rayhit, state);
 }
 
+inline static Material* clone(Material* material) {
+  return (Material*) material_emissive_clone((MaterialEmissive*) material);
+}
+
 inline static void destroy(Material* material) {
   material_emissive_destroy((MaterialEmissive*) material);
 }
 
-inline Color material_emissive_get_color(MaterialEmissive* emissive, Vector2 uv_coordinates) {
-  Color emissive_color = emissive->albedo->get_color(emissive->albedo, uv_coordinates);
+inline Color material_emissive_get_color(MaterialEmissive* emissive, Vector2 uv_coordinates, f32 uv_footprint) {
+  Color emissive_color = emissive->albedo->get_color(emissive->albedo, uv_coordinates, uv_footprint);
   return color_add(emissive_color, color_scale(emissive_color, emissive->emission_strength));
 }
 
@@ -88,6 +93,16 @@ error:
   return NULL;
 }
 
+MaterialEmissive* material_emissive_clone(MaterialEmissive* emissive) {
+  Texture* albedo = emissive->albedo->clone(emissive->albedo);
+  if (!albedo) { return NULL; }
+
+  MaterialEmissive* clone = material_emissive_create(albedo, emissive->emission_strength);
+  if (!clone) { albedo->destroy(albedo); }
+
+  return clone;
+}
+
 inline void material_emissive_destroy(MaterialEmissive* emissive) {
   emissive->albedo->destroy(emissive->albedo);
   free(emissive);
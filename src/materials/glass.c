@@ -13,8 +13,9 @@
 #include "textures/solid_color.h"
 #include "random.h"
 
-static Color get_color(Material* material, Vector2 uv_coordinates);
+static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint);
 static Vector3 get_direction(Material* material, RayHit rayhit, u64* state);
+static Material* clone(Material* material);
 static void destroy(Material* material);
 
 static f32 reflectance(f32 cosine, f32 refraction_ratio);
@@ -26,7 +27,7 @@ MaterialGlass* material_glass_create(Texture* albedo, f32 refraction_index, f32
     return NULL;
   }
 
-  glass->material = (Material) { MATERIAL_TYPE_GLASS, get_color, get_direction, destroy };
+  glass->material = (Material) { MATERIAL_TYPE_GLASS, get_color, get_direction, clone, destroy };
   glass->albedo = albedo;
   glass->refraction_index = refraction_index;
   glass->roughness = roughness;
@@ -34,20 +35,24 @@ MaterialGlass* material_glass_create(Texture* albedo, f32 refraction_index, f32
   return glass;
 }
 
-inline static Color get_color(Material* material, Vector2 uv_coordinates) {
-  return material_glass_get_color((MaterialGlass*) material, uv_coordinates);
+inline static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint) {
+  return material_glass_get_color((MaterialGlass*) material, uv_coordinates, uv_footprint);
 }
 
 inline static Vector3 get_direction(Material* material, RayHit rayhit, u64* state) {
   return material_glass_get_direction((MaterialGlass*) material, rayhit, state);
 }
 
+inline static Material* clone(Material* material) {
+  return (Material*) material_glass_clone((MaterialGlass*) material);
+}
+
 inline static void destroy(Material* material) {
   material_glass_destroy((MaterialGlass*) material);
 }
 
-inline Color material_glass_get_color(MaterialGlass* glass, Vector2 uv_coordinates) {
-  return glass->albedo->get_color(glass->albedo, uv_coordinates);
+inline Color material_glass_get_color(MaterialGlass* glass, Vector2 uv_coordinates, f32 uv_footprint) {
+  return glass->albedo->get_color(glass->albedo, uv_coordinates, uv_footprint);
 }
 
 Vector3 material_glass_get_direction(MaterialGlass *glass, RayHit rayhit, u64 *state) {
@@ -118,6 +123,17 @@ error:
   return NULL;
 }
 
+MaterialGlass* material_glass_clone(MaterialGlass* glass) {
+  Texture* albedo = glass->albedo->clone(glass->albedo);
+  if (!albedo) { return NULL; }
+
+  MaterialGlass* clone = material_glass_create(albedo, glass->refraction_index, glass->roughness);
+  if (!clone) { albedo->destroy(albedo); }
+
+  return clone;
+}
+
 inline void material_glass_destroy(MaterialGlass* glass) {
+  glass->albedo->destroy(glass->albedo);
   free(glass);
 }
@@ -10,8 +10,9 @@
 #include "textures/solid_color.h"
 #include "types/color.h"
 
-static Color get_color(Material* material, Vector2 uv_coordinates);
+static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint);
 static Vector3 get_direction(Material* material, RayHit rayhit, u64* state);
+static Material* clone(Material* material);
 static void destroy(Material* material);
 
 Metal* material_metal_create(Texture* albedo, f32 roughness) {
@@ -21,27 +22,31 @@ Metal* material_metal_create(Texture* albedo, f32 roughness) {
     return NULL;
   }
 
-  metal->material = (Material) { MATERIAL_TYPE_METAL, get_color, get_direction, destroy };
+  metal->material = (Material) { MATERIAL_TYPE_METAL, get_color, get_direction, clone, destroy };
   metal->albedo = albedo;
   metal->roughness = roughness;
 
   return metal;
 }
 
-inline static Color get_color(Material* material, Vector2 uv_coordinates) {
-  return material_metal_get_color((Metal*) material, uv_coordinates);
+inline static Color get_color(Material* material, Vector2 uv_coordinates, f32 uv_footprint) {
+  return material_metal_get_color((Metal*) material, uv_coordinates, uv_footprint);
 }
 
 inline static Vector3 get_direction(Material* material, RayHit rayhit, u64* state) {
   return material_metal_get_direction((Metal*) material, rayhit, state);
 }
 
+inline static Material* clone(Material* material) {
+  return (Material*) material_metal_clone((Metal*) material);
+}
+
 inline static void destroy(Material* material) {
   material_metal_destroy((Metal*) material);
 }
 
-inline Color material_metal_get_color(Metal* metal, Vector2 uv_coordinates) {
-  return metal->albedo->get_color(metal->albedo, uv_coordinates);
+inline Color material_metal_get_color(Metal* metal, Vector2 uv_coordinates, f32 uv_footprint) {
+  return metal->albedo->get_color(metal->albedo, uv_coordinates, uv_footprint);
 }
 
 inline Vector3 material_metal_get_direction(Metal* metal, RayHit rayhit, u64 *state) {
@@ -85,6 +90,16 @@ error:
   return NULL;
 }
 
+Metal* material_metal_clone(Metal* metal) {
+  Texture* albedo = metal->albedo->clone(metal->albedo);
+  if (!albedo) { return NULL; }
+
+  Metal* clone = material_metal_create(albedo, metal->roughness);
+  if (!clone) { albedo->destroy(albedo); }
+
+  return clone;
+}
+
 inline void material_metal_destroy(Metal* metal) {
   metal->albedo->destroy(metal->albedo);
   free(metal);
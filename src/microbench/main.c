@@ -0,0 +1,391 @@
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MICROBENCH_HAS_CYCLE_COUNTER 1
+#else
+#define MICROBENCH_HAS_CYCLE_COUNTER 0
+#endif
+
+#include "hittables/plane.h"
+#include "hittables/sphere.h"
+#include "math/ray.h"
+#include "math/vector2.h"
+#include "math/vector3.h"
+#include "random.h"
+#include "textures/image.h"
+#include "tonemapping.h"
+#include "types/base_types.h"
+#include "types/color.h"
+#include "types/rayhit.h"
+#include "utils/timer.h"
+
+#define MICROBENCH_DEFAULT_BATCH_SIZE 4096
+#define MICROBENCH_DEFAULT_REPETITIONS 200
+#define MICROBENCH_DEFAULT_WARMUP 20
+#define MICROBENCH_TEXTURE_SIZE 512
+#define MICROBENCH_LARGE_TEXTURE_SIZE 4096
+#define MICROBENCH_TRILINEAR_TEXELS 5.0f
+
+// inputs are generated once up front so every repetition of a kernel sees exactly the same data
+typedef struct MicrobenchData {
+  usize batch_size;
+
+  Ray* rays;
+  Vector3* vectors;
+  Vector2* uv_coordinates;
+  Color* colors;
+  u64* states;
+
+  HittableSphere* sphere;
+  HittablePlane* plane;
+  TextureImage texture;
+  TextureImage large_texture;
+  TextureImage large_half_texture;
+  ToneMappingOperator reinhard;
+
+  // every kernel folds its results in here so the compiler cannot drop the calls
+  f32 sink;
+} MicrobenchData;
+
+typedef struct MicrobenchKernel {
+  const char* name;
+  void (*run)(MicrobenchData* data);
+} MicrobenchKernel;
+
+typedef struct MicrobenchStats {
+  f64 min, median, mean, stddev;
+} MicrobenchStats;
+
+static void kernel_sphere_ray_hit(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    RayHit rayhit = hittable_sphere_ray_hit(data->sphere, data->rays[i]);
+    data->sink += rayhit.t;
+  }
+}
+
+static void kernel_plane_ray_hit(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    RayHit rayhit = hittable_plane_ray_hit(data->plane, data->rays[i]);
+    data->sink += rayhit.t;
+  }
+}
+
+static void kernel_pcg32(MicrobenchData* data) {
+  u64 state = data->states[0];
+  u32 result = 0;
+  for (usize i = 0; i < data->batch_size; i++) {
+    result ^= pcg32(&state);
+  }
+  data->sink += (f32) result;
+}
+
+static void kernel_random_vector3_unit_vector(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    u64 state = data->states[i];
+    data->sink += random_vector3_unit_vector(&state).x;
+  }
+}
+
+static void kernel_vector3_normalize(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    data->sink += vector3_normalize(data->vectors[i]).x;
+  }
+}
+
+static void kernel_texture_image_get(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    data->sink += texture_image_get(&data->texture, data->uv_coordinates[i], 0.0f).red;
+  }
+}
+
+static void kernel_texture_image_get_large_bilinear(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    data->sink += texture_image_get(&data->large_texture, data->uv_coordinates[i], 0.0f).red;
+  }
+}
+
+static void kernel_texture_image_get_large_half_bilinear(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    data->sink += texture_image_get(&data->large_half_texture, data->uv_coordinates[i], 0.0f).red;
+  }
+}
+
+static void kernel_texture_image_get_large_trilinear(MicrobenchData* data) {
+  f32 uv_footprint = MICROBENCH_TRILINEAR_TEXELS / MICROBENCH_LARGE_TEXTURE_SIZE;
+  for (usize i = 0; i < data->batch_size; i++) {
+    data->sink += texture_image_get(&data->large_texture, data->uv_coordinates[i], uv_footprint).red;
+  }
+}
+
+// walks down a column one texel per lookup, like neighbouring rays on a surface running across the image rows
+static void kernel_texture_image_get_large_column(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    Vector2 uv_coordinates = { data->uv_coordinates[0].x, (f32) i / MICROBENCH_LARGE_TEXTURE_SIZE };
+    data->sink += texture_image_get(&data->large_texture, uv_coordinates, 0.0f).red;
+  }
+}
+
+static void kernel_tonemapping_reinhard(MicrobenchData* data) {
+  for (usize i = 0; i < data->batch_size; i++) {
+    data->sink += tonemapping(data->reinhard, data->colors[i]).red;
+  }
+}
+
+static const MicrobenchKernel microbench_kernels[] = {
+  { "hittable_sphere_ray_hit", kernel_sphere_ray_hit },
+  { "hittable_plane_ray_hit", kernel_plane_ray_hit },
+  { "pcg32", kernel_pcg32 },
+  { "random_vector3_unit_vector", kernel_random_vector3_unit_vector },
+  { "vector3_normalize", kernel_vector3_normalize },
+  { "texture_image_get", kernel_texture_image_get },
+  { "texture_image_get_large_bilinear", kernel_texture_image_get_large_bilinear },
+  { "texture_image_get_large_half_bilinear", kernel_texture_image_get_large_half_bilinear },
+  { "texture_image_get_large_trilinear", kernel_texture_image_get_large_trilinear },
+  { "texture_image_get_large_column", kernel_texture_image_get_large_column },
+  { "tonemapping_reinhard", kernel_tonemapping_reinhard }
+};
+
+static inline u64 microbench_cycles() {
+#if MICROBENCH_HAS_CYCLE_COUNTER
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+static int microbench_compare_f64(const void* a, const void* b) {
+  f64 difference = *(const f64*) a - *(const f64*) b;
+  return (difference > 0.0) - (difference < 0.0);
+}
+
+static MicrobenchStats microbench_stats(f64* values, usize count) {
+  qsort(values, count, sizeof(f64), microbench_compare_f64);
+
+  MicrobenchStats stats = { .min = values[0], .median = values[count / 2] };
+  for (usize i = 0; i < count; i++) { stats.mean += values[i]; }
+  stats.mean /= count;
+
+  for (usize i = 0; i < count; i++) { stats.stddev += (values[i] - stats.mean) * (values[i] - stats.mean); }
+  stats.stddev = sqrt(stats.stddev / count);
+
+  return stats;
+}
+
+// a gradient, only the memory layout matters for timing lookups
+static bool microbench_texture_create(TextureImage* texture, u32 size, TextureImageFormat format) {
+  usize texels = (usize) size * size;
+  void* data = (format == TEXTURE_IMAGE_FORMAT_SRGB8) ? malloc(sizeof(u8) * 4 * texels) : malloc(sizeof(f32) * 3 * texels);
+  if (!data) {
+    fprintf(stderr, "[ERROR] [MICROBENCH] Failed to allocate memory for texture!\n");
+    return false;
+  }
+
+  for (usize i = 0; i < texels; i++) {
+    f32 red = (f32) (i % size) / size, green = (f32) (i / size) / size;
+    if (format == TEXTURE_IMAGE_FORMAT_SRGB8) {
+      u8* texel = &((u8*) data)[i * 4];
+      texel[0] = (u8) (red * 255.0f);
+      texel[1] = (u8) (green * 255.0f);
+      texel[2] = 128;
+      texel[3] = 255;
+    } else {
+      f32* texel = &((f32*) data)[i * 3];
+      texel[0] = red;
+      texel[1] = green;
+      texel[2] = 0.5f;
+    }
+  }
+
+  bool built = texture_image_build_levels(texture, format, data, size, size);
+  free(data);
+  if (!built) { return false; }
+
+  atomic_init(&texture->state, TEXTURE_IMAGE_STATE_READY);
+  return true;
+}
+
+// rays start around the unit sphere at the origin and mostly point at it, so both hit and miss paths get exercised
+static bool microbench_data_create(MicrobenchData* data, usize batch_size) {
+  memset(data, 0, sizeof(MicrobenchData));
+  data->batch_size = batch_size;
+
+  data->rays = (Ray*) malloc(sizeof(Ray) * batch_size);
+  data->vectors = (Vector3*) malloc(sizeof(Vector3) * batch_size);
+  data->uv_coordinates = (Vector2*) malloc(sizeof(Vector2) * batch_size);
+  data->colors = (Color*) malloc(sizeof(Color) * batch_size);
+  data->states = (u64*) malloc(sizeof(u64) * batch_size);
+  if (!data->rays || !data->vectors || !data->uv_coordinates || !data->colors || !data->states) {
+    fprintf(stderr, "[ERROR] [MICROBENCH] Failed to allocate memory for input batches!\n");
+    return false;
+  }
+
+  for (usize i = 0; i < batch_size; i++) {
+    u64 state = random_state_create(i, 0, 0, 0);
+
+    Vector3 origin = vector3_scale(random_vector3_unit_vector(&state), 4.0f);
+    Vector3 target = random_vector3(&state, -1.5f, 1.5f);
+    data->rays[i] = (Ray) { origin, vector3_normalize(vector3_subtract(target, origin)) };
+
+    data->vectors[i] = random_vector3(&state, -10.0f, 10.0f);
+    data->uv_coordinates[i] = (Vector2) { random_f32(&state), random_f32(&state) };
+    data->colors[i] = (Color) { random_f32_range(&state, 0.0f, 4.0f), random_f32_range(&state, 0.0f, 4.0f), random_f32_range(&state, 0.0f, 4.0f) };
+    data->states[i] = state;
+  }
+
+  if (!microbench_texture_create(&data->texture, MICROBENCH_TEXTURE_SIZE, TEXTURE_IMAGE_FORMAT_SRGB8)) { return false; }
+  if (!microbench_texture_create(&data->large_texture, MICROBENCH_LARGE_TEXTURE_SIZE, TEXTURE_IMAGE_FORMAT_SRGB8)) { return false; }
+  if (!microbench_texture_create(&data->large_half_texture, MICROBENCH_LARGE_TEXTURE_SIZE, TEXTURE_IMAGE_FORMAT_HALF)) { return false; }
+
+  data->sphere = hittable_sphere_create((Vector3) { 0.0f, 0.0f, 0.0f }, 1.0f, NULL);
+  data->plane = hittable_plane_create((Vector3) { 0.0f, 0.0f, 0.0f }, (Vector3) { 0.0f, 1.0f, 0.0f }, (Vector2) { 2.0f, 2.0f }, NULL);
+  if (!data->sphere || !data->plane) { return false; }
+
+  data->reinhard = (ToneMappingOperator) { REINHARD, 4.0f };
+
+  return true;
+}
+
+static void microbench_data_destroy(MicrobenchData* data) {
+  free(data->rays);
+  free(data->vectors);
+  free(data->uv_coordinates);
+  free(data->colors);
+  free(data->states);
+  free(data->texture.pixels);
+  free(data->large_texture.pixels);
+  free(data->large_half_texture.pixels);
+  if (data->sphere) { hittable_sphere_destroy(data->sphere); }
+  if (data->plane) { hittable_plane_destroy(data->plane); }
+}
+
+static void microbench_print_usage(const char* program) {
+  fprintf(stderr,
+    "Usage: %s [options] [kernel...]\n"
+    "  -b, --batch <count>         calls per repetition (default %u)\n"
+    "  -r, --repetitions <count>   timed repetitions (default %u)\n"
+    "  -w, --warmup <count>        untimed repetitions first (default %u)\n"
+    "  -h, --help                  show this message\n"
+    "Kernels default to all of them:\n",
+    program, MICROBENCH_DEFAULT_BATCH_SIZE, MICROBENCH_DEFAULT_REPETITIONS, MICROBENCH_DEFAULT_WARMUP
+  );
+
+  for (usize k = 0; k < (sizeof(microbench_kernels) / sizeof(MicrobenchKernel)); k++) {
+    fprintf(stderr, "  %s\n", microbench_kernels[k].name);
+  }
+}
+
+static bool microbench_parse_u32(const char* string, u32* value) {
+  char* end;
+  unsigned long parsed = strtoul(string, &end, 10);
+  if (end == string || *end != '\0' || parsed > UINT32_MAX) { return false; }
+
+  *value = (u32) parsed;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  u32 batch_size = MICROBENCH_DEFAULT_BATCH_SIZE;
+  u32 repetitions = MICROBENCH_DEFAULT_REPETITIONS;
+  u32 warmup = MICROBENCH_DEFAULT_WARMUP;
+
+  static const struct option long_options[] = {
+    { "batch", required_argument, NULL, 'b' },
+    { "repetitions", required_argument, NULL, 'r' },
+    { "warmup", required_argument, NULL, 'w' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  s32 option;
+  while ((option = getopt_long(argc, argv, "b:r:w:h", long_options, NULL)) != -1) {
+    bool valid = true;
+    switch (option) {
+      case 'b': valid = microbench_parse_u32(optarg, &batch_size) && batch_size > 0; break;
+      case 'r': valid = microbench_parse_u32(optarg, &repetitions) && repetitions > 0; break;
+      case 'w': valid = microbench_parse_u32(optarg, &warmup); break;
+      default: microbench_print_usage(argv[0]); return EXIT_FAILURE;
+    }
+
+    if (!valid) {
+      fprintf(stderr, "[ERROR] [MICROBENCH] Invalid value for option -%c: %s!\n", option, optarg);
+      microbench_print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // a misspelled kernel would otherwise just be missing from the table
+  for (s32 i = optind; i < argc; i++) {
+    bool known = false;
+    for (usize k = 0; k < (sizeof(microbench_kernels) / sizeof(MicrobenchKernel)); k++) {
+      if (strcmp(argv[i], microbench_kernels[k].name) == 0) { known = true; }
+    }
+
+    if (!known) {
+      fprintf(stderr, "[ERROR] [MICROBENCH] Unknown kernel: %s!\n", argv[i]);
+      microbench_print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  s32 status = EXIT_FAILURE;
+  MicrobenchData data = {0};
+  f64* nanoseconds = (f64*) malloc(sizeof(f64) * repetitions);
+  f64* cycles = (f64*) malloc(sizeof(f64) * repetitions);
+  if (!nanoseconds || !cycles) {
+    fprintf(stderr, "[ERROR] [MICROBENCH] Failed to allocate memory for measurements!\n");
+    goto cleanup;
+  }
+
+  if (!microbench_data_create(&data, batch_size)) { goto cleanup; }
+
+  printf("%-28s %10s %10s %10s %10s %12s\n", "kernel", "min ns", "median ns", "mean ns", "stddev ns", "median cyc");
+
+  for (usize k = 0; k < (sizeof(microbench_kernels) / sizeof(MicrobenchKernel)); k++) {
+    const MicrobenchKernel* kernel = &microbench_kernels[k];
+
+    bool selected = (optind == argc);
+    for (s32 i = optind; i < argc; i++) {
+      if (strcmp(argv[i], kernel->name) == 0) { selected = true; }
+    }
+    if (!selected) { continue; }
+
+    for (u32 i = 0; i < warmup; i++) { kernel->run(&data); }
+
+    for (u32 i = 0; i < repetitions; i++) {
+      u64 start_cycles = microbench_cycles();
+      f64 start_time = timer_get_seconds();
+      kernel->run(&data);
+      f64 end_time = timer_get_seconds();
+      u64 end_cycles = microbench_cycles();
+
+      nanoseconds[i] = ((end_time - start_time) * 1e9) / batch_size;
+      cycles[i] = (f64) (end_cycles - start_cycles) / batch_size;
+    }
+
+    MicrobenchStats time_stats = microbench_stats(nanoseconds, repetitions);
+    MicrobenchStats cycle_stats = microbench_stats(cycles, repetitions);
+
+    printf("%-28s %10.3f %10.3f %10.3f %10.3f", kernel->name, time_stats.min, time_stats.median, time_stats.mean, time_stats.stddev);
+    if (MICROBENCH_HAS_CYCLE_COUNTER) {
+      printf(" %12.2f\n", cycle_stats.median);
+    } else {
+      printf(" %12s\n", "n/a");
+    }
+  }
+
+  // printed so the sink is observable, its value is meaningless
+  printf("[INFO] [MICROBENCH] Checksum %g\n", data.sink);
+  status = EXIT_SUCCESS;
+
+cleanup:
+  microbench_data_destroy(&data);
+  free(nanoseconds);
+  free(cycles);
+  return status;
+}
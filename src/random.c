@@ -9,6 +9,21 @@
 #include "hittables/sphere.h"
 #include "hittables/plane.h"
 
+static inline u64 splitmix64(u64 x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// every random stream is a pure function of where it is used, so the same pixel and sample
+// always see the same numbers no matter which thread (or process) ends up rendering them
+u64 random_state_create(u32 pixel_index, u32 sample_index, u32 dimension, u32 seed) {
+  u64 state = splitmix64(((u64) seed << 32) | dimension);
+  state = splitmix64(state ^ pixel_index);
+  return splitmix64(state ^ sample_index);
+}
+
 u32 pcg32(u64* state) {
     u64 oldstate = *state;
     *state = oldstate * 6364136223846793005ULL + 1u;
@@ -0,0 +1,53 @@
+#include "render_stats.h"
+
+#include <stdio.h>
+
+#include "types/base_types.h"
+
+void render_stats_add(RenderStats* total, RenderStats* stats) {
+  total->primary_rays += stats->primary_rays;
+  total->secondary_rays += stats->secondary_rays;
+  for (usize i = 0; i < RENDER_STATS_HITTABLE_TYPE_COUNT; i++) {
+    total->intersection_tests[i] += stats->intersection_tests[i];
+  }
+  total->bounces += stats->bounces;
+  total->escaped_rays += stats->escaped_rays;
+  total->material_evaluations += stats->material_evaluations;
+
+  for (usize i = 0; i < RENDER_STAGE_COUNT; i++) {
+    total->stage_time[i] += stats->stage_time[i];
+  }
+}
+
+f64 render_stats_busy_time(RenderStats* stats) {
+  f64 busy_time = 0.0;
+  for (usize i = 0; i < RENDER_STAGE_COUNT; i++) {
+    busy_time += stats->stage_time[i];
+  }
+  return busy_time;
+}
+
+const char* render_stats_stage_name(RenderStage stage) {
+  switch (stage) {
+    case RENDER_STAGE_SNAPSHOT: return "Snapshot";
+    case RENDER_STAGE_PREVIEW: return "Preview";
+    case RENDER_STAGE_SAMPLE: return "Sample";
+    case RENDER_STAGE_EXPORT_COPY: return "Export Copy";
+    default: return "Unknown";
+  }
+}
+
+void render_stats_print(RenderStats* stats, f64 wall_time) {
+  u64 rays = stats->primary_rays + stats->secondary_rays;
+  printf("[INFO] [STATS] %llu primary rays (%.2f Mrays/s)\n", (unsigned long long) stats->primary_rays, (stats->primary_rays / wall_time) / 1e6);
+
+  if (RENDER_STATS_ENABLED) {
+    printf("[INFO] [STATS] %llu secondary rays, %.2f Mrays/s total\n", (unsigned long long) stats->secondary_rays, (rays / wall_time) / 1e6);
+    printf("[INFO] [STATS] %llu sphere tests, %llu plane tests\n", (unsigned long long) stats->intersection_tests[HITTABLE_TYPE_SPHERE], (unsigned long long) stats->intersection_tests[HITTABLE_TYPE_PLANE]);
+    printf("[INFO] [STATS] %llu bounces, %llu escaped rays, %llu material evaluations\n", (unsigned long long) stats->bounces, (unsigned long long) stats->escaped_rays, (unsigned long long) stats->material_evaluations);
+  }
+
+  for (usize i = 0; i < RENDER_STAGE_COUNT; i++) {
+    printf("[INFO] [STATS] %s: %.3fs summed over slices\n", render_stats_stage_name(i), stats->stage_time[i]);
+  }
+}
@@ -0,0 +1,376 @@
+#include "scene_binary.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "camera.h"
+#include "trace.h"
+#include "world.h"
+#include "hittables/hittable.h"
+#include "hittables/plane.h"
+#include "hittables/sphere.h"
+#include "materials/material.h"
+#include "materials/diffuse.h"
+#include "materials/emissive.h"
+#include "materials/glass.h"
+#include "materials/metal.h"
+#include "textures/texture.h"
+#include "textures/image.h"
+#include "textures/solid_color.h"
+#include "types/base_types.h"
+
+#define SCENE_BINARY_ALIGNMENT 8
+#define SCENE_BINARY_ALIGN(size) (((size) + (SCENE_BINARY_ALIGNMENT - 1)) & ~((u64) SCENE_BINARY_ALIGNMENT - 1))
+
+#define SCENE_BINARY_FNV_OFFSET 14695981039346656037ull
+#define SCENE_BINARY_FNV_PRIME 1099511628211ull
+
+// the tables are read straight from the mapping, so their layout is part of the format
+_Static_assert(sizeof(SceneBinaryHeader) == 72, "binary scene header layout changed, bump SCENE_BINARY_VERSION");
+_Static_assert(sizeof(SceneBinaryHittable) == 44, "binary scene hittable layout changed, bump SCENE_BINARY_VERSION");
+_Static_assert(sizeof(SceneBinaryMaterial) == 20, "binary scene material layout changed, bump SCENE_BINARY_VERSION");
+_Static_assert(sizeof(SceneBinaryTexture) == 20, "binary scene texture layout changed, bump SCENE_BINARY_VERSION");
+
+typedef struct SceneBinaryStrings {
+  char* data;
+  u32 size, capacity;
+} SceneBinaryStrings;
+
+// image texture indices by path, an open addressed table at most half full whose slots hold the index + 1
+typedef struct SceneBinaryPaths {
+  u32* slots;
+  u64 mask;
+} SceneBinaryPaths;
+
+static bool scene_binary_add_texture(Texture* texture, SceneBinaryTexture* textures, u32* textures_count, SceneBinaryStrings* strings, SceneBinaryPaths* paths, u32* index);
+static u64 scene_binary_path_hash(const char* path);
+static bool scene_binary_write(FILE* file, const void* data, usize size);
+static bool scene_binary_table_fits(u64 offset, u64 count, u64 element_size, u64 file_size);
+static Texture* scene_binary_texture_create(const SceneBinaryHeader* header, const SceneBinaryTexture* texture, const char* strings, TextureImage** images, u32 index);
+static Material* scene_binary_material_create(const SceneBinaryMaterial* material, Texture* albedo);
+
+bool scene_binary_is_binary_path(const char* filename) {
+  const char* extension = strrchr(filename, '.');
+  return extension && (strcmp(extension, SCENE_BINARY_EXTENSION) == 0);
+}
+
+bool scene_binary_save(World* world, Camera* camera, const char* filename) {
+  TraceScope trace = trace_begin("Scene Save");
+
+  bool saved = false;
+  FILE* file = NULL;
+  SceneBinaryStrings strings = {0};
+
+  // every hittable owns its material, so there are as many materials as hittables and at most as many textures
+  u32 count = world->hittables_count;
+  SceneBinaryHittable* hittables = (SceneBinaryHittable*) calloc(count + 1, sizeof(SceneBinaryHittable));
+  SceneBinaryMaterial* materials = (SceneBinaryMaterial*) calloc(count + 1, sizeof(SceneBinaryMaterial));
+  SceneBinaryTexture* textures = (SceneBinaryTexture*) calloc(count + 1, sizeof(SceneBinaryTexture));
+
+  u64 paths_size = 1;
+  while (paths_size < ((u64) count + 1) * 2) { paths_size *= 2; }
+  SceneBinaryPaths paths = { (u32*) calloc(paths_size, sizeof(u32)), paths_size - 1 };
+  if (!hittables || !materials || !textures || !paths.slots) { goto cleanup; }
+
+  u32 textures_count = 0;
+  for (u32 i = 0; i < count; i++) {
+    Hittable* hittable = world->hittables[i];
+    SceneBinaryHittable* hittable_entry = &hittables[i];
+
+    hittable_entry->type = hittable->type;
+    hittable_entry->material = i;
+    memcpy(hittable_entry->position, hittable->position->data, sizeof(hittable_entry->position));
+
+    switch (hittable->type) {
+      case HITTABLE_TYPE_SPHERE: hittable_entry->radius = ((HittableSphere*) hittable)->radius; break;
+      case HITTABLE_TYPE_PLANE: {
+        HittablePlane* plane = (HittablePlane*) hittable;
+        memcpy(hittable_entry->normal, plane->normal.data, sizeof(hittable_entry->normal));
+        hittable_entry->size[0] = plane->size.x;
+        hittable_entry->size[1] = plane->size.y;
+      } break;
+      default:
+        fprintf(stderr, "[ERROR] [SCENE] [BINARY] Unknown hittable type: %d!\n", hittable->type);
+        goto cleanup;
+    }
+
+    Material* material = hittable->material;
+    SceneBinaryMaterial* material_entry = &materials[i];
+    material_entry->type = material->type;
+
+    Texture* albedo = NULL;
+    switch (material->type) {
+      case MATERIAL_TYPE_DIFFUSE: albedo = ((MaterialDiffuse*) material)->albedo; break;
+      case MATERIAL_TYPE_METAL: {
+        albedo = ((Metal*) material)->albedo;
+        material_entry->roughness = ((Metal*) material)->roughness;
+      } break;
+      case MATERIAL_TYPE_GLASS: {
+        albedo = ((MaterialGlass*) material)->albedo;
+        material_entry->roughness = ((MaterialGlass*) material)->roughness;
+        material_entry->refraction_index = ((MaterialGlass*) material)->refraction_index;
+      } break;
+      case MATERIAL_TYPE_EMISSIVE: {
+        albedo = ((MaterialEmissive*) material)->albedo;
+        material_entry->emission_strength = ((MaterialEmissive*) material)->emission_strength;
+      } break;
+      default:
+        fprintf(stderr, "[ERROR] [SCENE] [BINARY] Unknown material type: %d!\n", material->type);
+        goto cleanup;
+    }
+
+    if (!scene_binary_add_texture(albedo, textures, &textures_count, &strings, &paths, &material_entry->texture)) { goto cleanup; }
+  }
+
+  SceneBinaryHeader header = {
+    .magic = SCENE_BINARY_MAGIC,
+    .version = SCENE_BINARY_VERSION,
+    .camera_position = { camera->position.x, camera->position.y, camera->position.z },
+    .seed = camera->seed,
+    .hittables_count = count,
+    .materials_count = count,
+    .textures_count = textures_count,
+    .strings_size = strings.size
+  };
+
+  header.hittables_offset = SCENE_BINARY_ALIGN(sizeof(SceneBinaryHeader));
+  header.materials_offset = header.hittables_offset + SCENE_BINARY_ALIGN((u64) count * sizeof(SceneBinaryHittable));
+  header.textures_offset = header.materials_offset + SCENE_BINARY_ALIGN((u64) count * sizeof(SceneBinaryMaterial));
+  header.strings_offset = header.textures_offset + SCENE_BINARY_ALIGN((u64) textures_count * sizeof(SceneBinaryTexture));
+
+  file = fopen(filename, "wb");
+  if (!file) { goto cleanup; }
+
+  if (!scene_binary_write(file, &header, sizeof(SceneBinaryHeader))) { goto cleanup; }
+  if (!scene_binary_write(file, hittables, count * sizeof(SceneBinaryHittable))) { goto cleanup; }
+  if (!scene_binary_write(file, materials, count * sizeof(SceneBinaryMaterial))) { goto cleanup; }
+  if (!scene_binary_write(file, textures, textures_count * sizeof(SceneBinaryTexture))) { goto cleanup; }
+  if (!scene_binary_write(file, strings.data, strings.size)) { goto cleanup; }
+
+  saved = true;
+
+cleanup:
+  if (file && fclose(file) != 0) { saved = false; }
+  if (!saved) { fprintf(stderr, "[ERROR] [SCENE] [BINARY] Failed to save scene: %s!\n", filename); }
+
+  free(hittables);
+  free(materials);
+  free(textures);
+  free(paths.slots);
+  free(strings.data);
+  trace_end(trace);
+  return saved;
+}
+
+// the hittables still have to be created one by one since the renderer works on them, but nothing is tokenized
+// or parsed and image textures are decoded once per table entry no matter how many materials use them,
+// the scene is built on the side so a broken file leaves the world and camera as they were
+bool scene_binary_load(World* world, Camera* camera, const char* filename) {
+  TraceScope trace = trace_begin("Scene Load");
+
+  bool loaded = false;
+  void* data = MAP_FAILED;
+  u64 file_size = 0;
+  TextureImage** images = NULL;
+  World loaded_world = {0};
+
+  s32 file_descriptor = open(filename, O_RDONLY);
+  if (file_descriptor < 0) {
+    fprintf(stderr, "[ERROR] [SCENE] [BINARY] Failed to open file: %s!\n", filename);
+    trace_end(trace);
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(file_descriptor, &file_stat) == 0 && (u64) file_stat.st_size >= sizeof(SceneBinaryHeader)) {
+    file_size = (u64) file_stat.st_size;
+    data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+  }
+  close(file_descriptor);
+  if (data == MAP_FAILED) { goto error; }
+
+  const SceneBinaryHeader* header = (const SceneBinaryHeader*) data;
+  if (memcmp(header->magic, SCENE_BINARY_MAGIC, sizeof(header->magic)) != 0) { goto error; }
+  if (header->version != SCENE_BINARY_VERSION) {
+    fprintf(stderr, "[ERROR] [SCENE] [BINARY] Unsupported version %u, expected %u!\n", header->version, SCENE_BINARY_VERSION);
+    goto error;
+  }
+
+  if (!scene_binary_table_fits(header->hittables_offset, header->hittables_count, sizeof(SceneBinaryHittable), file_size)) { goto error; }
+  if (!scene_binary_table_fits(header->materials_offset, header->materials_count, sizeof(SceneBinaryMaterial), file_size)) { goto error; }
+  if (!scene_binary_table_fits(header->textures_offset, header->textures_count, sizeof(SceneBinaryTexture), file_size)) { goto error; }
+  if (!scene_binary_table_fits(header->strings_offset, header->strings_size, sizeof(char), file_size)) { goto error; }
+
+  const SceneBinaryHittable* hittables = (const SceneBinaryHittable*) ((const u8*) data + header->hittables_offset);
+  const SceneBinaryMaterial* materials = (const SceneBinaryMaterial*) ((const u8*) data + header->materials_offset);
+  const SceneBinaryTexture* textures = (const SceneBinaryTexture*) ((const u8*) data + header->textures_offset);
+  const char* strings = (const char*) data + header->strings_offset;
+
+  images = (TextureImage**) calloc(header->textures_count + 1, sizeof(TextureImage*));
+  if (!images) { goto error; }
+
+  loaded_world = world_create();
+  if (!loaded_world.hittables) { goto error; }
+
+  for (u32 i = 0; i < header->hittables_count; i++) {
+    const SceneBinaryHittable* hittable_entry = &hittables[i];
+    if (hittable_entry->material >= header->materials_count) { goto error; }
+
+    const SceneBinaryMaterial* material_entry = &materials[hittable_entry->material];
+    if (material_entry->texture >= header->textures_count) { goto error; }
+
+    Texture* albedo = scene_binary_texture_create(header, &textures[material_entry->texture], strings, images, material_entry->texture);
+    if (!albedo) { goto error; }
+
+    Material* material = scene_binary_material_create(material_entry, albedo);
+    if (!material) {
+      albedo->destroy(albedo);
+      goto error;
+    }
+
+    Vector3 position = { hittable_entry->position[0], hittable_entry->position[1], hittable_entry->position[2] };
+    Hittable* hittable = NULL;
+    switch ((HittableType) hittable_entry->type) {
+      case HITTABLE_TYPE_SPHERE: hittable = (Hittable*) hittable_sphere_create(position, hittable_entry->radius, material); break;
+      case HITTABLE_TYPE_PLANE: {
+        Vector3 normal = { hittable_entry->normal[0], hittable_entry->normal[1], hittable_entry->normal[2] };
+        Vector2 size = { hittable_entry->size[0], hittable_entry->size[1] };
+        hittable = (Hittable*) hittable_plane_create(position, normal, size, material);
+      } break;
+    }
+
+    if (!hittable) {
+      material->destroy(material);
+      goto error;
+    }
+
+    world_add(&loaded_world, hittable);
+  }
+
+  world_destroy(world);
+  *world = loaded_world;
+  camera->position = (Vector3) { header->camera_position[0], header->camera_position[1], header->camera_position[2] };
+  camera->seed = header->seed;
+
+  loaded = true;
+  goto cleanup;
+
+error:
+  fprintf(stderr, "[ERROR] [SCENE] [BINARY] Failed to load scene: %s!\n", filename);
+  if (loaded_world.hittables) { world_destroy(&loaded_world); }
+
+cleanup:
+  // the materials hold their own references, these were only kept to share the decode
+  if (images) {
+    for (u32 i = 0; i < header->textures_count; i++) {
+      if (images[i]) { texture_image_destroy(images[i]); }
+    }
+    free(images);
+  }
+
+  if (data != MAP_FAILED) { munmap(data, file_size); }
+  trace_end(trace);
+  return loaded;
+}
+
+static bool scene_binary_add_texture(Texture* texture, SceneBinaryTexture* textures, u32* textures_count, SceneBinaryStrings* strings, SceneBinaryPaths* paths, u32* index) {
+  switch (texture->type) {
+    case TEXTURE_TYPE_SOLID_COLOR: {
+      Color color = ((TextureSolidColor*) texture)->color;
+      textures[*textures_count] = (SceneBinaryTexture) { .type = TEXTURE_TYPE_SOLID_COLOR, .color = { color.red, color.green, color.blue } };
+    } break;
+    case TEXTURE_TYPE_IMAGE: {
+      const char* path = ((TextureImage*) texture)->path_to_image;
+      u64 slot = scene_binary_path_hash(path) & paths->mask;
+      for (; paths->slots[slot] != 0; slot = (slot + 1) & paths->mask) {
+        u32 entry = paths->slots[slot] - 1;
+        if (strcmp(strings->data + textures[entry].path_offset, path) == 0) {
+          *index = entry;
+          return true;
+        }
+      }
+      paths->slots[slot] = *textures_count + 1;
+
+      u32 length = (u32) strlen(path) + 1;
+      if (strings->size + length > strings->capacity) {
+        u32 capacity = (strings->capacity == 0) ? 256 : strings->capacity;
+        while (strings->size + length > capacity) { capacity *= 2; }
+
+        char* temp = (char*) realloc(strings->data, capacity);
+        if (!temp) { return false; }
+
+        strings->data = temp;
+        strings->capacity = capacity;
+      }
+
+      memcpy(strings->data + strings->size, path, length);
+      textures[*textures_count] = (SceneBinaryTexture) { .type = TEXTURE_TYPE_IMAGE, .path_offset = strings->size };
+      strings->size += length;
+    } break;
+  }
+
+  *index = (*textures_count)++;
+  return true;
+}
+
+static u64 scene_binary_path_hash(const char* path) {
+  u64 hash = SCENE_BINARY_FNV_OFFSET;
+  for (const char* character = path; *character != '\0'; character++) {
+    hash = (hash ^ (u8) *character) * SCENE_BINARY_FNV_PRIME;
+  }
+
+  return hash;
+}
+
+static bool scene_binary_write(FILE* file, const void* data, usize size) {
+  static const u8 padding[SCENE_BINARY_ALIGNMENT] = {0};
+
+  if (size > 0 && fwrite(data, 1, size, file) != size) { return false; }
+
+  usize padding_size = SCENE_BINARY_ALIGN(size) - size;
+  return (padding_size == 0 || fwrite(padding, 1, padding_size, file) == padding_size);
+}
+
+static bool scene_binary_table_fits(u64 offset, u64 count, u64 element_size, u64 file_size) {
+  if (offset % SCENE_BINARY_ALIGNMENT != 0 || offset > file_size) { return false; }
+  return (count <= (file_size - offset) / element_size);
+}
+
+static Texture* scene_binary_texture_create(const SceneBinaryHeader* header, const SceneBinaryTexture* texture, const char* strings, TextureImage** images, u32 index) {
+  switch ((TextureType) texture->type) {
+    case TEXTURE_TYPE_SOLID_COLOR: return (Texture*) texture_solid_color_create((Color) { texture->color[0], texture->color[1], texture->color[2] });
+    case TEXTURE_TYPE_IMAGE: {
+      if (!images[index]) {
+        if (texture->path_offset >= header->strings_size) { return NULL; }
+
+        // the path has to end inside the string table
+        const char* path = strings + texture->path_offset;
+        if (!memchr(path, '\0', header->strings_size - texture->path_offset)) { return NULL; }
+
+        images[index] = texture_image_create(path);
+        if (!images[index]) { return NULL; }
+      }
+
+      return images[index]->texture.clone((Texture*) images[index]);
+    }
+  }
+
+  return NULL;
+}
+
+static Material* scene_binary_material_create(const SceneBinaryMaterial* material, Texture* albedo) {
+  switch ((MaterialType) material->type) {
+    case MATERIAL_TYPE_DIFFUSE: return (Material*) material_diffuse_create(albedo);
+    case MATERIAL_TYPE_METAL: return (Material*) material_metal_create(albedo, material->roughness);
+    case MATERIAL_TYPE_GLASS: return (Material*) material_glass_create(albedo, material->refraction_index, material->roughness);
+    case MATERIAL_TYPE_EMISSIVE: return (Material*) material_emissive_create(albedo, material->emission_strength);
+  }
+
+  return NULL;
+}
@@ -0,0 +1,268 @@
+#include "scene_generator.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "camera.h"
+#include "hittables/hittable.h"
+#include "hittables/plane.h"
+#include "hittables/sphere.h"
+#include "materials/material.h"
+#include "materials/diffuse.h"
+#include "materials/metal.h"
+#include "materials/glass.h"
+#include "materials/emissive.h"
+#include "math/vector2.h"
+#include "math/vector3.h"
+#include "random.h"
+#include "textures/texture.h"
+#include "textures/image.h"
+#include "textures/solid_color.h"
+#include "types/base_types.h"
+#include "types/color.h"
+#include "world.h"
+
+#define SCENE_GENERATOR_SPHERE_RADIUS 1.0f
+#define SCENE_GENERATOR_SPHERE_SPACING 2.5f
+
+static Material* scene_generator_material(u64* state);
+static Material* scene_generator_mixed_material(u64* state, SceneGeneratorOptions* options, TextureImage* texture);
+static void scene_generator_reset(World* world);
+
+// lays the spheres out on a square grid facing the camera, staggered in depth, in front of a back wall
+bool scene_generator_spheres(World* world, Camera* camera, u32 sphere_count, u32 seed) {
+  scene_generator_reset(world);
+
+  u32 side = (u32) ceilf(sqrtf((f32) sphere_count));
+  f32 extent = side * SCENE_GENERATOR_SPHERE_SPACING;
+
+  for (u32 i = 0; i < sphere_count; i++) {
+    u64 state = random_state_create(i, 0, 0, seed);
+
+    Vector3 position = {
+      ((i % side) + 0.5f) * SCENE_GENERATOR_SPHERE_SPACING - (extent / 2.0f),
+      ((i / side) + 0.5f) * SCENE_GENERATOR_SPHERE_SPACING - (extent / 2.0f),
+      random_f32_range(&state, -SCENE_GENERATOR_SPHERE_RADIUS, SCENE_GENERATOR_SPHERE_RADIUS)
+    };
+
+    Material* material = scene_generator_material(&state);
+    if (!material) { goto error; }
+
+    HittableSphere* sphere = hittable_sphere_create(position, SCENE_GENERATOR_SPHERE_RADIUS, material);
+    if (!sphere) {
+      material->destroy(material);
+      goto error;
+    }
+
+    world_add(world, (Hittable*) sphere);
+  }
+
+  Texture* wall_albedo = (Texture*) texture_solid_color_create((Color) { 0.75f, 0.75f, 0.75f });
+  if (!wall_albedo) { goto error; }
+
+  Material* wall_material = (Material*) material_diffuse_create(wall_albedo);
+  if (!wall_material) {
+    wall_albedo->destroy(wall_albedo);
+    goto error;
+  }
+
+  Vector3 wall_position = { 0.0f, 0.0f, -2.0f * SCENE_GENERATOR_SPHERE_SPACING };
+  HittablePlane* wall = hittable_plane_create(wall_position, (Vector3) { 0.0f, 0.0f, 1.0f }, (Vector2) { 4.0f * extent, 4.0f * extent }, wall_material);
+  if (!wall) {
+    wall_material->destroy(wall_material);
+    goto error;
+  }
+
+  world_add(world, (Hittable*) wall);
+
+  // the viewport is one unit tall at the focal length, so this distance fits the whole grid vertically
+  camera->position = (Vector3) { 0.0f, 0.0f, (extent * camera->focal_length) + SCENE_GENERATOR_SPHERE_SPACING };
+  camera->seed = seed;
+
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [SCENE GENERATOR] Failed to generate scene with %u spheres!\n", sphere_count);
+  return false;
+}
+
+static Material* scene_generator_material(u64* state) {
+  Color color = { random_f32_range(state, 0.2f, 0.9f), random_f32_range(state, 0.2f, 0.9f), random_f32_range(state, 0.2f, 0.9f) };
+  Texture* albedo = (Texture*) texture_solid_color_create(color);
+  if (!albedo) { return NULL; }
+
+  Material* material = NULL;
+  switch ((MaterialType) (pcg32(state) % 4)) {
+    case MATERIAL_TYPE_DIFFUSE: material = (Material*) material_diffuse_create(albedo); break;
+    case MATERIAL_TYPE_METAL: material = (Material*) material_metal_create(albedo, random_f32(state) * 0.5f); break;
+    case MATERIAL_TYPE_GLASS: material = (Material*) material_glass_create(albedo, 1.5f, random_f32(state) * 0.1f); break;
+    case MATERIAL_TYPE_EMISSIVE: material = (Material*) material_emissive_create(albedo, 2.0f); break;
+  }
+
+  if (!material) {
+    albedo->destroy(albedo);
+    return NULL;
+  }
+
+  return material;
+}
+
+SceneGeneratorOptions scene_generator_options_default() {
+  return (SceneGeneratorOptions) {
+    .sphere_count = 100,
+    .plane_count = 0,
+    .distribution = SCENE_GENERATOR_DISTRIBUTION_UNIFORM,
+    .material_weights = { 1.0f, 1.0f, 1.0f },
+    .emissive_fraction = 0.05f,
+    .texture_path = NULL,
+    .texture_fraction = 0.0f,
+    .seed = 0
+  };
+}
+
+// objects fill a cube sized to keep the density constant as the count grows, the camera looks at it down -z
+bool scene_generator_generate(World* world, Camera* camera, SceneGeneratorOptions* options) {
+  scene_generator_reset(world);
+
+  TextureImage* texture = NULL;
+  if (options->texture_path && options->texture_fraction > 0.0f) {
+    texture = texture_image_create(options->texture_path);
+    if (!texture) { goto error; }
+  }
+
+  u32 nested_group_count = (options->sphere_count + SCENE_GENERATOR_NESTING_DEPTH - 1) / SCENE_GENERATOR_NESTING_DEPTH;
+  u32 placed_count = (options->distribution == SCENE_GENERATOR_DISTRIBUTION_NESTED_GLASS) ? nested_group_count : options->sphere_count;
+  if (placed_count == 0) { placed_count = 1; }
+  f32 half_extent = (SCENE_GENERATOR_SPHERE_SPACING * cbrtf((f32) placed_count)) / 2.0f;
+
+  u32 cluster_count = options->sphere_count / SCENE_GENERATOR_CLUSTER_SIZE;
+  if (cluster_count == 0) { cluster_count = 1; }
+  f32 cluster_radius = (SCENE_GENERATOR_SPHERE_SPACING * cbrtf((f32) SCENE_GENERATOR_CLUSTER_SIZE)) / 4.0f;
+
+  for (u32 i = 0; i < options->sphere_count; i++) {
+    u64 state = random_state_create(i, 0, 0, options->seed);
+
+    Vector3 position;
+    f32 radius;
+    bool glass_shell = false;
+    switch (options->distribution) {
+      case SCENE_GENERATOR_DISTRIBUTION_UNIFORM: {
+        position = random_vector3(&state, -half_extent, half_extent);
+        radius = random_f32_range(&state, 0.25f, 1.0f) * SCENE_GENERATOR_SPHERE_RADIUS;
+      } break;
+      case SCENE_GENERATOR_DISTRIBUTION_CLUSTERED: {
+        u64 cluster_state = random_state_create(i % cluster_count, 0, 1, options->seed);
+        Vector3 center = random_vector3(&cluster_state, -half_extent, half_extent);
+        Vector3 offset = vector3_scale(random_vector3_unit_vector(&state), random_f32(&state) * cluster_radius);
+        position = vector3_add(center, offset);
+        radius = random_f32_range(&state, 0.1f, 0.5f) * SCENE_GENERATOR_SPHERE_RADIUS;
+      } break;
+      case SCENE_GENERATOR_DISTRIBUTION_NESTED_GLASS: {
+        // every group is SCENE_GENERATOR_NESTING_DEPTH concentric spheres, all but the innermost clear glass
+        u32 level = i % SCENE_GENERATOR_NESTING_DEPTH;
+        u64 group_state = random_state_create(i / SCENE_GENERATOR_NESTING_DEPTH, 0, 1, options->seed);
+        position = random_vector3(&group_state, -half_extent, half_extent);
+        radius = SCENE_GENERATOR_SPHERE_RADIUS * (f32) (SCENE_GENERATOR_NESTING_DEPTH - level) / SCENE_GENERATOR_NESTING_DEPTH;
+        glass_shell = (level < SCENE_GENERATOR_NESTING_DEPTH - 1);
+      } break;
+      default: {
+        fprintf(stderr, "[ERROR] [SCENE GENERATOR] Unknown sphere distribution: %d!\n", options->distribution);
+        goto error;
+      }
+    }
+
+    Material* material;
+    if (glass_shell) {
+      Texture* albedo = (Texture*) texture_solid_color_create((Color) { 0.95f, 0.95f, 0.95f });
+      if (!albedo) { goto error; }
+      material = (Material*) material_glass_create(albedo, 1.5f, 0.0f);
+      if (!material) { albedo->destroy(albedo); }
+    } else {
+      material = scene_generator_mixed_material(&state, options, texture);
+    }
+    if (!material) { goto error; }
+
+    HittableSphere* sphere = hittable_sphere_create(position, radius, material);
+    if (!sphere) {
+      material->destroy(material);
+      goto error;
+    }
+
+    world_add(world, (Hittable*) sphere);
+  }
+
+  for (u32 i = 0; i < options->plane_count; i++) {
+    u64 state = random_state_create(i, 0, 2, options->seed);
+
+    Vector3 position = random_vector3(&state, -half_extent, half_extent);
+    Vector3 normal = random_vector3_unit_vector(&state);
+    Vector2 size = { random_f32_range(&state, 1.0f, half_extent), random_f32_range(&state, 1.0f, half_extent) };
+
+    Material* material = scene_generator_mixed_material(&state, options, texture);
+    if (!material) { goto error; }
+
+    HittablePlane* plane = hittable_plane_create(position, normal, size, material);
+    if (!plane) {
+      material->destroy(material);
+      goto error;
+    }
+
+    world_add(world, (Hittable*) plane);
+  }
+
+  // every object holds its own reference to the shared texture
+  if (texture) { texture_image_destroy(texture); }
+
+  // the viewport is one unit tall at the focal length, so this distance fits the whole cube vertically
+  camera->position = (Vector3) { 0.0f, 0.0f, half_extent + (2.0f * half_extent * camera->focal_length) + SCENE_GENERATOR_SPHERE_SPACING };
+  camera->seed = options->seed;
+
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [SCENE GENERATOR] Failed to generate scene with %u spheres and %u planes!\n", options->sphere_count, options->plane_count);
+  if (texture) { texture_image_destroy(texture); }
+  return false;
+}
+
+static Material* scene_generator_mixed_material(u64* state, SceneGeneratorOptions* options, TextureImage* texture) {
+  Texture* albedo;
+  if (texture && random_f32(state) < options->texture_fraction) {
+    albedo = texture->texture.clone((Texture*) texture);
+  } else {
+    Color color = { random_f32_range(state, 0.2f, 0.9f), random_f32_range(state, 0.2f, 0.9f), random_f32_range(state, 0.2f, 0.9f) };
+    albedo = (Texture*) texture_solid_color_create(color);
+  }
+  if (!albedo) { return NULL; }
+
+  Material* material = NULL;
+  if (random_f32(state) < options->emissive_fraction) {
+    material = (Material*) material_emissive_create(albedo, random_f32_range(state, 2.0f, 8.0f));
+  } else {
+    f32 total_weight = options->material_weights[0] + options->material_weights[1] + options->material_weights[2];
+    f32 pick = random_f32(state) * total_weight;
+
+    if (pick < options->material_weights[0] || total_weight <= 0.0f) {
+      material = (Material*) material_diffuse_create(albedo);
+    } else if (pick < options->material_weights[0] + options->material_weights[1]) {
+      material = (Material*) material_metal_create(albedo, random_f32(state) * 0.5f);
+    } else {
+      material = (Material*) material_glass_create(albedo, 1.5f, random_f32(state) * 0.1f);
+    }
+  }
+
+  if (!material) {
+    albedo->destroy(albedo);
+    return NULL;
+  }
+
+  return material;
+}
+
+static void scene_generator_reset(World* world) {
+  if (world->hittables_count > 0) {
+    world_destroy(world);
+    *world = world_create();
+  }
+}
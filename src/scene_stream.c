@@ -0,0 +1,407 @@
+#include "scene_stream.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <cJSON.h>
+
+#include "camera.h"
+#include "scene_binary.h"
+#include "trace.h"
+#include "world.h"
+#include "textures/image.h"
+#include "types/base_types.h"
+#include "utils/file.h"
+#include "utils/timer.h"
+
+// hittables the loader parsed since its last hand over, only touched by the loader thread
+typedef struct SceneStreamBatch {
+  Hittable** hittables;
+  u32 count, capacity;
+  u32 target;
+} SceneStreamBatch;
+
+static void* scene_stream_load(void* stream_pointer);
+static bool scene_stream_load_json(SceneStream* stream, SceneStreamBatch* batch);
+static bool scene_stream_load_json_hittables(SceneStream* stream, SceneStreamBatch* batch, const char* text, const char* end, const char** cursor);
+static bool scene_stream_load_binary(SceneStream* stream, SceneStreamBatch* batch);
+static bool scene_stream_add(SceneStream* stream, SceneStreamBatch* batch, Hittable* hittable, usize bytes_parsed);
+static bool scene_stream_flush(SceneStream* stream, SceneStreamBatch* batch, usize bytes_parsed);
+static void scene_stream_set_camera(SceneStream* stream, Vector3 position, u32 seed);
+static void scene_stream_apply_camera(SceneStream* stream, Camera* camera);
+static const char* scene_stream_skip_whitespace(const char* cursor, const char* end);
+
+SceneStreamOptions scene_stream_options_default() {
+  return (SceneStreamOptions) {
+    .print_progress = false,
+    .first_chunk = SCENE_STREAM_FIRST_CHUNK,
+    .throttle = false
+  };
+}
+
+SceneStream* scene_stream_start(const char* path, SceneStreamOptions* options) {
+  SceneStream* stream = (SceneStream*) calloc(1, sizeof(SceneStream));
+  if (!stream) {
+    fprintf(stderr, "[ERROR] [SCENE] [STREAM] Failed to allocate memory for scene stream!\n");
+    return NULL;
+  }
+
+  stream->path = strdup(path);
+  if (!stream->path) {
+    free(stream);
+    return NULL;
+  }
+
+  stream->options = *options;
+  stream->start_time = timer_get_seconds();
+  stream->texture_decode_generation = texture_image_decode_generation();
+  atomic_init(&stream->cancelled, false);
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->chunk_cond, NULL);
+
+  if (pthread_create(&stream->loader, NULL, scene_stream_load, stream) != 0) {
+    fprintf(stderr, "[ERROR] [SCENE] [STREAM] Failed to create loader thread!\n");
+    pthread_mutex_destroy(&stream->lock);
+    pthread_cond_destroy(&stream->chunk_cond);
+    free((void*) stream->path);
+    free(stream);
+    return NULL;
+  }
+
+  return stream;
+}
+
+bool scene_stream_poll(SceneStream* stream, World* world, Camera* camera) {
+  pthread_mutex_lock(&stream->lock);
+
+  u32 added_count = stream->pending_count;
+  for (u32 i = 0; i < added_count; i++) {
+    world_add(world, stream->pending[i]);
+  }
+  stream->pending_count = 0;
+
+  if (added_count > 0) {
+    // a throttled loader waits for this
+    pthread_cond_broadcast(&stream->chunk_cond);
+    if (stream->progress.chunks_added == 0) { stream->progress.first_chunk_time = timer_get_seconds() - stream->start_time; }
+    stream->progress.hittables_added += added_count;
+    stream->progress.chunks_added++;
+  }
+
+  bool camera_changed = stream->camera_ready && !stream->camera_applied;
+  if (camera_changed) { scene_stream_apply_camera(stream, camera); }
+
+  stream->events_seen = stream->events;
+  SceneStreamProgress progress = stream->progress;
+  pthread_mutex_unlock(&stream->lock);
+
+  // read after the loader's state, once it is done every decode it started is counted
+  bool textures_changed = false;
+  u32 texture_decode_generation = texture_image_decode_generation();
+  if (texture_decode_generation != stream->texture_decode_generation) {
+    stream->texture_decode_generation = texture_decode_generation;
+    textures_changed = true;
+  }
+
+  if (added_count > 0 && stream->options.print_progress) {
+    f64 percent = (progress.bytes_total > 0) ? (100.0 * progress.bytes_parsed / progress.bytes_total) : 100.0;
+    printf("[INFO] [SCENE] [STREAM] %u hittables added after %.3fs (%.1f%% of %s)\n", progress.hittables_added, timer_get_seconds() - stream->start_time, percent, stream->path);
+  }
+
+  return added_count > 0 || camera_changed || textures_changed;
+}
+
+bool scene_stream_is_loading(SceneStream* stream) {
+  pthread_mutex_lock(&stream->lock);
+  bool loading = !stream->progress.done && !stream->progress.failed;
+  pthread_mutex_unlock(&stream->lock);
+  return loading;
+}
+
+void scene_stream_wait(SceneStream* stream) {
+  pthread_mutex_lock(&stream->lock);
+  while (stream->events == stream->events_seen && !stream->progress.done && !stream->progress.failed) {
+    pthread_cond_wait(&stream->chunk_cond, &stream->lock);
+  }
+  pthread_mutex_unlock(&stream->lock);
+}
+
+void scene_stream_wait_camera(SceneStream* stream, Camera* camera) {
+  pthread_mutex_lock(&stream->lock);
+  while (!stream->camera_ready && !stream->progress.done && !stream->progress.failed) {
+    pthread_cond_wait(&stream->chunk_cond, &stream->lock);
+  }
+  if (stream->camera_ready && !stream->camera_applied) { scene_stream_apply_camera(stream, camera); }
+  pthread_mutex_unlock(&stream->lock);
+}
+
+SceneStreamProgress scene_stream_get_progress(SceneStream* stream) {
+  pthread_mutex_lock(&stream->lock);
+  SceneStreamProgress progress = stream->progress;
+  pthread_mutex_unlock(&stream->lock);
+  return progress;
+}
+
+void scene_stream_destroy(SceneStream* stream) {
+  pthread_mutex_lock(&stream->lock);
+  atomic_store(&stream->cancelled, true);
+  pthread_cond_broadcast(&stream->chunk_cond);
+  pthread_mutex_unlock(&stream->lock);
+  pthread_join(stream->loader, NULL);
+
+  for (u32 i = 0; i < stream->pending_count; i++) {
+    stream->pending[i]->destroy(stream->pending[i]);
+  }
+  free(stream->pending);
+
+  pthread_mutex_destroy(&stream->lock);
+  pthread_cond_destroy(&stream->chunk_cond);
+  free((void*) stream->path);
+  free(stream);
+}
+
+// image textures are collected per chunk and decoded before the loader moves on, so the render shows the
+// placeholder color for them only until their chunk is decoded
+static void* scene_stream_load(void* stream_pointer) {
+  SceneStream* stream = (SceneStream*) stream_pointer;
+  trace_set_thread_name("Scene Stream");
+  TraceScope trace = trace_begin("Scene Stream");
+
+  SceneStreamBatch batch = { .target = (stream->options.first_chunk > 0) ? stream->options.first_chunk : 1 };
+  texture_image_decode_defer();
+  bool loaded = scene_binary_is_binary_path(stream->path) ? scene_stream_load_binary(stream, &batch) : scene_stream_load_json(stream, &batch);
+  texture_image_decode_submit();
+
+  // whatever was not handed over when loading stopped early is never going to be
+  for (u32 i = 0; i < batch.count; i++) {
+    batch.hittables[i]->destroy(batch.hittables[i]);
+  }
+  free(batch.hittables);
+
+  bool cancelled = atomic_load(&stream->cancelled);
+  if (!loaded && !cancelled) { fprintf(stderr, "[ERROR] [SCENE] [STREAM] Failed to load scene: %s!\n", stream->path); }
+
+  pthread_mutex_lock(&stream->lock);
+  stream->progress.done = loaded;
+  stream->progress.failed = !loaded;
+  stream->progress.load_time = timer_get_seconds() - stream->start_time;
+  stream->events++;
+  pthread_cond_broadcast(&stream->chunk_cond);
+  pthread_mutex_unlock(&stream->lock);
+
+  trace_end(trace);
+  return NULL;
+}
+
+// walks the top level object by hand and parses each of its values, and each hittable, on its own with cJSON,
+// so the first hittables are handed over long before the end of the file was even looked at
+static bool scene_stream_load_json(SceneStream* stream, SceneStreamBatch* batch) {
+  const char* text = file_to_string(stream->path);
+  if (!text) { return false; }
+
+  usize length = strlen(text);
+  pthread_mutex_lock(&stream->lock);
+  stream->progress.bytes_total = length;
+  pthread_mutex_unlock(&stream->lock);
+
+  bool loaded = false;
+  bool camera_found = false, hittables_found = false;
+  cJSON* item = NULL;
+  const char* end = text + length;
+  const char* cursor = scene_stream_skip_whitespace(text, end);
+  if (cursor == end || *cursor != '{') { goto cleanup; }
+  cursor = scene_stream_skip_whitespace(cursor + 1, end);
+
+  while (cursor != end && *cursor != '}') {
+    item = cJSON_ParseWithLengthOpts(cursor, end - cursor, &cursor, false);
+    if (!cJSON_IsString(item)) { goto cleanup; }
+
+    bool camera = (strcmp(cJSON_GetStringValue(item), "camera") == 0);
+    bool hittables = (strcmp(cJSON_GetStringValue(item), "hittables") == 0);
+    cJSON_Delete(item);
+    item = NULL;
+
+    cursor = scene_stream_skip_whitespace(cursor, end);
+    if (cursor == end || *cursor != ':') { goto cleanup; }
+    cursor = scene_stream_skip_whitespace(cursor + 1, end);
+
+    if (hittables) {
+      if (!scene_stream_load_json_hittables(stream, batch, text, end, &cursor)) { goto cleanup; }
+      hittables_found = true;
+    } else {
+      item = cJSON_ParseWithLengthOpts(cursor, end - cursor, &cursor, false);
+      if (!item) { goto cleanup; }
+
+      if (camera) {
+        Vector3 position;
+        u32 seed;
+        if (!world_camera_json_parse(item, &position, &seed)) { goto cleanup; }
+
+        scene_stream_set_camera(stream, position, seed);
+        camera_found = true;
+      }
+
+      cJSON_Delete(item);
+      item = NULL;
+    }
+
+    cursor = scene_stream_skip_whitespace(cursor, end);
+    if (cursor != end && *cursor == ',') { cursor = scene_stream_skip_whitespace(cursor + 1, end); }
+  }
+
+  loaded = (cursor != end && camera_found && hittables_found && scene_stream_flush(stream, batch, length));
+
+cleanup:
+  cJSON_Delete(item);
+  free((void*) text);
+  return loaded;
+}
+
+static bool scene_stream_load_json_hittables(SceneStream* stream, SceneStreamBatch* batch, const char* text, const char* end, const char** cursor) {
+  if (*cursor == end || **cursor != '[') { return false; }
+  *cursor = scene_stream_skip_whitespace(*cursor + 1, end);
+
+  while (*cursor != end && **cursor != ']') {
+    if (atomic_load_explicit(&stream->cancelled, memory_order_relaxed)) { return false; }
+
+    cJSON* hittable_json = cJSON_ParseWithLengthOpts(*cursor, end - *cursor, cursor, false);
+    if (!hittable_json) { return false; }
+
+    Hittable* hittable = world_hittable_json_parse(hittable_json);
+    cJSON_Delete(hittable_json);
+    if (!hittable || !scene_stream_add(stream, batch, hittable, *cursor - text)) { return false; }
+
+    *cursor = scene_stream_skip_whitespace(*cursor, end);
+    if (*cursor != end && **cursor == ',') { *cursor = scene_stream_skip_whitespace(*cursor + 1, end); }
+  }
+
+  if (*cursor == end) { return false; }
+  (*cursor)++;
+  return true;
+}
+
+// binary scenes need no parsing, so they are read whole and handed over as one chunk
+static bool scene_stream_load_binary(SceneStream* stream, SceneStreamBatch* batch) {
+  World world = world_create();
+  Camera* camera = (Camera*) calloc(1, sizeof(Camera));
+  bool loaded = camera && world.hittables && scene_binary_load(&world, camera, stream->path);
+
+  if (loaded) {
+    scene_stream_set_camera(stream, camera->position, camera->seed);
+
+    u32 i = 0;
+    for (; i < world.hittables_count && loaded; i++) {
+      loaded = scene_stream_add(stream, batch, world.hittables[i], 0);
+    }
+
+    // the ones added are owned by the batch now
+    for (; i < world.hittables_count; i++) {
+      world.hittables[i]->destroy(world.hittables[i]);
+    }
+    world.hittables_count = 0;
+  }
+
+  struct stat file_stat;
+  usize file_size = (stat(stream->path, &file_stat) == 0) ? (usize) file_stat.st_size : 0;
+  pthread_mutex_lock(&stream->lock);
+  stream->progress.bytes_total = file_size;
+  pthread_mutex_unlock(&stream->lock);
+
+  loaded = loaded && scene_stream_flush(stream, batch, file_size);
+
+  free(camera);
+  world_destroy(&world);
+  return loaded;
+}
+
+static bool scene_stream_add(SceneStream* stream, SceneStreamBatch* batch, Hittable* hittable, usize bytes_parsed) {
+  if (batch->count == batch->capacity) {
+    u32 capacity = (batch->capacity == 0) ? SCENE_STREAM_FIRST_CHUNK : (batch->capacity * 2);
+    Hittable** temp = (Hittable**) realloc(batch->hittables, sizeof(Hittable*) * capacity);
+    if (!temp) {
+      fprintf(stderr, "[ERROR] [SCENE] [STREAM] Failed to grow hittable chunk!\n");
+      hittable->destroy(hittable);
+      return false;
+    }
+
+    batch->hittables = temp;
+    batch->capacity = capacity;
+  }
+
+  batch->hittables[batch->count++] = hittable;
+  if (batch->count < batch->target) { return true; }
+
+  batch->target *= 2;
+  return scene_stream_flush(stream, batch, bytes_parsed);
+}
+
+// hands the batch over, then decodes the image textures it introduced while the render already uses it
+static bool scene_stream_flush(SceneStream* stream, SceneStreamBatch* batch, usize bytes_parsed) {
+  pthread_mutex_lock(&stream->lock);
+
+  if (stream->pending_count + batch->count > stream->pending_capacity) {
+    u32 capacity = (stream->pending_capacity == 0) ? SCENE_STREAM_FIRST_CHUNK : stream->pending_capacity;
+    while (stream->pending_count + batch->count > capacity) { capacity *= 2; }
+
+    Hittable** temp = (Hittable**) realloc(stream->pending, sizeof(Hittable*) * capacity);
+    if (!temp) {
+      fprintf(stderr, "[ERROR] [SCENE] [STREAM] Failed to grow pending hittables!\n");
+      pthread_mutex_unlock(&stream->lock);
+      return false;
+    }
+
+    stream->pending = temp;
+    stream->pending_capacity = capacity;
+  }
+
+  memcpy(&stream->pending[stream->pending_count], batch->hittables, sizeof(Hittable*) * batch->count);
+  stream->pending_count += batch->count;
+  stream->progress.hittables_parsed += batch->count;
+  stream->progress.bytes_parsed = bytes_parsed;
+  batch->count = 0;
+
+  stream->events++;
+  pthread_cond_broadcast(&stream->chunk_cond);
+  pthread_mutex_unlock(&stream->lock);
+
+  texture_image_decode_submit();
+  texture_image_decode_defer();
+
+  // wakes a waiting render for the decodes that just finished, polling sees them through the decode generation
+  pthread_mutex_lock(&stream->lock);
+  stream->events++;
+  pthread_cond_broadcast(&stream->chunk_cond);
+  while (stream->options.throttle && stream->pending_count > 0 && !atomic_load(&stream->cancelled)) {
+    pthread_cond_wait(&stream->chunk_cond, &stream->lock);
+  }
+  pthread_mutex_unlock(&stream->lock);
+
+  return true;
+}
+
+static void scene_stream_set_camera(SceneStream* stream, Vector3 position, u32 seed) {
+  pthread_mutex_lock(&stream->lock);
+  stream->camera_position = position;
+  stream->camera_seed = seed;
+  stream->camera_ready = true;
+  stream->events++;
+  pthread_cond_broadcast(&stream->chunk_cond);
+  pthread_mutex_unlock(&stream->lock);
+}
+
+// called with the lock held
+static void scene_stream_apply_camera(SceneStream* stream, Camera* camera) {
+  camera->position = stream->camera_position;
+  camera->seed = stream->camera_seed;
+  stream->camera_applied = true;
+}
+
+static inline const char* scene_stream_skip_whitespace(const char* cursor, const char* end) {
+  while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) { cursor++; }
+  return cursor;
+}
@@ -0,0 +1,228 @@
+#include "snapshot_writer.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "camera.h"
+#include "image.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "types/base_types.h"
+#include "types/color.h"
+#include "utils/timer.h"
+
+#define SNAPSHOT_PATH_LENGTH 1024
+#define SNAPSHOT_TEMPORARY_SUFFIX ".tmp"
+
+static void* snapshot_writer_work(void* writer_pointer);
+static bool snapshot_writer_write(SnapshotWriter* writer);
+
+SnapshotOptions snapshot_options_default() {
+  return (SnapshotOptions) {
+    .outputs_count = 0,
+    .sample_interval = 0,
+    .time_interval = DEFAULT_SNAPSHOT_INTERVAL,
+    .image_options = image_options_default()
+  };
+}
+
+SnapshotWriter* snapshot_writer_create(Camera* camera, SnapshotOptions* options) {
+  SnapshotWriter* writer = (SnapshotWriter*) calloc(1, sizeof(SnapshotWriter));
+  if (!writer) {
+    fprintf(stderr, "[ERROR] [SNAPSHOT] Failed to allocate memory for snapshot writer!\n");
+    return NULL;
+  }
+
+  writer->options = *options;
+  pthread_mutex_init(&writer->lock, NULL);
+  pthread_cond_init(&writer->work_cond, NULL);
+  pthread_cond_init(&writer->done_cond, NULL);
+
+  usize framebuffer_length = camera->width * camera->height;
+  writer->framebuffer = (Color*) malloc(sizeof(Color) * framebuffer_length);
+  writer->framebuffer_even = (Color*) malloc(sizeof(Color) * framebuffer_length);
+  if (!writer->framebuffer || !writer->framebuffer_even) {
+    fprintf(stderr, "[ERROR] [SNAPSHOT] Failed to allocate memory for snapshot framebuffers!\n");
+    goto error;
+  }
+
+  // one pool thread encodes bands next to the writer thread, which helps out while it waits on them
+  writer->thread_pool = thread_pool_create(1);
+  if (!writer->thread_pool) { goto error; }
+
+  writer->alive = true;
+  if (pthread_create(&writer->writer, NULL, snapshot_writer_work, writer) != 0) {
+    fprintf(stderr, "[ERROR] [SNAPSHOT] Failed to create writer thread!\n");
+    writer->alive = false;
+    goto error;
+  }
+
+  writer->last_sample_count = camera->sample_count;
+  writer->last_time = timer_get_seconds();
+  writer->due_time = writer->last_time;
+  return writer;
+
+error:
+  if (writer->thread_pool) { thread_pool_destroy(writer->thread_pool); }
+  free(writer->framebuffer);
+  free(writer->framebuffer_even);
+  pthread_mutex_destroy(&writer->lock);
+  pthread_cond_destroy(&writer->work_cond);
+  pthread_cond_destroy(&writer->done_cond);
+  free(writer);
+  return NULL;
+}
+
+u32 snapshot_writer_clamp_chunk(SnapshotWriter* writer, u32 sample_count, u32 chunk) {
+  u32 interval = writer->options.sample_interval;
+  if (interval == 0) { return chunk; }
+
+  u32 remaining = interval - (sample_count % interval);
+  return (chunk > remaining) ? remaining : chunk;
+}
+
+bool snapshot_writer_begin(SnapshotWriter* writer, u32 end_sample_count, Color** framebuffer, Color** framebuffer_even) {
+  u32 sample_interval = writer->options.sample_interval;
+  f64 time_interval = writer->options.time_interval;
+
+  f64 time = timer_get_seconds();
+  bool samples_due = (sample_interval > 0 && (end_sample_count % sample_interval) == 0);
+  bool time_due = (time_interval > 0.0 && time - writer->due_time >= time_interval);
+  if (!samples_due && !time_due) { return false; }
+
+  pthread_mutex_lock(&writer->lock);
+  bool busy = writer->pending;
+  pthread_mutex_unlock(&writer->lock);
+
+  // a slow disk skips a snapshot instead of holding up the render, the interval then starts over so the chunks
+  // rendered until the writer is done do not count as more skipped snapshots
+  if (busy) {
+    writer->skipped_count++;
+    writer->due_time = time;
+    return false;
+  }
+
+  *framebuffer = writer->framebuffer;
+  *framebuffer_even = writer->framebuffer_even;
+  return true;
+}
+
+void snapshot_writer_commit(SnapshotWriter* writer, Camera* camera) {
+  f64 time = timer_get_seconds();
+  if (writer->committed_count++ == 0) {
+    writer->first_sample_count = camera->sample_count;
+    writer->first_time = time;
+  }
+
+  pthread_mutex_lock(&writer->lock);
+  writer->camera = *camera;
+  writer->camera.framebuffer = writer->framebuffer;
+  writer->camera.framebuffer_even = writer->framebuffer_even;
+  writer->camera.thread_pool = writer->thread_pool;
+  writer->camera.thread_count = 1;
+  writer->camera.checkpoint = NULL;
+  writer->camera.snapshot_writer = NULL;
+  writer->camera.scene_stream = NULL;
+  writer->pending = true;
+  pthread_cond_signal(&writer->work_cond);
+  pthread_mutex_unlock(&writer->lock);
+
+  writer->last_sample_count = camera->sample_count;
+  writer->last_time = time;
+  writer->due_time = time;
+}
+
+void snapshot_writer_print_stats(SnapshotWriter* writer) {
+  pthread_mutex_lock(&writer->lock);
+  while (writer->pending) {
+    pthread_cond_wait(&writer->done_cond, &writer->lock);
+  }
+  pthread_mutex_unlock(&writer->lock);
+
+  printf("[INFO] [SNAPSHOT] Wrote %u snapshots, skipped %u while the previous one was still being written\n", writer->written_count, writer->skipped_count);
+  if (writer->committed_count > 1) {
+    u32 intervals = writer->committed_count - 1;
+    f64 sample_cadence = (f64) (writer->last_sample_count - writer->first_sample_count) / intervals;
+    f64 time_cadence = (writer->last_time - writer->first_time) / intervals;
+    printf("[INFO] [SNAPSHOT] One snapshot every %.1f samples and %.3fs on average\n", sample_cadence, time_cadence);
+  }
+  if (writer->written_count > 0) {
+    printf("[INFO] [SNAPSHOT] Encoding took %.3fs on the writer thread (%.3fs per snapshot)\n", writer->encode_time, writer->encode_time / writer->written_count);
+  }
+}
+
+void snapshot_writer_destroy(SnapshotWriter* writer) {
+  pthread_mutex_lock(&writer->lock);
+  writer->alive = false;
+  pthread_cond_signal(&writer->work_cond);
+  pthread_mutex_unlock(&writer->lock);
+  pthread_join(writer->writer, NULL);
+
+  thread_pool_destroy(writer->thread_pool);
+  free(writer->framebuffer);
+  free(writer->framebuffer_even);
+  pthread_mutex_destroy(&writer->lock);
+  pthread_cond_destroy(&writer->work_cond);
+  pthread_cond_destroy(&writer->done_cond);
+  free(writer);
+}
+
+static void* snapshot_writer_work(void* writer_pointer) {
+  SnapshotWriter* writer = (SnapshotWriter*) writer_pointer;
+  trace_set_thread_name("Snapshot Writer");
+
+  pthread_mutex_lock(&writer->lock);
+  while (true) {
+    while (writer->alive && !writer->pending) {
+      pthread_cond_wait(&writer->work_cond, &writer->lock);
+    }
+    if (!writer->pending) { break; }
+    pthread_mutex_unlock(&writer->lock);
+
+    TraceScope trace = trace_begin("Snapshot");
+    f64 start_time = timer_get_seconds();
+    bool written = snapshot_writer_write(writer);
+    f64 encode_time = timer_get_seconds() - start_time;
+    trace_end(trace);
+
+    pthread_mutex_lock(&writer->lock);
+    if (written) {
+      writer->written_count++;
+    } else {
+      writer->failed = true;
+    }
+    writer->encode_time += encode_time;
+    writer->pending = false;
+    pthread_cond_broadcast(&writer->done_cond);
+  }
+  pthread_mutex_unlock(&writer->lock);
+
+  return NULL;
+}
+
+// every output is written next to its path first and renamed over it, so a viewer never sees half a file
+static bool snapshot_writer_write(SnapshotWriter* writer) {
+  bool written = true;
+  for (u32 i = 0; i < writer->options.outputs_count; i++) {
+    SnapshotOutput* output = &writer->options.outputs[i];
+
+    char temporary_path[SNAPSHOT_PATH_LENGTH];
+    s32 length = snprintf(temporary_path, sizeof(temporary_path), "%s" SNAPSHOT_TEMPORARY_SUFFIX, output->path);
+    if (length < 0 || (usize) length >= sizeof(temporary_path)) {
+      fprintf(stderr, "[ERROR] [SNAPSHOT] Snapshot path is too long: %s!\n", output->path);
+      written = false;
+      continue;
+    }
+
+    if (!image_create(temporary_path, output->type, &writer->camera, &writer->options.image_options) || rename(temporary_path, output->path) != 0) {
+      fprintf(stderr, "[ERROR] [SNAPSHOT] Failed to write snapshot: %s!\n", output->path);
+      remove(temporary_path);
+      written = false;
+    }
+  }
+
+  return written;
+}
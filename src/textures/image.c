@@ -1,105 +1,655 @@
 #include "textures/image.h"
-#include "gui/texture.h"
-#include "gui/window.h"
 #include "math/vector2.h"
 #include "textures/texture.h"
-#include "tonemapping.h"
-#include "utils/file.h"
-
+#include "textures/virtual_texture.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "utils/half.h"
+#include "utils/timer.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <cJSON.h>
-#include <nfd.h>
 
-#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
-#include <cimgui.h>
-#include <cimgui_impl.h>
-
-static Color get_color(Texture* texture, Vector2 uv_coordinates);
+static Color get_color(Texture* texture, Vector2 uv_coordinates, f32 uv_footprint);
+static Texture* clone(Texture* texture);
 static void destroy(Texture* texture);
 
+#define TEXTURE_IMAGE_CACHE_STARTING_CAPACITY 16
+#define TEXTURE_IMAGE_CACHE_MULTIPLIER 0x9E3779B97F4A7C15ull
+#define TEXTURE_IMAGE_FNV_OFFSET 14695981039346656037ull
+#define TEXTURE_IMAGE_FNV_PRIME 1099511628211ull
+#define TEXTURE_IMAGE_HALF_ONE 0x3c00
+#define TEXTURE_IMAGE_PATH_LENGTH 1024
+
+// entries are removed when their image is destroyed, so a lookup never sees a freed image, a content size of 0
+// means the file has not been read yet and the entry is not in the content table
+typedef struct TextureImageCacheEntry {
+  const char* canonical_path;
+  u64 path_hash;
+  u64 content_hash;
+  usize content_size;
+  TextureImage* image;
+  bool retained;
+} TextureImageCacheEntry;
+
+// the same entries in two open addressed tables, one keyed by the canonical path and one by the contents, both
+// probed linearly and kept at most half full, so a lookup never walks the whole cache while holding the lock
+static struct {
+  pthread_mutex_t lock;
+  bool retain;
+
+  TextureImageCacheEntry** paths;
+  TextureImageCacheEntry** contents;
+  usize entries_count;
+  u64 table_mask; // both tables have the same power of two size, 0 while they do not exist
+
+  TextureImageCacheStats stats;
+} texture_image_cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// images created while this thread defers decoding, each list entry holds a reference
+static _Thread_local struct {
+  bool deferring;
+  TextureImage** images;
+  usize images_count, capacity;
+} texture_image_deferred;
+
+// srgb byte to linear float, filled the first time any image is built
+static f32 texture_image_srgb_table[256];
+static pthread_once_t texture_image_srgb_table_once = PTHREAD_ONCE_INIT;
+
+static atomic_uint texture_image_decodes_finished;
+static atomic_uint texture_image_decodes_waiting;
+
+static TextureImage* texture_image_allocate(const char* path);
+static bool texture_image_defer(TextureImage* texture);
+static void texture_image_decode_job(void* data, usize index);
+static void texture_image_load(TextureImage* texture);
+static bool texture_image_decode(TextureImage* texture, const u8* data, usize size, const char* path, bool* placeholder);
+static bool texture_image_decode_virtual(TextureImage* texture, const u8* data, usize size, u64 content_hash, bool* placeholder);
+static usize texture_image_texel_index(TextureImageLevel* level, u32 x, u32 y);
+static usize texture_image_texel_size(TextureImageFormat format);
+static Color texture_image_fetch(TextureImageFormat format, TextureImageLevel* level, u32 x, u32 y);
+static void texture_image_store(TextureImageFormat format, TextureImageLevel* level, u32 x, u32 y, Color color);
+static void texture_image_bilinear_coordinates(TextureImageLevel* level, Vector2 uv_coordinates, u32 x[2], u32 y[2], f32* fx, f32* fy);
+static Color texture_image_bilinear(TextureImageFormat format, TextureImageLevel* level, Vector2 uv_coordinates);
+static Color texture_image_sample(TextureImage* image, u32 level, Vector2 uv_coordinates);
+static Color texture_image_bilinear_virtual(TextureImage* image, u32 level, Vector2 uv_coordinates);
+static bool texture_image_fetch_virtual(TextureImage* image, u32 level, const u32 x[2], const u32 y[2], Color texels[4]);
+static s32 texture_image_floor(f32 value);
+static Color texture_image_lerp(Color a, Color b, f32 t);
+static void texture_image_srgb_table_create();
+static u8 texture_image_srgb8_from_linear(f32 value);
+static u8* texture_image_read_file(const char* path, usize* size);
+static u64 texture_image_hash(const u8* data, usize size);
+static bool texture_image_file_matches(const char* path, const u8* data, usize size);
+static TextureImage* texture_image_cache_find_path(const char* canonical_path);
+static TextureImage* texture_image_cache_find_content(TextureImage* image, u64 content_hash, usize content_size);
+static void texture_image_cache_insert(const char* canonical_path, TextureImage* image);
+static void texture_image_cache_remove(TextureImage* image);
+static void texture_image_cache_forget(TextureImage* image);
+static u64 texture_image_cache_key(TextureImageCacheEntry* entry, bool content);
+static void texture_image_cache_table_insert(TextureImageCacheEntry** table, TextureImageCacheEntry* entry, bool content);
+static void texture_image_cache_table_remove(TextureImageCacheEntry** table, TextureImageCacheEntry* entry, bool content);
+static bool texture_image_cache_grow();
+
+// decoding never touches the gpu, the gui uploads its preview texture lazily from its own thread
 TextureImage* texture_image_create(const char* path) {
+  char* resolved_path = realpath(path, NULL);
+  const char* canonical_path = resolved_path ? resolved_path : path;
+
+  TextureImage* texture = texture_image_cache_find_path(canonical_path);
+  if (texture) { goto cleanup; }
+
+  texture = texture_image_allocate(path);
+  if (!texture) { goto cleanup; }
+
+  // cached before decoding, so other materials naming the same path share this decode even while it is pending
+  texture_image_cache_insert(canonical_path, texture);
+  if (!texture_image_defer(texture)) { texture_image_load(texture); }
+
+cleanup:
+  free(resolved_path);
+  return texture;
+}
+
+void texture_image_decode_defer() {
+  texture_image_deferred.deferring = true;
+}
+
+void texture_image_decode_submit() {
+  texture_image_deferred.deferring = false;
+  if (texture_image_deferred.images_count == 0) { return; }
+
+  TraceScope trace = trace_begin("Texture Decode Submit");
+
+  ThreadPool* pool = thread_pool_get_global();
+  ThreadPoolGroup group = {0};
+  for (usize i = 0; i < texture_image_deferred.images_count; i++) {
+    if (pool) {
+      thread_pool_submit(pool, &group, texture_image_decode_job, texture_image_deferred.images[i], 0);
+    } else {
+      texture_image_decode_job(texture_image_deferred.images[i], 0);
+    }
+  }
+
+  free(texture_image_deferred.images);
+  texture_image_deferred.images = NULL;
+  texture_image_deferred.images_count = 0;
+  texture_image_deferred.capacity = 0;
+
+  if (pool) { thread_pool_wait(pool, &group); }
+  trace_end(trace);
+}
+
+u32 texture_image_decode_generation() {
+  return atomic_load(&texture_image_decodes_finished);
+}
+
+u32 texture_image_decodes_pending() {
+  return atomic_load(&texture_image_decodes_waiting);
+}
+
+static TextureImage* texture_image_allocate(const char* path) {
   TextureImage* texture = (TextureImage*) malloc(sizeof(TextureImage));
   if (!texture) {
     fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to allocate memory for image texture!\n");
     return NULL;
   }
 
-  texture->texture = (Texture) { TEXTURE_TYPE_IMAGE, get_color, destroy };
+  texture->texture = (Texture) { TEXTURE_TYPE_IMAGE, get_color, clone, destroy };
+  atomic_init(&texture->reference_count, 1);
 
+  texture->path_to_image = strdup(path);
+  atomic_init(&texture->state, TEXTURE_IMAGE_STATE_PENDING);
+  texture->width = 0;
+  texture->height = 0;
+  texture->format = TEXTURE_IMAGE_FORMAT_SRGB8;
   texture->pixels = NULL;
-  texture_image_change_image(texture, path);
+  texture->pixels_size = 0;
+  texture->levels_count = 0;
+  texture->pixels_owner = NULL;
+  texture->virtual_texture = NULL;
+  texture->cache_entry = NULL;
+  texture->preview_texture = 0;
+  texture->preview_texture_destroy = NULL;
 
   return texture;
 }
 
-void texture_image_change_image(TextureImage* texture, const char* path) {
-  if (texture->pixels) { free(texture->pixels); }
-  texture_destroy(texture->gl_texture);
+// false when this thread is not deferring, or the list cannot grow and the image has to be decoded right away
+static bool texture_image_defer(TextureImage* texture) {
+  if (!texture_image_deferred.deferring) { return false; }
+
+  if (texture_image_deferred.images_count == texture_image_deferred.capacity) {
+    usize capacity = (texture_image_deferred.capacity == 0) ? TEXTURE_IMAGE_CACHE_STARTING_CAPACITY : (texture_image_deferred.capacity * 2);
+    TextureImage** temp = (TextureImage**) realloc(texture_image_deferred.images, sizeof(TextureImage*) * capacity);
+    if (!temp) { return false; }
+
+    texture_image_deferred.images = temp;
+    texture_image_deferred.capacity = capacity;
+  }
+
+  texture_image_deferred.images[texture_image_deferred.images_count++] = (TextureImage*) clone((Texture*) texture);
+  atomic_fetch_add(&texture_image_decodes_waiting, 1);
+  return true;
+}
+
+// the job owns the reference taken when the image was deferred, so a scene unloaded meanwhile cannot free it
+static void texture_image_decode_job(void* data, usize index) {
+  (void) index;
+  TextureImage* texture = (TextureImage*) data;
+  texture_image_load(texture);
+  atomic_fetch_sub(&texture_image_decodes_waiting, 1);
+  texture_image_destroy(texture);
+}
+
+static void texture_image_load(TextureImage* texture) {
+  f64 start_time = timer_get_seconds();
 
-  texture->path_to_image = path;
+  usize size = 0;
+  u8* data = texture_image_read_file(texture->path_to_image, &size);
+
+  // a copy of a file already in use under another name borrows its pixels but keeps its own path for saving
+  u64 content_hash = data ? texture_image_hash(data, size) : 0;
+  TextureImage* owner = data ? texture_image_cache_find_content(texture, content_hash, size) : NULL;
+
+  // the hash only picks the candidate, a collision or a file rewritten since it was decoded must not be shared
+  if (owner && !texture_image_file_matches(owner->path_to_image, data, size)) {
+    texture_image_destroy(owner);
+    owner = NULL;
+  }
+
+  bool loaded = true;
+  bool placeholder = false;
+  if (owner) {
+    pthread_mutex_lock(&texture_image_cache.lock);
+    texture_image_cache.stats.content_hits++;
+    texture_image_cache.stats.saved_bytes += owner->pixels_size;
+    pthread_mutex_unlock(&texture_image_cache.lock);
+
+    texture->format = owner->format;
+    texture->pixels = owner->pixels;
+    texture->pixels_size = owner->pixels_size;
+    memcpy(texture->levels, owner->levels, sizeof(texture->levels));
+    texture->levels_count = owner->levels_count;
+    texture->width = owner->width;
+    texture->height = owner->height;
+    texture->pixels_owner = owner;
+    texture->virtual_texture = owner->virtual_texture;
+  } else if (data && virtual_texture_pager_is_running()) {
+    loaded = texture_image_decode_virtual(texture, data, size, content_hash, &placeholder);
+  } else {
+    loaded = texture_image_decode(texture, data, size, texture->path_to_image, &placeholder);
+  }
 
-  stbi_set_flip_vertically_on_load(true);
-  f32* image_data = stbi_loadf(path, (s32*) &texture->width, (s32*) &texture->height, NULL, 3);
+  free(data);
+
+  // the file may be fixed or replaced later, so the next request for the path tries to decode it again
+  if (placeholder || !loaded) { texture_image_cache_forget(texture); }
+
+  pthread_mutex_lock(&texture_image_cache.lock);
+  texture_image_cache.stats.decode_time += timer_get_seconds() - start_time;
+  pthread_mutex_unlock(&texture_image_cache.lock);
+
+  // publishes the pixels to every thread that sees the new state
+  atomic_store_explicit(&texture->state, loaded ? TEXTURE_IMAGE_STATE_READY : TEXTURE_IMAGE_STATE_FAILED, memory_order_release);
+  atomic_fetch_add(&texture_image_decodes_finished, 1);
+}
+
+// data is the file contents, or NULL when it could not be read and the placeholder is decoded instead
+static bool texture_image_decode(TextureImage* texture, const u8* data, usize size, const char* path, bool* placeholder) {
+  TraceScope trace = trace_begin("Texture Decode");
+
+  s32 width, height;
+  stbi_set_flip_vertically_on_load_thread(true);
+
+  // only hdr files go through floats, everything else keeps its 8 bit srgb values
+  bool readable = (data && size <= INT_MAX);
+  bool hdr = readable && stbi_is_hdr_from_memory(data, (s32) size);
+  void* image_data = NULL;
+  if (readable) {
+    image_data = hdr ? (void*) stbi_loadf_from_memory(data, (s32) size, &width, &height, NULL, 3) : (void*) stbi_load_from_memory(data, (s32) size, &width, &height, NULL, 4);
+  }
   if (!image_data) {
-    fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to load image data!\n");
-    image_data = stbi_loadf(TEXTURE_IMAGE_INVALID_PATH, (s32*) &texture->width, (s32*) &texture->height, NULL, 3);
+    fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to load image data: %s!\n", path);
+    hdr = false;
+    *placeholder = true;
+    image_data = stbi_load(TEXTURE_IMAGE_INVALID_PATH, &width, &height, NULL, 4);
     if (!image_data) {
-      free(texture);
-      return;
+      fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to load invalid image placeholder!\n");
+      trace_end(trace);
+      return false;
     }
   }
 
-  usize pixels_length = (texture->width * texture->height);
-  texture->pixels = (Color*) malloc(sizeof(Color) * pixels_length);
-  if (!image_data) {
+  bool built = texture_image_build_levels(texture, hdr ? TEXTURE_IMAGE_FORMAT_HALF : TEXTURE_IMAGE_FORMAT_SRGB8, image_data, width, height);
+  stbi_image_free(image_data);
+  if (!built) {
+    trace_end(trace);
+    return false;
+  }
+
+  pthread_mutex_lock(&texture_image_cache.lock);
+  texture_image_cache.stats.decodes++;
+  pthread_mutex_unlock(&texture_image_cache.lock);
+
+  trace_end(trace);
+  return true;
+}
+
+// the cache file is written by the first decode of the contents, every later load only reads its header and pinned
+// levels, an image that cannot be paged stays in memory as decoded
+static bool texture_image_decode_virtual(TextureImage* texture, const u8* data, usize size, u64 content_hash, bool* placeholder) {
+  char path[TEXTURE_IMAGE_PATH_LENGTH];
+  if (!virtual_texture_cache_path(path, sizeof(path), content_hash, size)) { return texture_image_decode(texture, data, size, texture->path_to_image, placeholder); }
+
+  // an image opened from its cache file is never built, lookups still need the table building fills
+  pthread_once(&texture_image_srgb_table_once, texture_image_srgb_table_create);
+  texture->virtual_texture = virtual_texture_open(path, texture, content_hash, size);
+  if (texture->virtual_texture) { return true; }
+
+  if (!texture_image_decode(texture, data, size, texture->path_to_image, placeholder)) { return false; }
+  if (!virtual_texture_write(path, texture, content_hash, size)) { return true; }
+
+  u8* pixels = texture->pixels;
+  texture->virtual_texture = virtual_texture_open(path, texture, content_hash, size);
+  if (texture->virtual_texture) { free(pixels); }
+  return true;
+}
+
+bool texture_image_build_levels(TextureImage* image, TextureImageFormat format, const void* data, u32 width, u32 height) {
+  TraceScope trace = trace_begin("Texture Mip Levels");
+  pthread_once(&texture_image_srgb_table_once, texture_image_srgb_table_create);
+
+  usize texel_size = texture_image_texel_size(format);
+  usize level_sizes[TEXTURE_IMAGE_MAX_LEVELS];
+  usize pixels_size = 0;
+  u32 levels_count = 0;
+  for (u32 level_width = width, level_height = height; levels_count < TEXTURE_IMAGE_MAX_LEVELS; levels_count++) {
+    TextureImageLevel* level = &image->levels[levels_count];
+    level->width = level_width;
+    level->height = level_height;
+    level->tiles_x = (level_width + TEXTURE_IMAGE_TILE_SIZE - 1) >> TEXTURE_IMAGE_TILE_SHIFT;
+
+    u32 tiles_y = (level_height + TEXTURE_IMAGE_TILE_SIZE - 1) >> TEXTURE_IMAGE_TILE_SHIFT;
+    level_sizes[levels_count] = (usize) level->tiles_x * tiles_y * TEXTURE_IMAGE_TILE_SIZE * TEXTURE_IMAGE_TILE_SIZE * texel_size;
+    pixels_size += level_sizes[levels_count];
+
+    if (level_width == 1 && level_height == 1) {
+      levels_count++;
+      break;
+    }
+    level_width = (level_width > 1) ? (level_width / 2) : 1;
+    level_height = (level_height > 1) ? (level_height / 2) : 1;
+  }
+
+  u8* pixels = (u8*) malloc(pixels_size);
+  if (!pixels) {
     fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to allocate memory for pixels!\n");
-    stbi_image_free((void*) image_data);
-    free(texture);
-    return;
+    trace_end(trace);
+    return false;
   }
 
-  for (usize i = 0; i < pixels_length; i++) {
-    usize data_index = (i * 3);
-    texture->pixels[i] = (Color) { image_data[data_index], image_data[data_index + 1], image_data[data_index + 2] };
+  image->format = format;
+  image->pixels = pixels;
+  image->pixels_size = pixels_size;
+  image->levels_count = levels_count;
+  image->width = width;
+  image->height = height;
+
+  for (u32 i = 0; i < levels_count; i++) {
+    image->levels[i].texels = pixels;
+    pixels += level_sizes[i];
   }
 
-  stbi_image_free((void*) image_data);
+  TextureImageLevel* full = &image->levels[0];
+  for (u32 y = 0; y < height; y++) {
+    for (u32 x = 0; x < width; x++) {
+      usize source_index = (usize) y * width + x;
+      if (format == TEXTURE_IMAGE_FORMAT_SRGB8) {
+        memcpy(&full->texels[texture_image_texel_index(full, x, y) * texel_size], &((const u8*) data)[source_index * 4], 4);
+      } else {
+        const f32* rgb = &((const f32*) data)[source_index * 3];
+        texture_image_store(format, full, x, y, (Color) { rgb[0], rgb[1], rgb[2] });
+      }
+    }
+  }
 
-  texture->gl_texture = texture_create();
-  ColorRGB* pixelsRGB = (ColorRGB*) malloc(sizeof(ColorRGB) * pixels_length);
-  if (!pixelsRGB) {
-    fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to allocate memory for pixels RGB!\n");
-    return;
+  // a box filter over the previous level in linear space, odd sizes clamp so the last row and column are not read past
+  for (u32 i = 1; i < levels_count; i++) {
+    TextureImageLevel* source = &image->levels[i - 1];
+    TextureImageLevel* level = &image->levels[i];
+
+    for (u32 y = 0; y < level->height; y++) {
+      u32 y0 = (y * 2 < source->height) ? (y * 2) : (source->height - 1);
+      u32 y1 = (y * 2 + 1 < source->height) ? (y * 2 + 1) : y0;
+      for (u32 x = 0; x < level->width; x++) {
+        u32 x0 = (x * 2 < source->width) ? (x * 2) : (source->width - 1);
+        u32 x1 = (x * 2 + 1 < source->width) ? (x * 2 + 1) : x0;
+
+        Color sum = color_add(
+          color_add(texture_image_fetch(format, source, x0, y0), texture_image_fetch(format, source, x1, y0)),
+          color_add(texture_image_fetch(format, source, x0, y1), texture_image_fetch(format, source, x1, y1))
+        );
+        texture_image_store(format, level, x, y, color_scale(sum, 0.25f));
+      }
+    }
+  }
+
+  trace_end(trace);
+  return true;
+}
+
+static u8* texture_image_read_file(const char* path, usize* size) {
+  FILE* file = fopen(path, "rb");
+  if (!file) { return NULL; }
+
+  u8* data = NULL;
+  if (fseek(file, 0, SEEK_END) != 0) { goto cleanup; }
+
+  long length = ftell(file);
+  if (length <= 0 || fseek(file, 0, SEEK_SET) != 0) { goto cleanup; }
+
+  data = (u8*) malloc(length);
+  if (data && fread(data, 1, length, file) != (usize) length) {
+    free(data);
+    data = NULL;
   }
+  *size = (usize) length;
+
+cleanup:
+  fclose(file);
+  return data;
+}
 
-  for (usize i = 0; i < pixels_length; i++) {
-    pixelsRGB[i] = tonemapping_clamp(texture->pixels[i]);
+static u64 texture_image_hash(const u8* data, usize size) {
+  u64 hash = TEXTURE_IMAGE_FNV_OFFSET;
+  for (usize i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * TEXTURE_IMAGE_FNV_PRIME;
   }
 
-  texture_set_colorRGB_buffer(texture->gl_texture, pixelsRGB, texture->width, texture->height);
+  return hash;
+}
+
+static bool texture_image_file_matches(const char* path, const u8* data, usize size) {
+  usize file_size = 0;
+  u8* file_data = texture_image_read_file(path, &file_size);
 
-  free(pixelsRGB);
+  bool matches = file_data && (file_size == size) && (memcmp(file_data, data, size) == 0);
+  free(file_data);
+  return matches;
 }
 
-static inline Color get_color(Texture* texture, Vector2 uv_coordinates) {
-  return texture_image_get((TextureImage*) texture, uv_coordinates);
+static inline Color get_color(Texture* texture, Vector2 uv_coordinates, f32 uv_footprint) {
+  return texture_image_get((TextureImage*) texture, uv_coordinates, uv_footprint);
+}
+
+static inline Texture* clone(Texture* texture) {
+  atomic_fetch_add(&((TextureImage*) texture)->reference_count, 1);
+  return texture;
 }
 
 static inline void destroy(Texture* texture) {
   texture_image_destroy((TextureImage*) texture);
 }
 
-inline Color texture_image_get(TextureImage* image, Vector2 uv_coordinates) {
-  u32 x = ((s32) (image->width * uv_coordinates.x)) % image->width;
-  u32 y = ((s32) (image->height * uv_coordinates.y)) % image->height;
-  return image->pixels[y * image->width + x];
+inline Color texture_image_get(TextureImage* image, Vector2 uv_coordinates, f32 uv_footprint) {
+  if (atomic_load_explicit(&image->state, memory_order_acquire) != TEXTURE_IMAGE_STATE_READY) { return TEXTURE_IMAGE_PLACEHOLDER_COLOR; }
+
+  // the level of detail is how many texels of the full image the footprint covers, in powers of two
+  f32 texels = uv_footprint * (f32) ((image->width > image->height) ? image->width : image->height);
+  if (texels <= 1.0f) { return texture_image_sample(image, 0, uv_coordinates); }
+
+  f32 lod = log2f(texels);
+  u32 level = (u32) lod;
+  if (level >= image->levels_count - 1) { return texture_image_sample(image, image->levels_count - 1, uv_coordinates); }
+
+  f32 t = lod - (f32) level;
+  Color fine = texture_image_sample(image, level, uv_coordinates);
+  Color coarse = texture_image_sample(image, level + 1, uv_coordinates);
+  return texture_image_lerp(fine, coarse, t);
+}
+
+// paged levels are always waited for here, the editor needs the exact texel
+Color texture_image_get_texel(TextureImage* image, u32 level, u32 x, u32 y) {
+  TextureImageLevel* image_level = &image->levels[level];
+  if (image_level->texels) { return texture_image_fetch(image->format, image_level, x, y); }
+
+  VirtualTexture* virtual_texture = image->virtual_texture;
+  VirtualTexturePage page;
+  virtual_texture_page_acquire(virtual_texture, level, x >> virtual_texture->page_shift_x, y >> virtual_texture->page_shift_y, true, &page);
+
+  TextureImageLevel page_level = { .tiles_x = 1u << (virtual_texture->page_shift_x - TEXTURE_IMAGE_TILE_SHIFT), .texels = (u8*) page.texels };
+  Color color = texture_image_fetch(image->format, &page_level, x & ((1u << virtual_texture->page_shift_x) - 1), y & ((1u << virtual_texture->page_shift_y) - 1));
+  virtual_texture_page_release(&page);
+  return color;
+}
+
+static inline usize texture_image_texel_index(TextureImageLevel* level, u32 x, u32 y) {
+  usize tile = (usize) (y >> TEXTURE_IMAGE_TILE_SHIFT) * level->tiles_x + (x >> TEXTURE_IMAGE_TILE_SHIFT);
+  u32 mask = TEXTURE_IMAGE_TILE_SIZE - 1;
+  return (tile << (2 * TEXTURE_IMAGE_TILE_SHIFT)) | ((y & mask) << TEXTURE_IMAGE_TILE_SHIFT) | (x & mask);
+}
+
+static inline usize texture_image_texel_size(TextureImageFormat format) {
+  return (format == TEXTURE_IMAGE_FORMAT_SRGB8) ? (4 * sizeof(u8)) : (4 * sizeof(u16));
+}
+
+static inline Color texture_image_fetch(TextureImageFormat format, TextureImageLevel* level, u32 x, u32 y) {
+  usize index = texture_image_texel_index(level, x, y);
+  if (format == TEXTURE_IMAGE_FORMAT_SRGB8) {
+    const u8* texel = &level->texels[index * 4];
+    return (Color) { texture_image_srgb_table[texel[0]], texture_image_srgb_table[texel[1]], texture_image_srgb_table[texel[2]] };
+  }
+
+  const u16* texel = (const u16*) &level->texels[index * 4 * sizeof(u16)];
+  return (Color) { half_to_f32(texel[0]), half_to_f32(texel[1]), half_to_f32(texel[2]) };
+}
+
+static void texture_image_store(TextureImageFormat format, TextureImageLevel* level, u32 x, u32 y, Color color) {
+  usize index = texture_image_texel_index(level, x, y);
+  if (format == TEXTURE_IMAGE_FORMAT_SRGB8) {
+    u8* texel = &level->texels[index * 4];
+    texel[0] = texture_image_srgb8_from_linear(color.red);
+    texel[1] = texture_image_srgb8_from_linear(color.green);
+    texel[2] = texture_image_srgb8_from_linear(color.blue);
+    texel[3] = UINT8_MAX;
+    return;
+  }
+
+  u16* texel = (u16*) &level->texels[index * 4 * sizeof(u16)];
+  texel[0] = half_from_f32(color.red);
+  texel[1] = half_from_f32(color.green);
+  texel[2] = half_from_f32(color.blue);
+  texel[3] = TEXTURE_IMAGE_HALF_ONE;
+}
+
+// uv coordinates repeat, texel centers sit at half texel offsets
+static inline void texture_image_bilinear_coordinates(TextureImageLevel* level, Vector2 uv_coordinates, u32 x[2], u32 y[2], f32* fx, f32* fy) {
+  f32 u = (uv_coordinates.x - texture_image_floor(uv_coordinates.x)) * level->width - 0.5f;
+  f32 v = (uv_coordinates.y - texture_image_floor(uv_coordinates.y)) * level->height - 0.5f;
+  s32 x0 = texture_image_floor(u);
+  s32 y0 = texture_image_floor(v);
+  *fx = u - x0;
+  *fy = v - y0;
+
+  // after wrapping the floor is at least -1 and at most the last texel, rounding can push it one past
+  if (x0 < 0) { x0 += level->width; } else if ((u32) x0 >= level->width) { x0 -= level->width; }
+  if (y0 < 0) { y0 += level->height; } else if ((u32) y0 >= level->height) { y0 -= level->height; }
+  x[0] = (u32) x0;
+  y[0] = (u32) y0;
+  x[1] = ((u32) x0 + 1 == level->width) ? 0 : (u32) x0 + 1;
+  y[1] = ((u32) y0 + 1 == level->height) ? 0 : (u32) y0 + 1;
+}
+
+static inline Color texture_image_bilinear(TextureImageFormat format, TextureImageLevel* level, Vector2 uv_coordinates) {
+  u32 x[2], y[2];
+  f32 fx, fy;
+  texture_image_bilinear_coordinates(level, uv_coordinates, x, y, &fx, &fy);
+
+  Color c00 = texture_image_fetch(format, level, x[0], y[0]);
+  Color c10 = texture_image_fetch(format, level, x[1], y[0]);
+  Color c01 = texture_image_fetch(format, level, x[0], y[1]);
+  Color c11 = texture_image_fetch(format, level, x[1], y[1]);
+
+  return texture_image_lerp(texture_image_lerp(c00, c10, fx), texture_image_lerp(c01, c11, fx), fy);
+}
+
+// only levels of a virtual texture that are read page by page have no texels
+static inline Color texture_image_sample(TextureImage* image, u32 level, Vector2 uv_coordinates) {
+  if (image->levels[level].texels) { return texture_image_bilinear(image->format, &image->levels[level], uv_coordinates); }
+  return texture_image_bilinear_virtual(image, level, uv_coordinates);
+}
+
+// a level whose pages are not resident yet falls back to the next coarser one, the coarsest levels are pinned
+static Color texture_image_bilinear_virtual(TextureImage* image, u32 level, Vector2 uv_coordinates) {
+  for (; level < image->levels_count; level++) {
+    TextureImageLevel* image_level = &image->levels[level];
+    if (image_level->texels) { return texture_image_bilinear(image->format, image_level, uv_coordinates); }
+
+    u32 x[2], y[2];
+    f32 fx, fy;
+    texture_image_bilinear_coordinates(image_level, uv_coordinates, x, y, &fx, &fy);
+
+    Color c[4];
+    if (!texture_image_fetch_virtual(image, level, x, y, c)) { continue; }
+    return texture_image_lerp(texture_image_lerp(c[0], c[1], fx), texture_image_lerp(c[2], c[3], fx), fy);
+  }
+
+  return TEXTURE_IMAGE_PLACEHOLDER_COLOR;
+}
+
+// the four texels of a lookup usually share one page, which is only acquired once for them
+static bool texture_image_fetch_virtual(TextureImage* image, u32 level, const u32 x[2], const u32 y[2], Color texels[4]) {
+  VirtualTexture* virtual_texture = image->virtual_texture;
+  u32 shift_x = virtual_texture->page_shift_x, shift_y = virtual_texture->page_shift_y;
+  u32 mask_x = (1u << shift_x) - 1, mask_y = (1u << shift_y) - 1;
+
+  TextureImageLevel page_level = { .tiles_x = 1u << (shift_x - TEXTURE_IMAGE_TILE_SHIFT) };
+  VirtualTexturePage page;
+  bool held = false;
+  u32 held_x = 0, held_y = 0;
+  for (u32 i = 0; i < 4; i++) {
+    u32 texel_x = x[i & 1], texel_y = y[i >> 1];
+    u32 page_x = texel_x >> shift_x, page_y = texel_y >> shift_y;
+    if (!held || page_x != held_x || page_y != held_y) {
+      if (held) { virtual_texture_page_release(&page); }
+
+      held = virtual_texture_page_acquire(virtual_texture, level, page_x, page_y, false, &page);
+      if (!held) { return false; }
+
+      held_x = page_x;
+      held_y = page_y;
+      page_level.texels = (u8*) page.texels;
+    }
+
+    texels[i] = texture_image_fetch(image->format, &page_level, texel_x & mask_x, texel_y & mask_y);
+  }
+
+  virtual_texture_page_release(&page);
+  return true;
+}
+
+// floorf is a libm call without sse4.1, this is exact for anything a uv coordinate can reach
+static inline s32 texture_image_floor(f32 value) {
+  s32 truncated = (s32) value;
+  return truncated - (value < (f32) truncated);
+}
+
+// spelled out since color_add and color_scale are not inlined across translation units
+static inline Color texture_image_lerp(Color a, Color b, f32 t) {
+  return (Color) { a.red + (b.red - a.red) * t, a.green + (b.green - a.green) * t, a.blue + (b.blue - a.blue) * t };
+}
+
+static void texture_image_srgb_table_create() {
+  for (u32 i = 0; i < 256; i++) {
+    f32 value = i / 255.0f;
+    texture_image_srgb_table[i] = (value <= 0.04045f) ? (value / 12.92f) : powf((value + 0.055f) / 1.055f, 2.4f);
+  }
+}
+
+// only used while building levels, lookups go through the table
+static u8 texture_image_srgb8_from_linear(f32 value) {
+  if (!(value > 0.0f)) { return 0; }
+  if (value >= 1.0f) { return UINT8_MAX; }
+
+  f32 srgb = (value <= 0.0031308f) ? (value * 12.92f) : (1.055f * powf(value, 1.0f / 2.4f) - 0.055f);
+  return (u8) (srgb * 255.0f + 0.5f);
+}
+
+TextureImageState texture_image_get_state(TextureImage* image) {
+  return (TextureImageState) atomic_load_explicit(&image->state, memory_order_acquire);
 }
 
 cJSON* texture_image_json_create(TextureImage* image) {
@@ -128,32 +678,259 @@ error:
   return NULL;
 }
 
-bool texture_image_gui_edit(TextureImage* image) {
-  ImVec2 image_preview_size;
-  if (image->width > image->height) {
-    image_preview_size = (ImVec2) { (((f32) image->width / image->height) * 128.0f), 128.0f };
+void texture_image_destroy(TextureImage* image) {
+  // dropping the last reference and leaving the cache happen under its lock, so a lookup cannot revive the image
+  pthread_mutex_lock(&texture_image_cache.lock);
+  bool last_reference = (atomic_fetch_sub(&image->reference_count, 1) == 1);
+  if (last_reference) { texture_image_cache_remove(image); }
+  pthread_mutex_unlock(&texture_image_cache.lock);
+
+  if (!last_reference) { return; }
+
+  if (image->preview_texture_destroy) { image->preview_texture_destroy(image->preview_texture); }
+  if (image->pixels_owner) {
+    texture_image_destroy(image->pixels_owner);
+  } else if (image->virtual_texture) {
+    virtual_texture_close(image->virtual_texture);
   } else {
-    image_preview_size = (ImVec2) { 128.0f, (((f32) image->height / image->width) * 128.0f) };
+    free(image->pixels);
   }
-  igImage((ImTextureRef) { NULL, image->gl_texture }, image_preview_size, (ImVec2) { 0.0f, 1.0f }, (ImVec2) { 1.0f, 0.0f } );
 
-  if (igSmallButton("Change Image")) {
-    nfdfilteritem_t filter_items[] = { { "Image", "jpg,png" } };
-    const char* path = file_dialog_get_open(filter_items, (sizeof(filter_items) / sizeof(nfdfilteritem_t)));
-    if (!path) {
-      return false;
+  free((void*) image->path_to_image);
+  free(image);
+}
+
+void texture_image_cache_retain(bool retain) {
+  pthread_mutex_lock(&texture_image_cache.lock);
+  texture_image_cache.retain = retain;
+
+  // released outside the lock since destroying takes it
+  usize released_count = 0;
+  TextureImage** released = NULL;
+  if (!retain && texture_image_cache.entries_count > 0) {
+    released = (TextureImage**) malloc(sizeof(TextureImage*) * texture_image_cache.entries_count);
+    for (u64 i = 0; released && i <= texture_image_cache.table_mask; i++) {
+      TextureImageCacheEntry* entry = texture_image_cache.paths[i];
+      if (!entry || !entry->retained) { continue; }
+
+      entry->retained = false;
+      released[released_count++] = entry->image;
     }
+  }
+
+  pthread_mutex_unlock(&texture_image_cache.lock);
+
+  for (usize i = 0; i < released_count; i++) {
+    texture_image_destroy(released[i]);
+  }
+  free(released);
+}
+
+TextureImageCacheStats texture_image_cache_get_stats() {
+  pthread_mutex_lock(&texture_image_cache.lock);
 
-    texture_image_change_image(image, path);
-    file_dialog_string_destroy(path);
-    return true;
+  TextureImageCacheStats stats = texture_image_cache.stats;
+  stats.entries = texture_image_cache.entries_count;
+  stats.resident_bytes = 0;
+  for (u64 i = 0; texture_image_cache.paths && i <= texture_image_cache.table_mask; i++) {
+    if (!texture_image_cache.paths[i]) { continue; }
+
+    TextureImage* image = texture_image_cache.paths[i]->image;
+    if (texture_image_get_state(image) == TEXTURE_IMAGE_STATE_READY && !image->pixels_owner) { stats.resident_bytes += image->pixels_size; }
   }
 
-  return false;
+  pthread_mutex_unlock(&texture_image_cache.lock);
+  return stats;
 }
 
-void texture_image_destroy(TextureImage* image) {
-  texture_destroy(image->gl_texture);
-  free(image->pixels);
-  free(image);
+void texture_image_cache_print_stats() {
+  TextureImageCacheStats stats = texture_image_cache_get_stats();
+  printf("[INFO] [TEXTURE] [CACHE] %u decodes, %u path and %u content hits taking %.3fs, %.2f MiB resident, %.2f MiB saved\n",
+    stats.decodes, stats.path_hits, stats.content_hits, stats.decode_time, stats.resident_bytes / (1024.0 * 1024.0), stats.saved_bytes / (1024.0 * 1024.0));
+}
+
+static TextureImage* texture_image_cache_find_path(const char* canonical_path) {
+  u64 path_hash = texture_image_hash((const u8*) canonical_path, strlen(canonical_path));
+  pthread_mutex_lock(&texture_image_cache.lock);
+
+  TextureImage* image = NULL;
+  u64 mask = texture_image_cache.table_mask;
+  for (u64 slot = (path_hash * TEXTURE_IMAGE_CACHE_MULTIPLIER) & mask; texture_image_cache.paths && texture_image_cache.paths[slot]; slot = (slot + 1) & mask) {
+    TextureImageCacheEntry* entry = texture_image_cache.paths[slot];
+    if (entry->path_hash != path_hash || strcmp(entry->canonical_path, canonical_path) != 0) { continue; }
+
+    image = (TextureImage*) clone((Texture*) entry->image);
+    texture_image_cache.stats.path_hits++;
+    if (texture_image_get_state(image) == TEXTURE_IMAGE_STATE_READY) {
+      texture_image_cache.stats.saved_bytes += image->pixels_size;
+    }
+    break;
+  }
+
+  pthread_mutex_unlock(&texture_image_cache.lock);
+  return image;
+}
+
+// records the contents on the image's own entry and looks for another decoded file with the same ones,
+// files still being decoded elsewhere are not waited for and simply decode twice
+static TextureImage* texture_image_cache_find_content(TextureImage* image, u64 content_hash, usize content_size) {
+  pthread_mutex_lock(&texture_image_cache.lock);
+
+  TextureImageCacheEntry* own = image->cache_entry;
+  if (own && own->content_size == 0 && content_size > 0) {
+    own->content_hash = content_hash;
+    own->content_size = content_size;
+    texture_image_cache_table_insert(texture_image_cache.contents, own, true);
+  }
+
+  TextureImage* owner = NULL;
+  TextureImageCacheEntry key = { .content_hash = content_hash, .content_size = content_size };
+  u64 mask = texture_image_cache.table_mask;
+  u64 slot = (texture_image_cache_key(&key, true) * TEXTURE_IMAGE_CACHE_MULTIPLIER) & mask;
+  for (; texture_image_cache.contents && texture_image_cache.contents[slot]; slot = (slot + 1) & mask) {
+    TextureImageCacheEntry* entry = texture_image_cache.contents[slot];
+    bool match = (entry != own && entry->content_size == content_size && entry->content_hash == content_hash && !entry->image->pixels_owner &&
+      texture_image_get_state(entry->image) == TEXTURE_IMAGE_STATE_READY);
+    if (!match) { continue; }
+
+    owner = (TextureImage*) clone((Texture*) entry->image);
+    break;
+  }
+
+  pthread_mutex_unlock(&texture_image_cache.lock);
+  return owner;
+}
+
+static void texture_image_cache_insert(const char* canonical_path, TextureImage* image) {
+  pthread_mutex_lock(&texture_image_cache.lock);
+
+  TextureImageCacheEntry* entry = NULL;
+  if (!texture_image_cache_grow()) { goto error; }
+
+  entry = (TextureImageCacheEntry*) calloc(1, sizeof(TextureImageCacheEntry));
+  if (!entry) { goto error; }
+
+  entry->canonical_path = strdup(canonical_path);
+  if (!entry->canonical_path) { goto error; }
+
+  entry->path_hash = texture_image_hash((const u8*) canonical_path, strlen(canonical_path));
+  entry->image = image;
+  entry->retained = texture_image_cache.retain;
+  if (entry->retained) { clone((Texture*) image); }
+
+  texture_image_cache_table_insert(texture_image_cache.paths, entry, false);
+  texture_image_cache.entries_count++;
+  image->cache_entry = entry;
+
+  pthread_mutex_unlock(&texture_image_cache.lock);
+  return;
+
+error:
+  fprintf(stderr, "[ERROR] [TEXTURE] [IMAGE] Failed to grow texture cache, %s is not cached!\n", canonical_path);
+  free(entry);
+  pthread_mutex_unlock(&texture_image_cache.lock);
+}
+
+// called with the lock held
+static void texture_image_cache_remove(TextureImage* image) {
+  TextureImageCacheEntry* entry = image->cache_entry;
+  if (!entry) { return; }
+
+  texture_image_cache_table_remove(texture_image_cache.paths, entry, false);
+  if (entry->content_size > 0) { texture_image_cache_table_remove(texture_image_cache.contents, entry, true); }
+  texture_image_cache.entries_count--;
+  image->cache_entry = NULL;
+
+  free((void*) entry->canonical_path);
+  free(entry);
+
+  if (texture_image_cache.entries_count == 0) {
+    free(texture_image_cache.paths);
+    free(texture_image_cache.contents);
+    texture_image_cache.paths = NULL;
+    texture_image_cache.contents = NULL;
+    texture_image_cache.table_mask = 0;
+  }
+}
+
+// drops the image's entry while it stays alive for everyone already holding it, including the batch reference
+static void texture_image_cache_forget(TextureImage* image) {
+  pthread_mutex_lock(&texture_image_cache.lock);
+
+  bool retained = image->cache_entry && image->cache_entry->retained;
+  texture_image_cache_remove(image);
+
+  pthread_mutex_unlock(&texture_image_cache.lock);
+
+  // the image is still referenced by its caller, so this never frees it
+  if (retained) { texture_image_destroy(image); }
+}
+
+static u64 texture_image_cache_key(TextureImageCacheEntry* entry, bool content) {
+  if (!content) { return entry->path_hash; }
+
+  return entry->content_hash ^ ((u64) entry->content_size * TEXTURE_IMAGE_FNV_PRIME);
+}
+
+// called with the lock held, the table always has a free slot since it is never more than half full
+static void texture_image_cache_table_insert(TextureImageCacheEntry** table, TextureImageCacheEntry* entry, bool content) {
+  u64 mask = texture_image_cache.table_mask;
+  u64 slot = (texture_image_cache_key(entry, content) * TEXTURE_IMAGE_CACHE_MULTIPLIER) & mask;
+  while (table[slot]) { slot = (slot + 1) & mask; }
+  table[slot] = entry;
+}
+
+// called with the lock held, the entries after the freed slot move back so no probe sequence is cut short
+static void texture_image_cache_table_remove(TextureImageCacheEntry** table, TextureImageCacheEntry* entry, bool content) {
+  u64 mask = texture_image_cache.table_mask;
+  u64 slot = (texture_image_cache_key(entry, content) * TEXTURE_IMAGE_CACHE_MULTIPLIER) & mask;
+  while (table[slot] != entry) {
+    if (!table[slot]) { return; }
+    slot = (slot + 1) & mask;
+  }
+
+  table[slot] = NULL;
+  for (u64 next = (slot + 1) & mask; table[next]; next = (next + 1) & mask) {
+    u64 home = (texture_image_cache_key(table[next], content) * TEXTURE_IMAGE_CACHE_MULTIPLIER) & mask;
+
+    // an entry may only move back if its home slot is not between the freed slot and where it is now
+    bool stays = (slot <= next) ? (slot < home && home <= next) : (slot < home || home <= next);
+    if (stays) { continue; }
+
+    table[slot] = table[next];
+    table[next] = NULL;
+    slot = next;
+  }
+}
+
+// called with the lock held, doubles both tables once another entry would fill them more than half
+static bool texture_image_cache_grow() {
+  u64 size = (texture_image_cache.paths) ? texture_image_cache.table_mask + 1 : 0;
+  if ((texture_image_cache.entries_count + 1) * 2 <= size) { return true; }
+
+  u64 new_size = (size == 0) ? TEXTURE_IMAGE_CACHE_STARTING_CAPACITY : size * 2;
+  TextureImageCacheEntry** paths = (TextureImageCacheEntry**) calloc(new_size, sizeof(TextureImageCacheEntry*));
+  TextureImageCacheEntry** contents = (TextureImageCacheEntry**) calloc(new_size, sizeof(TextureImageCacheEntry*));
+  if (!paths || !contents) {
+    free(paths);
+    free(contents);
+    return false;
+  }
+
+  TextureImageCacheEntry** old_paths = texture_image_cache.paths;
+  texture_image_cache.paths = paths;
+  free(texture_image_cache.contents);
+  texture_image_cache.contents = contents;
+  texture_image_cache.table_mask = new_size - 1;
+
+  for (u64 i = 0; i < size; i++) {
+    TextureImageCacheEntry* entry = old_paths[i];
+    if (!entry) { continue; }
+
+    texture_image_cache_table_insert(paths, entry, false);
+    if (entry->content_size > 0) { texture_image_cache_table_insert(contents, entry, true); }
+  }
+
+  free(old_paths);
+  return true;
 }
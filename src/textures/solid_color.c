@@ -4,11 +4,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-#define CIMGUI_DEFINE_ENUMS_AND_STRUCTS
-#include <cimgui.h>
-#include <cimgui_impl.h>
-
-static Color get_color(Texture* texture, Vector2 uv_coordinates);
+static Color get_color(Texture* texture, Vector2 uv_coordinates, f32 uv_footprint);
+static Texture* clone(Texture* texture);
 static void destroy(Texture* texture);
 
 TextureSolidColor* texture_solid_color_create(Color color) {
@@ -18,16 +15,20 @@ TextureSolidColor* texture_solid_color_create(Color color) {
     return NULL;
   }
 
-  texture->texture = (Texture) { TEXTURE_TYPE_SOLID_COLOR, get_color, destroy };
+  texture->texture = (Texture) { TEXTURE_TYPE_SOLID_COLOR, get_color, clone, destroy };
   texture->color = color;
 
   return texture;
 }
 
-static inline Color get_color(Texture* texture, Vector2 uv_coordinates) {
+static inline Color get_color(Texture* texture, Vector2 uv_coordinates, f32 uv_footprint) {
   return texture_solid_color_get((TextureSolidColor*) texture);
 }
 
+static inline Texture* clone(Texture* texture) {
+  return (Texture*) texture_solid_color_create(((TextureSolidColor*) texture)->color);
+}
+
 static inline void destroy(Texture* texture) {
   texture_solid_color_destroy((TextureSolidColor*) texture);
 }
@@ -71,10 +72,6 @@ error:
   return NULL;
 }
 
-bool texture_solid_color_gui_edit(TextureSolidColor* solid_color) {
-  return igColorEdit3("Albedo", solid_color->color.data, 0);
-}
-
 void texture_solid_color_destroy(TextureSolidColor* solid_color) {
   free(solid_color);
 }
@@ -0,0 +1,636 @@
+#include "textures/virtual_texture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "textures/image.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "types/base_types.h"
+#include "utils/timer.h"
+
+// a lookup holds at most this many pages and releases them before reading another one, so with a slot for every
+// pool thread, the thread waiting on the pool and the pager thread nobody has to wait for a slot to be released
+#define VIRTUAL_TEXTURE_LOOKUP_PAGES 1
+#define VIRTUAL_TEXTURE_MIN_SLOTS ((THREAD_POOL_MAX_THREADS + 2) * VIRTUAL_TEXTURE_LOOKUP_PAGES)
+#define VIRTUAL_TEXTURE_REQUESTS_CAPACITY 4096
+#define VIRTUAL_TEXTURE_PATH_LENGTH 1024
+
+
+typedef struct VirtualTextureSlot {
+  VirtualTexture* owner; // NULL while free
+  u64 page;
+  atomic_uint readers;
+  atomic_bool referenced;
+  bool loading;
+} VirtualTextureSlot;
+
+typedef struct VirtualTextureRequest {
+  VirtualTexture* texture;
+  u64 page;
+} VirtualTextureRequest;
+
+// one pool of page slots shared by every virtual texture, the lock guards everything but the slot readers
+// and reference bits, which lookups touch without it
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t request_cond;
+  pthread_cond_t loaded_cond; // also signaled when a slot is released while an allocation waits for one
+  bool running;
+  VirtualTextureOptions options;
+  pthread_t thread;
+
+  u8* memory;
+  VirtualTextureSlot* slots;
+  u32 slots_count;
+  u32 resident_count;
+  u32 clock_hand;
+  atomic_uint allocations_waiting;
+
+  VirtualTextureRequest requests[VIRTUAL_TEXTURE_REQUESTS_CAPACITY];
+  usize requests_head, requests_count;
+  VirtualTexture* loading_texture; // read into by the pager thread outside the lock
+
+  atomic_ullong hits;
+  atomic_ullong misses;
+  u64 page_ins;
+  u64 evictions;
+  u64 bytes_read;
+  f64 page_in_time;
+} virtual_texture_pager = {
+  .lock = PTHREAD_MUTEX_INITIALIZER,
+  .request_cond = PTHREAD_COND_INITIALIZER,
+  .loaded_cond = PTHREAD_COND_INITIALIZER
+};
+
+// hits are counted per thread and added to the shared counter when a render slice ends, so lookups do not contend on it
+static _Thread_local u64 virtual_texture_local_hits;
+
+static void* virtual_texture_pager_work(void* data);
+static void virtual_texture_request(VirtualTexture* texture, u64 page);
+static void virtual_texture_load(VirtualTexture* texture, u64 page);
+static u32 virtual_texture_slot_allocate(VirtualTexture* texture, u64 page);
+static bool virtual_texture_slot_is_pinned(VirtualTextureSlot* slot);
+static bool virtual_texture_read(s32 file_descriptor, void* buffer, usize size, off_t offset);
+static u32 virtual_texture_page_shift_y(TextureImageFormat format);
+static u32 virtual_texture_levels(u32 width, u32 height, u32 levels_width[TEXTURE_IMAGE_MAX_LEVELS], u32 levels_height[TEXTURE_IMAGE_MAX_LEVELS]);
+
+VirtualTextureOptions virtual_texture_options_default() {
+  return (VirtualTextureOptions) {
+    .cache_directory = NULL,
+    .budget_bytes = DEFAULT_VIRTUAL_TEXTURE_BUDGET,
+    .wait = false
+  };
+}
+
+bool virtual_texture_pager_start(VirtualTextureOptions* options) {
+  if (virtual_texture_pager.running) {
+    fprintf(stderr, "[ERROR] [TEXTURE] [PAGING] The texture pager is already running!\n");
+    return false;
+  }
+
+  if (mkdir(options->cache_directory, 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "[ERROR] [TEXTURE] [PAGING] Failed to create texture cache directory %s: %s!\n", options->cache_directory, strerror(errno));
+    return false;
+  }
+
+  usize slots_count = options->budget_bytes / VIRTUAL_TEXTURE_PAGE_SIZE;
+  if (slots_count < VIRTUAL_TEXTURE_MIN_SLOTS) { slots_count = VIRTUAL_TEXTURE_MIN_SLOTS; }
+  if (slots_count > UINT32_MAX - VIRTUAL_TEXTURE_PAGE_SLOT_BASE) { slots_count = UINT32_MAX - VIRTUAL_TEXTURE_PAGE_SLOT_BASE; }
+
+  // the slots are only touched once they are first used, so a large budget costs nothing up front
+  virtual_texture_pager.memory = (u8*) malloc(slots_count * VIRTUAL_TEXTURE_PAGE_SIZE);
+  virtual_texture_pager.slots = (VirtualTextureSlot*) calloc(slots_count, sizeof(VirtualTextureSlot));
+  if (!virtual_texture_pager.memory || !virtual_texture_pager.slots) {
+    fprintf(stderr, "[ERROR] [TEXTURE] [PAGING] Failed to allocate memory for %zu texture pages!\n", slots_count);
+    goto error;
+  }
+
+  virtual_texture_pager.options = *options;
+  virtual_texture_pager.slots_count = (u32) slots_count;
+  virtual_texture_pager.resident_count = 0;
+  virtual_texture_pager.clock_hand = 0;
+  virtual_texture_pager.requests_head = 0;
+  virtual_texture_pager.requests_count = 0;
+  virtual_texture_pager.loading_texture = NULL;
+
+  virtual_texture_pager.running = true;
+  if (pthread_create(&virtual_texture_pager.thread, NULL, virtual_texture_pager_work, NULL) != 0) {
+    fprintf(stderr, "[ERROR] [TEXTURE] [PAGING] Failed to create pager thread!\n");
+    virtual_texture_pager.running = false;
+    goto error;
+  }
+
+  return true;
+
+error:
+  free(virtual_texture_pager.memory);
+  free(virtual_texture_pager.slots);
+  virtual_texture_pager.memory = NULL;
+  virtual_texture_pager.slots = NULL;
+  return false;
+}
+
+bool virtual_texture_pager_is_running() {
+  return virtual_texture_pager.running;
+}
+
+bool virtual_texture_pager_waits() {
+  return virtual_texture_pager.options.wait;
+}
+
+void virtual_texture_pager_stop() {
+  if (!virtual_texture_pager.running) { return; }
+
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+  virtual_texture_pager.running = false;
+  pthread_cond_signal(&virtual_texture_pager.request_cond);
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+  pthread_join(virtual_texture_pager.thread, NULL);
+
+  free(virtual_texture_pager.memory);
+  free(virtual_texture_pager.slots);
+  virtual_texture_pager.memory = NULL;
+  virtual_texture_pager.slots = NULL;
+  virtual_texture_pager.slots_count = 0;
+}
+
+bool virtual_texture_cache_path(char* buffer, usize buffer_size, u64 content_hash, usize content_size) {
+  s32 length = snprintf(buffer, buffer_size, "%s/%016llx-%llx" VIRTUAL_TEXTURE_EXTENSION,
+    virtual_texture_pager.options.cache_directory, (unsigned long long) content_hash, (unsigned long long) content_size);
+  return length > 0 && (usize) length < buffer_size;
+}
+
+// written next to its final path and renamed, so a concurrent decode of the same contents or a crash never
+// leaves a partial file behind under the real name
+bool virtual_texture_write(const char* path, TextureImage* image, u64 content_hash, usize content_size) {
+  TraceScope trace = trace_begin("Virtual Texture Write");
+
+  char temporary_path[VIRTUAL_TEXTURE_PATH_LENGTH];
+  s32 length = snprintf(temporary_path, sizeof(temporary_path), "%s.XXXXXX", path);
+  if (length < 0 || (usize) length >= sizeof(temporary_path)) { goto error; }
+
+  s32 file_descriptor = mkstemp(temporary_path);
+  if (file_descriptor < 0) { goto error; }
+
+  FILE* file = fdopen(file_descriptor, "wb");
+  if (!file) {
+    close(file_descriptor);
+    remove(temporary_path);
+    goto error;
+  }
+
+  u32 page_shift_y = virtual_texture_page_shift_y(image->format);
+  u32 page_tiles_x = 1u << (VIRTUAL_TEXTURE_PAGE_SHIFT_X - TEXTURE_IMAGE_TILE_SHIFT);
+  u32 page_tiles_y = 1u << (page_shift_y - TEXTURE_IMAGE_TILE_SHIFT);
+  usize tile_size = VIRTUAL_TEXTURE_PAGE_SIZE / (page_tiles_x * page_tiles_y);
+
+  u64 pages_count = 0;
+  for (u32 i = 0; i < image->levels_count; i++) {
+    u64 pages_x = ((u64) image->levels[i].width + (1u << VIRTUAL_TEXTURE_PAGE_SHIFT_X) - 1) >> VIRTUAL_TEXTURE_PAGE_SHIFT_X;
+    u64 pages_y = ((u64) image->levels[i].height + (1u << page_shift_y) - 1) >> page_shift_y;
+    pages_count += pages_x * pages_y;
+  }
+
+  u8 header_page[VIRTUAL_TEXTURE_HEADER_SIZE] = {0};
+  VirtualTextureHeader header = {
+    .version = VIRTUAL_TEXTURE_VERSION,
+    .content_hash = content_hash,
+    .content_size = content_size,
+    .format = image->format,
+    .width = image->width,
+    .height = image->height,
+    .levels_count = image->levels_count,
+    .pages_count = pages_count
+  };
+  memcpy(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic));
+  memcpy(header_page, &header, sizeof(header));
+  bool written = fwrite(header_page, 1, sizeof(header_page), file) == sizeof(header_page);
+
+  // a page is a block of the level's tiles, tiles past the level's edge are left zeroed
+  u8 page[VIRTUAL_TEXTURE_PAGE_SIZE];
+  for (u32 i = 0; written && i < image->levels_count; i++) {
+    TextureImageLevel* level = &image->levels[i];
+    u32 tiles_y = (level->height + TEXTURE_IMAGE_TILE_SIZE - 1) >> TEXTURE_IMAGE_TILE_SHIFT;
+    u32 pages_x = (level->tiles_x + page_tiles_x - 1) / page_tiles_x;
+    u32 pages_y = (tiles_y + page_tiles_y - 1) / page_tiles_y;
+
+    for (u32 page_y = 0; written && page_y < pages_y; page_y++) {
+      for (u32 page_x = 0; written && page_x < pages_x; page_x++) {
+        memset(page, 0, sizeof(page));
+        for (u32 y = 0; y < page_tiles_y; y++) {
+          for (u32 x = 0; x < page_tiles_x; x++) {
+            u32 tile_x = page_x * page_tiles_x + x, tile_y = page_y * page_tiles_y + y;
+            if (tile_x >= level->tiles_x || tile_y >= tiles_y) { continue; }
+
+            usize tile = (usize) tile_y * level->tiles_x + tile_x;
+            memcpy(&page[(y * page_tiles_x + x) * tile_size], &level->texels[tile * tile_size], tile_size);
+          }
+        }
+        written = fwrite(page, 1, sizeof(page), file) == sizeof(page);
+      }
+    }
+  }
+
+  if (fclose(file) != 0 || !written || rename(temporary_path, path) != 0) {
+    remove(temporary_path);
+    goto error;
+  }
+
+  trace_end(trace);
+  return true;
+
+error:
+  fprintf(stderr, "[ERROR] [TEXTURE] [PAGING] Failed to write texture cache %s!\n", path);
+  trace_end(trace);
+  return false;
+}
+
+VirtualTexture* virtual_texture_open(const char* path, TextureImage* image, u64 content_hash, usize content_size) {
+  s32 file_descriptor = open(path, O_RDONLY);
+  if (file_descriptor < 0) { return NULL; }
+
+  VirtualTexture* texture = NULL;
+  VirtualTextureHeader header;
+  if (!virtual_texture_read(file_descriptor, &header, sizeof(header), 0)) { goto error; }
+
+  bool valid = memcmp(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic)) == 0 && header.version == VIRTUAL_TEXTURE_VERSION &&
+    header.content_hash == content_hash && header.content_size == content_size &&
+    (header.format == TEXTURE_IMAGE_FORMAT_SRGB8 || header.format == TEXTURE_IMAGE_FORMAT_HALF) && header.width > 0 && header.height > 0;
+  if (!valid) { goto error; }
+
+  u32 levels_width[TEXTURE_IMAGE_MAX_LEVELS], levels_height[TEXTURE_IMAGE_MAX_LEVELS];
+  u32 levels_count = virtual_texture_levels(header.width, header.height, levels_width, levels_height);
+  if (levels_count != header.levels_count) { goto error; }
+
+  texture = (VirtualTexture*) calloc(1, sizeof(VirtualTexture));
+  if (!texture) { goto error; }
+
+  texture->file_descriptor = file_descriptor;
+  texture->page_shift_x = VIRTUAL_TEXTURE_PAGE_SHIFT_X;
+  texture->page_shift_y = virtual_texture_page_shift_y((TextureImageFormat) header.format);
+  texture->paged_levels_count = levels_count;
+
+  u64 pages_count = 0;
+  for (u32 i = 0; i < levels_count; i++) {
+    u32 pages_x = (levels_width[i] + (1u << texture->page_shift_x) - 1) >> texture->page_shift_x;
+    u32 pages_y = (levels_height[i] + (1u << texture->page_shift_y) - 1) >> texture->page_shift_y;
+    texture->pages_x[i] = pages_x;
+    texture->first_page[i] = pages_count;
+    pages_count += (u64) pages_x * pages_y;
+
+    if (pages_x == 1 && pages_y == 1 && texture->paged_levels_count == levels_count) { texture->paged_levels_count = i; }
+  }
+
+  // a truncated file would only show up as short reads once its pages are needed
+  struct stat file_stat;
+  if (pages_count != header.pages_count || fstat(file_descriptor, &file_stat) != 0 ||
+      (u64) file_stat.st_size != VIRTUAL_TEXTURE_HEADER_SIZE + pages_count * VIRTUAL_TEXTURE_PAGE_SIZE) {
+    goto error;
+  }
+
+  texture->page_table = (atomic_uint*) calloc(pages_count, sizeof(atomic_uint));
+  texture->pinned_size = (usize) (levels_count - texture->paged_levels_count) * VIRTUAL_TEXTURE_PAGE_SIZE;
+  texture->pinned = (u8*) malloc(texture->pinned_size);
+  if (!texture->page_table || !texture->pinned) { goto error; }
+
+  for (u32 i = texture->paged_levels_count; i < levels_count; i++) {
+    u8* destination = &texture->pinned[(usize) (i - texture->paged_levels_count) * VIRTUAL_TEXTURE_PAGE_SIZE];
+    off_t offset = (off_t) (VIRTUAL_TEXTURE_HEADER_SIZE + texture->first_page[i] * VIRTUAL_TEXTURE_PAGE_SIZE);
+    if (!virtual_texture_read(file_descriptor, destination, VIRTUAL_TEXTURE_PAGE_SIZE, offset)) { goto error; }
+  }
+
+  // every level is addressed like a page, so the pinned ones are read by the regular in memory lookups
+  image->format = (TextureImageFormat) header.format;
+  image->width = header.width;
+  image->height = header.height;
+  image->levels_count = levels_count;
+  image->pixels = texture->pinned;
+  image->pixels_size = texture->pinned_size;
+  for (u32 i = 0; i < levels_count; i++) {
+    bool pinned = (i >= texture->paged_levels_count);
+    image->levels[i] = (TextureImageLevel) {
+      .width = levels_width[i],
+      .height = levels_height[i],
+      .tiles_x = 1u << (texture->page_shift_x - TEXTURE_IMAGE_TILE_SHIFT),
+      .texels = pinned ? &texture->pinned[(usize) (i - texture->paged_levels_count) * VIRTUAL_TEXTURE_PAGE_SIZE] : NULL
+    };
+  }
+
+  return texture;
+
+error:
+  if (texture) {
+    free(texture->page_table);
+    free(texture->pinned);
+    free(texture);
+  }
+  close(file_descriptor);
+  return NULL;
+}
+
+void virtual_texture_close(VirtualTexture* texture) {
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+
+  // drops the texture's queued requests and waits for a page the pager thread is reading into it
+  usize kept = 0;
+  for (usize i = 0; i < virtual_texture_pager.requests_count; i++) {
+    VirtualTextureRequest request = virtual_texture_pager.requests[(virtual_texture_pager.requests_head + i) % VIRTUAL_TEXTURE_REQUESTS_CAPACITY];
+    if (request.texture == texture) { continue; }
+    virtual_texture_pager.requests[(virtual_texture_pager.requests_head + kept++) % VIRTUAL_TEXTURE_REQUESTS_CAPACITY] = request;
+  }
+  virtual_texture_pager.requests_count = kept;
+
+  while (virtual_texture_pager.loading_texture == texture) {
+    pthread_cond_wait(&virtual_texture_pager.loaded_cond, &virtual_texture_pager.lock);
+  }
+
+  for (u32 i = 0; i < virtual_texture_pager.slots_count; i++) {
+    VirtualTextureSlot* slot = &virtual_texture_pager.slots[i];
+    if (slot->owner != texture) { continue; }
+
+    slot->owner = NULL;
+    atomic_store_explicit(&slot->referenced, false, memory_order_relaxed);
+    virtual_texture_pager.resident_count--;
+  }
+
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+
+  close(texture->file_descriptor);
+  free(texture->page_table);
+  free(texture->pinned);
+  free(texture);
+}
+
+// a reader announces itself on the slot before checking that the page still maps to it, and eviction unmaps
+// the page before checking for readers, so one of them always sees the other
+bool virtual_texture_page_acquire(VirtualTexture* texture, u32 level, u32 page_x, u32 page_y, bool wait, VirtualTexturePage* page) {
+  u64 index = texture->first_page[level] + (u64) page_y * texture->pages_x[level] + page_x;
+  atomic_uint* entry = &texture->page_table[index];
+  wait = wait || virtual_texture_pager.options.wait;
+
+  bool missed = false;
+  while (true) {
+    u32 value = atomic_load_explicit(entry, memory_order_acquire);
+    if (value >= VIRTUAL_TEXTURE_PAGE_SLOT_BASE) {
+      u32 slot_index = value - VIRTUAL_TEXTURE_PAGE_SLOT_BASE;
+      VirtualTextureSlot* slot = &virtual_texture_pager.slots[slot_index];
+
+      atomic_fetch_add(&slot->readers, 1);
+      if (atomic_load(entry) == value) {
+        if (!atomic_load_explicit(&slot->referenced, memory_order_relaxed)) { atomic_store_explicit(&slot->referenced, true, memory_order_relaxed); }
+        if (!missed) { virtual_texture_local_hits++; }
+
+        page->texels = &virtual_texture_pager.memory[(usize) slot_index * VIRTUAL_TEXTURE_PAGE_SIZE];
+        page->slot = slot_index;
+        return true;
+      }
+
+      // evicted in between, whatever the entry says now is looked at again
+      atomic_fetch_sub(&slot->readers, 1);
+      continue;
+    }
+
+    if (!missed) {
+      atomic_fetch_add_explicit(&virtual_texture_pager.misses, 1, memory_order_relaxed);
+      missed = true;
+    }
+
+    if (value == 0) {
+      u32 expected = 0;
+      if (!atomic_compare_exchange_strong(entry, &expected, VIRTUAL_TEXTURE_PAGE_LOADING)) { continue; }
+
+      if (wait) {
+        virtual_texture_load(texture, index);
+        continue;
+      }
+
+      virtual_texture_request(texture, index);
+      return false;
+    }
+
+    // someone else is reading the page
+    if (!wait) { return false; }
+
+    pthread_mutex_lock(&virtual_texture_pager.lock);
+    while (atomic_load(entry) == VIRTUAL_TEXTURE_PAGE_LOADING) {
+      pthread_cond_wait(&virtual_texture_pager.loaded_cond, &virtual_texture_pager.lock);
+    }
+    pthread_mutex_unlock(&virtual_texture_pager.lock);
+  }
+}
+
+// sequentially consistent like the waiting count, so a waiting allocation either sees the slot free or is woken
+void virtual_texture_page_release(VirtualTexturePage* page) {
+  bool released = atomic_fetch_sub(&virtual_texture_pager.slots[page->slot].readers, 1) == 1;
+  if (!released || atomic_load(&virtual_texture_pager.allocations_waiting) == 0) { return; }
+
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+  pthread_cond_broadcast(&virtual_texture_pager.loaded_cond);
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+}
+
+void virtual_texture_flush_hits() {
+  if (virtual_texture_local_hits == 0) { return; }
+
+  atomic_fetch_add_explicit(&virtual_texture_pager.hits, virtual_texture_local_hits, memory_order_relaxed);
+  virtual_texture_local_hits = 0;
+}
+
+VirtualTextureStats virtual_texture_get_stats() {
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+
+  VirtualTextureStats stats = {
+    .hits = atomic_load(&virtual_texture_pager.hits),
+    .misses = atomic_load(&virtual_texture_pager.misses),
+    .page_ins = virtual_texture_pager.page_ins,
+    .evictions = virtual_texture_pager.evictions,
+    .bytes_read = virtual_texture_pager.bytes_read,
+    .page_in_time = virtual_texture_pager.page_in_time,
+    .resident_bytes = (usize) virtual_texture_pager.resident_count * VIRTUAL_TEXTURE_PAGE_SIZE,
+    .budget_bytes = (usize) virtual_texture_pager.slots_count * VIRTUAL_TEXTURE_PAGE_SIZE
+  };
+
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+  return stats;
+}
+
+void virtual_texture_print_stats() {
+  VirtualTextureStats stats = virtual_texture_get_stats();
+  u64 lookups = stats.hits + stats.misses;
+  printf("[INFO] [TEXTURE] [PAGING] %llu page hits and %llu misses (%.2f%% hits), %llu page-ins reading %.2f MiB in %.3fs, %llu evictions, %.2f of %.2f MiB resident\n",
+    (unsigned long long) stats.hits, (unsigned long long) stats.misses, (lookups > 0) ? (100.0 * stats.hits / lookups) : 0.0,
+    (unsigned long long) stats.page_ins, stats.bytes_read / (1024.0 * 1024.0), stats.page_in_time, (unsigned long long) stats.evictions,
+    stats.resident_bytes / (1024.0 * 1024.0), stats.budget_bytes / (1024.0 * 1024.0));
+}
+
+static void* virtual_texture_pager_work(void* data) {
+  trace_set_thread_name("Texture Pager");
+
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+  while (true) {
+    while (virtual_texture_pager.running && virtual_texture_pager.requests_count == 0) {
+      pthread_cond_wait(&virtual_texture_pager.request_cond, &virtual_texture_pager.lock);
+    }
+    if (!virtual_texture_pager.running) { break; }
+
+    VirtualTextureRequest request = virtual_texture_pager.requests[virtual_texture_pager.requests_head];
+    virtual_texture_pager.requests_head = (virtual_texture_pager.requests_head + 1) % VIRTUAL_TEXTURE_REQUESTS_CAPACITY;
+    virtual_texture_pager.requests_count--;
+    virtual_texture_pager.loading_texture = request.texture;
+    pthread_mutex_unlock(&virtual_texture_pager.lock);
+
+    virtual_texture_load(request.texture, request.page);
+
+    pthread_mutex_lock(&virtual_texture_pager.lock);
+    virtual_texture_pager.loading_texture = NULL;
+    pthread_cond_broadcast(&virtual_texture_pager.loaded_cond);
+  }
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+
+  return NULL;
+}
+
+// the caller claimed the page by marking it loading, a full queue gives the claim back so a later lookup retries
+static void virtual_texture_request(VirtualTexture* texture, u64 page) {
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+
+  if (virtual_texture_pager.requests_count == VIRTUAL_TEXTURE_REQUESTS_CAPACITY) {
+    atomic_store(&texture->page_table[page], 0);
+    pthread_cond_broadcast(&virtual_texture_pager.loaded_cond);
+  } else {
+    usize tail = (virtual_texture_pager.requests_head + virtual_texture_pager.requests_count) % VIRTUAL_TEXTURE_REQUESTS_CAPACITY;
+    virtual_texture_pager.requests[tail] = (VirtualTextureRequest) { texture, page };
+    virtual_texture_pager.requests_count++;
+    pthread_cond_signal(&virtual_texture_pager.request_cond);
+  }
+
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+}
+
+// a page that cannot be read in full is published zeroed, so lookups never wait on it forever
+static void virtual_texture_load(VirtualTexture* texture, u64 page) {
+  TraceScope trace = trace_begin("Texture Page In");
+  f64 start_time = timer_get_seconds();
+
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+  u32 slot_index = virtual_texture_slot_allocate(texture, page);
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+
+  u8* destination = &virtual_texture_pager.memory[(usize) slot_index * VIRTUAL_TEXTURE_PAGE_SIZE];
+  off_t offset = (off_t) (VIRTUAL_TEXTURE_HEADER_SIZE + page * VIRTUAL_TEXTURE_PAGE_SIZE);
+  bool read = virtual_texture_read(texture->file_descriptor, destination, VIRTUAL_TEXTURE_PAGE_SIZE, offset);
+  if (!read) {
+    fprintf(stderr, "[ERROR] [TEXTURE] [PAGING] Failed to read texture page %llu!\n", (unsigned long long) page);
+    memset(destination, 0, VIRTUAL_TEXTURE_PAGE_SIZE);
+  }
+
+  pthread_mutex_lock(&virtual_texture_pager.lock);
+  virtual_texture_pager.slots[slot_index].loading = false;
+  virtual_texture_pager.page_ins++;
+  virtual_texture_pager.bytes_read += read ? VIRTUAL_TEXTURE_PAGE_SIZE : 0;
+  virtual_texture_pager.page_in_time += timer_get_seconds() - start_time;
+  atomic_store_explicit(&texture->page_table[page], slot_index + VIRTUAL_TEXTURE_PAGE_SLOT_BASE, memory_order_release);
+  pthread_cond_broadcast(&virtual_texture_pager.loaded_cond);
+  pthread_mutex_unlock(&virtual_texture_pager.lock);
+
+  trace_end(trace);
+}
+
+// a clock sweep as an approximation of least recently used, a page used since the hand last passed it gets a
+// second chance, called with the lock held, waits when a whole sweep found every slot read or loaded
+static u32 virtual_texture_slot_allocate(VirtualTexture* texture, u64 page) {
+  u32 pinned_count = 0;
+  while (true) {
+    if (pinned_count >= virtual_texture_pager.slots_count) {
+      atomic_fetch_add(&virtual_texture_pager.allocations_waiting, 1);
+
+      // a slot released after the sweep passed it is either seen here or its release wakes the wait
+      bool released = false;
+      for (u32 i = 0; i < virtual_texture_pager.slots_count && !released; i++) {
+        released = !virtual_texture_slot_is_pinned(&virtual_texture_pager.slots[i]);
+      }
+      if (!released) { pthread_cond_wait(&virtual_texture_pager.loaded_cond, &virtual_texture_pager.lock); }
+
+      atomic_fetch_sub(&virtual_texture_pager.allocations_waiting, 1);
+      pinned_count = 0;
+    }
+
+    u32 slot_index = virtual_texture_pager.clock_hand;
+    VirtualTextureSlot* slot = &virtual_texture_pager.slots[slot_index];
+    virtual_texture_pager.clock_hand = (slot_index + 1) % virtual_texture_pager.slots_count;
+
+    if (virtual_texture_slot_is_pinned(slot)) {
+      pinned_count++;
+      continue;
+    }
+    if (slot->owner) {
+      if (atomic_exchange_explicit(&slot->referenced, false, memory_order_relaxed)) { continue; }
+
+      // readers that got in before the page was unmapped finish their lookup, later ones see it gone
+      atomic_store(&slot->owner->page_table[slot->page], 0);
+      while (atomic_load(&slot->readers) > 0) { sched_yield(); }
+
+      virtual_texture_pager.evictions++;
+      virtual_texture_pager.resident_count--;
+    }
+
+    slot->owner = texture;
+    slot->page = page;
+    slot->loading = true;
+    atomic_store_explicit(&slot->referenced, true, memory_order_relaxed);
+    virtual_texture_pager.resident_count++;
+    return slot_index;
+  }
+}
+
+// called with the lock held
+static bool virtual_texture_slot_is_pinned(VirtualTextureSlot* slot) {
+  return slot->loading || (slot->owner && atomic_load(&slot->readers) > 0);
+}
+
+// pread may return less than asked for, only reaching the end of the file or an error is a failure
+static bool virtual_texture_read(s32 file_descriptor, void* buffer, usize size, off_t offset) {
+  u8* bytes = (u8*) buffer;
+  while (size > 0) {
+    ssize_t bytes_read = pread(file_descriptor, bytes, size, offset);
+    if (bytes_read < 0 && errno == EINTR) { continue; }
+    if (bytes_read <= 0) { return false; }
+
+    bytes += bytes_read;
+    size -= bytes_read;
+    offset += bytes_read;
+  }
+
+  return true;
+}
+
+// both page shapes hold 16 KiB of texels
+static inline u32 virtual_texture_page_shift_y(TextureImageFormat format) {
+  return (format == TEXTURE_IMAGE_FORMAT_SRGB8) ? VIRTUAL_TEXTURE_PAGE_SHIFT_Y_SRGB8 : VIRTUAL_TEXTURE_PAGE_SHIFT_Y_HALF;
+}
+
+// the same pyramid texture_image_build_levels creates, halving down to 1x1
+static u32 virtual_texture_levels(u32 width, u32 height, u32 levels_width[TEXTURE_IMAGE_MAX_LEVELS], u32 levels_height[TEXTURE_IMAGE_MAX_LEVELS]) {
+  u32 levels_count = 0;
+  while (levels_count < TEXTURE_IMAGE_MAX_LEVELS) {
+    levels_width[levels_count] = width;
+    levels_height[levels_count] = height;
+    levels_count++;
+
+    if (width == 1 && height == 1) { break; }
+    width = (width > 1) ? (width / 2) : 1;
+    height = (height > 1) ? (height / 2) : 1;
+  }
+
+  return levels_count;
+}
@@ -0,0 +1,244 @@
+#include "thread_pool.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "types/base_types.h"
+
+// a pthread_once_t cannot be reset, so the pool is created under a lock and destroying it only clears the flag
+static ThreadPool* global_pool = NULL;
+static bool global_pool_created = false;
+static pthread_mutex_t global_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t global_pool_atfork_once = PTHREAD_ONCE_INIT;
+
+static void* thread_pool_work(void* pool_pointer);
+static bool thread_pool_pop(ThreadPool* pool, ThreadPoolJob* job);
+static void thread_pool_finish(ThreadPool* pool, ThreadPoolJob* job);
+static void global_pool_create();
+static void global_pool_register_atfork();
+static void global_pool_lock_before_fork();
+static void global_pool_unlock_after_fork();
+static void global_pool_forget();
+
+ThreadPool* thread_pool_create(u32 thread_count) {
+  if (thread_count == 0) { thread_count = 1; }
+  if (thread_count > THREAD_POOL_MAX_THREADS) { thread_count = THREAD_POOL_MAX_THREADS; }
+
+  ThreadPool* pool = (ThreadPool*) malloc(sizeof(ThreadPool));
+  if (!pool) {
+    fprintf(stderr, "[ERROR] [THREAD POOL] Failed to allocate memory for thread pool!\n");
+    return NULL;
+  }
+
+  pool->jobs_capacity = THREAD_POOL_STARTING_CAPACITY;
+  pool->jobs = (ThreadPoolJob*) malloc(sizeof(ThreadPoolJob) * pool->jobs_capacity);
+  if (!pool->jobs) {
+    fprintf(stderr, "[ERROR] [THREAD POOL] Failed to allocate memory for job queue!\n");
+    free(pool);
+    return NULL;
+  }
+  pool->jobs_head = 0;
+  pool->jobs_count = 0;
+
+  pool->alive = true;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  pool->thread_count = 0;
+  for (u32 i = 0; i < thread_count; i++) {
+    if (pthread_create(&pool->threads[i], NULL, thread_pool_work, pool) != 0) {
+      fprintf(stderr, "[ERROR] [THREAD POOL] Failed to create thread %u!\n", i);
+      break;
+    }
+    pool->thread_count++;
+  }
+
+  if (pool->thread_count == 0) {
+    thread_pool_destroy(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+ThreadPool* thread_pool_get_global() {
+  pthread_once(&global_pool_atfork_once, global_pool_register_atfork);
+
+  pthread_mutex_lock(&global_pool_lock);
+  if (!global_pool_created) {
+    global_pool_create();
+    global_pool_created = true;
+  }
+  ThreadPool* pool = global_pool;
+  pthread_mutex_unlock(&global_pool_lock);
+
+  return pool;
+}
+
+void thread_pool_submit(ThreadPool* pool, ThreadPoolGroup* group, ThreadPoolJobFunction function, void* data, usize index) {
+  pthread_mutex_lock(&pool->lock);
+
+  if (pool->jobs_count == pool->jobs_capacity) {
+    usize new_capacity = pool->jobs_capacity * THREAD_POOL_SCALE_FACTOR;
+    ThreadPoolJob* temp = (ThreadPoolJob*) malloc(sizeof(ThreadPoolJob) * new_capacity);
+    if (!temp) {
+      // run it here rather than dropping it, waiting on the group still works
+      pthread_mutex_unlock(&pool->lock);
+      fprintf(stderr, "[ERROR] [THREAD POOL] Failed to grow job queue, running job on the calling thread!\n");
+      function(data, index);
+      return;
+    }
+
+    for (usize i = 0; i < pool->jobs_count; i++) {
+      temp[i] = pool->jobs[(pool->jobs_head + i) % pool->jobs_capacity];
+    }
+
+    free(pool->jobs);
+    pool->jobs = temp;
+    pool->jobs_head = 0;
+    pool->jobs_capacity = new_capacity;
+  }
+
+  pool->jobs[(pool->jobs_head + pool->jobs_count) % pool->jobs_capacity] = (ThreadPoolJob) { function, data, index, group };
+  pool->jobs_count++;
+  if (group) { group->pending++; }
+
+  pthread_cond_signal(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+// the waiting thread runs queued jobs itself, so waiting from inside a job cannot deadlock the pool
+void thread_pool_wait(ThreadPool* pool, ThreadPoolGroup* group) {
+  TraceScope trace = trace_begin("Pool Wait");
+
+  pthread_mutex_lock(&pool->lock);
+  while (group->pending > 0) {
+    ThreadPoolJob job;
+    if (thread_pool_pop(pool, &job)) {
+      pthread_mutex_unlock(&pool->lock);
+      job.function(job.data, job.index);
+      pthread_mutex_lock(&pool->lock);
+      thread_pool_finish(pool, &job);
+      continue;
+    }
+
+    pthread_cond_wait(&pool->done_cond, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  trace_end(trace);
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, usize count, ThreadPoolJobFunction function, void* data) {
+  ThreadPoolGroup group = {0};
+  for (usize i = 0; i < count; i++) {
+    thread_pool_submit(pool, &group, function, data, i);
+  }
+  thread_pool_wait(pool, &group);
+}
+
+static void* thread_pool_work(void* pool_pointer) {
+  ThreadPool* pool = (ThreadPool*) pool_pointer;
+  trace_set_thread_name("Pool Worker");
+
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    ThreadPoolJob job;
+    if (thread_pool_pop(pool, &job)) {
+      pthread_mutex_unlock(&pool->lock);
+      job.function(job.data, job.index);
+      pthread_mutex_lock(&pool->lock);
+      thread_pool_finish(pool, &job);
+      continue;
+    }
+
+    if (!pool->alive) { break; }
+
+    pthread_cond_wait(&pool->work_cond, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+// both helpers expect the pool lock to be held
+static bool thread_pool_pop(ThreadPool* pool, ThreadPoolJob* job) {
+  if (pool->jobs_count == 0) { return false; }
+
+  *job = pool->jobs[pool->jobs_head];
+  pool->jobs_head = (pool->jobs_head + 1) % pool->jobs_capacity;
+  pool->jobs_count--;
+
+  return true;
+}
+
+static void thread_pool_finish(ThreadPool* pool, ThreadPoolJob* job) {
+  if (!job->group) { return; }
+
+  job->group->pending--;
+  if (job->group->pending == 0) {
+    pthread_cond_broadcast(&pool->done_cond);
+  }
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->alive = false;
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (u32 i = 0; i < pool->thread_count; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_cond_destroy(&pool->done_cond);
+
+  free(pool->jobs);
+  free(pool);
+}
+
+void thread_pool_global_destroy() {
+  pthread_mutex_lock(&global_pool_lock);
+  ThreadPool* pool = global_pool;
+  global_pool = NULL;
+  global_pool_created = false;
+  pthread_mutex_unlock(&global_pool_lock);
+
+  if (pool) { thread_pool_destroy(pool); }
+}
+
+// more threads than cores only adds switching, the render slices queue up as jobs either way
+static void global_pool_create() {
+  long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (core_count < 1) { core_count = 1; }
+
+  global_pool = thread_pool_create((core_count < THREAD_POOL_MAX_THREADS) ? (u32) core_count : THREAD_POOL_MAX_THREADS);
+}
+
+static void global_pool_register_atfork() {
+  pthread_atfork(global_pool_lock_before_fork, global_pool_unlock_after_fork, global_pool_forget);
+}
+
+// held across fork, so the child never inherits the lock from a thread that does not exist there
+static void global_pool_lock_before_fork() {
+  pthread_mutex_lock(&global_pool_lock);
+}
+
+static void global_pool_unlock_after_fork() {
+  pthread_mutex_unlock(&global_pool_lock);
+}
+
+// only the forking thread survives in a child process, so the child has to start its own pool
+static void global_pool_forget() {
+  global_pool = NULL;
+  global_pool_created = false;
+  pthread_mutex_unlock(&global_pool_lock);
+}
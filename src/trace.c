@@ -0,0 +1,142 @@
+#include "trace.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "types/base_types.h"
+#include "utils/timer.h"
+
+static atomic_bool recording = false;
+static f64 recording_start = 0.0;
+
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer* buffers[TRACE_MAX_THREADS];
+static u32 buffers_count = 0;
+
+static _Thread_local TraceBuffer* thread_buffer = NULL;
+static _Thread_local const char* thread_name = "Thread";
+
+static TraceBuffer* trace_thread_buffer();
+
+void trace_start() {
+  pthread_mutex_lock(&buffers_lock);
+  for (u32 i = 0; i < buffers_count; i++) {
+    buffers[i]->written = 0;
+  }
+  recording_start = timer_get_seconds();
+  pthread_mutex_unlock(&buffers_lock);
+
+  atomic_store(&recording, true);
+}
+
+void trace_stop() {
+  atomic_store(&recording, false);
+}
+
+bool trace_is_recording() {
+  return atomic_load_explicit(&recording, memory_order_relaxed);
+}
+
+// when not recording this is a single relaxed load, so scopes can stay in the code permanently
+inline TraceScope trace_begin(const char* name) {
+  if (!atomic_load_explicit(&recording, memory_order_relaxed)) { return (TraceScope) {0}; }
+  return (TraceScope) { name, timer_get_seconds() };
+}
+
+void trace_end(TraceScope scope) {
+  if (!scope.name) { return; }
+
+  f64 end = timer_get_seconds();
+  TraceBuffer* buffer = trace_thread_buffer();
+  if (!buffer) { return; }
+
+  buffer->events[buffer->written % TRACE_BUFFER_CAPACITY] = (TraceEvent) { scope.name, scope.start, end - scope.start };
+  buffer->written++;
+}
+
+void trace_set_thread_name(const char* name) {
+  thread_name = name;
+  if (thread_buffer) { thread_buffer->thread_name = name; }
+}
+
+// buffers are created on a thread's first event and kept until trace_destroy, so events outlive the thread
+static TraceBuffer* trace_thread_buffer() {
+  if (thread_buffer) { return thread_buffer; }
+
+  pthread_mutex_lock(&buffers_lock);
+  if (buffers_count == TRACE_MAX_THREADS) {
+    pthread_mutex_unlock(&buffers_lock);
+    return NULL;
+  }
+
+  TraceBuffer* buffer = (TraceBuffer*) malloc(sizeof(TraceBuffer));
+  if (!buffer) {
+    pthread_mutex_unlock(&buffers_lock);
+    fprintf(stderr, "[ERROR] [TRACE] Failed to allocate memory for trace buffer!\n");
+    return NULL;
+  }
+
+  buffer->written = 0;
+  buffer->thread_id = buffers_count;
+  buffer->thread_name = thread_name;
+  buffers[buffers_count++] = buffer;
+  pthread_mutex_unlock(&buffers_lock);
+
+  thread_buffer = buffer;
+  return buffer;
+}
+
+// chrome trace event format, timestamps in microseconds since trace_start, which perfetto opens as well
+bool trace_write(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "[ERROR] [TRACE] Failed to open file: %s!\n", path);
+    return false;
+  }
+
+  s32 pid = getpid();
+  bool first = true;
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+  pthread_mutex_lock(&buffers_lock);
+  for (u32 i = 0; i < buffers_count; i++) {
+    TraceBuffer* buffer = buffers[i];
+
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", (first ? "" : ","), pid, buffer->thread_id, buffer->thread_name);
+    first = false;
+
+    u64 oldest = (buffer->written > TRACE_BUFFER_CAPACITY) ? (buffer->written - TRACE_BUFFER_CAPACITY) : 0;
+    for (u64 j = oldest; j < buffer->written; j++) {
+      TraceEvent* event = &buffer->events[j % TRACE_BUFFER_CAPACITY];
+      fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}", event->name, (event->start - recording_start) * 1e6, event->duration * 1e6, pid, buffer->thread_id);
+    }
+  }
+  pthread_mutex_unlock(&buffers_lock);
+
+  fprintf(file, "\n]}\n");
+
+  if (fclose(file) != 0) {
+    fprintf(stderr, "[ERROR] [TRACE] Failed to write file: %s!\n", path);
+    return false;
+  }
+
+  return true;
+}
+
+void trace_destroy() {
+  atomic_store(&recording, false);
+
+  pthread_mutex_lock(&buffers_lock);
+  for (u32 i = 0; i < buffers_count; i++) {
+    free(buffers[i]);
+  }
+  buffers_count = 0;
+  pthread_mutex_unlock(&buffers_lock);
+
+  thread_buffer = NULL;
+}
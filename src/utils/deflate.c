@@ -0,0 +1,513 @@
+#include "utils/deflate.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types/base_types.h"
+
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_MIN_MATCH 4
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_BLOCK_TOKENS 16384
+#define DEFLATE_MAX_STORED 65535
+
+#define DEFLATE_LITERAL_CODES 286
+#define DEFLATE_DISTANCE_CODES 30
+#define DEFLATE_LENGTH_CODES 19
+#define DEFLATE_END_OF_BLOCK 256
+#define DEFLATE_MAX_CODE_LENGTH 15
+#define DEFLATE_MAX_LENGTH_CODE_LENGTH 7
+
+#define DEFLATE_MATCH_FLAG 0x80000000u
+#define DEFLATE_ADLER32_MODULUS 65521u
+#define DEFLATE_ADLER32_MAX_RUN 5552
+
+// bits go out least significant first, whole 32 bit words are flushed at a time
+typedef struct DeflateWriter {
+  u8* output;
+  usize size;
+  u64 bits;
+  u32 bit_count;
+} DeflateWriter;
+
+// a token is a literal byte or a match flag with the length in bits 16 to 24 and the distance minus one below
+typedef struct DeflateState {
+  u32 head[1 << DEFLATE_HASH_BITS];
+  u32 tokens[DEFLATE_BLOCK_TOKENS];
+  u32 tokens_count;
+} DeflateState;
+
+typedef struct DeflateSymbol {
+  u32 frequency;
+  u32 symbol;
+} DeflateSymbol;
+
+static const u8 deflate_length_code_order[DEFLATE_LENGTH_CODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+static u32 deflate_crc32_table[256];
+static pthread_once_t deflate_crc32_table_once = PTHREAD_ONCE_INIT;
+
+static void deflate_write_block(DeflateWriter* writer, DeflateState* state, const u8* data, usize size, bool final);
+static void deflate_write_stored(DeflateWriter* writer, const u8* data, usize size, bool final);
+static u32 deflate_encode_lengths(const u8* lengths, u32 count, u16* symbols, u32* frequencies);
+static void deflate_build_lengths(const u32* frequencies, u32 count, u32 limit, u8* lengths);
+static void deflate_build_codes(const u8* lengths, u32 count, u16* codes);
+static u32 deflate_length_symbol(u32 length, u32* extra_bits, u32* extra_value);
+static u32 deflate_distance_symbol(u32 distance, u32* extra_bits, u32* extra_value);
+static void deflate_put_bits(DeflateWriter* writer, u32 value, u32 count);
+static void deflate_align(DeflateWriter* writer);
+static u32 deflate_hash(const u8* data);
+static usize deflate_match_length(const u8* a, const u8* b, usize max_length);
+static void deflate_crc32_table_create();
+static int deflate_symbol_compare(const void* a, const void* b);
+
+usize deflate_bound(usize size) {
+  return size + (size / DEFLATE_MAX_STORED + 2) * 5 + (size / DEFLATE_BLOCK_TOKENS + 1) * 8 + 16;
+}
+
+// greedy matching against the last position with the same 4 byte hash, which is what makes it fast,
+// every block then gets its own huffman codes or is stored when that comes out smaller
+usize deflate_compress(const u8* data, usize size, bool final, u8* output) {
+  DeflateState* state = (DeflateState*) malloc(sizeof(DeflateState));
+  if (!state) { return 0; }
+
+  memset(state->head, 0, sizeof(state->head));
+  state->tokens_count = 0;
+
+  DeflateWriter writer = { output, 0, 0, 0 };
+  usize block_start = 0;
+  usize i = 0;
+  while (i + DEFLATE_MIN_MATCH <= size) {
+    u32 hash = deflate_hash(&data[i]);
+    u32 candidate = state->head[hash];
+    state->head[hash] = (u32) i + 1;
+
+    usize length = 0;
+    if (candidate > 0 && i - (candidate - 1) <= DEFLATE_WINDOW_SIZE) {
+      usize max_length = (size - i < DEFLATE_MAX_MATCH) ? size - i : DEFLATE_MAX_MATCH;
+      length = deflate_match_length(&data[candidate - 1], &data[i], max_length);
+    }
+
+    if (length >= DEFLATE_MIN_MATCH) {
+      state->tokens[state->tokens_count++] = DEFLATE_MATCH_FLAG | ((u32) length << 16) | (u32) (i - candidate);
+      for (usize j = i + 1; j < i + length && j + DEFLATE_MIN_MATCH <= size; j++) {
+        state->head[deflate_hash(&data[j])] = (u32) j + 1;
+      }
+      i += length;
+    } else {
+      state->tokens[state->tokens_count++] = data[i];
+      i++;
+    }
+
+    if (state->tokens_count == DEFLATE_BLOCK_TOKENS) {
+      deflate_write_block(&writer, state, &data[block_start], i - block_start, false);
+      block_start = i;
+    }
+  }
+
+  for (; i < size; i++) {
+    state->tokens[state->tokens_count++] = data[i];
+    if (state->tokens_count == DEFLATE_BLOCK_TOKENS) {
+      deflate_write_block(&writer, state, &data[block_start], i + 1 - block_start, false);
+      block_start = i + 1;
+    }
+  }
+
+  // a final segment always needs a last block, even an empty one
+  if (state->tokens_count > 0 || final) {
+    deflate_write_block(&writer, state, &data[block_start], size - block_start, final);
+  }
+
+  if (!final) { deflate_write_stored(&writer, NULL, 0, false); }
+  deflate_align(&writer);
+
+  free(state);
+  return writer.size;
+}
+
+u32 deflate_adler32(u32 adler, const u8* data, usize size) {
+  u32 a = adler & 0xffff;
+  u32 b = adler >> 16;
+
+  while (size > 0) {
+    usize run = (size < DEFLATE_ADLER32_MAX_RUN) ? size : DEFLATE_ADLER32_MAX_RUN;
+    size -= run;
+    for (usize i = 0; i < run; i++) {
+      a += data[i];
+      b += a;
+    }
+    data += run;
+    a %= DEFLATE_ADLER32_MODULUS;
+    b %= DEFLATE_ADLER32_MODULUS;
+  }
+
+  return (b << 16) | a;
+}
+
+// the checksum of two pieces joined, from the checksum of each and the length of the second
+u32 deflate_adler32_combine(u32 first, u32 second, usize second_size) {
+  u32 modulus = DEFLATE_ADLER32_MODULUS;
+  u32 remainder = (u32) (second_size % modulus);
+
+  u32 a = first & 0xffff;
+  u32 b = (u32) (((u64) remainder * a) % modulus);
+  a += (second & 0xffff) + modulus - 1;
+  b += (first >> 16) + (second >> 16) + modulus - remainder;
+
+  if (a >= modulus) { a -= modulus; }
+  if (a >= modulus) { a -= modulus; }
+  if (b >= (modulus << 1)) { b -= (modulus << 1); }
+  if (b >= modulus) { b -= modulus; }
+
+  return (b << 16) | a;
+}
+
+u32 deflate_crc32(u32 crc, const u8* data, usize size) {
+  pthread_once(&deflate_crc32_table_once, deflate_crc32_table_create);
+
+  crc = ~crc;
+  for (usize i = 0; i < size; i++) {
+    crc = deflate_crc32_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+
+  return ~crc;
+}
+
+static void deflate_write_block(DeflateWriter* writer, DeflateState* state, const u8* data, usize size, bool final) {
+  u32 literal_frequencies[DEFLATE_LITERAL_CODES] = {0};
+  u32 distance_frequencies[DEFLATE_DISTANCE_CODES] = {0};
+  u64 extra_bits_total = 0;
+
+  for (u32 i = 0; i < state->tokens_count; i++) {
+    u32 token = state->tokens[i];
+    if (!(token & DEFLATE_MATCH_FLAG)) {
+      literal_frequencies[token]++;
+      continue;
+    }
+
+    u32 extra_bits, extra_value;
+    literal_frequencies[deflate_length_symbol((token >> 16) & 0x1ff, &extra_bits, &extra_value)]++;
+    extra_bits_total += extra_bits;
+    distance_frequencies[deflate_distance_symbol((token & 0xffff) + 1, &extra_bits, &extra_value)]++;
+    extra_bits_total += extra_bits;
+  }
+  literal_frequencies[DEFLATE_END_OF_BLOCK]++;
+
+  u8 literal_lengths[DEFLATE_LITERAL_CODES];
+  u8 distance_lengths[DEFLATE_DISTANCE_CODES];
+  deflate_build_lengths(literal_frequencies, DEFLATE_LITERAL_CODES, DEFLATE_MAX_CODE_LENGTH, literal_lengths);
+  deflate_build_lengths(distance_frequencies, DEFLATE_DISTANCE_CODES, DEFLATE_MAX_CODE_LENGTH, distance_lengths);
+
+  u32 literal_count = DEFLATE_LITERAL_CODES;
+  while (literal_count > 257 && literal_lengths[literal_count - 1] == 0) { literal_count--; }
+  u32 distance_count = DEFLATE_DISTANCE_CODES;
+  while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) { distance_count--; }
+
+  // both code length lists are run length encoded as one, so the distance lengths follow the used literals
+  u8 lengths_combined[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES];
+  memcpy(lengths_combined, literal_lengths, literal_count);
+  memcpy(&lengths_combined[literal_count], distance_lengths, distance_count);
+
+  u16 length_symbols[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES];
+  u32 length_frequencies[DEFLATE_LENGTH_CODES] = {0};
+  u32 length_symbols_count = deflate_encode_lengths(lengths_combined, literal_count + distance_count, length_symbols, length_frequencies);
+
+  u8 length_lengths[DEFLATE_LENGTH_CODES];
+  deflate_build_lengths(length_frequencies, DEFLATE_LENGTH_CODES, DEFLATE_MAX_LENGTH_CODE_LENGTH, length_lengths);
+
+  u32 length_count = DEFLATE_LENGTH_CODES;
+  while (length_count > 4 && length_lengths[deflate_length_code_order[length_count - 1]] == 0) { length_count--; }
+
+  u64 dynamic_bits = 3 + 5 + 5 + 4 + 3 * length_count + extra_bits_total;
+  for (u32 i = 0; i < DEFLATE_LENGTH_CODES; i++) { dynamic_bits += (u64) length_frequencies[i] * length_lengths[i]; }
+  for (u32 i = 0; i < length_symbols_count; i++) {
+    u32 symbol = length_symbols[i] & 0xff;
+    dynamic_bits += (symbol == 16) ? 2 : (symbol == 17) ? 3 : (symbol == 18) ? 7 : 0;
+  }
+  for (u32 i = 0; i < DEFLATE_LITERAL_CODES; i++) { dynamic_bits += (u64) literal_frequencies[i] * literal_lengths[i]; }
+  for (u32 i = 0; i < DEFLATE_DISTANCE_CODES; i++) { dynamic_bits += (u64) distance_frequencies[i] * distance_lengths[i]; }
+
+  u64 stored_bits = (size / DEFLATE_MAX_STORED + 1) * 40 + 7 + (u64) size * 8;
+  if (stored_bits <= dynamic_bits) {
+    deflate_write_stored(writer, data, size, final);
+    state->tokens_count = 0;
+    return;
+  }
+
+  u16 literal_codes[DEFLATE_LITERAL_CODES];
+  u16 distance_codes[DEFLATE_DISTANCE_CODES];
+  u16 length_codes[DEFLATE_LENGTH_CODES];
+  deflate_build_codes(literal_lengths, DEFLATE_LITERAL_CODES, literal_codes);
+  deflate_build_codes(distance_lengths, DEFLATE_DISTANCE_CODES, distance_codes);
+  deflate_build_codes(length_lengths, DEFLATE_LENGTH_CODES, length_codes);
+
+  deflate_put_bits(writer, final ? 1 : 0, 1);
+  deflate_put_bits(writer, 2, 2);
+  deflate_put_bits(writer, literal_count - 257, 5);
+  deflate_put_bits(writer, distance_count - 1, 5);
+  deflate_put_bits(writer, length_count - 4, 4);
+  for (u32 i = 0; i < length_count; i++) {
+    deflate_put_bits(writer, length_lengths[deflate_length_code_order[i]], 3);
+  }
+
+  for (u32 i = 0; i < length_symbols_count; i++) {
+    u32 symbol = length_symbols[i] & 0xff;
+    u32 extra = length_symbols[i] >> 8;
+    deflate_put_bits(writer, length_codes[symbol], length_lengths[symbol]);
+    if (symbol == 16) { deflate_put_bits(writer, extra, 2); }
+    if (symbol == 17) { deflate_put_bits(writer, extra, 3); }
+    if (symbol == 18) { deflate_put_bits(writer, extra, 7); }
+  }
+
+  for (u32 i = 0; i < state->tokens_count; i++) {
+    u32 token = state->tokens[i];
+    if (!(token & DEFLATE_MATCH_FLAG)) {
+      deflate_put_bits(writer, literal_codes[token], literal_lengths[token]);
+      continue;
+    }
+
+    u32 extra_bits, extra_value;
+    u32 symbol = deflate_length_symbol((token >> 16) & 0x1ff, &extra_bits, &extra_value);
+    deflate_put_bits(writer, literal_codes[symbol], literal_lengths[symbol]);
+    deflate_put_bits(writer, extra_value, extra_bits);
+
+    symbol = deflate_distance_symbol((token & 0xffff) + 1, &extra_bits, &extra_value);
+    deflate_put_bits(writer, distance_codes[symbol], distance_lengths[symbol]);
+    deflate_put_bits(writer, extra_value, extra_bits);
+  }
+
+  deflate_put_bits(writer, literal_codes[DEFLATE_END_OF_BLOCK], literal_lengths[DEFLATE_END_OF_BLOCK]);
+  state->tokens_count = 0;
+}
+
+// an empty non final stored block is the sync marker that ends a segment
+static void deflate_write_stored(DeflateWriter* writer, const u8* data, usize size, bool final) {
+  do {
+    usize length = (size < DEFLATE_MAX_STORED) ? size : DEFLATE_MAX_STORED;
+    size -= length;
+
+    deflate_put_bits(writer, (final && size == 0) ? 1 : 0, 1);
+    deflate_put_bits(writer, 0, 2);
+    deflate_align(writer);
+    deflate_put_bits(writer, (u32) length, 16);
+    deflate_put_bits(writer, (u32) length ^ 0xffff, 16);
+    deflate_align(writer);
+
+    if (length > 0) { memcpy(&writer->output[writer->size], data, length); }
+    writer->size += length;
+    data += length;
+  } while (size > 0);
+}
+
+// code lengths as symbols 0 to 18, with the repeat count of 16, 17 and 18 in the high byte
+static u32 deflate_encode_lengths(const u8* lengths, u32 count, u16* symbols, u32* frequencies) {
+  u32 symbols_count = 0;
+  u32 i = 0;
+  while (i < count) {
+    u8 length = lengths[i];
+    u32 run = 1;
+    while (i + run < count && lengths[i + run] == length) { run++; }
+    i += run;
+
+    if (length == 0) {
+      while (run >= 11) {
+        u32 repeat = (run < 138) ? run : 138;
+        symbols[symbols_count++] = (u16) (18 | ((repeat - 11) << 8));
+        run -= repeat;
+      }
+      if (run >= 3) {
+        symbols[symbols_count++] = (u16) (17 | ((run - 3) << 8));
+        run = 0;
+      }
+    } else {
+      symbols[symbols_count++] = length;
+      run--;
+      while (run >= 3) {
+        u32 repeat = (run < 6) ? run : 6;
+        symbols[symbols_count++] = (u16) (16 | ((repeat - 3) << 8));
+        run -= repeat;
+      }
+    }
+
+    while (run > 0) {
+      symbols[symbols_count++] = length;
+      run--;
+    }
+  }
+
+  for (u32 j = 0; j < symbols_count; j++) { frequencies[symbols[j] & 0xff]++; }
+  return symbols_count;
+}
+
+// plain huffman through two sorted queues, whenever a code comes out longer than the limit the
+// frequencies are halved and it is built again, which flattens the tree until it fits
+static void deflate_build_lengths(const u32* frequencies, u32 count, u32 limit, u8* lengths) {
+  DeflateSymbol leaves[DEFLATE_LITERAL_CODES];
+  u32 weights[2 * DEFLATE_LITERAL_CODES];
+  u32 parents[2 * DEFLATE_LITERAL_CODES];
+  u32 depths[2 * DEFLATE_LITERAL_CODES];
+
+  // a single code would leave the tree incomplete, some decoders reject that so there are always two
+  u32 leaves_count = 0;
+  for (u32 i = 0; i < count; i++) {
+    if (frequencies[i] > 0) { leaves[leaves_count++] = (DeflateSymbol) { frequencies[i], i }; }
+  }
+  for (u32 i = 0; i < count && leaves_count < 2; i++) {
+    if (frequencies[i] == 0) { leaves[leaves_count++] = (DeflateSymbol) { 1, i }; }
+  }
+
+  qsort(leaves, leaves_count, sizeof(DeflateSymbol), deflate_symbol_compare);
+
+  while (true) {
+    for (u32 i = 0; i < leaves_count; i++) { weights[i] = leaves[i].frequency; }
+
+    // internal nodes are created in order of weight, so they form the second sorted queue
+    u32 next_leaf = 0, next_internal = leaves_count, nodes_count = leaves_count;
+    for (u32 i = 0; i < leaves_count - 1; i++) {
+      u32 children[2];
+      for (u32 j = 0; j < 2; j++) {
+        bool take_leaf = next_leaf < leaves_count && (next_internal == nodes_count || weights[next_leaf] <= weights[next_internal]);
+        children[j] = take_leaf ? next_leaf++ : next_internal++;
+      }
+
+      weights[nodes_count] = weights[children[0]] + weights[children[1]];
+      parents[children[0]] = nodes_count;
+      parents[children[1]] = nodes_count;
+      nodes_count++;
+    }
+
+    u32 root = nodes_count - 1;
+    depths[root] = 0;
+    u32 max_depth = 0;
+    for (u32 node = root; node-- > 0;) {
+      depths[node] = depths[parents[node]] + 1;
+      if (node < leaves_count && depths[node] > max_depth) { max_depth = depths[node]; }
+    }
+
+    if (max_depth <= limit) { break; }
+    for (u32 i = 0; i < leaves_count; i++) { leaves[i].frequency = (leaves[i].frequency >> 1) | 1; }
+  }
+
+  memset(lengths, 0, count);
+  for (u32 i = 0; i < leaves_count; i++) { lengths[leaves[i].symbol] = (u8) depths[i]; }
+}
+
+// canonical codes, bit reversed since deflate sends huffman codes most significant bit first
+static void deflate_build_codes(const u8* lengths, u32 count, u16* codes) {
+  u32 length_counts[DEFLATE_MAX_CODE_LENGTH + 1] = {0};
+  for (u32 i = 0; i < count; i++) { length_counts[lengths[i]]++; }
+  length_counts[0] = 0;
+
+  u32 next_codes[DEFLATE_MAX_CODE_LENGTH + 1];
+  u32 code = 0;
+  for (u32 bits = 1; bits <= DEFLATE_MAX_CODE_LENGTH; bits++) {
+    code = (code + length_counts[bits - 1]) << 1;
+    next_codes[bits] = code;
+  }
+
+  for (u32 i = 0; i < count; i++) {
+    u32 length = lengths[i];
+    if (length == 0) {
+      codes[i] = 0;
+      continue;
+    }
+
+    u32 value = next_codes[length]++;
+    u32 reversed = 0;
+    for (u32 bit = 0; bit < length; bit++) { reversed |= ((value >> bit) & 1) << (length - 1 - bit); }
+    codes[i] = (u16) reversed;
+  }
+}
+
+// lengths 3 to 10 have a code each, after that every group of four codes doubles its range up to 258
+static u32 deflate_length_symbol(u32 length, u32* extra_bits, u32* extra_value) {
+  u32 offset = length - 3;
+  if (offset < 8 || length == DEFLATE_MAX_MATCH) {
+    *extra_bits = 0;
+    *extra_value = 0;
+    return (length == DEFLATE_MAX_MATCH) ? 285 : 257 + offset;
+  }
+
+  u32 log2 = 31 - __builtin_clz(offset);
+  *extra_bits = log2 - 2;
+  *extra_value = offset & ((1u << *extra_bits) - 1);
+  return 257 + 4 * (log2 - 1) + ((offset >> *extra_bits) & 3);
+}
+
+// distances 1 to 4 have a code each, after that every pair of codes doubles its range up to 32768
+static u32 deflate_distance_symbol(u32 distance, u32* extra_bits, u32* extra_value) {
+  u32 offset = distance - 1;
+  if (offset < 4) {
+    *extra_bits = 0;
+    *extra_value = 0;
+    return offset;
+  }
+
+  u32 log2 = 31 - __builtin_clz(offset);
+  *extra_bits = log2 - 1;
+  *extra_value = offset & ((1u << *extra_bits) - 1);
+  return 2 * log2 + ((offset >> *extra_bits) & 1);
+}
+
+static inline void deflate_put_bits(DeflateWriter* writer, u32 value, u32 count) {
+  writer->bits |= (u64) value << writer->bit_count;
+  writer->bit_count += count;
+  if (writer->bit_count < 32) { return; }
+
+  u8* output = &writer->output[writer->size];
+  output[0] = (u8) writer->bits;
+  output[1] = (u8) (writer->bits >> 8);
+  output[2] = (u8) (writer->bits >> 16);
+  output[3] = (u8) (writer->bits >> 24);
+  writer->size += 4;
+  writer->bits >>= 32;
+  writer->bit_count -= 32;
+}
+
+static void deflate_align(DeflateWriter* writer) {
+  while (writer->bit_count > 0) {
+    writer->output[writer->size++] = (u8) writer->bits;
+    writer->bits >>= 8;
+    writer->bit_count = (writer->bit_count > 8) ? writer->bit_count - 8 : 0;
+  }
+  writer->bits = 0;
+}
+
+static inline u32 deflate_hash(const u8* data) {
+  u32 value;
+  memcpy(&value, data, sizeof(u32));
+  return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static inline usize deflate_match_length(const u8* a, const u8* b, usize max_length) {
+  usize length = 0;
+  while (length + sizeof(u64) <= max_length) {
+    u64 x, y;
+    memcpy(&x, &a[length], sizeof(u64));
+    memcpy(&y, &b[length], sizeof(u64));
+    if (x != y) { return length + (__builtin_ctzll(x ^ y) >> 3); }
+    length += sizeof(u64);
+  }
+
+  while (length < max_length && a[length] == b[length]) { length++; }
+  return length;
+}
+
+static void deflate_crc32_table_create() {
+  for (u32 i = 0; i < 256; i++) {
+    u32 crc = i;
+    for (u32 bit = 0; bit < 8; bit++) { crc = (crc & 1) ? (0xedb88320u ^ (crc >> 1)) : (crc >> 1); }
+    deflate_crc32_table[i] = crc;
+  }
+}
+
+// ties go by symbol so the codes never depend on qsort's order
+static int deflate_symbol_compare(const void* a, const void* b) {
+  const DeflateSymbol* first = (const DeflateSymbol*) a;
+  const DeflateSymbol* second = (const DeflateSymbol*) b;
+  if (first->frequency != second->frequency) { return (first->frequency < second->frequency) ? -1 : 1; }
+  return (first->symbol < second->symbol) ? -1 : 1;
+}
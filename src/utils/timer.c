@@ -0,0 +1,11 @@
+#include "utils/timer.h"
+
+#include <time.h>
+
+#include "types/base_types.h"
+
+inline f64 timer_get_seconds() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (f64) time.tv_sec + ((f64) time.tv_nsec / 1000000000.0);
+}
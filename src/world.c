@@ -5,6 +5,7 @@
 #include <cJSON.h>
 #include <string.h>
 
+#include "animation.h"
 #include "camera.h"
 #include "hittables/hittable.h"
 #include "hittables/sphere.h"
@@ -17,8 +18,13 @@
 #include "materials/emissive.h"
 
 #include "math/vector3.h"
+#include "scene_binary.h"
+#include "textures/image.h"
+#include "trace.h"
 #include "utils/file.h"
 
+static bool world_scene_load_json(World* world, Camera* camera, const char* filename);
+
 World world_create() {
   World world = {0};
 
@@ -67,17 +73,28 @@ void world_remove(World* world, usize index) {
   }
 
   world->hittables[index]->destroy(world->hittables[index]);
+  if (world->animation) { animation_remove_hittable(world->animation, (u32) index); }
   for (usize i = index; i < world->hittables_count - 1; i++) {
     world->hittables[i] = world->hittables[i + 1];
   }
   world->hittables_count--;
 }
 
-void world_scene_save(World* world, Camera* camera, const char* filename) {
+bool world_scene_save(World* world, Camera* camera, const char* filename) {
+  if (scene_binary_is_binary_path(filename)) {
+    // the binary format has no animation table yet, so the keyframes would be lost
+    if (world->animation && world->animation->tracks_count > 0) {
+      fprintf(stderr, "[ERROR] [WORLD] [SCENE] Binary scenes cannot hold an animation, save %s as JSON!\n", filename);
+      return false;
+    }
+
+    return scene_binary_save(world, camera, filename);
+  }
+
   cJSON* scene_json = cJSON_CreateObject();
   if (!scene_json) { goto error; }
 
-  cJSON* camera_json = cJSON_CreateObject();
+  cJSON* camera_json = cJSON_AddObjectToObject(scene_json, "camera");
   if (!camera_json) { goto error; }
 
   cJSON* camera_position_json = cJSON_AddArrayToObject(camera_json, "position");
@@ -90,7 +107,7 @@ void world_scene_save(World* world, Camera* camera, const char* filename) {
     if (!cJSON_AddItemToArray(camera_position_json, element)) { goto error; }
   }
 
-  cJSON_AddItemToObject(scene_json, "camera", camera_json);
+  if (!cJSON_AddNumberToObject(camera_json, "seed", camera->seed)) { goto error; }
 
   cJSON* hittables_json = cJSON_AddArrayToObject(scene_json, "hittables");
   if (!hittables_json) { goto error; }
@@ -100,6 +117,9 @@ void world_scene_save(World* world, Camera* camera, const char* filename) {
     switch (world->hittables[i]->type) {
       case HITTABLE_TYPE_SPHERE: hittable_json = hittable_sphere_json_create((HittableSphere*) world->hittables[i]); break;
       case HITTABLE_TYPE_PLANE: hittable_json = hittable_plane_json_create((HittablePlane*) world->hittables[i]); break;
+      default:
+        fprintf(stderr, "[ERROR] [WORLD] [SCENE] Unknown hittable type: %d!\n", world->hittables[i]->type);
+        goto error;
     }
 
     if (!hittable_json) { goto error; }
@@ -110,32 +130,62 @@ void world_scene_save(World* world, Camera* camera, const char* filename) {
       case MATERIAL_TYPE_METAL: material_json = material_metal_json_create((Metal*) world->hittables[i]->material); break;
       case MATERIAL_TYPE_GLASS: material_json = material_glass_json_create((MaterialGlass*) world->hittables[i]->material); break;
       case MATERIAL_TYPE_EMISSIVE: material_json = material_emissive_json_create((MaterialEmissive*) world->hittables[i]->material); break;
+      default:
+        fprintf(stderr, "[ERROR] [WORLD] [SCENE] Unknown material type: %d!\n", world->hittables[i]->material->type);
+        cJSON_Delete(hittable_json);
+        goto error;
     }
 
-    if (!material_json) { goto error; }
+    if (!material_json) {
+      cJSON_Delete(hittable_json);
+      goto error;
+    }
 
     cJSON_AddItemToObject(hittable_json, "material", material_json);
     cJSON_AddItemToArray(hittables_json, hittable_json);
   }
 
+  if (world->animation && world->animation->tracks_count > 0) {
+    cJSON* animation_json = animation_json_create(world->animation);
+    if (!animation_json) { goto error; }
+
+    cJSON_AddItemToObject(scene_json, "animation", animation_json);
+  }
+
   const char* string = cJSON_Print(scene_json);
-  file_write_string(filename, string);
+  if (!string) { goto error; }
+
+  bool written = file_write_string(filename, string);
   free((void*) string);
+  if (!written) { goto error; }
 
   cJSON_Delete(scene_json);
 
-  return;
+  return true;
 
 error:
-  fprintf(stderr, "[ERROR] [WORLD] [SCENE] Failed to save scene!\n");
-  //cJSON_Delete(scene_json);
+  fprintf(stderr, "[ERROR] [WORLD] [SCENE] Failed to save scene: %s!\n", filename);
+  cJSON_Delete(scene_json);
+  return false;
+}
+
+// every image path is collected while parsing and the decodes only start once the whole scene is known
+bool world_scene_load(World* world, Camera* camera, const char* filename) {
+  texture_image_decode_defer();
+  bool loaded = scene_binary_is_binary_path(filename) ? scene_binary_load(world, camera, filename) : world_scene_load_json(world, camera, filename);
+  texture_image_decode_submit();
+
+  return loaded;
 }
 
-void world_scene_load(World* world, Camera* camera, const char* filename) {
+static bool world_scene_load_json(World* world, Camera* camera, const char* filename) {
+  TraceScope trace = trace_begin("Scene Load");
+
   const char* string = file_to_string(filename);
   if (!string) {
     fprintf(stderr, "[ERROR] [WORLD] [SCENE] Failed to load file: %s!\n", filename);
-    return;
+    trace_end(trace);
+    return false;
   }
 
   cJSON* scene_json = cJSON_Parse(string);
@@ -146,7 +196,7 @@ void world_scene_load(World* world, Camera* camera, const char* filename) {
 
   free((void*) string);
 
-  if (world->hittables_count > 0) {
+  if (world->hittables_count > 0 || world->animation) {
     world_destroy(world);
     *world = world_create();
   }
@@ -154,57 +204,94 @@ void world_scene_load(World* world, Camera* camera, const char* filename) {
   cJSON* camera_json = cJSON_GetObjectItemCaseSensitive(scene_json, "camera");
   if (!camera || !cJSON_IsObject(camera_json)) { goto error; }
 
-  cJSON* camera_position = cJSON_GetObjectItemCaseSensitive(camera_json, "position");
-  if (!camera_position || !cJSON_IsArray(camera_position)) { goto error; }
-
-  camera->position = (Vector3) { cJSON_GetNumberValue(cJSON_GetArrayItem(camera_position, 0)), cJSON_GetNumberValue(cJSON_GetArrayItem(camera_position, 1)), cJSON_GetNumberValue(cJSON_GetArrayItem(camera_position, 2)) };
+  if (!world_camera_json_parse(camera_json, &camera->position, &camera->seed)) { goto error; }
 
   cJSON* hittables_json = cJSON_GetObjectItemCaseSensitive(scene_json, "hittables");
   if (!hittables_json || !cJSON_IsArray(hittables_json)) { goto error; }
 
-  s32 hittables_count = cJSON_GetArraySize(hittables_json);
-  for (usize i = 0; i < hittables_count; i++) {
-    cJSON* hittable_json = cJSON_GetArrayItem(hittables_json, i);
-    if (!hittable_json) { goto error; }
+  // cJSON arrays are linked lists, indexing them would make loading quadratic in the hittable count
+  cJSON* hittable_json;
+  cJSON_ArrayForEach(hittable_json, hittables_json) {
+    Hittable* new_hittable = world_hittable_json_parse(hittable_json);
+    if (!new_hittable) { goto error; }
+
+    world_add(world, new_hittable);
+  }
 
-    cJSON* type_json = cJSON_GetObjectItemCaseSensitive(hittable_json, "type");
-    if (!type_json || !cJSON_IsNumber(type_json)) { goto error; }
+  // parsed last since tracks are checked against the hittables they move
+  cJSON* animation_json = cJSON_GetObjectItemCaseSensitive(scene_json, "animation");
+  if (animation_json) {
+    world->animation = (Animation*) malloc(sizeof(Animation));
+    if (!world->animation) { goto error; }
 
-    Hittable* new_hittable;
-    switch ((HittableType) cJSON_GetNumberValue(type_json)) {
-      case HITTABLE_TYPE_SPHERE: new_hittable = (Hittable*) hittable_sphere_json_parse(hittable_json); break;
-      case HITTABLE_TYPE_PLANE: new_hittable = (Hittable*) hittable_plane_json_parse(hittable_json); break;
+    if (!animation_json_parse(world->animation, world, animation_json)) {
+      free(world->animation);
+      world->animation = NULL;
+      goto error;
     }
+  }
 
-    if (!new_hittable) { goto error; }
+  cJSON_Delete(scene_json);
 
-    cJSON* material_json = cJSON_GetObjectItemCaseSensitive(hittable_json, "material");
-    if (!material_json || !cJSON_IsObject(material_json)) { goto error; }
+  trace_end(trace);
+  return true;
 
-    cJSON* material_type_json = cJSON_GetObjectItemCaseSensitive(material_json, "type");
-    if (!material_type_json || !cJSON_IsNumber(material_type_json)) { goto error; }
+error:
+  fprintf(stderr, "[ERROR] [WORLD] [JSON] Failed to load scene!\n");
+  cJSON_Delete(scene_json);
+  trace_end(trace);
+  return false;
+}
 
-    Material* material;
-    switch ((MaterialType) cJSON_GetNumberValue(material_type_json)) {
-      case MATERIAL_TYPE_DIFFUSE: material = (Material*) material_diffuse_json_parse(material_json); break;
-      case MATERIAL_TYPE_METAL: material = (Material*) material_metal_json_parse(material_json); break;
-      case MATERIAL_TYPE_GLASS: material = (Material*) material_glass_json_parse(material_json); break;
-      case MATERIAL_TYPE_EMISSIVE: material = (Material*) material_emissive_json_parse(material_json); break;
-    }
+bool world_camera_json_parse(cJSON* camera_json, Vector3* position, u32* seed) {
+  if (!cJSON_IsObject(camera_json)) { return false; }
 
-    if (!material) { goto error; }
+  cJSON* camera_position = cJSON_GetObjectItemCaseSensitive(camera_json, "position");
+  if (!camera_position || !cJSON_IsArray(camera_position)) { return false; }
 
-    new_hittable->material = material;
-    world_add(world, new_hittable);
+  *position = (Vector3) { cJSON_GetNumberValue(cJSON_GetArrayItem(camera_position, 0)), cJSON_GetNumberValue(cJSON_GetArrayItem(camera_position, 1)), cJSON_GetNumberValue(cJSON_GetArrayItem(camera_position, 2)) };
+
+  // the seed is optional so scenes saved before it existed still load
+  cJSON* camera_seed = cJSON_GetObjectItemCaseSensitive(camera_json, "seed");
+  *seed = cJSON_IsNumber(camera_seed) ? (u32) cJSON_GetNumberValue(camera_seed) : DEFAULT_SEED;
+
+  return true;
+}
+
+Hittable* world_hittable_json_parse(cJSON* hittable_json) {
+  cJSON* type_json = cJSON_GetObjectItemCaseSensitive(hittable_json, "type");
+  if (!type_json || !cJSON_IsNumber(type_json)) { return NULL; }
+
+  Hittable* hittable = NULL;
+  switch ((HittableType) cJSON_GetNumberValue(type_json)) {
+    case HITTABLE_TYPE_SPHERE: hittable = (Hittable*) hittable_sphere_json_parse(hittable_json); break;
+    case HITTABLE_TYPE_PLANE: hittable = (Hittable*) hittable_plane_json_parse(hittable_json); break;
   }
 
-  cJSON_Delete(scene_json);
+  if (!hittable) { return NULL; }
+
+  cJSON* material_json = cJSON_GetObjectItemCaseSensitive(hittable_json, "material");
+  if (!material_json || !cJSON_IsObject(material_json)) { goto error; }
+
+  cJSON* material_type_json = cJSON_GetObjectItemCaseSensitive(material_json, "type");
+  if (!material_type_json || !cJSON_IsNumber(material_type_json)) { goto error; }
+
+  Material* material = NULL;
+  switch ((MaterialType) cJSON_GetNumberValue(material_type_json)) {
+    case MATERIAL_TYPE_DIFFUSE: material = (Material*) material_diffuse_json_parse(material_json); break;
+    case MATERIAL_TYPE_METAL: material = (Material*) material_metal_json_parse(material_json); break;
+    case MATERIAL_TYPE_GLASS: material = (Material*) material_glass_json_parse(material_json); break;
+    case MATERIAL_TYPE_EMISSIVE: material = (Material*) material_emissive_json_parse(material_json); break;
+  }
 
-  return;
+  if (!material) { goto error; }
+
+  hittable->material = material;
+  return hittable;
 
 error:
-  fprintf(stderr, "[ERROR] [WORLD] [JSON] Failed to load scene!\n");
-  cJSON_Delete(scene_json);
+  hittable->destroy(hittable);
+  return NULL;
 }
 
 void world_destroy(World* world) {
@@ -214,4 +301,10 @@ void world_destroy(World* world) {
 
   free(world->hittables);
   world->hittables = NULL;
+
+  if (world->animation) {
+    animation_destroy(world->animation);
+    free(world->animation);
+    world->animation = NULL;
+  }
 }
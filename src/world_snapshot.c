@@ -0,0 +1,191 @@
+#include "world_snapshot.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "world.h"
+#include "types/base_types.h"
+
+static WorldSnapshot* snapshot_create(WorldSnapshotQueue* queue, World* world, WorldSnapshot* previous);
+static WorldSnapshotHittable* snapshot_hittable_find(WorldSnapshotHittable** table, u64 table_mask, u64 revision);
+static void snapshot_destroy(WorldSnapshot* snapshot);
+
+void world_snapshot_queue_create(WorldSnapshotQueue* queue, World* world) {
+  queue->version = 0;
+  queue->revision = 0;
+  queue->retired = NULL;
+
+  atomic_init(&queue->epoch, 1);
+  for (usize i = 0; i < WORLD_SNAPSHOT_MAX_READERS; i++) {
+    atomic_init(&queue->reader_epochs[i], 0);
+  }
+
+  atomic_init(&queue->current, snapshot_create(queue, world, NULL));
+}
+
+void world_snapshot_queue_publish(WorldSnapshotQueue* queue, World* world) {
+  // only the producer replaces the current snapshot, so reading it here cannot race with reclaiming it
+  WorldSnapshot* snapshot = snapshot_create(queue, world, atomic_load(&queue->current));
+  if (!snapshot) {
+    fprintf(stderr, "[ERROR] [WORLD] [SNAPSHOT] Failed to publish world version %llu!\n", (unsigned long long) queue->version + 1);
+    return;
+  }
+  queue->version++;
+
+  WorldSnapshot* old = atomic_exchange(&queue->current, snapshot);
+
+  // any reader that could still be holding the old snapshot announced an epoch before this increment
+  old->retired_epoch = atomic_fetch_add(&queue->epoch, 1) + 1;
+  old->next_retired = queue->retired;
+  queue->retired = old;
+
+  world_snapshot_queue_reclaim(queue);
+}
+
+void world_snapshot_queue_reclaim(WorldSnapshotQueue* queue) {
+  u64 oldest_reader_epoch = UINT64_MAX;
+  for (usize i = 0; i < WORLD_SNAPSHOT_MAX_READERS; i++) {
+    u64 reader_epoch = atomic_load(&queue->reader_epochs[i]);
+    if (reader_epoch != 0 && reader_epoch < oldest_reader_epoch) {
+      oldest_reader_epoch = reader_epoch;
+    }
+  }
+
+  WorldSnapshot** link = &queue->retired;
+  while (*link) {
+    WorldSnapshot* snapshot = *link;
+    if (snapshot->retired_epoch <= oldest_reader_epoch) {
+      *link = snapshot->next_retired;
+      snapshot_destroy(snapshot);
+    } else {
+      link = &snapshot->next_retired;
+    }
+  }
+}
+
+WorldSnapshot* world_snapshot_acquire(WorldSnapshotQueue* queue, u32 reader) {
+  atomic_store(&queue->reader_epochs[reader], atomic_load(&queue->epoch));
+  return atomic_load(&queue->current);
+}
+
+inline void world_snapshot_release(WorldSnapshotQueue* queue, u32 reader) {
+  atomic_store(&queue->reader_epochs[reader], 0);
+}
+
+// every reader must have stopped before the queue is destroyed
+void world_snapshot_queue_destroy(WorldSnapshotQueue* queue) {
+  while (queue->retired) {
+    WorldSnapshot* next = queue->retired->next_retired;
+    snapshot_destroy(queue->retired);
+    queue->retired = next;
+  }
+
+  snapshot_destroy(atomic_load(&queue->current));
+  atomic_store(&queue->current, NULL);
+}
+
+static WorldSnapshot* snapshot_create(WorldSnapshotQueue* queue, World* world, WorldSnapshot* previous) {
+  WorldSnapshot* snapshot = (WorldSnapshot*) malloc(sizeof(WorldSnapshot));
+  if (!snapshot) {
+    fprintf(stderr, "[ERROR] [WORLD] [SNAPSHOT] Failed to allocate memory for world snapshot!\n");
+    return NULL;
+  }
+
+  u32 hittables_count = world->hittables_count;
+  snapshot->world = *world;
+  snapshot->world.capacity = (hittables_count > 0) ? hittables_count : 1;
+  snapshot->world.hittables = (Hittable**) malloc(sizeof(Hittable*) * snapshot->world.capacity);
+  snapshot->world.hittables_count = 0;
+  snapshot->shared = (WorldSnapshotHittable**) malloc(sizeof(WorldSnapshotHittable*) * snapshot->world.capacity);
+  snapshot->version = queue->version + (previous ? 1 : 0);
+  snapshot->retired_epoch = 0;
+  snapshot->next_retired = NULL;
+
+  // the previous copies are looked up by revision, an open addressed table at most half full
+  u64 table_mask = 0;
+  WorldSnapshotHittable** table = NULL;
+  if (previous && previous->world.hittables_count > 0) {
+    u64 table_size = 1;
+    while (table_size < (u64) previous->world.hittables_count * 2) { table_size *= 2; }
+    table_mask = table_size - 1;
+    table = (WorldSnapshotHittable**) calloc(table_size, sizeof(WorldSnapshotHittable*));
+  }
+
+  if (!snapshot->world.hittables || !snapshot->shared || (previous && previous->world.hittables_count > 0 && !table)) {
+    fprintf(stderr, "[ERROR] [WORLD] [SNAPSHOT] Failed to allocate memory for world snapshot hittables!\n");
+    goto error;
+  }
+
+  if (table) {
+    for (u32 i = 0; i < previous->world.hittables_count; i++) {
+      WorldSnapshotHittable* shared = previous->shared[i];
+      u64 slot = (shared->revision * 0x9E3779B97F4A7C15ull) & table_mask;
+      while (table[slot]) { slot = (slot + 1) & table_mask; }
+      table[slot] = shared;
+    }
+  }
+
+  for (u32 i = 0; i < hittables_count; i++) {
+    Hittable* hittable = world->hittables[i];
+
+    WorldSnapshotHittable* shared = NULL;
+    if (table && hittable->snapshot_revision != 0) {
+      shared = snapshot_hittable_find(table, table_mask, hittable->snapshot_revision);
+    }
+
+    if (shared) {
+      shared->reference_count++;
+    } else {
+      shared = (WorldSnapshotHittable*) malloc(sizeof(WorldSnapshotHittable));
+      Hittable* copy = shared ? hittable->clone(hittable) : NULL;
+      if (!copy) {
+        fprintf(stderr, "[ERROR] [WORLD] [SNAPSHOT] Failed to clone hittable %u!\n", i);
+        free(shared);
+        goto error;
+      }
+
+      if (hittable->snapshot_revision == 0) { hittable->snapshot_revision = ++queue->revision; }
+      *shared = (WorldSnapshotHittable) { copy, hittable->snapshot_revision, 1 };
+    }
+
+    snapshot->shared[i] = shared;
+    snapshot->world.hittables[i] = shared->hittable;
+    snapshot->world.hittables_count++;
+  }
+
+  free(table);
+  return snapshot;
+
+error:
+  free(table);
+  snapshot_destroy(snapshot);
+  return NULL;
+}
+
+static WorldSnapshotHittable* snapshot_hittable_find(WorldSnapshotHittable** table, u64 table_mask, u64 revision) {
+  u64 slot = (revision * 0x9E3779B97F4A7C15ull) & table_mask;
+  while (table[slot]) {
+    if (table[slot]->revision == revision) { return table[slot]; }
+    slot = (slot + 1) & table_mask;
+  }
+
+  return NULL;
+}
+
+static void snapshot_destroy(WorldSnapshot* snapshot) {
+  if (!snapshot) { return; }
+
+  for (u32 i = 0; i < snapshot->world.hittables_count; i++) {
+    WorldSnapshotHittable* shared = snapshot->shared[i];
+    if (--shared->reference_count > 0) { continue; }
+
+    shared->hittable->destroy(shared->hittable);
+    free(shared);
+  }
+
+  free(snapshot->world.hittables);
+  free(snapshot->shared);
+  free(snapshot);
+}
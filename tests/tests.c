@@ -0,0 +1,1114 @@
+#include <dirent.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include "animation.h"
+#include "camera.h"
+#include "checkpoint.h"
+#include "distributed.h"
+#include "image.h"
+#include "random.h"
+#include "scene_binary.h"
+#include "scene_generator.h"
+#include "scene_stream.h"
+#include "snapshot_writer.h"
+#include "thread_pool.h"
+#include "tonemapping.h"
+#include "world.h"
+#include "world_snapshot.h"
+#include "hittables/plane.h"
+#include "hittables/sphere.h"
+#include "materials/diffuse.h"
+#include "textures/image.h"
+#include "textures/solid_color.h"
+#include "textures/virtual_texture.h"
+#include "types/base_types.h"
+#include "types/color.h"
+
+// has to match the bench defaults, the reference images are shared with it
+#define TESTS_WIDTH 160
+#define TESTS_HEIGHT 120
+#define TESTS_SAMPLES 16
+#define TESTS_SEED 1
+
+// the references are stored as .hdr, whose shared exponent encoding alone accounts for ~0.003
+#define TESTS_MAX_RMSE 0.01
+// worker sums are added up in a different order than one accumulation, so only rounding may differ
+#define TESTS_MAX_MERGE_ERROR 1e-4
+// restart markers only reset the dc prediction, the decoded bands should come out within rounding of one encode
+#define TESTS_MAX_JPG_ERROR 2
+
+#define TESTS_SCENES_DIRECTORY "../scenes"
+#define TESTS_REFERENCES_DIRECTORY "../bench/references"
+#define TESTS_TEXTURE_PATH "../assets/texture.jpg"
+
+#define TESTS_PATH_LENGTH 1024
+#define TESTS_BINARY_SCENE_PATH P_tmpdir "/path_tracer_tests" SCENE_BINARY_EXTENSION
+#define TESTS_CHECKPOINT_PATH P_tmpdir "/path_tracer_tests.checkpoint"
+#define TESTS_SNAPSHOT_PATH P_tmpdir "/path_tracer_tests_snapshot.hdr"
+#define TESTS_STREAM_SCENE_PATH P_tmpdir "/path_tracer_tests_stream.scene"
+#define TESTS_TEXTURE_COPY_PATH P_tmpdir "/path_tracer_tests_copy.jpg"
+#define TESTS_TEXTURE_MISSING_PATH P_tmpdir "/path_tracer_tests_missing.jpg"
+#define TESTS_TEXTURE_COPIES_PATH P_tmpdir "/path_tracer_tests_copy_%u.tga"
+#define TESTS_IMAGE_PATH P_tmpdir "/path_tracer_tests_image"
+#define TESTS_TEXTURE_CACHE_DIRECTORY P_tmpdir "/path_tracer_tests_textures"
+#define TESTS_TEXTURE_NOISE_PATH P_tmpdir "/path_tracer_tests_noise.tga"
+
+// not a multiple of the band height or the exr tile size, so the last band and tiles are partial
+#define TESTS_IMAGE_WIDTH 150
+#define TESTS_IMAGE_HEIGHT 100
+#define TESTS_IMAGE_SAMPLES 4
+#define TESTS_EXR_TILE_SIZE 32
+
+// enough files to grow the texture cache tables a few times
+#define TESTS_TEXTURE_COPIES 100
+
+// the pager keeps a page for every thread anyway, the generated texture has 340 and the close up view reads over 100 of them
+#define TESTS_TEXTURE_PAGES 4
+#define TESTS_TEXTURE_SIZE 1024
+#define TESTS_TEXTURE_DISTANCE 0.5f
+
+// chunks double, so the stream hands the spheres and the ground over as chunks of 2, 4 and 3
+#define TESTS_STREAM_FIRST_CHUNK 2
+#define TESTS_STREAM_SPHERES 8
+
+#define TESTS_SNAPSHOT_READERS 4
+#define TESTS_SNAPSHOT_PUBLISHES 256
+#define TESTS_SNAPSHOT_SPHERES 64
+
+typedef struct Test {
+  const char* name;
+  bool (*run)();
+} Test;
+
+// a scene file when filename is set, otherwise a generated grid of sphere_count spheres
+static bool tests_load_scene(World* world, Camera* camera, const char* filename, u32 sphere_count) {
+  if (filename) {
+    char path[TESTS_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s", TESTS_SCENES_DIRECTORY, filename);
+    if (!world_scene_load(world, camera, path)) { return false; }
+  } else {
+    if (!scene_generator_spheres(world, camera, sphere_count, TESTS_SEED)) { return false; }
+  }
+
+  camera->seed = TESTS_SEED;
+  camera->sample_limit = TESTS_SAMPLES;
+  return true;
+}
+
+static bool test_references() {
+  const struct { const char* name; const char* filename; u32 sphere_count; } scenes[] = {
+    { "test", "test.scene", 0 },
+    { "brick-earth", "brick-earth.scene", 0 },
+    { "spheres-16", NULL, 16 }
+  };
+
+  bool passed = true;
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  for (usize i = 0; i < (sizeof(scenes) / sizeof(scenes[0])); i++) {
+    if (!tests_load_scene(&world, camera, scenes[i].filename, scenes[i].sphere_count)) {
+      passed = false;
+      continue;
+    }
+
+    camera_render_export(camera, &world);
+
+    char reference_path[TESTS_PATH_LENGTH];
+    snprintf(reference_path, sizeof(reference_path), "%s/%s.hdr", TESTS_REFERENCES_DIRECTORY, scenes[i].name);
+
+    f64 rmse;
+    if (!image_compare_hdr(reference_path, camera, &rmse)) {
+      passed = false;
+      continue;
+    }
+
+    printf("[INFO] [TESTS] %s: rmse %f\n", scenes[i].name, rmse);
+    if (rmse > TESTS_MAX_RMSE) {
+      fprintf(stderr, "[ERROR] [TESTS] %s differs from its reference, rmse %f is above %f!\n", scenes[i].name, rmse, TESTS_MAX_RMSE);
+      passed = false;
+    }
+  }
+
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// every pixel sample draws from its own hashed stream, so the slicing must not change a single bit
+static bool test_thread_determinism() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* single_thread = (Color*) malloc(framebuffer_size);
+  bool passed = (single_thread != NULL) && tests_load_scene(&world, camera, NULL, 16);
+
+  if (passed) {
+    camera->thread_count = 1;
+    camera_render_export(camera, &world);
+    memcpy(single_thread, camera->framebuffer, framebuffer_size);
+
+    camera->thread_count = MAX_THREAD_COUNT;
+    camera_render_export(camera, &world);
+
+    if (memcmp(single_thread, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] Rendering with 1 and %u threads gave different images!\n", MAX_THREAD_COUNT);
+      passed = false;
+    }
+  }
+
+  free(single_thread);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// rendering the samples in two calls has to accumulate exactly like one call, the interactive and export paths rely on it
+static bool test_sample_ranges() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* single_call = (Color*) malloc(framebuffer_size);
+  bool passed = (single_call != NULL) && tests_load_scene(&world, camera, "test.scene", 0);
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    memcpy(single_call, camera->framebuffer, framebuffer_size);
+
+    camera_clear_framebuffer(camera);
+    camera_render_samples(camera, &world, 0, TESTS_SAMPLES / 2);
+    camera_render_samples(camera, &world, TESTS_SAMPLES / 2, TESTS_SAMPLES - (TESTS_SAMPLES / 2));
+
+    if (camera->sample_count != TESTS_SAMPLES || memcmp(single_call, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] Rendering the samples in two calls gave a different image!\n");
+      passed = false;
+    }
+  }
+
+  free(single_call);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// worker processes render sample ranges that are merged back, the image and its even sample sum, which the noise
+// estimate and the exr aovs are computed from, have to match an in-process render
+static bool test_distributed_render() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_length = TESTS_WIDTH * TESTS_HEIGHT;
+  Color* in_process = (Color*) malloc(sizeof(Color) * framebuffer_length * 2);
+  Color* in_process_even = in_process + framebuffer_length;
+  bool passed = (in_process != NULL) && tests_load_scene(&world, camera, "test.scene", 0);
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    memcpy(in_process, camera->framebuffer, sizeof(Color) * framebuffer_length);
+    memcpy(in_process_even, camera->framebuffer_even, sizeof(Color) * framebuffer_length);
+
+    passed = distributed_render(camera, &world, 3, 1) && camera->sample_count == TESTS_SAMPLES;
+  }
+
+  for (usize i = 0; i < framebuffer_length && passed; i++) {
+    for (usize j = 0; j < 3; j++) {
+      f64 error = fabs(in_process[i].data[j] - camera->framebuffer[i].data[j]) / (1.0 + fabs(in_process[i].data[j]));
+      f64 even_error = fabs(in_process_even[i].data[j] - camera->framebuffer_even[i].data[j]) / (1.0 + fabs(in_process_even[i].data[j]));
+      if (error > TESTS_MAX_MERGE_ERROR || even_error > TESTS_MAX_MERGE_ERROR) {
+        fprintf(stderr, "[ERROR] [TESTS] The merged worker framebuffers differ from the in-process render at pixel %zu!\n", i);
+        passed = false;
+        break;
+      }
+    }
+  }
+
+  if (passed && camera->noise_estimate == CAMERA_NOISE_UNKNOWN) {
+    fprintf(stderr, "[ERROR] [TESTS] The distributed render left the noise estimate unknown!\n");
+    passed = false;
+  }
+
+  free(in_process);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+typedef struct TestsSnapshotReader {
+  pthread_t thread;
+  WorldSnapshotQueue* queue;
+  u32 slot;
+  atomic_bool* stop;
+  atomic_ullong reads;
+  bool valid;
+} TestsSnapshotReader;
+
+// walks every hittable of whatever snapshot is current, a snapshot freed too early shows up here, most reliably
+// when the tests are built with -fsanitize=thread or -fsanitize=address
+static void* tests_snapshot_reader(void* data) {
+  TestsSnapshotReader* reader = (TestsSnapshotReader*) data;
+  Ray ray = { { 0.0f, 0.0f, 100.0f }, { 0.0f, 0.0f, -1.0f } };
+
+  while (!atomic_load(reader->stop)) {
+    WorldSnapshot* snapshot = world_snapshot_acquire(reader->queue, reader->slot);
+    for (u32 i = 0; i < snapshot->world.hittables_count; i++) {
+      Hittable* hittable = snapshot->world.hittables[i];
+      hittable->hit(hittable, ray);
+      Color color = hittable->material->get_color(hittable->material, (Vector2) { 0.5f, 0.5f }, 0.0f);
+      if (!isfinite(color.red) || !isfinite(hittable->position->x)) { reader->valid = false; }
+    }
+    world_snapshot_release(reader->queue, reader->slot);
+    atomic_fetch_add(&reader->reads, 1);
+  }
+
+  return NULL;
+}
+
+// a snapshot only copies the hittables edited since the last one, and readers never see a copy freed under them
+static bool test_world_snapshots() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  bool passed = tests_load_scene(&world, camera, NULL, TESTS_SNAPSHOT_SPHERES);
+  if (!passed) { goto cleanup; }
+
+  WorldSnapshotQueue queue;
+  world_snapshot_queue_create(&queue, &world);
+
+  // the spare reader slot pins the first snapshot while the second is published
+  WorldSnapshot* first = world_snapshot_acquire(&queue, WORLD_SNAPSHOT_MAX_READERS - 1);
+  world.hittables[3]->position->x += 1.0f;
+  world.hittables[3]->snapshot_revision = 0;
+  world_snapshot_queue_publish(&queue, &world);
+
+  WorldSnapshot* second = atomic_load(&queue.current);
+  for (u32 i = 0; i < world.hittables_count; i++) {
+    if ((first->world.hittables[i] == second->world.hittables[i]) == (i == 3)) {
+      fprintf(stderr, "[ERROR] [TESTS] Snapshot hittable %u was %s!\n", i, (i == 3) ? "shared after an edit" : "copied without an edit");
+      passed = false;
+    }
+  }
+  world_snapshot_release(&queue, WORLD_SNAPSHOT_MAX_READERS - 1);
+
+  atomic_bool stop;
+  atomic_init(&stop, false);
+  TestsSnapshotReader readers[TESTS_SNAPSHOT_READERS];
+  u32 started_count = 0;
+  for (u32 i = 0; i < TESTS_SNAPSHOT_READERS; i++) {
+    readers[i] = (TestsSnapshotReader) { .queue = &queue, .slot = i, .stop = &stop, .valid = true };
+    atomic_init(&readers[i].reads, 0);
+    if (pthread_create(&readers[i].thread, NULL, tests_snapshot_reader, &readers[i]) != 0) { break; }
+    started_count++;
+  }
+
+  // the readers have to be in the middle of reading while snapshots are retired, even on a single core
+  for (u32 i = 0; i < started_count; i++) {
+    while (atomic_load(&readers[i].reads) == 0) { sched_yield(); }
+  }
+
+  // every eighth publish replaces a hittable, the others move one
+  for (u32 i = 0; i < TESTS_SNAPSHOT_PUBLISHES && started_count == TESTS_SNAPSHOT_READERS; i++) {
+    u32 index = (i * 7) % world.hittables_count;
+    if (i % 8 == 0) {
+      world_remove(&world, index);
+      Material* material = (Material*) material_diffuse_create((Texture*) texture_solid_color_create((Color) { 0.5f, 0.5f, 0.5f }));
+      world_add(&world, (Hittable*) hittable_sphere_create((Vector3) { (f32) i, 0.0f, 0.0f }, 1.0f, material));
+    } else {
+      world.hittables[index]->position->y += 0.5f;
+      world.hittables[index]->snapshot_revision = 0;
+    }
+    world_snapshot_queue_publish(&queue, &world);
+    sched_yield();
+  }
+
+  atomic_store(&stop, true);
+  for (u32 i = 0; i < started_count; i++) {
+    pthread_join(readers[i].thread, NULL);
+    if (!readers[i].valid) { passed = false; }
+  }
+  if (started_count != TESTS_SNAPSHOT_READERS) { passed = false; }
+
+  // after all the sharing the last snapshot still has to match the world it was taken from
+  WorldSnapshot* last = atomic_load(&queue.current);
+  for (u32 i = 0; i < world.hittables_count; i++) {
+    if (memcmp(last->world.hittables[i]->position, world.hittables[i]->position, sizeof(Vector3)) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The last snapshot differs from the world at hittable %u!\n", i);
+      passed = false;
+      break;
+    }
+  }
+
+  world_snapshot_queue_destroy(&queue);
+
+cleanup:
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// points the first hittable at a material the file does not have, which is only found halfway through loading
+static bool tests_corrupt_binary_scene(const char* filename) {
+  FILE* file = fopen(filename, "r+b");
+  if (!file) { return false; }
+
+  u32 material = UINT32_MAX;
+  bool written = fseek(file, sizeof(SceneBinaryHeader) + offsetof(SceneBinaryHittable, material), SEEK_SET) == 0 && fwrite(&material, sizeof(u32), 1, file) == 1;
+  return (fclose(file) == 0) && written;
+}
+
+// a scene converted to the binary format has to render exactly like the json it came from, and a broken one must
+// not touch the loaded scene
+static bool test_binary_scene() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* json_render = (Color*) malloc(framebuffer_size);
+  bool passed = (json_render != NULL) && tests_load_scene(&world, camera, "brick-earth.scene", 0);
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    memcpy(json_render, camera->framebuffer, framebuffer_size);
+
+    passed = scene_binary_save(&world, camera, TESTS_BINARY_SCENE_PATH) && world_scene_load(&world, camera, TESTS_BINARY_SCENE_PATH);
+  }
+
+  if (passed) {
+    camera_render_export(camera, &world);
+
+    if (memcmp(json_render, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The binary scene rendered differently from its json source!\n");
+      passed = false;
+    }
+  }
+
+  if (passed) {
+    u32 hittables_count = world.hittables_count;
+    passed = tests_corrupt_binary_scene(TESTS_BINARY_SCENE_PATH) && !world_scene_load(&world, camera, TESTS_BINARY_SCENE_PATH);
+    camera_render_export(camera, &world);
+
+    if (!passed || world.hittables_count != hittables_count || memcmp(json_render, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] A broken binary scene changed the loaded one!\n");
+      passed = false;
+    }
+  }
+
+  remove(TESTS_BINARY_SCENE_PATH);
+
+  free(json_render);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// stopping halfway and resuming from the checkpoint file has to give exactly the uninterrupted image
+static bool test_checkpoint_resume() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* uninterrupted = (Color*) malloc(framebuffer_size);
+  bool passed = (uninterrupted != NULL) && tests_load_scene(&world, camera, "test.scene", 0);
+  u64 scene_hash = checkpoint_scene_hash(TESTS_SCENES_DIRECTORY "/test.scene");
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    memcpy(uninterrupted, camera->framebuffer, framebuffer_size);
+
+    camera->checkpoint = checkpoint_open(TESTS_CHECKPOINT_PATH, camera, scene_hash, 0.0, false);
+    camera->sample_limit = TESTS_SAMPLES / 2;
+    passed = (camera->checkpoint != NULL);
+  }
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    checkpoint_close(camera->checkpoint);
+    camera->checkpoint = NULL;
+
+    camera_clear_framebuffer(camera);
+    camera->checkpoint = checkpoint_open(TESTS_CHECKPOINT_PATH, camera, scene_hash, 0.0, true);
+    camera->sample_limit = TESTS_SAMPLES;
+    passed = (camera->checkpoint != NULL) && camera->sample_count == TESTS_SAMPLES / 2;
+  }
+
+  if (passed) {
+    camera_render_export_continue(camera, &world);
+    checkpoint_close(camera->checkpoint);
+    camera->checkpoint = NULL;
+
+    if (camera->sample_count != TESTS_SAMPLES || memcmp(uninterrupted, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The resumed render differs from the uninterrupted one!\n");
+      passed = false;
+    }
+  }
+
+  remove(TESTS_CHECKPOINT_PATH);
+  free(uninterrupted);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// copying the accumulation out after every sample must not change the image the export ends with
+static bool test_snapshot_render() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* plain = (Color*) malloc(framebuffer_size);
+  bool passed = (plain != NULL) && tests_load_scene(&world, camera, "test.scene", 0);
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    memcpy(plain, camera->framebuffer, framebuffer_size);
+
+    SnapshotOptions options = snapshot_options_default();
+    options.outputs[options.outputs_count++] = (SnapshotOutput) { TESTS_SNAPSHOT_PATH, HDR };
+    options.sample_interval = 1;
+    options.time_interval = 0.0;
+    camera->snapshot_writer = snapshot_writer_create(camera, &options);
+    passed = (camera->snapshot_writer != NULL);
+  }
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    snapshot_writer_print_stats(camera->snapshot_writer);
+
+    SnapshotWriter* writer = camera->snapshot_writer;
+    if (writer->failed || writer->written_count == 0 || writer->written_count + writer->skipped_count != TESTS_SAMPLES) {
+      fprintf(stderr, "[ERROR] [TESTS] Expected one snapshot written or skipped per sample!\n");
+      passed = false;
+    }
+    if (memcmp(plain, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] Writing snapshots changed the final image!\n");
+      passed = false;
+    }
+
+    snapshot_writer_destroy(camera->snapshot_writer);
+    camera->snapshot_writer = NULL;
+  }
+
+  remove(TESTS_SNAPSHOT_PATH);
+  free(plain);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// frame 6 of turntable.scene is one second in, halfway through the sphere's rise, and has to render exactly like the
+// scene with that pose set by hand
+static bool test_animation_frames() {
+  World world = world_create();
+  World posed = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* first_frame = (Color*) malloc(framebuffer_size);
+  bool passed = (first_frame != NULL) && tests_load_scene(&world, camera, "turntable.scene", 0) && world.animation != NULL;
+
+  if (passed) {
+    animation_apply(world.animation, &world, camera, 0.0f);
+    camera_render_export(camera, &world);
+    memcpy(first_frame, camera->framebuffer, framebuffer_size);
+
+    u32 moved_count = animation_apply(world.animation, &world, camera, 6.0f / world.animation->frame_rate);
+    Vector3 position = *world.hittables[0]->position;
+    if (moved_count != 1 || position.x != -3.0f || position.y != 1.0f || position.z != 0.0f || camera->focal_length != 1.25f) {
+      fprintf(stderr, "[ERROR] [TESTS] Frame 6 did not move the sphere to its interpolated position!\n");
+      passed = false;
+    }
+  }
+
+  if (passed) {
+    camera_render_export(camera, &world);
+    if (memcmp(first_frame, camera->framebuffer, framebuffer_size) == 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The animated frames rendered the same image!\n");
+      passed = false;
+    }
+    memcpy(first_frame, camera->framebuffer, framebuffer_size);
+
+    Vector3 camera_position = camera->position;
+    passed = passed && tests_load_scene(&posed, camera, "turntable.scene", 0);
+    camera->position = camera_position;
+  }
+
+  if (passed) {
+    *posed.hittables[0]->position = (Vector3) { -3.0f, 1.0f, 0.0f };
+    camera_render_export(camera, &posed);
+    if (memcmp(first_frame, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The animated frame differs from the scene posed by hand!\n");
+      passed = false;
+    }
+  }
+
+  free(first_frame);
+  camera_destroy(camera);
+  world_destroy(&posed);
+  world_destroy(&world);
+  return passed;
+}
+
+static bool tests_copy_file(const char* source, const char* destination) {
+  FILE* input = fopen(source, "rb");
+  FILE* output = fopen(destination, "wb");
+  bool copied = (input && output);
+
+  u8 buffer[4096];
+  usize read;
+  while (copied && (read = fread(buffer, 1, sizeof(buffer), input)) > 0) {
+    copied = (fwrite(buffer, 1, read, output) == read);
+  }
+
+  if (input) { fclose(input); }
+  if (output && fclose(output) != 0) { copied = false; }
+  return copied;
+}
+
+// many copies of one file all borrow the first one's pixels, and after every other one is gone the rest are
+// still found by their paths, so removing entries from the tables never hides the ones after them
+static bool tests_texture_cache_copies(TextureImageCacheStats start) {
+  TextureImage* copies[TESTS_TEXTURE_COPIES] = {0};
+  char path[TESTS_PATH_LENGTH];
+
+  u8 pixels[4 * 4 * 3];
+  for (u32 i = 0; i < sizeof(pixels); i++) { pixels[i] = (u8) (i * 17); }
+  snprintf(path, sizeof(path), TESTS_TEXTURE_COPIES_PATH, 0);
+  bool passed = stbi_write_tga(path, 4, 4, 3, pixels) != 0;
+
+  char first_path[TESTS_PATH_LENGTH];
+  memcpy(first_path, path, sizeof(path));
+  for (u32 i = 0; i < TESTS_TEXTURE_COPIES && passed; i++) {
+    snprintf(path, sizeof(path), TESTS_TEXTURE_COPIES_PATH, i);
+    passed = (i == 0 || tests_copy_file(first_path, path)) && (copies[i] = texture_image_create(path)) != NULL;
+    if (passed && i > 0 && copies[i]->pixels_owner != copies[0]) {
+      fprintf(stderr, "[ERROR] [TESTS] Copy %u of the file did not borrow the decoded pixels!\n", i);
+      passed = false;
+    }
+  }
+
+  for (u32 i = 1; i < TESTS_TEXTURE_COPIES && passed; i += 2) {
+    texture_image_destroy(copies[i]);
+    copies[i] = NULL;
+  }
+
+  for (u32 i = 0; i < TESTS_TEXTURE_COPIES && passed; i += 2) {
+    snprintf(path, sizeof(path), TESTS_TEXTURE_COPIES_PATH, i);
+    TextureImage* image = texture_image_create(path);
+    if (image != copies[i]) {
+      fprintf(stderr, "[ERROR] [TESTS] Copy %u was not found by its path after other entries were removed!\n", i);
+      passed = false;
+    }
+    if (image) { texture_image_destroy(image); }
+  }
+
+  for (u32 i = 0; i < TESTS_TEXTURE_COPIES; i++) {
+    if (copies[i]) { texture_image_destroy(copies[i]); }
+    snprintf(path, sizeof(path), TESTS_TEXTURE_COPIES_PATH, i);
+    remove(path);
+  }
+
+  if (passed && texture_image_cache_get_stats().entries != start.entries) {
+    fprintf(stderr, "[ERROR] [TESTS] Destroying every copy left images in the cache!\n");
+    passed = false;
+  }
+
+  return passed;
+}
+
+// a second name for a path shares the image, a copy of the file shares its pixels and holds the original alive,
+// retaining keeps an unused image decoded and a file that fell back to the placeholder is never cached
+static bool test_texture_cache() {
+  TextureImageCacheStats start = texture_image_cache_get_stats();
+  TextureImage* images[3] = {0};
+  bool passed = tests_copy_file(TESTS_TEXTURE_PATH, TESTS_TEXTURE_COPY_PATH);
+
+  if (passed) {
+    images[0] = texture_image_create(TESTS_TEXTURE_PATH);
+    images[1] = texture_image_create("../assets/../assets/texture.jpg");
+    images[2] = texture_image_create(TESTS_TEXTURE_COPY_PATH);
+    passed = images[0] && images[1] && images[2];
+  }
+
+  if (passed) {
+    TextureImageCacheStats stats = texture_image_cache_get_stats();
+    if (images[1] != images[0] || stats.path_hits != start.path_hits + 1 || stats.decodes != start.decodes + 1) {
+      fprintf(stderr, "[ERROR] [TESTS] A second name for the same path did not share the image!\n");
+      passed = false;
+    }
+    if (images[2] == images[0] || images[2]->pixels_owner != images[0] || images[2]->pixels != images[0]->pixels || stats.content_hits != start.content_hits + 1) {
+      fprintf(stderr, "[ERROR] [TESTS] A copy of the file did not borrow the decoded pixels!\n");
+      passed = false;
+    }
+  }
+
+  if (passed) {
+    // the copy's reference keeps the original decoded and cached after every material using it is gone
+    texture_image_destroy(images[0]);
+    texture_image_destroy(images[1]);
+    images[0] = images[1] = NULL;
+
+    TextureImage* reloaded = texture_image_create(TESTS_TEXTURE_PATH);
+    TextureImageCacheStats stats = texture_image_cache_get_stats();
+    if (!reloaded || reloaded != images[2]->pixels_owner || stats.decodes != start.decodes + 1) {
+      fprintf(stderr, "[ERROR] [TESTS] The borrowed pixels did not keep their owner alive!\n");
+      passed = false;
+    }
+    if (reloaded) { texture_image_destroy(reloaded); }
+
+    texture_image_destroy(images[2]);
+    images[2] = NULL;
+    if (texture_image_cache_get_stats().entries != start.entries) {
+      fprintf(stderr, "[ERROR] [TESTS] Destroying the last reference left images in the cache!\n");
+      passed = false;
+    }
+  }
+
+  if (passed) {
+    texture_image_cache_retain(true);
+    TextureImage* image = texture_image_create(TESTS_TEXTURE_PATH);
+    if (image) { texture_image_destroy(image); }
+
+    TextureImageCacheStats retained = texture_image_cache_get_stats();
+    image = texture_image_create(TESTS_TEXTURE_PATH);
+    if (image) { texture_image_destroy(image); }
+    texture_image_cache_retain(false);
+
+    TextureImageCacheStats stats = texture_image_cache_get_stats();
+    if (!image || retained.entries != start.entries + 1 || stats.decodes != retained.decodes || stats.entries != start.entries) {
+      fprintf(stderr, "[ERROR] [TESTS] Retaining did not keep the unused image decoded until it was turned off!\n");
+      passed = false;
+    }
+  }
+
+  if (passed) {
+    remove(TESTS_TEXTURE_MISSING_PATH);
+    texture_image_cache_retain(true);
+    TextureImage* image = texture_image_create(TESTS_TEXTURE_MISSING_PATH);
+    TextureImageCacheStats stats = texture_image_cache_get_stats();
+    if (image) { texture_image_destroy(image); }
+    texture_image_cache_retain(false);
+
+    if (!image || stats.entries != start.entries) {
+      fprintf(stderr, "[ERROR] [TESTS] A missing image was cached with the placeholder!\n");
+      passed = false;
+    }
+  }
+
+  for (u32 i = 0; i < 3; i++) {
+    if (images[i]) { texture_image_destroy(images[i]); }
+  }
+  remove(TESTS_TEXTURE_COPY_PATH);
+
+  return passed && tests_texture_cache_copies(start);
+}
+
+// removes every file in the directory and the directory itself, or only cuts every file in half when truncate is set
+static void tests_clear_directory(const char* directory, bool truncate_files) {
+  DIR* entries = opendir(directory);
+  if (!entries) { return; }
+
+  struct dirent* entry;
+  while ((entry = readdir(entries)) != NULL) {
+    if (entry->d_name[0] == '.') { continue; }
+
+    char path[TESTS_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+
+    struct stat file_stat;
+    if (!truncate_files) {
+      remove(path);
+    } else if (stat(path, &file_stat) == 0 && truncate(path, file_stat.st_size / 2) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] Failed to truncate %s!\n", path);
+    }
+  }
+
+  closedir(entries);
+  if (!truncate_files) { remove(directory); }
+}
+
+// a texture with no two pages alike, so a page read for the wrong place cannot go unnoticed
+static bool tests_write_noise_texture(const char* path) {
+  u8* pixels = (u8*) malloc((usize) TESTS_TEXTURE_SIZE * TESTS_TEXTURE_SIZE * 3);
+  if (!pixels) { return false; }
+
+  u64 state = random_state_create(0, 0, 0, TESTS_SEED);
+  for (usize i = 0; i < (usize) TESTS_TEXTURE_SIZE * TESTS_TEXTURE_SIZE * 3; i++) {
+    pixels[i] = (u8) (random_f32(&state) * 255.0f);
+  }
+
+  bool written = stbi_write_tga(path, TESTS_TEXTURE_SIZE, TESTS_TEXTURE_SIZE, 3, pixels) != 0;
+  free(pixels);
+  return written;
+}
+
+// a plane close enough that the camera sees the finest levels of its texture
+static void tests_texture_world(World* world, Camera* camera) {
+  Material* material = (Material*) material_diffuse_create((Texture*) texture_image_create(TESTS_TEXTURE_NOISE_PATH));
+  world_add(world, (Hittable*) hittable_plane_create((Vector3) {0}, (Vector3) { 0.0f, 0.0f, 1.0f }, (Vector2) { 1.0f, 1.0f }, material));
+
+  camera->position = (Vector3) { 0.0f, 0.0f, TESTS_TEXTURE_DISTANCE };
+  camera->seed = TESTS_SEED;
+  camera->sample_limit = 1;
+}
+
+// with waiting on, paging through a budget far smaller than the texture must not change a single bit
+static bool test_virtual_texture_render() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH * 4, TESTS_HEIGHT * 4);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * camera->width * camera->height;
+  Color* in_memory = (Color*) malloc(framebuffer_size);
+  bool passed = (in_memory != NULL) && tests_write_noise_texture(TESTS_TEXTURE_NOISE_PATH);
+
+  if (passed) {
+    tests_texture_world(&world, camera);
+    camera_render_export(camera, &world);
+    memcpy(in_memory, camera->framebuffer, framebuffer_size);
+    world_destroy(&world);
+    world = world_create();
+
+    tests_clear_directory(TESTS_TEXTURE_CACHE_DIRECTORY, false);
+    VirtualTextureOptions options = virtual_texture_options_default();
+    options.cache_directory = TESTS_TEXTURE_CACHE_DIRECTORY;
+    options.budget_bytes = TESTS_TEXTURE_PAGES * VIRTUAL_TEXTURE_PAGE_SIZE;
+    options.wait = true;
+    passed = virtual_texture_pager_start(&options);
+  }
+
+  if (passed) {
+    VirtualTextureStats start = virtual_texture_get_stats();
+    tests_texture_world(&world, camera);
+    camera_render_export(camera, &world);
+    if (memcmp(in_memory, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] Paged textures rendered differently from the in memory ones!\n");
+      passed = false;
+    }
+
+    VirtualTextureStats stats = virtual_texture_get_stats();
+    printf("[INFO] [TESTS] virtual_texture_render: %llu hits, %llu misses, %llu evictions\n", (unsigned long long) (stats.hits - start.hits),
+      (unsigned long long) (stats.misses - start.misses), (unsigned long long) (stats.evictions - start.evictions));
+    if (stats.evictions == start.evictions || stats.hits == start.hits) {
+      fprintf(stderr, "[ERROR] [TESTS] The render did not page through the texture budget!\n");
+      passed = false;
+    }
+
+    // a truncated cache file must be written again instead of having its missing pages read as texels
+    world_destroy(&world);
+    world = world_create();
+    tests_clear_directory(TESTS_TEXTURE_CACHE_DIRECTORY, true);
+    tests_texture_world(&world, camera);
+    camera_render_export(camera, &world);
+    if (memcmp(in_memory, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] A truncated texture cache file changed the render!\n");
+      passed = false;
+    }
+
+    // the pager only stops once every virtual texture is closed
+    world_destroy(&world);
+    world = world_create();
+    virtual_texture_pager_stop();
+    tests_clear_directory(TESTS_TEXTURE_CACHE_DIRECTORY, false);
+  }
+
+  remove(TESTS_TEXTURE_NOISE_PATH);
+  free(in_memory);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+typedef struct TestsBuffer {
+  u8* data;
+  usize size, capacity;
+} TestsBuffer;
+
+// stb_image_write output callback
+static void tests_buffer_append(void* context, void* data, int size) {
+  TestsBuffer* buffer = (TestsBuffer*) context;
+  if (buffer->size + size > buffer->capacity) {
+    usize capacity = (buffer->capacity > 0) ? buffer->capacity : 4096;
+    while (buffer->size + size > capacity) { capacity *= 2; }
+
+    u8* temp = (u8*) realloc(buffer->data, capacity);
+    if (!temp) { return; }
+    buffer->data = temp;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(&buffer->data[buffer->size], data, size);
+  buffer->size += size;
+}
+
+static bool tests_read_file(const char* filename, TestsBuffer* buffer) {
+  FILE* file = fopen(filename, "rb");
+  if (!file) { return false; }
+
+  u8 chunk[4096];
+  usize read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    tests_buffer_append(buffer, chunk, (int) read);
+  }
+
+  fclose(file);
+  return buffer->data != NULL;
+}
+
+// every tile in the offset table has to sit where its coordinates say and inflate to exactly the size of its
+// clipped pixels, tiles stored uncompressed have exactly that size already
+static bool tests_check_exr_tiles(const TestsBuffer* file, u32 channels_count, u32 pixel_size) {
+  usize position = 8;
+  while (position < file->size && file->data[position] != 0) {
+    position += strlen((const char*) &file->data[position]) + 1;
+    position += strlen((const char*) &file->data[position]) + 1;
+
+    u32 value_size;
+    memcpy(&value_size, &file->data[position], sizeof(u32));
+    position += sizeof(u32) + value_size;
+  }
+  position++;
+
+  u32 tiles_x = (TESTS_IMAGE_WIDTH + TESTS_EXR_TILE_SIZE - 1) / TESTS_EXR_TILE_SIZE;
+  u32 tiles_y = (TESTS_IMAGE_HEIGHT + TESTS_EXR_TILE_SIZE - 1) / TESTS_EXR_TILE_SIZE;
+  if (position + (usize) tiles_x * tiles_y * sizeof(u64) > file->size) { return false; }
+
+  usize raw_capacity = (usize) TESTS_EXR_TILE_SIZE * TESTS_EXR_TILE_SIZE * channels_count * pixel_size;
+  char* raw = (char*) malloc(raw_capacity + 1);
+  if (!raw) { return false; }
+
+  bool valid = true;
+  for (u32 i = 0; valid && i < tiles_x * tiles_y; i++) {
+    u64 offset;
+    memcpy(&offset, &file->data[position + i * sizeof(u64)], sizeof(u64));
+
+    s32 tile_header[5];
+    valid = (offset + sizeof(tile_header) <= file->size);
+    if (!valid) { break; }
+    memcpy(tile_header, &file->data[offset], sizeof(tile_header));
+
+    u32 tile_x = i % tiles_x, tile_y = i / tiles_x;
+    u32 columns = (TESTS_IMAGE_WIDTH - tile_x * TESTS_EXR_TILE_SIZE < TESTS_EXR_TILE_SIZE) ? TESTS_IMAGE_WIDTH - tile_x * TESTS_EXR_TILE_SIZE : TESTS_EXR_TILE_SIZE;
+    u32 rows = (TESTS_IMAGE_HEIGHT - tile_y * TESTS_EXR_TILE_SIZE < TESTS_EXR_TILE_SIZE) ? TESTS_IMAGE_HEIGHT - tile_y * TESTS_EXR_TILE_SIZE : TESTS_EXR_TILE_SIZE;
+    s32 raw_size = (s32) (columns * rows * channels_count * pixel_size);
+    s32 data_size = tile_header[4];
+
+    valid = tile_header[0] == (s32) tile_x && tile_header[1] == (s32) tile_y && tile_header[2] == 0 && tile_header[3] == 0;
+    valid = valid && data_size > 0 && data_size <= raw_size && offset + sizeof(tile_header) + data_size <= file->size;
+    if (valid && data_size < raw_size) {
+      const char* data = (const char*) &file->data[offset + sizeof(tile_header)];
+      valid = (stbi_zlib_decode_buffer(raw, (int) raw_capacity + 1, data, data_size) == raw_size);
+    }
+
+    if (!valid) { fprintf(stderr, "[ERROR] [TESTS] EXR tile %u, %u is broken!\n", tile_x, tile_y); }
+  }
+
+  free(raw);
+  return valid;
+}
+
+// the banded writers against what stb_image_write makes of the whole image at once, which is what they replaced
+static bool test_image_writers() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_IMAGE_WIDTH, TESTS_IMAGE_HEIGHT);
+  if (!camera) { return false; }
+
+  usize pixels_count = (usize) TESTS_IMAGE_WIDTH * TESTS_IMAGE_HEIGHT;
+  Color* radiance = (Color*) malloc(sizeof(Color) * pixels_count);
+  ColorRGB* rgb = (ColorRGB*) malloc(sizeof(ColorRGB) * pixels_count);
+  TestsBuffer expected = {0}, written = {0};
+  u8* decoded = NULL;
+  u8* expected_decoded = NULL;
+
+  bool passed = radiance && rgb && tests_load_scene(&world, camera, "test.scene", 0);
+  if (passed) {
+    camera->sample_limit = TESTS_IMAGE_SAMPLES;
+    camera_render_export(camera, &world);
+
+    // top row first, as every format stores it
+    for (u32 y = 0; y < TESTS_IMAGE_HEIGHT; y++) {
+      for (u32 x = 0; x < TESTS_IMAGE_WIDTH; x++) {
+        usize i = (usize) y * TESTS_IMAGE_WIDTH + x;
+        radiance[i] = color_scale(camera->framebuffer[(usize) (TESTS_IMAGE_HEIGHT - 1 - y) * TESTS_IMAGE_WIDTH + x], 1.0f / camera->sample_count);
+        rgb[i] = tonemapping(camera->tonemapping_operator, radiance[i]);
+      }
+    }
+  }
+
+  if (passed) {
+    stbi_flip_vertically_on_write(false);
+    passed = stbi_write_hdr_to_func(tests_buffer_append, &expected, TESTS_IMAGE_WIDTH, TESTS_IMAGE_HEIGHT, 3, (f32*) radiance);
+    passed = passed && image_create_hdr(TESTS_IMAGE_PATH ".hdr", camera) && tests_read_file(TESTS_IMAGE_PATH ".hdr", &written);
+
+    if (passed && (written.size != expected.size || memcmp(written.data, expected.data, expected.size) != 0)) {
+      fprintf(stderr, "[ERROR] [TESTS] The banded .hdr is not byte identical to the single shot one!\n");
+      passed = false;
+    }
+  }
+
+  s32 width = 0, height = 0;
+  if (passed) {
+    stbi_set_flip_vertically_on_load(false);
+    passed = image_create_png(TESTS_IMAGE_PATH ".png", camera);
+    decoded = passed ? stbi_load(TESTS_IMAGE_PATH ".png", &width, &height, NULL, 3) : NULL;
+
+    if (!decoded || width != TESTS_IMAGE_WIDTH || height != TESTS_IMAGE_HEIGHT || memcmp(decoded, rgb, sizeof(ColorRGB) * pixels_count) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The .png does not decode to the framebuffer!\n");
+      passed = false;
+    }
+  }
+
+  if (passed) {
+    expected.size = 0;
+    stbi_image_free(decoded);
+    passed = stbi_write_jpg_to_func(tests_buffer_append, &expected, TESTS_IMAGE_WIDTH, TESTS_IMAGE_HEIGHT, 3, rgb, 100) && image_create_jpg(TESTS_IMAGE_PATH ".jpg", camera);
+    decoded = passed ? stbi_load(TESTS_IMAGE_PATH ".jpg", &width, &height, NULL, 3) : NULL;
+    expected_decoded = passed ? stbi_load_from_memory(expected.data, (int) expected.size, &width, &height, NULL, 3) : NULL;
+
+    s32 max_error = 0;
+    for (usize i = 0; decoded && expected_decoded && i < pixels_count * 3; i++) {
+      s32 error = abs((s32) decoded[i] - (s32) expected_decoded[i]);
+      if (error > max_error) { max_error = error; }
+    }
+
+    if (!decoded || !expected_decoded || max_error > TESTS_MAX_JPG_ERROR) {
+      fprintf(stderr, "[ERROR] [TESTS] The banded .jpg decodes differently from a single stb_image_write encode, off by up to %d!\n", max_error);
+      passed = false;
+    }
+  }
+
+  const ImageOptions exr_options[] = { { .exr_float = false, .exr_aovs = false }, { .exr_float = true, .exr_aovs = true } };
+  for (usize i = 0; passed && i < (sizeof(exr_options) / sizeof(ImageOptions)); i++) {
+    ImageOptions options = exr_options[i];
+    written.size = 0;
+    passed = image_create_exr(TESTS_IMAGE_PATH ".exr", camera, &options) && tests_read_file(TESTS_IMAGE_PATH ".exr", &written);
+    passed = passed && tests_check_exr_tiles(&written, options.exr_aovs ? 9 : 3, options.exr_float ? sizeof(f32) : sizeof(u16));
+  }
+
+  remove(TESTS_IMAGE_PATH ".hdr");
+  remove(TESTS_IMAGE_PATH ".png");
+  remove(TESTS_IMAGE_PATH ".jpg");
+  remove(TESTS_IMAGE_PATH ".exr");
+  stbi_image_free(decoded);
+  stbi_image_free(expected_decoded);
+  free(expected.data);
+  free(written.data);
+  free(rgb);
+  free(radiance);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+// throttled, the loader hands the spheres over in three chunks that each restart the export, which still has to end
+// with exactly the image of the scene loaded up front
+static bool test_scene_stream() {
+  World world = world_create();
+  Camera* camera = camera_create(TESTS_WIDTH, TESTS_HEIGHT);
+  if (!camera) { return false; }
+
+  usize framebuffer_size = sizeof(Color) * TESTS_WIDTH * TESTS_HEIGHT;
+  Color* blocking = (Color*) malloc(framebuffer_size);
+  bool passed = (blocking != NULL) && tests_load_scene(&world, camera, NULL, TESTS_STREAM_SPHERES);
+
+  u32 hittables_count = world.hittables_count;
+  if (passed) {
+    world_scene_save(&world, camera, TESTS_STREAM_SCENE_PATH);
+    camera_render_export(camera, &world);
+    memcpy(blocking, camera->framebuffer, framebuffer_size);
+
+    world_destroy(&world);
+    world = world_create();
+    camera_clear_framebuffer(camera);
+
+    SceneStreamOptions options = scene_stream_options_default();
+    options.first_chunk = TESTS_STREAM_FIRST_CHUNK;
+    options.throttle = true;
+    camera->scene_stream = scene_stream_start(TESTS_STREAM_SCENE_PATH, &options);
+    passed = (camera->scene_stream != NULL);
+  }
+
+  if (passed) {
+    scene_stream_wait_camera(camera->scene_stream, camera);
+    camera->seed = TESTS_SEED;
+    camera_render_export(camera, &world);
+
+    SceneStreamProgress progress = scene_stream_get_progress(camera->scene_stream);
+    if (progress.failed || memcmp(blocking, camera->framebuffer, framebuffer_size) != 0) {
+      fprintf(stderr, "[ERROR] [TESTS] The streamed scene rendered differently from the blocking load!\n");
+      passed = false;
+    }
+    if (progress.chunks_added < 3 || progress.hittables_added != hittables_count) {
+      fprintf(stderr, "[ERROR] [TESTS] The scene was added in %u chunks with %u hittables instead of streamed in three!\n", progress.chunks_added, progress.hittables_added);
+      passed = false;
+    }
+
+    scene_stream_destroy(camera->scene_stream);
+    camera->scene_stream = NULL;
+  }
+
+  remove(TESTS_STREAM_SCENE_PATH);
+  free(blocking);
+  camera_destroy(camera);
+  world_destroy(&world);
+  return passed;
+}
+
+static const Test tests[] = {
+  { "references", test_references },
+  { "thread_determinism", test_thread_determinism },
+  { "sample_ranges", test_sample_ranges },
+  { "distributed_render", test_distributed_render },
+  { "world_snapshots", test_world_snapshots },
+  { "binary_scene", test_binary_scene },
+  { "checkpoint_resume", test_checkpoint_resume },
+  { "snapshot_render", test_snapshot_render },
+  { "animation_frames", test_animation_frames },
+  { "texture_cache", test_texture_cache },
+  { "virtual_texture_render", test_virtual_texture_render },
+  { "image_writers", test_image_writers },
+  { "scene_stream", test_scene_stream }
+};
+
+// runs the named tests, or all of them without arguments
+int main(int argc, char** argv) {
+  bool passed = true;
+
+  for (usize i = 0; i < (sizeof(tests) / sizeof(Test)); i++) {
+    bool selected = (argc == 1);
+    for (s32 j = 1; j < argc; j++) {
+      if (strcmp(argv[j], tests[i].name) == 0) { selected = true; }
+    }
+    if (!selected) { continue; }
+
+    bool result = tests[i].run();
+    printf("[INFO] [TESTS] %s: %s\n", tests[i].name, result ? "passed" : "FAILED");
+    passed = passed && result;
+  }
+
+  thread_pool_global_destroy();
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}